@@ -1,9 +1,10 @@
 # This file is generated using Digistring's completions generator
 function _generate_digistring_compl() {
     local cur=${COMP_WORDS[COMP_CWORD]}
-    local ALL_FLAGS="-f -h -n -o -p -r -s --audio --audio_in --audio_out --experiment --experiments --file --gen-completions --help --midi --output --over --perf --rsc --slow --sync --synth --synths"
+    local ALL_FLAGS="-f -h -n -o -p -r -s --audio --audio_in --audio_out --estimator --estimators --experiment --experiments --file --gen-completions --help --midi --output --over --perf --play_note_event_file --rsc --slow --sync --synth --synths"
     local ALL_EXPERIMENTS="frame_size_limit optimize_xqifft qifft"
-    local ALL_SYNTHS="sine sine_amped square"
+    local ALL_SYNTHS="sine sine_amped sine_poly square"
+    local ALL_ESTIMATORS="basic_fourier highres sliding_highres tuned"
 
     if (( $COMP_CWORD - 1 >= 1 )); then
         case ${COMP_WORDS[COMP_CWORD - 1]} in
@@ -101,6 +102,11 @@ function _generate_digistring_compl() {
                     COMPREPLY=(${cur})
                 fi
                 return 0;;
+            --estimator)
+                COMPREPLY=($(compgen -W "$ALL_ESTIMATORS" -- $cur))
+                return 0;;
+            --estimators)
+                return 0;;
             --experiment)
                 COMPREPLY=($(compgen -W "$ALL_EXPERIMENTS" -- $cur))
                 return 0;;
@@ -152,6 +158,9 @@ function _generate_digistring_compl() {
                     COMPREPLY=($(compgen -A file -- $cur))
                 fi
                 return 0;;
+            --play_note_event_file)
+                COMPREPLY=($(compgen -A file -- $cur))
+                return 0;;
             --rsc)
                 COMPREPLY=($(compgen -A directory -- $cur))
                 return 0;;
@@ -220,6 +229,9 @@ function _generate_digistring_compl() {
                     IFS="$OLD_IFS"
                 fi
                 return 0;;
+            --play_note_event_file)
+                COMPREPLY=($(compgen -W "$ALL_SYNTHS" -- $cur))
+                return 0;;
             --synth)
                 if [[ ${#cur} == 0 ]]; then
                     OLD_IFS="$IFS"
@@ -245,6 +257,16 @@ function _generate_digistring_compl() {
             --over)
                 COMPREPLY=($(compgen -W "midi_on midi_off" -- $cur))
                 return 0;;
+            --play_note_event_file)
+                if [[ ${#cur} == 0 ]]; then
+                    OLD_IFS="$IFS"
+                    IFS=$'\n'
+                    COMPREPLY=($(compgen -W "Please enter a playback device name (as printed by Digistring at start-up) or nothing for default playback device${IFS}..." -- ""))
+                    IFS="$OLD_IFS"
+                else
+                    COMPREPLY=(${cur})
+                fi
+                return 0;;
         esac
     fi
 
@@ -252,6 +274,8 @@ function _generate_digistring_compl() {
         case ${COMP_WORDS[COMP_CWORD - 4]} in
             --over)
                 return 0;;
+            --play_note_event_file)
+                return 0;;
         esac
     fi
 
@@ -0,0 +1,301 @@
+#include "batch_transcriber.h"
+
+#include "program.h"  // Program::adjust_events(), Program::write_result_header(), Program::write_results()
+#include "results_file.h"
+#include "worker_pool.h"
+#include "quit.h"
+#include "error.h"
+
+#include "estimators/estimators.h"
+#include "sample_getter/audio_file.h"
+
+#include "config/batch.h"
+#include "config/cli_args.h"
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+
+#include <omp.h>  // omp_get_num_procs()
+
+#include <algorithm>  // std::sort(), std::transform(), std::clamp()
+#include <cctype>  // std::tolower()
+#include <chrono>
+#include <cstring>  // memcpy()
+#include <filesystem>
+#include <fstream>  // Reading file lists
+#include <set>
+#include <stdexcept>  // std::runtime_error
+#include <string>
+#include <system_error>  // std::error_code
+#include <thread>
+#include <vector>
+
+#include <sstream>  // This and iomanip are for double->string formatting
+#include <iomanip>
+
+
+BatchTranscriber::BatchTranscriber(const std::string &input, const std::string &output_dir, const int n_workers) {
+    if constexpr(DO_OVERLAP_NONBLOCK) {
+        error("Can't perform nonblocking overlap on samples getters which do not block (audio recording devices)");
+        hint("Enable normal overlapping instead in config/transcription.h for batch transcription");
+        exit(EXIT_FAILURE);
+    }
+
+    next_file = 0;
+    n_transcribed = 0;
+    transcribed_samples = 0;
+
+    collect_files(input, output_dir);
+    if(files.empty())
+        return;
+
+    // No more workers than files, as every worker transcribes whole files
+    const int n = std::clamp(n_workers > 0 ? n_workers : omp_get_num_procs(), 1, (int)files.size());
+
+    // Files are transcribed in parallel instead of frames, so the estimators shouldn't start their own threads
+    set_worker_pool_thread_limit(BATCH_WORKER_POOL_THREADS);
+
+    // Estimators are created here, as creating them isn't thread-safe (pre-calculations are shared)
+    workers.resize(n);
+    for(Worker &worker : workers) {
+        worker.estimator_buffer = NULL;
+        worker.estimator_buffer_n_samples = -1;
+        worker.estimator = estimator_factory(cli_args.estimator_type, worker.estimator_buffer, worker.estimator_buffer_n_samples);
+        if(worker.estimator_buffer == NULL) {
+            error("Estimator did not create an input buffer");
+            exit(EXIT_FAILURE);
+        }
+        if(worker.estimator_buffer_n_samples == -1) {
+            error("Estimator did not set number of samples in input buffer");
+            exit(EXIT_FAILURE);
+        }
+
+        worker.decimator = nullptr;
+        worker.frame_n_samples = worker.estimator_buffer_n_samples;
+        if(params.decimation_factor > 1) {
+            worker.decimator = new Decimator(params.decimation_factor, worker.estimator_buffer_n_samples);
+            worker.frame_n_samples = worker.decimator->get_in_size();
+        }
+
+        worker.note_events.reserve(MAX_NOTE_EVENTS_PER_FRAME);
+    }
+}
+
+BatchTranscriber::~BatchTranscriber() {
+    for(Worker &worker : workers) {
+        delete worker.decimator;
+        delete worker.estimator;
+    }
+}
+
+
+void BatchTranscriber::collect_files(const std::string &input, const std::string &output_dir) {
+    std::vector<std::filesystem::path> wav_files;
+    if(std::filesystem::is_directory(input)) {
+        for(const auto &entry : std::filesystem::directory_iterator(input)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](const unsigned char c) {return std::tolower(c);});
+            if(entry.is_regular_file() && extension == BATCH_INPUT_EXTENSION)
+                wav_files.push_back(entry.path());
+        }
+
+        // Directory order is arbitrary
+        std::sort(wav_files.begin(), wav_files.end());
+    }
+    else {
+        std::ifstream file_list(input);
+        if(!file_list.is_open()) {
+            error("Failed to open batch file list '" + input + "'");
+            exit(EXIT_FAILURE);
+        }
+
+        // One file per line; empty lines and lines starting with '#' are skipped
+        std::string line;
+        while(std::getline(file_list, line)) {
+            if(!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if(line.empty() || line[0] == '#')
+                continue;
+
+            if(!std::filesystem::is_regular_file(line)) {
+                error("File '" + line + "' in batch file list '" + input + "' does not exist");
+                exit(EXIT_FAILURE);
+            }
+            wav_files.push_back(line);
+        }
+    }
+
+    if(wav_files.empty()) {
+        warning("No WAV files found in '" + input + "'");
+        return;
+    }
+
+    std::set<std::filesystem::path> outputs;
+    int n_skipped = 0;
+    for(const auto &wav_file : wav_files) {
+        const std::filesystem::path dir = output_dir.empty() ? wav_file.parent_path() : std::filesystem::path(output_dir);
+        const std::filesystem::path output = (dir / wav_file.stem()).lexically_normal().string() + BATCH_OUTPUT_EXTENSION;
+
+        if(!outputs.insert(output).second) {
+            error("Multiple WAV files would write their results to '" + output.string() + "' (second is '" + wav_file.string() + "')");
+            hint("Give WAV files in the same output directory different names");
+            exit(EXIT_FAILURE);
+        }
+
+        if(std::filesystem::exists(output)) {
+            n_skipped++;
+            continue;
+        }
+
+        files.push_back({wav_file.string(), output.string()});
+    }
+
+    if(n_skipped > 0)
+        info("Skipping " + STR(n_skipped) + " of " + STR(wav_files.size()) + " file(s), as their results file already exists");
+}
+
+
+bool BatchTranscriber::run() {
+    if(files.empty()) {
+        info("Nothing to transcribe");
+        return true;
+    }
+
+    info("Transcribing " + STR(files.size()) + " file(s) with " + STR(workers.size()) + " worker(s)...");
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for(Worker &worker : workers)
+        threads.emplace_back(&BatchTranscriber::worker_loop, this, std::ref(worker));
+    for(auto &thread : threads)
+        thread.join();
+    const std::chrono::duration<double> batch_time = std::chrono::steady_clock::now() - start;
+
+    const double audio_time = (double)transcribed_samples / (double)params.sample_rate;
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3)
+       << "Transcribed " << n_transcribed << " of " << files.size() << " file(s) (" << audio_time << " s of audio) in " << batch_time.count() << " s; "
+       << audio_time / batch_time.count() << " times real-time";
+    info(ss.str());
+
+    if(!failed_files.empty()) {
+        std::string failed_list;
+        for(const std::string &file : failed_files)
+            failed_list += "\n  - " + file;
+        error(STR(failed_files.size()) + " file(s) failed to transcribe:" + failed_list);
+    }
+
+    if(n_transcribed + (int)failed_files.size() < (int)files.size())
+        info("Remaining files are transcribed when starting this batch again");
+
+    return failed_files.empty();
+}
+
+
+void BatchTranscriber::worker_loop(Worker &worker) {
+    while(!poll_quit()) {
+        const int i = next_file++;
+        if(i >= (int)files.size())
+            break;
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        long n_samples;
+        try {
+            n_samples = transcribe_file(worker, files[i]);
+        }
+        catch(const AudioFileError &e) {
+            fail_file(files[i], e.what(), e.get_hint());
+            continue;
+        }
+        catch(const std::runtime_error &e) {
+            fail_file(files[i], e.what(), "");
+            continue;
+        }
+        if(n_samples < 0)
+            break;
+        const std::chrono::duration<double> file_time = std::chrono::steady_clock::now() - start;
+
+        transcribed_samples += n_samples;
+        const int n_done = ++n_transcribed;
+
+        const double audio_time = (double)n_samples / (double)params.sample_rate;
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3)
+           << '[' << n_done << '/' << files.size() << "] " << files[i].input << " (" << audio_time << " s; " << audio_time / file_time.count() << " times real-time)";
+
+        const std::lock_guard<std::mutex> lock(print_mutex);
+        info(ss.str());
+    }
+}
+
+
+long BatchTranscriber::transcribe_file(Worker &worker, const BatchFile &file) {
+    AudioFile audio_file(worker.frame_n_samples, file.input, false);
+
+    // The worker's estimator was used for other files, so its first frames shouldn't depend on the end of the previous file
+    worker.estimator->reset();
+    const std::string partial_output = file.output + BATCH_PARTIAL_SUFFIX;
+
+    // Same frames and results as the main loop of Program when playing a file
+    long processed_samples = 0;
+    {
+        ResultsFile results_file(partial_output);
+        Program::write_result_header(results_file, worker.frame_n_samples, worker.estimator_buffer_n_samples, worker.decimator != nullptr);
+        results_file.start_array("note events");
+
+        while(!audio_file.has_ended()) {
+            if(poll_quit())
+                break;
+
+            const int new_samples = audio_file.next_frame(worker.frame_n_samples);
+            const float *const frame = audio_file.get_frame_view(worker.frame_n_samples);
+            processed_samples += new_samples;
+
+            // The estimator works in place on its own input buffer
+            if(worker.decimator != nullptr)
+                worker.decimator->decimate(frame, worker.estimator_buffer);
+            else
+                memcpy(worker.estimator_buffer, frame, worker.estimator_buffer_n_samples * sizeof(float));
+
+            worker.note_events.clear();
+            worker.estimator->perform(worker.estimator_buffer, worker.note_events);
+            if(worker.decimator != nullptr)
+                worker.decimator->scale_events(worker.note_events);
+            if(new_samples < worker.frame_n_samples)
+                Program::adjust_events(worker.note_events, worker.frame_n_samples, new_samples);
+
+            Program::write_results(results_file, worker.note_events, audio_file.get_played_samples() - new_samples);
+        }
+
+        // Write silent note event to explicitly stop the last note
+        Program::write_results(results_file, NoteEvents(), audio_file.get_played_samples());
+        results_file.stop_array();
+
+        if(!results_file.close())
+            throw(std::runtime_error("Failed to write results file '" + partial_output + "'"));
+    }
+
+    std::error_code ec;
+    if(!audio_file.has_ended()) {
+        std::filesystem::remove(partial_output, ec);
+        return -1;
+    }
+
+    std::filesystem::rename(partial_output, file.output, ec);
+    if(ec)
+        throw(std::runtime_error("Failed to rename results file '" + partial_output + "' to '" + file.output + "' (" + ec.message() + ")"));
+
+    return processed_samples;
+}
+
+
+void BatchTranscriber::fail_file(const BatchFile &file, const std::string &reason, const std::string &hint_message) {
+    // A results file is only complete after renaming, so no partial results are left behind
+    std::error_code ec;
+    std::filesystem::remove(file.output + BATCH_PARTIAL_SUFFIX, ec);
+
+    const std::lock_guard<std::mutex> lock(print_mutex);
+    error("Failed to transcribe '" + file.input + "'; continuing with the next file\n" + reason);
+    if(!hint_message.empty())
+        hint(hint_message);
+    failed_files.push_back(file.input);
+}
@@ -0,0 +1,83 @@
+#ifndef DIGISTRING_BATCH_TRANSCRIBER_H
+#define DIGISTRING_BATCH_TRANSCRIBER_H
+
+
+#include "note.h"
+#include "estimators/estimator.h"
+#include "sample_getter/decimator.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/* Headless transcription of many WAV files in parallel (--batch)
+ * Every worker thread has its own estimator and transcribes whole files, taking the next file from the shared list
+ * The estimator is reset before every file, so the results of a file don't depend on which files the worker transcribed before
+ * No SDL subsystem is initialized, so batches also run on machines without display or audio devices
+ * The results file of every WAV file is identical to the one written by '--file <WAV file> -o <results file>'
+ * Files which can't be transcribed are reported and skipped, so one bad file doesn't stop the batch
+ */
+class BatchTranscriber {
+    public:
+        // input is a directory of WAV files or a file listing a WAV file per line
+        // Results files are written to output_dir, or next to their WAV file if output_dir is empty
+        // n_workers <= 0 uses one worker per core
+        BatchTranscriber(const std::string &input, const std::string &output_dir, const int n_workers);
+        ~BatchTranscriber();
+
+        // Returns when all files are transcribed or when quitting
+        // Returns false if any file failed to transcribe
+        bool run();
+
+
+    private:
+        struct BatchFile {
+            std::string input;
+            std::string output;
+        };
+
+        struct Worker {
+            Estimator *estimator;
+            float *estimator_buffer;  // Created by the estimator
+            int estimator_buffer_n_samples;
+
+            // Size of the frames read from the WAV files; larger than the estimator buffer if frames are decimated before estimation
+            int frame_n_samples;
+            Decimator *decimator;  // nullptr if not decimating
+
+            // Reused every frame, so the estimator doesn't have to allocate for its results
+            NoteEvents note_events;
+        };
+
+        std::vector<BatchFile> files;
+        std::vector<Worker> workers;
+
+        // Index of the next file to transcribe
+        std::atomic<int> next_file;
+
+        // Totals over all workers
+        std::atomic<int> n_transcribed;
+        std::atomic<long> transcribed_samples;
+
+        // Progress of the workers is printed line by line
+        // Also guards failed_files
+        std::mutex print_mutex;
+        std::vector<std::string> failed_files;
+
+
+        // Fills files from a directory or file list; files which already have results are skipped
+        void collect_files(const std::string &input, const std::string &output_dir);
+
+        void worker_loop(Worker &worker);
+        // Writes the results of file to a partial results file, which is renamed when the whole file is transcribed
+        // Returns the number of transcribed samples, or -1 if quitting interrupted the transcription
+        // Throws an AudioFileError if the WAV file can't be read and a std::runtime_error if the results file can't be stored
+        long transcribe_file(Worker &worker, const BatchFile &file);
+        // Removes the partial results file of a file which failed and logs why it failed
+        void fail_file(const BatchFile &file, const std::string &reason, const std::string &hint_message);
+};
+
+
+#endif  // DIGISTRING_BATCH_TRANSCRIBER_H
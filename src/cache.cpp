@@ -5,16 +5,29 @@
 #include <config/cache.h>
 #include <config/cli_args.h>
 
+#include <fftw3.h>
+
 #include <string>
+#include <mutex>
+#include <functional>  // std::function
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
 #include <sstream>
+#include <iomanip>  // std::setprecision()
+#include <limits>
+#include <cctype>  // std::isalnum()
+#include <cstring>  // std::strerror(), strlen()
+#include <cerrno>
+#include <unistd.h>  // fork(), pipe(), read(), write(), _exit()
+#include <sys/wait.h>  // waitpid()
 
 
 // Is set in init_cache()
 std::string Cache::cache_dir = "";
 
+std::mutex Cache::fftw_planner_mutex;
+
 
 void Cache::init_cache() {
     if(cache_dir != "") {
@@ -46,6 +59,10 @@ void Cache::init_cache() {
         error("Cache path is not a directory; please remove the file at '" + cache_dir + "'");
         exit(EXIT_FAILURE);
     }
+
+    // All plans use the wisdom in memory, so it is only read once
+    const std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+    load_fftw_wisdom();
 }
 
 
@@ -166,3 +183,319 @@ bool Cache::load_dolph_window(float out[], const int size, const double attenuat
 
     return true;
 }
+
+
+std::string Cache::get_constant_q_kernel_filename(const ConstantQKernelConfig &config) {
+    // Copy the const string, as replace() mutates string
+    std::string out = CONSTANT_Q_KERNEL_FILENAME;
+
+    // Put kernel configuration in filename; floating point values with three (threshold six) decimal digits
+    size_t pos = out.find_last_of('%');
+    if(pos == std::string::npos) {
+        error("No '%' in CONSTANT_Q_KERNEL_FILENAME in data cache config");
+        exit(EXIT_FAILURE);
+    }
+
+    std::stringstream ss;
+    ss << config.sample_rate << '_' << config.fft_size << '_'
+       << std::fixed << std::setprecision(3) << config.min_freq << '_'
+       << config.bins_per_octave << '_' << config.n_bins << '_'
+       << config.q << '_' << std::setprecision(6) << config.threshold;
+    out.replace(pos, 1, ss.str());
+
+    return out;
+}
+
+
+void Cache::save_constant_q_kernel(const ConstantQKernel &kernel) {
+    if constexpr(DISABLE_CACHE)
+        return;
+
+    if(cache_dir == "")
+        return;
+
+    const std::string filename = get_constant_q_kernel_filename(kernel.config);
+
+    std::fstream kernel_file(cache_dir + filename, std::ios::out);
+    if(!kernel_file.is_open()) {
+        warning("Failed to open constant-Q kernel cache file '" + filename + "' for writing; not saving to cache");
+        return;
+    }
+
+    // Number of values, followed by every row as its number of values and its (column, real, imaginary) triplets
+    kernel_file << std::setprecision(std::numeric_limits<float>::max_digits10);
+    kernel_file << kernel.columns.size() << '\n';
+    for(int k = 0; k < kernel.config.n_bins; k++) {
+        kernel_file << kernel.row_starts[k + 1] - kernel.row_starts[k] << '\n';
+        for(int i = kernel.row_starts[k]; i < kernel.row_starts[k + 1]; i++)
+            kernel_file << kernel.columns[i] << ' ' << kernel.values_re[i] << ' ' << kernel.values_im[i] << '\n';
+    }
+    kernel_file << std::endl;
+}
+
+
+bool Cache::load_constant_q_kernel(ConstantQKernel &kernel) {
+    if constexpr(DISABLE_CACHE)
+        return false;
+
+    if(cache_dir == "")
+        return false;
+
+    const std::string filename = get_constant_q_kernel_filename(kernel.config);
+    if(!std::filesystem::exists(cache_dir + filename))
+        return false;
+
+    std::fstream kernel_file(cache_dir + filename);
+    if(!kernel_file.is_open()) {
+        warning("Failed to open constant-Q kernel cache file '" + filename + "' for reading");
+        return false;
+    }
+
+    size_t n_values;
+    kernel_file >> n_values;
+    if(!kernel_file) {
+        warning("Constant-Q kernel cache file '" + filename + "' is corrupt; recomputing kernel");
+        return false;
+    }
+
+    kernel.row_starts.assign(1, 0);
+    kernel.columns.resize(n_values);
+    kernel.values_re.resize(n_values);
+    kernel.values_im.resize(n_values);
+    size_t i = 0;
+    for(int k = 0; k < kernel.config.n_bins; k++) {
+        size_t row_size;
+        kernel_file >> row_size;
+        if(!kernel_file || i + row_size > n_values) {
+            warning("Constant-Q kernel cache file '" + filename + "' is corrupt; recomputing kernel");
+            return false;
+        }
+
+        for(const size_t end = i + row_size; i < end; i++) {
+            kernel_file >> kernel.columns[i] >> kernel.values_re[i] >> kernel.values_im[i];
+            if(!kernel_file || kernel.columns[i] < 0 || kernel.columns[i] > kernel.config.fft_size / 2) {
+                warning("Constant-Q kernel cache file '" + filename + "' is corrupt; recomputing kernel");
+                return false;
+            }
+        }
+        kernel.row_starts.push_back(i);
+    }
+
+    if(i != n_values) {
+        warning("Constant-Q kernel cache file '" + filename + "' is corrupt; recomputing kernel");
+        return false;
+    }
+
+    return true;
+}
+
+
+std::string Cache::get_fftw_wisdom_filename() {
+    // Copy the const string, as replace() mutates string
+    std::string out = FFTW_WISDOM_FILENAME;
+
+    // Put precision in filename; all transforms use single precision (fftwf_*)
+    size_t pos = out.find_last_of('$');
+    if(pos == std::string::npos) {
+        error("No '$' in FFTW_WISDOM_FILENAME in data cache config");
+        exit(EXIT_FAILURE);
+    }
+    out.replace(pos, 1, "float");
+
+    // Put host CPU in filename
+    pos = out.find_last_of('@');
+    if(pos == std::string::npos) {
+        error("No '@' in FFTW_WISDOM_FILENAME in data cache config");
+        exit(EXIT_FAILURE);
+    }
+    out.replace(pos, 1, get_host_cpu_id());
+
+    return out;
+}
+
+
+const std::string &Cache::get_host_cpu_id() {
+    static const std::string cpu_id = []() {
+        std::string model = "unknown_cpu";
+
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        std::string line;
+        while(std::getline(cpuinfo, line)) {
+            if(line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos) {
+                model = line.substr(line.find(':') + 1);
+                break;
+            }
+        }
+
+        // Only keep characters safe for filenames and collapse the others to a single '-'
+        std::string id;
+        for(const char c : model) {
+            if(std::isalnum((unsigned char)c))
+                id += c;
+            else if(id != "" && id.back() != '-')
+                id += '-';
+        }
+        if(id != "" && id.back() == '-')
+            id.pop_back();
+
+        return id == "" ? std::string("unknown_cpu") : id;
+    }();
+
+    return cpu_id;
+}
+
+
+bool Cache::load_fftw_wisdom() {
+    if constexpr(DISABLE_CACHE)
+        return false;
+
+    if(cache_dir == "")
+        return false;
+
+    const std::string filename = get_fftw_wisdom_filename();
+    if(!std::filesystem::exists(cache_dir + filename))
+        return false;
+
+    if(!fftwf_import_wisdom_from_filename((cache_dir + filename).c_str())) {
+        warning("Failed to read FFTW3 wisdom cache file '" + filename + "'");
+        return false;
+    }
+
+    return true;
+}
+
+
+void Cache::save_fftw_wisdom() {
+    if constexpr(DISABLE_CACHE)
+        return;
+
+    if(cache_dir == "")
+        return;
+
+    // The wisdom in memory contains the cached wisdom as well, so no plan's wisdom is lost
+    const std::string filename = get_fftw_wisdom_filename();
+    if(!fftwf_export_wisdom_to_filename((cache_dir + filename).c_str()))
+        warning("Failed to write FFTW3 wisdom cache file '" + filename + "'; not saving to cache");
+}
+
+
+bool Cache::measure_fftw_wisdom(const std::function<fftwf_plan()> &measure_plan, std::unique_lock<std::mutex> &lock) {
+    int fds[2];
+    if(pipe(fds) == -1) {
+        warning("Failed to create pipe to measure FFTW3 plan in child process\nOS error: " + std::string(std::strerror(errno)));
+        return false;
+    }
+
+    // Forked while holding the lock, so the child's copy of the planner is not halfway a plan of another thread
+    const pid_t pid = fork();
+    if(pid == -1) {
+        warning("Failed to fork process to measure FFTW3 plan\nOS error: " + std::string(std::strerror(errno)));
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    else if(pid == 0) {
+        // Child process; only the forking thread exists, so it uses nothing but the planner and the pipe and doesn't run any destructors
+        close(fds[0]);
+
+        const fftwf_plan p = measure_plan();
+        char *const wisdom = p != NULL ? fftwf_export_wisdom_to_string() : NULL;
+        if(wisdom == NULL)
+            _exit(EXIT_FAILURE);
+
+        const size_t len = strlen(wisdom);
+        for(size_t written = 0; written < len;) {
+            const ssize_t ret = write(fds[1], wisdom + written, len - written);
+            if(ret <= 0)
+                _exit(EXIT_FAILURE);
+            written += ret;
+        }
+
+        _exit(EXIT_SUCCESS);
+    }
+
+    // Parent process; other threads can plan while the child measures
+    close(fds[1]);
+    lock.unlock();
+
+    std::string wisdom;
+    char buf[4096];
+    ssize_t ret;
+    while((ret = read(fds[0], buf, sizeof(buf))) != 0) {
+        if(ret == -1 && errno == EINTR)
+            continue;
+        else if(ret == -1)
+            break;
+        wisdom.append(buf, ret);
+    }
+    close(fds[0]);
+
+    int status;
+    pid_t ret_pid;
+    do {
+        ret_pid = waitpid(pid, &status, 0);
+    } while(ret_pid == -1 && errno == EINTR);
+
+    lock.lock();
+    if(ret_pid != pid || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS || ret == -1) {
+        warning("Failed to measure FFTW3 plan in child process");
+        return false;
+    }
+
+    if(!fftwf_import_wisdom_from_string(wisdom.c_str())) {
+        warning("Failed to import FFTW3 wisdom measured in child process");
+        return false;
+    }
+
+    return true;
+}
+
+
+fftwf_plan Cache::plan_with_wisdom(const std::function<fftwf_plan(const unsigned int)> &plan, const unsigned int flags, const std::string &description) {
+    std::unique_lock<std::mutex> lock(fftw_planner_mutex);
+
+    if(flags & FFTW_ESTIMATE)
+        return plan(flags);
+
+    // Wisdom only planning fails if the wisdom doesn't cover this transform
+    fftwf_plan p = plan(flags | FFTW_WISDOM_ONLY);
+    if(p != NULL || (flags & FFTW_WISDOM_ONLY))
+        return p;
+
+    info("Optimizing FFTW3 plan of " + description + " for this machine; this is only done once");
+
+    // Measuring takes long and only this plan needs it, so it is done in a child process, which doesn't block the planner for other threads
+    // Falls back to measuring in this process if the child's wisdom doesn't give the plan
+    if(measure_fftw_wisdom([&]() {return plan(flags);}, lock))
+        p = plan(flags | FFTW_WISDOM_ONLY);
+    if(p == NULL)
+        p = plan(flags);
+
+    if(p != NULL)
+        save_fftw_wisdom();
+
+    return p;
+}
+
+
+fftwf_plan Cache::plan_dft_r2c_1d(const int size, float *in, fftwf_complex *out, const unsigned int flags) {
+    return plan_with_wisdom([&](const unsigned int plan_flags) {
+        return fftwf_plan_dft_r2c_1d(size, in, out, plan_flags);
+    }, flags, "size " + STR(size));
+}
+
+
+fftwf_plan Cache::plan_many_dft(const int size, const int howmany, fftwf_complex *in, fftwf_complex *out, const int sign, const unsigned int flags) {
+    return plan_with_wisdom([&](const unsigned int plan_flags) {
+        return fftwf_plan_many_dft(1, &size, howmany,
+                                   in, NULL, 1, size,
+                                   out, NULL, 1, size,
+                                   sign, plan_flags);
+    }, flags, STR(howmany) + " transforms of size " + STR(size));
+}
+
+
+void Cache::destroy_plan(fftwf_plan p) {
+    const std::lock_guard<std::mutex> lock(fftw_planner_mutex);
+    fftwf_destroy_plan(p);
+}
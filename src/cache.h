@@ -2,7 +2,15 @@
 #define DIGISTRING_CACHE_H
 
 
+#include "estimators/estimation_func/constant_q_kernel.h"
+
+#include "config/cache.h"
+
+#include <fftw3.h>
+
 #include <string>
+#include <mutex>
+#include <functional>  // std::function
 
 
 class Cache {
@@ -21,6 +29,27 @@ class Cache {
         static bool load_dolph_window(double out[], const int size, const double attenuation);
         static bool load_dolph_window(float out[], const int size, const double attenuation);
 
+        static std::string get_constant_q_kernel_filename(const ConstantQKernelConfig &config);
+
+        // The kernel is looked up by kernel.config
+        static void save_constant_q_kernel(const ConstantQKernel &kernel);
+        static bool load_constant_q_kernel(ConstantQKernel &kernel);
+
+        static std::string get_fftw_wisdom_filename();
+        static const std::string &get_host_cpu_id();
+
+        // Create FFTW3 plans with FFTW_PLANNER_FLAGS, using and extending the cached wisdom
+        // Only the first run on a machine measures the plan; later runs plan instantly from the wisdom loaded in init_cache()
+        // Measuring may overwrite the in and out buffers, so they should be initialized after planning
+        // With FFTW_WISDOM_ONLY in flags, NULL is returned instead of measuring if the cached wisdom doesn't cover the transform
+        // With FFTW_ESTIMATE in flags, the cached wisdom is not used
+        // Planning is serialized, so plans may be created from multiple threads; measuring is done in a child process, so it doesn't block other threads
+        static fftwf_plan plan_dft_r2c_1d(const int size, float *in, fftwf_complex *out, const unsigned int flags = FFTW_PLANNER_FLAGS);
+        // howmany contiguous transforms of size elements each
+        static fftwf_plan plan_many_dft(const int size, const int howmany, fftwf_complex *in, fftwf_complex *out, const int sign, const unsigned int flags = FFTW_PLANNER_FLAGS);
+        // Destroying plans uses the planner, so it is serialized as well
+        static void destroy_plan(fftwf_plan p);
+
 
     private:
         // Remove ability to create an instance
@@ -28,6 +57,19 @@ class Cache {
 
         // Is set in init_cache()
         static std::string cache_dir;
+
+        // The FFTW3 planner is not thread-safe
+        static std::mutex fftw_planner_mutex;
+
+        // Adds the cached wisdom to the wisdom in memory; saving writes all wisdom in memory, so the wisdom of all plans is kept in one file
+        static bool load_fftw_wisdom();
+        static void save_fftw_wisdom();
+
+        // Measures the plan in a forked child process and imports its wisdom; lock is released while the child measures
+        // Returns false if the wisdom couldn't be measured this way
+        static bool measure_fftw_wisdom(const std::function<fftwf_plan()> &measure_plan, std::unique_lock<std::mutex> &lock);
+        // Plans from the wisdom in memory or measures and caches the plan; description is used in the info message
+        static fftwf_plan plan_with_wisdom(const std::function<fftwf_plan(const unsigned int)> &plan, const unsigned int flags, const std::string &description);
 };
 
 
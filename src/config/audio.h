@@ -4,12 +4,15 @@
 
 #include <SDL2/SDL.h>
 
+#include <cstddef>  // size_t
 
-// Sampling rate of input (and output if playback is enabled)
-constexpr int SAMPLE_RATE = 192000;
-// constexpr int SAMPLE_RATE = 96000;
-// constexpr int SAMPLE_RATE = 48000;
-// constexpr int SAMPLE_RATE = 44100;
+
+// Default sampling rate of input (and output if playback is enabled); change at runtime with '--param sample_rate <Hz>'
+// Use params.sample_rate (config/transcription_params.h) in code
+constexpr int DEFAULT_SAMPLE_RATE = 192000;
+// constexpr int DEFAULT_SAMPLE_RATE = 96000;
+// constexpr int DEFAULT_SAMPLE_RATE = 48000;
+// constexpr int DEFAULT_SAMPLE_RATE = 44100;
 
 constexpr SDL_AudioFormat AUDIO_FORMAT = AUDIO_F32SYS;  // 32 bit floats
 // constexpr SDL_AudioFormat AUDIO_FORMAT = AUDIO_S32SYS;  // 32 bit ints (synths currently do not support this!)
@@ -29,15 +32,23 @@ constexpr bool ALLOW_PLAYBACK_CHANGE = true;
 constexpr bool PRINT_AUDIO_UNDERRUNS = false;
 
 
-/* Note: Currently disabled! */
-// When reading samples from audio in, Digistring sleeps the time it takes to have enough samples ready from the audio driver
-// To prevent sleeping too long, which leads to more latency, we only sleep SLEEP_FACTOR times wait required time
-// Setting a lower factor increases the length of the burst of high CPU usage before full frame is read
-// We still let the CPU burst to minimize the latency between the driver having the buffer ready and reading it in Digistring
-// Set to 0.0 to not sleep at all
-constexpr double SLEEP_FACTOR = 0.85;
-// Alternatively, subtract a constant time from sleep time to account for OS scheduling
-constexpr double SLEEP_OVERHEAD_TIME = 15.0;  // Milliseconds
+// The audio callback of the recording device writes into a ring buffer, from which audio in reads its frames
+// Number of samples in the ring; recorded samples which don't fit are lost (overrun), so it should hold a few frames
+constexpr int CAPTURE_RING_SIZE = 1 << 16;
+static_assert((CAPTURE_RING_SIZE & (CAPTURE_RING_SIZE - 1)) == 0, "Capture ring size should be a power of two");
+
+// When more than this many frames are queued in the capture ring, audio in skips ahead to the newest samples (counted as overrun)
+// This bounds the latency when the estimator can't keep up, instead of letting a backlog of up to a whole ring build up
+constexpr double CAPTURE_MAX_BACKLOG_FRAMES = 2.0;
+static_assert(CAPTURE_MAX_BACKLOG_FRAMES >= 1.0, "Capture ring backlog should allow at least one frame");
+
+
+// Input files are memory mapped; the pages which were read are given back to the OS in steps of this many bytes
+constexpr size_t AUDIO_FILE_RELEASE_BYTES = 16 * 1024 * 1024;
+
+// Channel of multi-channel input files which is transcribed (0 is the left channel of stereo files)
+constexpr int AUDIO_FILE_CHANNEL = 0;
+static_assert(AUDIO_FILE_CHANNEL >= 0, "Audio file channel can't be negative");
 
 
 // Number of seconds is scrubbed through the input file every scroll wheel action
@@ -0,0 +1,26 @@
+#ifndef DIGISTRING_CONFIG_BATCH_H
+#define DIGISTRING_CONFIG_BATCH_H
+
+
+#include <string>
+
+
+// Batch transcription (--batch) transcribes many WAV files in parallel, each worker with its own estimator
+// Number of workers (files transcribed at the same time); 0 uses one worker per core
+constexpr int DEFAULT_BATCH_WORKERS = 0;
+static_assert(DEFAULT_BATCH_WORKERS >= 0, "Number of batch workers can't be negative");
+
+// Threads of the worker pool of every estimator in batch mode (see WORKER_POOL_THREADS in config/transcription.h)
+// The files are parallelized instead of the frames, which scales better than splitting every kernel of every worker over the remaining cores
+constexpr int BATCH_WORKER_POOL_THREADS = 1;
+static_assert(BATCH_WORKER_POOL_THREADS >= 1, "Estimators should have at least one thread");
+
+// Extension of the WAV files read from a directory (case insensitive) and of the results files
+const std::string BATCH_INPUT_EXTENSION = ".wav";
+const std::string BATCH_OUTPUT_EXTENSION = ".json";
+// Results are written to a file with this suffix, which is renamed when the file is transcribed completely
+// Files which already have results are skipped, so an interrupted batch continues where it stopped when started again
+const std::string BATCH_PARTIAL_SUFFIX = ".part";
+
+
+#endif  // DIGISTRING_CONFIG_BATCH_H
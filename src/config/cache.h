@@ -2,6 +2,8 @@
 #define DIGISTRING_CONFIG_CACHE_H
 
 
+#include <fftw3.h>
+
 #include <string>
 
 
@@ -15,5 +17,24 @@ const std::string CACHE_DIR_FROM_RSC_DIR = "../cache/";
 // The last $ is replaces by the db attenuation
 const std::string DOLPH_WINDOW_FILENAME = "dolph_window_%_$.txt";
 
+// Holds the wisdom of all transforms (sizes, kinds and batch sizes)
+// The last $ is replaced by the floating point precision
+// The last @ is replaced by the host CPU model, as plans measured on one CPU may be slow on another
+const std::string FFTW_WISDOM_FILENAME = "fftw_wisdom_$_@.txt";
+
+// The last % is replaced by the configuration of the kernel (sample rate, FFT size, lowest frequency, bins per octave, number of bins, Q and threshold)
+const std::string CONSTANT_Q_KERNEL_FILENAME = "constant_q_kernel_%.txt";
+
+// Planner rigor of all FFTW3 plans; FFTW_PATIENT finds faster plans, but the first run on a machine may take minutes
+// Plans are only measured once per machine, as the resulting wisdom is saved in the cache
+constexpr unsigned int FFTW_PLANNER_FLAGS = FFTW_MEASURE;
+
+// Without cached wisdom, estimators start on an FFTW_ESTIMATE plan while the measured plan is created in a background thread
+// The estimator switches to the measured plan between two frames once it is ready
+constexpr bool BACKGROUND_FFTW_PLANNING = true;
+// Number of transforms timed with both plans to report the gain of switching plans
+constexpr int BACKGROUND_PLAN_TIMING_REPS = 16;
+static_assert(BACKGROUND_PLAN_TIMING_REPS > 0, "Background plan timing repetitions should be positive");
+
 
 #endif  // DIGISTRING_CONFIG_CACHE_H
@@ -5,10 +5,12 @@
 #include "note.h"
 #include "error.h"
 #include "synth/synth.h"  // Only for Synths enum
+#include "estimators/estimator.h"  // Only for Estimators enum
 #include "sample_getter/sample_getter.h"  // Only for SampleGetters enum
 
 #include "config/audio.h"
 #include "config/graphics.h"
+#include "config/batch.h"
 
 #include <string>
 
@@ -27,6 +29,9 @@ struct CLIArgs {
     // This path is verified (and string is cleaned) at start of main()
     std::string rsc_dir = "rsc/";
 
+    // Estimator used for transcription
+    Estimators estimator_type = Estimators::highres;
+
     // Print performance measurements to CLI every frame
     bool output_performance = false;
     // File to write performance number to (which can be plotted with the performance plot tool)
@@ -77,6 +82,12 @@ struct CLIArgs {
     // Playing back a note event file through an arbitrary synth
     bool do_play_note_event_file = false;
     std::string note_event_file;
+
+    // Batch transcription of many WAV files in parallel
+    bool batch = false;
+    std::string batch_input;  // Directory of WAV files or file listing a WAV file per line
+    std::string batch_output_dir = "";  // Empty writes every results file next to its WAV file
+    int batch_workers = DEFAULT_BATCH_WORKERS;
 };
 extern CLIArgs cli_args;
 
@@ -110,6 +121,29 @@ inline bool verify_cli_args() {
         return false;
     }
 
+    if(!cli_args.batch && cli_args.batch_workers != DEFAULT_BATCH_WORKERS) {
+        error("Setting the number of workers with '-j' only has effect with batch transcription ('--batch')");
+        return false;
+    }
+
+    if(cli_args.batch) {
+        if(cli_args.audio_input_method != DEFAULT_AUDIO_INPUT_METHOD || cli_args.output_file) {
+            error("Batch transcription reads and writes its own files; can't also pass an input or output file");
+            hint("Results files are written next to the WAV files or to the output directory passed after the batch input");
+            return false;
+        }
+
+        if(cli_args.playback || cli_args.synth || cli_args.sync_with_audio || cli_args.do_slowdown || cli_args.midi_out) {
+            error("Batch transcription is headless and as fast as possible; can't play back, synthesize, sync, slowdown or output MIDI");
+            return false;
+        }
+
+        if(cli_args.output_performance || cli_args.perf_output_file != "") {
+            error("Can't output performance statistics of batch transcription, as the workers would mix their measurements");
+            return false;
+        }
+    }
+
     return true;
 }
 
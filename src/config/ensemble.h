@@ -0,0 +1,36 @@
+#ifndef DIGISTRING_CONFIG_ENSEMBLE_H
+#define DIGISTRING_CONFIG_ENSEMBLE_H
+
+
+#include "estimators/estimator.h"  // Only for Estimators enum
+
+#include <algorithm>  // std::find()
+#include <iterator>  // std::size()
+
+
+// How the ensemble estimator combines the note events of its estimators
+enum class EnsemblePolicy {
+    priority,  // Note events of the first estimator (in ENSEMBLE_ESTIMATORS order) which found any note
+    vote  // Notes found by at least ENSEMBLE_MIN_VOTES estimators; the note event is taken from the first estimator which found it
+};
+
+
+// Estimators run by the ensemble estimator, in order of priority
+// Every estimator runs in its own thread on the same frame; estimators using a smaller frame get the newest samples
+// Voting only helps if the estimators make different mistakes, so the default combines a Fourier, a time domain (YIN) and a constant-Q estimator
+// Variants of the same analysis (highres, sliding_highres and multires_highres) mostly agree on their errors as well
+constexpr Estimators ENSEMBLE_ESTIMATORS[] = {Estimators::highres, Estimators::yin, Estimators::constant_q};
+constexpr int ENSEMBLE_SIZE = std::size(ENSEMBLE_ESTIMATORS);
+static_assert(std::find(std::begin(ENSEMBLE_ESTIMATORS), std::end(ENSEMBLE_ESTIMATORS), Estimators::ensemble) == std::end(ENSEMBLE_ESTIMATORS), "The ensemble can't contain itself");
+
+constexpr EnsemblePolicy ENSEMBLE_POLICY = EnsemblePolicy::vote;
+constexpr int ENSEMBLE_MIN_VOTES = 2;
+static_assert(ENSEMBLE_MIN_VOTES >= 1 && ENSEMBLE_MIN_VOTES <= ENSEMBLE_SIZE, "Minimum number of votes should be between 1 and the number of estimators in the ensemble");
+
+// Pin the threads of the estimators (except the first, which runs in the estimating thread) to the first free CPUs from ENSEMBLE_FIRST_CPU on
+// Estimators with their own worker pool also pin their workers (see WORKER_POOL_PIN in config/transcription.h); every pool pins to CPUs no other pool pinned, so they don't overlap
+constexpr bool ENSEMBLE_PIN = false;
+constexpr int ENSEMBLE_FIRST_CPU = 1;
+
+
+#endif  // DIGISTRING_CONFIG_ENSEMBLE_H
@@ -0,0 +1,43 @@
+#ifndef DIGISTRING_CONFIG_PIPELINE_H
+#define DIGISTRING_CONFIG_PIPELINE_H
+
+
+// What a pipeline stage does when the queue to the next stage is full
+enum class BackPressure {
+    drop,  // Discard the new item
+    block,  // Wait till the next stage pops an item
+    coalesce  // Merge items, so only the newest state is processed (see below)
+};
+
+
+// Run capture, estimation and output (results file, MIDI, synth and graphics) in separate threads connected by queues
+// A slow output stage then doesn't delay capturing and estimating the next frame
+// Slowdown and stereo split playback always use the serial main loop
+constexpr bool PIPELINE = true;
+
+// Number of frames each queue can hold
+constexpr int PIPELINE_QUEUE_SIZE = 4;
+static_assert(PIPELINE_QUEUE_SIZE > 0, "Pipeline queues should hold at least one frame");
+
+// Captured frames are queued as views into the SampleGetter's ring, so they are only copied to the estimator's buffer
+// The ring holds this many frames: the queued frames, the frame being estimated, the frame being captured and a seek's overlap
+// The capture stage waits when it would overwrite samples the estimation stage still needs
+constexpr int PIPELINE_RING_FRAMES = PIPELINE_QUEUE_SIZE + 4;
+
+// Back-pressure is only applied when capturing from an audio recording device
+// Other sample getters have no deadline, so they are throttled by blocking, which keeps the results identical to the serial main loop
+// Coalescing captured frames makes the estimator skip to the newest queued frame, as it overlaps the older ones
+constexpr BackPressure CAPTURE_BACK_PRESSURE = BackPressure::coalesce;
+// Coalescing estimated frames concatenates their note events till the output stage has room, so no results are lost
+constexpr BackPressure OUTPUT_BACK_PRESSURE = BackPressure::coalesce;
+// Maximum number of estimated frames merged into one; more blocks the estimator
+constexpr int PIPELINE_MAX_COALESCED_FRAMES = 64;
+
+// Time the output stage (main thread) sleeps when no estimated frame is ready; SDL events are handled in between
+constexpr double PIPELINE_OUTPUT_POLL_TIME = 1.0;  // ms
+
+// Print queue depths, drops and coalesced frames of every stage when quitting
+constexpr bool PRINT_PIPELINE_STATS = true;
+
+
+#endif  // DIGISTRING_CONFIG_PIPELINE_H
@@ -4,6 +4,8 @@
 
 #include "note.h"
 
+#include "config/audio.h"
+
 #include <string>
 #include <algorithm>
 
@@ -14,53 +16,101 @@ constexpr Note HIGHEST_NOTE = Note(Notes::E, 6);
 
 
 /* High Res transcriber */
-// constexpr int FRAME_SIZE = 40960;  // BasicFourier
-constexpr int FRAME_SIZE = 1024 * 8 /** 2*/;  // Number of samples in Fourier frame
-// constexpr int FRAME_SIZE = 1024 * 4;  // For 96000 Hz
-// constexpr int FRAME_SIZE = 2048;  // For 48000 Hz
-// constexpr int FRAME_SIZE = 1882;  // For 44100 Hz
-constexpr double POWER_THRESHOLD = 15.0;  // Threshold of channel power before finding peaks
-constexpr double PEAK_THRESHOLD = 0.25;  // Threshold of peak before significant
-constexpr double OVERTONE_ERROR = 45.0;  // Error in cents that an detected overtone may have compared to the theoretical overtone
-
-constexpr double ZERO_PAD_FACTOR = 15.0;  // Calculates number of zeros to pad; choose a power of two minus one for optimal efficiency (0.0 to disable)
-constexpr int FRAME_SIZE_PADDED = FRAME_SIZE + (FRAME_SIZE * ZERO_PAD_FACTOR);  // Size of the frame with padding
+// The defaults of the runtime parameters (see config/transcription_params.h) are prefixed with DEFAULT_
+// Use the params global in code, as these can be changed with '--param <name> <value>' or '--param-file <file>'
+// constexpr int DEFAULT_FRAME_SIZE = 40960;  // BasicFourier
+constexpr int DEFAULT_FRAME_SIZE = 1024 * 8 /** 2*/;  // Number of samples in Fourier frame
+// constexpr int DEFAULT_FRAME_SIZE = 1024 * 4;  // For 96000 Hz
+// constexpr int DEFAULT_FRAME_SIZE = 2048;  // For 48000 Hz
+// constexpr int DEFAULT_FRAME_SIZE = 1882;  // For 44100 Hz
+constexpr double DEFAULT_POWER_THRESHOLD = 15.0;  // Threshold of channel power (sum of the norms of the analysed bins; see BAND_LIMIT) before finding peaks
+constexpr double DEFAULT_PEAK_THRESHOLD = 0.25;  // Threshold of peak before significant
+constexpr double DEFAULT_OVERTONE_ERROR = 45.0;  // Error in cents that an detected overtone may have compared to the theoretical overtone
+
+constexpr double DEFAULT_ZERO_PAD_FACTOR = 15.0;  // Calculates number of zeros to pad; choose a power of two minus one for optimal efficiency (0.0 to disable)
+// Size of the frame with padding
+constexpr int calc_frame_size_padded(const int frame_size, const double zero_pad_factor) {
+    return frame_size + (int)(frame_size * zero_pad_factor);
+}
+// Skip the zero-padding and the bins above the band limit in the FFT by interleaving (zero pad factor / 2) + 1 sub-FFTs of the frame size (benchmark with "--experiment pruned_fft")
+// Off, as its bins differ from the full FFT by floating point rounding, which may change the results
+// Requires an integer zero pad factor (checked when setting the parameters)
+constexpr bool PRUNED_FFT = false;
+
+// Only analyse bins up to BAND_LIMIT_OVERTONES overtones of HIGHEST_NOTE (plus overtone error margin)
+// Norms, envelope, peak picking and the spectrum graphics only process these bins
+// The power compared to POWER_THRESHOLD and TRANSIENT_FILTER_POWER and the highest norm SIGNAL_TO_NOISE_FILTER is relative to are also over these bins only
+// Frames with notes in range have nearly the same power as over the full spectrum, but noise above the band limit doesn't add to it anymore
+// For white noise, the power is only (analysed bins / all bins) of the full spectrum power, so noisy silence passes POWER_THRESHOLD much less often
+// The thresholds were tuned on the full spectrum and kept as is, so they gate more strictly on noise; set BAND_LIMIT to false for their original meaning
+constexpr bool BAND_LIMIT = true;
+constexpr int BAND_LIMIT_OVERTONES = 5;
+// Number of analysed bins (+2, so the last useful bin has a neighbour for interpolation)
+constexpr int calc_band_limited_n_bins(const int sample_rate, const int frame_size_padded, const double overtone_error) {
+    const double band_limit_frequency = HIGHEST_NOTE.freq * (BAND_LIMIT_OVERTONES + 1) * exp2(overtone_error / 1200.0);
+    return BAND_LIMIT ? std::min((int)(band_limit_frequency / ((double)sample_rate / (double)frame_size_padded)) + 2, (frame_size_padded / 2) + 1)
+                      : (frame_size_padded / 2) + 1;
+}
+static_assert(BAND_LIMIT_OVERTONES >= 0, "Number of band limit overtones can't be negative");
 
 // Dolph Chebyshev attanuation
 constexpr double DEFAULT_ATTENUATION = 50.0;  // dB (shouldn't be <45 dB, as equivalent noise bandwidth will increase much)
 
 // Gaussian average settings (for peak picking)
-// constexpr double KERNEL_WIDTH_FACTOR = 0.000478;  // Width of kernel with respect to spectrum size
-constexpr double KERNEL_WIDTH_FACTOR = 0.0005;  // Width of kernel with respect to spectrum size
-// constexpr double KERNEL_WIDTH_FACTOR = 0.001;  // Width of kernel with respect to spectrum size
-// constexpr double KERNEL_WIDTH_FACTOR = 0.002;  // Width of kernel with respect to spectrum size
-constexpr int KERNEL_WIDTH = (FRAME_SIZE_PADDED * KERNEL_WIDTH_FACTOR) + ((int)(FRAME_SIZE_PADDED * KERNEL_WIDTH_FACTOR) % 2 == 0 ? 1 : 0);
-// constexpr int KERNEL_WIDTH = 47;  // Choose odd value
+// constexpr double DEFAULT_KERNEL_WIDTH_FACTOR = 0.000478;  // Width of kernel with respect to spectrum size
+constexpr double DEFAULT_KERNEL_WIDTH_FACTOR = 0.0005;  // Width of kernel with respect to spectrum size
+// constexpr double DEFAULT_KERNEL_WIDTH_FACTOR = 0.001;  // Width of kernel with respect to spectrum size
+// constexpr double DEFAULT_KERNEL_WIDTH_FACTOR = 0.002;  // Width of kernel with respect to spectrum size
+// Always odd
+constexpr int calc_kernel_width(const int frame_size_padded, const double kernel_width_factor) {
+    return (int)(frame_size_padded * kernel_width_factor) + ((int)(frame_size_padded * kernel_width_factor) % 2 == 0 ? 1 : 0);
+}
 constexpr double SIGMA = 1.25;  // Higher values of sigma make values close to kernel center weight more
+// Use the O(n) cascaded box filter approximation instead of direct convolution (compare both with "--experiment envelope")
+constexpr bool BOX_ENVELOPE = false;
+// Compute the norms, Gaussian envelope and peaks in one pass over tiles of FUSED_TILE_BINS bins, so every tile stays in cache (HighRes; not with BOX_ENVELOPE)
+// Off, as it measured slower than the separate passes so far; compare both with "--experiment fused_peak_picking" before enabling it
+constexpr bool FUSED_PEAK_PICKING = false;
+constexpr int FUSED_TILE_BINS = 2048;
+static_assert(FUSED_TILE_BINS > 0, "Fused peak picking tiles should hold at least one bin");
 /* TODO: Change to ENVELOPE_THRESHOLD */
-// constexpr double ENVELOPE_MIN = 0.1;  // Minimum height of envelope at peaks
-constexpr double ENVELOPE_MIN = 0.35;  // Minimum height of envelope at peaks
+// constexpr double DEFAULT_ENVELOPE_MIN = 0.1;  // Minimum height of envelope at peaks
+constexpr double DEFAULT_ENVELOPE_MIN = 0.35;  // Minimum height of envelope at peaks
 
 // Min difference in Y value between last valley to be a peak
-constexpr double MIN_PEAK_DY = 1.0;
+constexpr double DEFAULT_MIN_PEAK_DY = 1.0;
 
 // Filter notes which are outside of LOWEST_NOTE and HIGHEST_NOTE
 constexpr bool RANGE_FILTER = true;
 
 // Transient filtering
 constexpr bool TRANSIENT_FILTER = false;
-constexpr double TRANSIENT_FILTER_POWER = 0.3;  // Extra signal power over previous frame before frame has a transient
+constexpr double TRANSIENT_FILTER_POWER = 0.3;  // Extra signal power (over the analysed bins) over previous frame before frame has a transient
 
 /* TODO: Rename to SIGNAL_TO_NOISE_FACTOR */
-constexpr double SIGNAL_TO_NOISE_FILTER = 0.05;  // Minimum height of peak compared to highest peak
+constexpr double DEFAULT_SIGNAL_TO_NOISE_FILTER = 0.05;  // Minimum height of peak compared to highest peak (of the analysed bins)
+
+/* Harmonic sieve note selector (polyphony) */
+// Select up to MAX_POLYPHONY notes per frame with get_harmonic_sieve() instead of a single note with get_most_overtones() (HighRes and variants)
+constexpr bool POLYPHONIC = false;
+constexpr int MAX_POLYPHONY = 6;
+// Every peak votes for the candidate fundamentals at its first SIEVE_HARMONICS subharmonics
+constexpr int SIEVE_HARMONICS = 8;
+// Resolution of the candidate fundamentals; a vote is spread over the bins within the overtone error
+constexpr int SIEVE_BINS_PER_SEMITONE = 10;
+// Minimum number of matched harmonics (including the fundamental) of every note after the first
+constexpr int SIEVE_MIN_HARMONICS = 3;
+static_assert(MAX_POLYPHONY > 0, "Maximum polyphony should be positive");
+static_assert(SIEVE_HARMONICS > 0, "The harmonic sieve should at least match the fundamental");
+static_assert(SIEVE_BINS_PER_SEMITONE > 0, "There should be at least one harmonic sieve bin per semitone");
 
 
 /* Overlapping read buffers */
 // Overlap is only supported if the same number of samples is requested every call to the SampleGetter
 constexpr bool DO_OVERLAP = true;
 // 0.0 < OVERLAP < 1.0: Ratio of old to new buffer, where higher numbers use more old buffer
-constexpr double OVERLAP_RATIO = 0.85;
-static_assert(OVERLAP_RATIO >= 0.0 && OVERLAP_RATIO <= 1.0, "Overlap ratio should be between 0.0 and 1.0");
+constexpr double DEFAULT_OVERLAP_RATIO = 0.85;
+static_assert(DEFAULT_OVERLAP_RATIO >= 0.0 && DEFAULT_OVERLAP_RATIO <= 1.0, "Overlap ratio should be between 0.0 and 1.0");
 
 // When reading from audio in, instead of reading a fixed ratio, read as many samples as possible without blocking
 constexpr bool DO_OVERLAP_NONBLOCK = false;
@@ -73,4 +123,138 @@ static_assert(MIN_NONBLOCK_OVERLAP_RATIO < MAX_NONBLOCK_OVERLAP_RATIO, "MAX_NONB
 static_assert(!(DO_OVERLAP && DO_OVERLAP_NONBLOCK), "Can't set both DO_OVERLAP and DO_OVERLAP_NONBLOCK");
 
 
+/* Decimation front-end (all estimators) */
+// With '--param decimation_factor <n>', frames are low-pass filtered and decimated before estimation
+// Estimators then run at sample_rate / n on frame_size / n samples, while capture, playback and synthesis stay at the full sample rate
+constexpr int DEFAULT_DECIMATION_FACTOR = 1;
+// The linear phase anti-aliasing FIR filter has DECIMATION_TAPS_PER_PHASE taps per polyphase branch (factor * taps per phase + 1 taps in total)
+constexpr int DECIMATION_TAPS_PER_PHASE = 32;
+// Cutoff of the filter as fraction of the decimated Nyquist frequency
+// The transition band of the Blackman windowed filter is centered on it and is 11 / DECIMATION_TAPS_PER_PHASE of the decimated Nyquist frequency wide
+// Keep the cutoff plus half of the transition band below 1.0, so nothing aliases
+constexpr double DECIMATION_CUTOFF = 0.8;
+// Highest frequency (Hz) passing the filter unattenuated
+constexpr double calc_decimation_passband(const int decimated_sample_rate) {
+    return (DECIMATION_CUTOFF - (5.5 / DECIMATION_TAPS_PER_PHASE)) * (decimated_sample_rate / 2.0);
+}
+static_assert(DEFAULT_DECIMATION_FACTOR >= 1, "Decimation factor should be at least one");
+static_assert(DECIMATION_TAPS_PER_PHASE >= 4, "Decimation filter should have at least four taps per polyphase branch");
+static_assert(DECIMATION_CUTOFF > 0.0 && DECIMATION_CUTOFF <= 1.0, "Decimation cutoff should be between 0.0 and 1.0 of the decimated Nyquist frequency");
+
+
+/* Worker pool for the parallel estimation kernels (norms, envelope and peak picking) */
+// Total number of threads including the estimating thread; 0 uses half of the cores, as using all cores may cause latency spikes
+constexpr int WORKER_POOL_THREADS = 0;
+// Pin worker threads to the first CPUs (from WORKER_POOL_FIRST_CPU on) that no worker of another pool is pinned to (the estimating thread itself is not pinned)
+// Pools of estimators running at the same time (ensemble) thereby get disjoint CPUs; a pool gets fewer threads if the other pools pinned all CPUs
+constexpr bool WORKER_POOL_PIN = true;
+constexpr int WORKER_POOL_FIRST_CPU = 1;
+// Number of spin iterations (with pause instruction) before an idle worker parks; covers the gaps between kernels in a frame
+constexpr int WORKER_POOL_SPIN_ITERATIONS = 20000;
+// Don't split work over more threads than gives every thread this many bins
+constexpr int WORKER_POOL_MIN_CHUNK = 512;
+
+
+/* Steady state allocation */
+// Capacity reserved for the note events of one frame; more note events still work, but allocate
+constexpr int MAX_NOTE_EVENTS_PER_FRAME = 16;
+// Frames in which an estimator may still allocate before reaching its steady state (only checked when compiled with -DCOUNT_HEAP_ALLOCATIONS)
+constexpr unsigned long HEAP_ALLOCATION_WARMUP_FRAMES = 8;
+
+
+/* Sliding DFT (SlidingHighRes estimator) */
+// Sliding costs (number of slid bins * number of new samples), so sliding all band limited bins is several times slower than the FFT it replaces
+// Instead, a full analysis (FFT, envelope and peak picking as HighRes) finds the peaks, after which only the bins around these peaks are slid
+// Compare it to HighRes with "--experiment sliding_dft"
+// Number of bins on both sides of a peak which are slid; a peak moving to the edge of its neighbourhood triggers a full analysis
+constexpr int SLIDING_DFT_PEAK_RADIUS = 2;
+constexpr int SLIDING_DFT_NEIGHBOURHOOD_BINS = (2 * SLIDING_DFT_PEAK_RADIUS) + 1;
+// Maximum number of tracked peaks; a full analysis with more peaks is followed by another full analysis
+constexpr int SLIDING_DFT_MAX_PEAKS = 64;
+// A full analysis is done when the energy of the frame changed more than this factor since the last full analysis (onsets and releases)
+constexpr double SLIDING_DFT_ENERGY_RATIO = 2.0;
+// A full analysis is done when the share of the frame's energy in the neighbourhoods of the tracked peaks dropped below this fraction of
+// its share at the last full analysis (new notes at a similar energy)
+constexpr double SLIDING_DFT_MIN_SHARE = 0.5;
+// A full analysis is done at least every n frames, which also cancels accumulated rounding errors of the recursion
+constexpr int SLIDING_DFT_RESYNC_INTERVAL = 16;
+static_assert(SLIDING_DFT_PEAK_RADIUS >= 1, "Sliding DFT peaks need a neighbour on both sides for interpolation");
+static_assert(SLIDING_DFT_MAX_PEAKS > 0, "Sliding DFT should track at least one peak");
+static_assert(SLIDING_DFT_ENERGY_RATIO > 1.0, "Sliding DFT energy ratio should be larger than 1.0");
+static_assert(SLIDING_DFT_MIN_SHARE > 0.0 && SLIDING_DFT_MIN_SHARE < 1.0, "Sliding DFT minimum share should be between 0.0 and 1.0");
+static_assert(SLIDING_DFT_RESYNC_INTERVAL > 0, "Sliding DFT resync interval should be positive");
+// The Hann window is applied in the frequency domain by combining bins (frame size padded / frame size) apart, so the zero pad factor should be an integer
+
+
+/* Multi-resolution HighRes (MultiResHighRes estimator) */
+// Every band analyses the newest (frame size / divisor) samples of the frame, zero-padded with the same zero pad factor
+// Peaks from half a semitone below lowest_note up to the next band are taken from this band, so every band holds the same number of periods of its lowest note
+// The first band should cover the whole frame and start at LOWEST_NOTE; bands should be ordered on both divisor and lowest note
+struct MultiResBandConfig {
+    int frame_size_divisor;
+    Note lowest_note;
+};
+constexpr MultiResBandConfig MULTIRES_BANDS[] = {
+    {1, LOWEST_NOTE},
+    {2, Note(Notes::E, 3)},
+    {4, Note(Notes::E, 4)}
+};
+constexpr int N_MULTIRES_BANDS = sizeof(MULTIRES_BANDS) / sizeof(MULTIRES_BANDS[0]);
+constexpr bool multires_bands_ordered() {
+    for(int i = 1; i < N_MULTIRES_BANDS; i++)
+        if(MULTIRES_BANDS[i].frame_size_divisor <= MULTIRES_BANDS[i - 1].frame_size_divisor || MULTIRES_BANDS[i].lowest_note.midi_number <= MULTIRES_BANDS[i - 1].lowest_note.midi_number)
+            return false;
+    return true;
+}
+static_assert(MULTIRES_BANDS[0].frame_size_divisor == 1 && MULTIRES_BANDS[0].lowest_note.midi_number == LOWEST_NOTE.midi_number, "First multi-resolution band should cover the whole frame from LOWEST_NOTE");
+static_assert(multires_bands_ordered(), "Multi-resolution bands should be ordered on increasing divisor and lowest note");
+static_assert(MULTIRES_BANDS[N_MULTIRES_BANDS - 1].lowest_note.midi_number <= HIGHEST_NOTE.midi_number, "Multi-resolution bands should start below HIGHEST_NOTE");
+
+
+/* Goertzel resonator bank (Goertzel estimator) */
+// Every note between LOWEST_NOTE and HIGHEST_NOTE is analysed over this many periods of its fundamental, so all notes have the same relative resolution
+// Over N periods, a resonator's Hann bin width is 1/N of its frequency, while neighbouring semitones are 2^(1/12) - 1 = 5.95% apart
+// So at least 17 periods (5.88%) are needed to put the neighbouring semitones one resonator bandwidth away; 16 periods (6.25%) is too few
+constexpr double GOERTZEL_PERIODS = 17.0;
+static_assert(1.0 / GOERTZEL_PERIODS < 0.0595, "Goertzel resonators should be narrower than a semitone (at least 17 periods)");
+// Number of resonators per note (fundamental and overtones); these run as SIMD lanes of one recursion
+constexpr int GOERTZEL_HARMONICS = 4;
+// Minimum amplitude of the fundamental (with samples in [-1.0, 1.0]) before a note is considered
+constexpr double GOERTZEL_MIN_AMPLITUDE = 0.01;
+// Resolution of the shared Hann window; every note samples it with its own stride
+constexpr int GOERTZEL_WINDOW_TABLE_SIZE = 4096;
+static_assert(GOERTZEL_PERIODS > 0.0, "Number of Goertzel periods should be positive");
+static_assert(GOERTZEL_HARMONICS > 0, "There should be at least one Goertzel resonator per note");
+static_assert(HIGHEST_NOTE.midi_number >= LOWEST_NOTE.midi_number, "HIGHEST_NOTE can't be lower than LOWEST_NOTE");
+
+
+/* Constant-Q transform (ConstantQ estimator) */
+// Bins are spaced geometrically around the notes from LOWEST_NOTE to HIGHEST_NOTE; 1 aligns the bins to the semitones and more bins resolve cents
+constexpr int CQ_BINS_PER_SEMITONE = 1;
+// Bins continue up to this harmonic of HIGHEST_NOTE, so the harmonic sum of every note is covered
+constexpr int CQ_HARMONICS = 4;
+// Scales the quality factor (frequency / bandwidth) of all bins; at 1.0, the bandwidth of a bin is its spacing
+// With more bins per semitone, lower values keep the kernels (and FFT) short at the cost of resolution
+constexpr double CQ_Q_SCALE = 1.0;
+// Values of the spectral kernel with a smaller magnitude are dropped (Brown and Puckette use 0.0054); the kernel is cached per threshold
+constexpr double CQ_KERNEL_THRESHOLD = 0.0054;
+// Minimum amplitude of the fundamental (with samples in [-1.0, 1.0]) before a note is considered
+constexpr double CQ_MIN_AMPLITUDE = 0.01;
+static_assert(CQ_BINS_PER_SEMITONE > 0, "There should be at least one constant-Q bin per semitone");
+static_assert(CQ_HARMONICS > 0, "The constant-Q bins should cover at least the fundamental");
+static_assert(CQ_Q_SCALE > 0.0, "Constant-Q quality factor scale should be positive");
+
+
+/* YIN (Yin estimator) */
+// Lags are searched between a semitone above HIGHEST_NOTE and half a semitone below LOWEST_NOTE
+// Integration window of the difference function in periods of LOWEST_NOTE; the frame is the window plus the longest lag
+constexpr double YIN_WINDOW_PERIODS = 1.0;
+// Threshold of the cumulative mean normalized difference (the YIN paper uses 0.10 to 0.15); frames without a lag below it are unvoiced
+constexpr double YIN_THRESHOLD = 0.15;
+// Minimum RMS of the frame (with samples in [-1.0, 1.0]) before a note is considered
+constexpr double YIN_MIN_RMS = 0.005;
+static_assert(YIN_WINDOW_PERIODS > 0.0, "YIN window should be positive");
+static_assert(YIN_THRESHOLD > 0.0 && YIN_THRESHOLD < 1.0, "YIN threshold should be between 0.0 and 1.0");
+
+
 #endif  // DIGISTRING_CONFIG_TRANSCRIPTION_H
@@ -0,0 +1,148 @@
+#ifndef DIGISTRING_CONFIG_TRANSCRIPTION_PARAMS_H
+#define DIGISTRING_CONFIG_TRANSCRIPTION_PARAMS_H
+
+
+#include "error.h"
+
+#include "config/audio.h"
+#include "config/transcription.h"
+
+#include <map>
+#include <string>
+#include <variant>
+#include <algorithm>  // std::max()
+#include <cmath>  // exp2()
+
+
+// Transcription parameters which can be changed without recompiling, through '--param <name> <value>' or '--param-file <file>'
+// Defaults are the DEFAULT_ constants in config/audio.h and config/transcription.h
+// Should only be written to by ArgParser at the start of the program, before any sample getter or estimator is created
+struct TranscriptionParams {
+    int sample_rate = DEFAULT_SAMPLE_RATE;
+    int frame_size = DEFAULT_FRAME_SIZE;
+    double zero_pad_factor = DEFAULT_ZERO_PAD_FACTOR;
+    double overlap_ratio = DEFAULT_OVERLAP_RATIO;
+    double kernel_width_factor = DEFAULT_KERNEL_WIDTH_FACTOR;
+
+    // Thresholds
+    double power_threshold = DEFAULT_POWER_THRESHOLD;
+    double peak_threshold = DEFAULT_PEAK_THRESHOLD;
+    double overtone_error = DEFAULT_OVERTONE_ERROR;
+    double envelope_min = DEFAULT_ENVELOPE_MIN;
+    double min_peak_dy = DEFAULT_MIN_PEAK_DY;
+    double signal_to_noise_filter = DEFAULT_SIGNAL_TO_NOISE_FILTER;
+
+    int decimation_factor = DEFAULT_DECIMATION_FACTOR;
+
+    // Derived from the parameters above; updated by update_derived_params()
+    // Estimators run on the decimated frames, so they use the analysis sample rate and frame size (equal to the sample rate and frame size without decimation)
+    int analysis_sample_rate = DEFAULT_SAMPLE_RATE / DEFAULT_DECIMATION_FACTOR;
+    int analysis_frame_size = DEFAULT_FRAME_SIZE / DEFAULT_DECIMATION_FACTOR;
+    int frame_size_padded = calc_frame_size_padded(analysis_frame_size, DEFAULT_ZERO_PAD_FACTOR);
+    int band_limited_n_bins = calc_band_limited_n_bins(analysis_sample_rate, frame_size_padded, DEFAULT_OVERTONE_ERROR);
+    int kernel_width = calc_kernel_width(frame_size_padded, DEFAULT_KERNEL_WIDTH_FACTOR);
+};
+extern TranscriptionParams params;
+
+
+// Names of the parameters in '--param' and parameter files
+struct ParamInfo {
+    std::variant<int TranscriptionParams::*, double TranscriptionParams::*> member;
+    std::string description;
+};
+const std::map<const std::string, const ParamInfo> param_info = {
+    {"sample_rate",             {&TranscriptionParams::sample_rate,             "Sampling rate of input and output (Hz)"}},
+    {"frame_size",              {&TranscriptionParams::frame_size,              "Number of samples in a frame"}},
+    {"zero_pad_factor",         {&TranscriptionParams::zero_pad_factor,         "Number of zeros padded to a frame, as factor of the frame size"}},
+    {"overlap_ratio",           {&TranscriptionParams::overlap_ratio,           "Ratio of old to new samples in overlapping frames"}},
+    {"kernel_width_factor",     {&TranscriptionParams::kernel_width_factor,     "Width of the envelope kernel with respect to the padded frame size"}},
+    {"power_threshold",         {&TranscriptionParams::power_threshold,         "Threshold of frame power (sum of the norms of the analysed bins) before finding peaks"}},
+    {"peak_threshold",          {&TranscriptionParams::peak_threshold,          "Threshold of peak before significant"}},
+    {"overtone_error",          {&TranscriptionParams::overtone_error,          "Error in cents a detected overtone may have"}},
+    {"envelope_min",            {&TranscriptionParams::envelope_min,            "Minimum height of envelope at peaks"}},
+    {"min_peak_dy",             {&TranscriptionParams::min_peak_dy,             "Minimum difference with the last valley to be a peak"}},
+    {"signal_to_noise_filter",  {&TranscriptionParams::signal_to_noise_filter,  "Minimum height of peak compared to highest peak"}},
+    {"decimation_factor",       {&TranscriptionParams::decimation_factor,       "Factor by which frames are decimated before estimation (1 to disable)"}}
+};
+
+
+inline void update_derived_params() {
+    // Invalid factors are reported by verify_params()
+    const int decimation_factor = std::max(params.decimation_factor, 1);
+    params.analysis_sample_rate = params.sample_rate / decimation_factor;
+    params.analysis_frame_size = params.frame_size / decimation_factor;
+
+    params.frame_size_padded = calc_frame_size_padded(params.analysis_frame_size, params.zero_pad_factor);
+    params.band_limited_n_bins = calc_band_limited_n_bins(params.analysis_sample_rate, params.frame_size_padded, params.overtone_error);
+    params.kernel_width = calc_kernel_width(params.frame_size_padded, params.kernel_width_factor);
+}
+
+
+// Checks if combination of params is valid
+inline bool verify_params() {
+    if(params.sample_rate <= 0) {
+        error("Sample rate should be positive");
+        return false;
+    }
+
+    if(params.frame_size < 2) {
+        error("Frame size should be at least two samples");
+        return false;
+    }
+
+    if(params.zero_pad_factor < 0.0) {
+        error("Zero pad factor can't be negative");
+        return false;
+    }
+
+    if(params.decimation_factor < 1) {
+        error("Decimation factor should be at least one");
+        return false;
+    }
+
+    if(params.decimation_factor > 1) {
+        if(params.sample_rate % params.decimation_factor != 0) {
+            error("Sample rate (" + STR(params.sample_rate) + " Hz) should be divisible by the decimation factor (" + STR(params.decimation_factor) + ")");
+            return false;
+        }
+
+        if(params.analysis_frame_size < 2) {
+            error("Decimated frame size should be at least two samples");
+            return false;
+        }
+
+        // All overtones the estimators may look at should pass the anti-aliasing filter
+        const double highest_overtone = HIGHEST_NOTE.freq * (BAND_LIMIT_OVERTONES + 1) * exp2(params.overtone_error / 1200.0);
+        if(calc_decimation_passband(params.analysis_sample_rate) < highest_overtone) {
+            error("Decimating by " + STR(params.decimation_factor) + " filters out overtones up to " + STR(highest_overtone) + " Hz (passband ends at " + STR(calc_decimation_passband(params.analysis_sample_rate)) + " Hz)");
+            hint("Use a smaller decimation factor or more taps per phase (DECIMATION_TAPS_PER_PHASE in config/transcription.h)");
+            return false;
+        }
+    }
+
+    if(PRUNED_FFT && params.frame_size_padded % params.analysis_frame_size != 0) {
+        error("Pruned FFT requires an integer zero pad factor");
+        hint("Either round the zero pad factor or disable PRUNED_FFT in config/transcription.h");
+        return false;
+    }
+
+    if(params.overlap_ratio < 0.0 || params.overlap_ratio > 1.0) {
+        error("Overlap ratio should be between 0.0 and 1.0");
+        return false;
+    }
+
+    if(params.kernel_width_factor <= 0.0) {
+        error("Kernel width factor should be positive");
+        return false;
+    }
+
+    if(params.overtone_error < 0.0) {
+        error("Overtone error can't be negative");
+        return false;
+    }
+
+    return true;
+}
+
+
+#endif  // DIGISTRING_CONFIG_TRANSCRIPTION_PARAMS_H
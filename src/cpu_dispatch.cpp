@@ -0,0 +1,23 @@
+#include "cpu_dispatch.h"
+
+
+bool cpu_supports(const CpuFeature feature) {
+    #ifdef CPU_X86
+    // __builtin_cpu_supports() only takes string literals
+    __builtin_cpu_init();
+    switch(feature) {
+        case CpuFeature::sse2:
+            return __builtin_cpu_supports("sse2");
+
+        case CpuFeature::avx2:
+            return __builtin_cpu_supports("avx2");
+
+        case CpuFeature::avx512f:
+            return __builtin_cpu_supports("avx512f");
+    }
+    #else
+    (void)feature;
+    #endif
+
+    return false;
+}
@@ -0,0 +1,41 @@
+#ifndef DIGISTRING_CPU_DISPATCH_H
+#define DIGISTRING_CPU_DISPATCH_H
+
+
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_X86
+#include <immintrin.h>
+#endif
+
+
+/* Run-time selection of SIMD kernels
+ * Kernels for every instruction set are compiled into the binary (with __attribute__((target(...)))), so the same binary runs on any CPU of the architecture
+ * The best kernel the CPU supports is selected using CPU feature detection; store the result in a static, so this is only done once at start-up
+ */
+enum class CpuFeature {
+    sse2, avx2, avx512f
+};
+
+// Always false on other architectures than x86
+bool cpu_supports(const CpuFeature feature);
+
+template<typename Kernel>
+struct CpuKernel {
+    CpuFeature feature;  // Required by kernel
+    Kernel kernel;
+};
+
+// The first kernel whose feature the CPU supports, so order kernels from most to least advanced; fallback if none is supported
+template<typename Kernel>
+Kernel select_cpu_kernel(const std::initializer_list<CpuKernel<Kernel>> kernels, const Kernel fallback) {
+    for(const CpuKernel<Kernel> &k : kernels)
+        if(cpu_supports(k.feature))
+            return k.kernel;
+
+    return fallback;
+}
+
+
+#endif  // DIGISTRING_CPU_DISPATCH_H
@@ -4,9 +4,11 @@
 #include "note.h"
 
 #include "estimation_func/window_func.h"
+#include "estimation_func/hot_swap_plan.h"
 
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 #include "config/graphics.h"
 
 #include <fftw3.h>
@@ -16,42 +18,43 @@
 #include <vector>
 
 
-BasicFourier::BasicFourier(float *&input_buffer, int &buffer_size) {
+BasicFourier::BasicFourier(float *&input_buffer, int &buffer_size) : sample_rate(params.analysis_sample_rate), frame_size(params.analysis_frame_size) {
     // Let the called know the number of samples to request from SampleGetter each call
-    buffer_size = FRAME_SIZE;
+    buffer_size = frame_size;
 
     // fftw3 input buffer to Fourier on
-    in = (float*)fftwf_malloc(FRAME_SIZE * sizeof(float));
+    in = (float*)fftwf_malloc(frame_size * sizeof(float));
     if(in == NULL) {
         error("Failed to malloc sample input buffer");
         exit(EXIT_FAILURE);
     }
     input_buffer = in;  // Share the input buffer with caller, so SampleGetter can directly write samples to it (no copies needed)
 
-    out = (fftwf_complex*)fftwf_malloc(((FRAME_SIZE / 2) + 1) * sizeof(fftwf_complex));
+    out = (fftwf_complex*)fftwf_malloc(((frame_size / 2) + 1) * sizeof(fftwf_complex));
     if(out == NULL) {
         error("Failed to malloc Fourier output buffer");
         exit(EXIT_FAILURE);
     }
 
-    // TODO: Exhaustive planner and graphics to show "optimizing planner"
-    p = fftwf_plan_dft_r2c_1d(FRAME_SIZE, input_buffer, out, FFTW_ESTIMATE);
-    if(p == NULL) {
-        error("Failed to create FFTW3 plan");
+    plan = new HotSwapPlan(frame_size, input_buffer, out);
+
+    window_func = (float*)fftwf_malloc(frame_size * sizeof(float));
+    if(window_func == NULL) {
+        error("Failed to malloc window function");
         exit(EXIT_FAILURE);
     }
 
     // Pre-calculate window function
-    if(!dolph_chebyshev_window(window_func, FRAME_SIZE, DEFAULT_ATTENUATION, true)) {
+    if(!dolph_chebyshev_window(window_func, frame_size, DEFAULT_ATTENUATION, true)) {
         // dolph_chebyshev_window() already prints error
         warning("Failed to get Dolph Chebyshev window; using Blackman Nuttall window instead...");
 
-        blackman_nuttall_window(window_func, FRAME_SIZE);
+        blackman_nuttall_window(window_func, frame_size);
     }
 
     if constexpr(!HEADLESS) {
         try {
-            norms = new double[(FRAME_SIZE / 2) + 1];
+            norms = new double[(frame_size / 2) + 1];
         }
         catch(const std::bad_alloc &e) {
             error("Failed to allocate norms buffer (" + STR(e.what()) + ")");
@@ -68,7 +71,7 @@ BasicFourier::BasicFourier(float *&input_buffer, int &buffer_size) {
 
         std::vector<float> &tmp_wave_samples = tmp_graphics->get_wave_samples();
         tmp_wave_samples.clear();  // Just to be sure
-        tmp_wave_samples.resize(FRAME_SIZE, 0.0);
+        tmp_wave_samples.resize(frame_size, 0.0);
     }
 }
 
@@ -78,7 +81,8 @@ BasicFourier::~BasicFourier() {
         delete[] norms;
     }
 
-    fftwf_destroy_plan(p);
+    delete plan;
+    fftwf_free(window_func);
     fftwf_free(out);
     fftwf_free(in);
 }
@@ -95,21 +99,21 @@ void BasicFourier::perform(float *const input_buffer, NoteEvents &note_events) {
         BasicFourierGraphics *const basic_fourier_graphics = static_cast<BasicFourierGraphics *>(estimator_graphics);
 
         std::vector<float> &wave_samples = basic_fourier_graphics->get_wave_samples();
-        memcpy(wave_samples.data(), input_buffer, FRAME_SIZE * sizeof(float));
+        memcpy(wave_samples.data(), input_buffer, frame_size * sizeof(float));
     }
 
     /* Fourier transform */
     // Apply window function to minimize spectral leakage
-    for(int i = 0; i < FRAME_SIZE; i++)
+    for(int i = 0; i < frame_size; i++)
         input_buffer[i] *= window_func[i];
 
     // Do the actual transform
-    fftwf_execute(p);
+    plan->execute();
 
     // Get the bin with maximum signal power
     double max_norm_val = -1.0;
     int max_norm_idx = -1;
-    for(int i = 1; i < (FRAME_SIZE / 2) + 1; i++) {
+    for(int i = 1; i < (frame_size / 2) + 1; i++) {
         const double tmp_norm = sqrt((out[i][0] * out[i][0]) + (out[i][1] * out[i][1]));
 
         if(tmp_norm > max_norm_val) {
@@ -127,7 +131,7 @@ void BasicFourier::perform(float *const input_buffer, NoteEvents &note_events) {
 
     // Add note to output note_events
     if(max_norm_idx != -1)
-        note_events.push_back(NoteEvent(Note(max_norm_idx * ((double)SAMPLE_RATE / (double)FRAME_SIZE), max_norm_val), FRAME_SIZE, 0));
+        note_events.push_back(NoteEvent(Note(max_norm_idx * ((double)sample_rate / (double)frame_size), max_norm_val), frame_size, 0));
 
 
     // Graphics
@@ -139,12 +143,12 @@ void BasicFourier::perform(float *const input_buffer, NoteEvents &note_events) {
         spectrum.clear();
 
         // Start at i = 1 to skip rendering DC offset
-        for(int i = 1; i < (FRAME_SIZE / 2) + 1; i++)
-            spectrum.add_data(i * ((double)SAMPLE_RATE / (double)FRAME_SIZE), norms[i], (double)SAMPLE_RATE / (double)FRAME_SIZE);
+        for(int i = 1; i < (frame_size / 2) + 1; i++)
+            spectrum.add_data(i * ((double)sample_rate / (double)frame_size), norms[i], (double)sample_rate / (double)frame_size);
         spectrum.sort();
 
         std::vector<double> &f_peaks = basic_fourier_graphics->get_peaks();
         f_peaks.clear();
-        f_peaks.push_back(max_norm_idx * ((double)SAMPLE_RATE / (double)FRAME_SIZE));
+        f_peaks.push_back(max_norm_idx * ((double)sample_rate / (double)frame_size));
     }
 }
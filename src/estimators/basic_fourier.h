@@ -4,6 +4,8 @@
 
 #include "estimator.h"
 
+#include "estimation_func/hot_swap_plan.h"
+
 #include "estimator_graphics/spectrogram.h"
 #include "estimator_graphics/bins.h"
 #include "estimator_graphics/waterfall.h"
@@ -27,13 +29,17 @@ class BasicFourier : public Estimator {
 
 
     private:
+        // Copied from the runtime parameters
+        const int sample_rate;
+        const int frame_size;
+
         float *in;
         fftwf_complex *out;
-        fftwf_plan p;
+        HotSwapPlan *plan;
 
         double *norms;  // For storing the norms for graphics
 
-        float window_func[FRAME_SIZE];
+        float *window_func;
 };
 
 
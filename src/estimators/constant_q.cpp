@@ -0,0 +1,175 @@
+#include "constant_q.h"
+
+#include "note.h"
+#include "error.h"
+
+#include "estimation_func/hot_swap_plan.h"
+#include "estimation_func/constant_q_kernel.h"
+
+#include "config/audio.h"
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+#include "config/graphics.h"
+
+#include <fftw3.h>
+
+#include <cmath>
+#include <algorithm>  // std::fill_n(), std::max()
+#include <bit>  // std::bit_ceil()
+
+
+ConstantQ::ConstantQ(float *&input_buffer, int &buffer_size) : sample_rate(params.analysis_sample_rate) {
+    const int bins_per_octave = 12 * CQ_BINS_PER_SEMITONE;
+    note_bin_offset = CQ_BINS_PER_SEMITONE / 2;
+    for(int h = 0; h < CQ_HARMONICS; h++)
+        harmonic_bin_offsets[h] = (int)round(bins_per_octave * log2(h + 1));
+
+    ConstantQKernelConfig config;
+    config.sample_rate = sample_rate;
+    config.min_freq = LOWEST_NOTE.freq * exp2(-note_bin_offset / (double)bins_per_octave);
+    config.bins_per_octave = bins_per_octave;
+    config.q = CQ_Q_SCALE / (exp2(1.0 / bins_per_octave) - 1.0);
+    config.threshold = CQ_KERNEL_THRESHOLD;
+
+    // Up to the last harmonic of the highest note, but not above the Nyquist frequency
+    const int n_note_bins = ((HIGHEST_NOTE.midi_number - LOWEST_NOTE.midi_number) * CQ_BINS_PER_SEMITONE) + (2 * note_bin_offset) + 1;
+    config.n_bins = n_note_bins + harmonic_bin_offsets[CQ_HARMONICS - 1];
+    while(config.n_bins > 0 && constant_q_bin_freq(config, config.n_bins - 1) >= sample_rate / 2.0)
+        config.n_bins--;
+    if(config.n_bins < n_note_bins) {
+        error("Highest note is above the Nyquist frequency");
+        hint("Increase the sample rate or lower HIGHEST_NOTE in config/transcription.h");
+        exit(EXIT_FAILURE);
+    }
+
+    // Let the caller know the number of samples to request from SampleGetter each call
+    frame_size = constant_q_kernel_length(config, 0);
+    buffer_size = frame_size;
+    fft_size = std::bit_ceil((unsigned int)frame_size);
+    config.fft_size = fft_size;
+
+    in = (float*)fftwf_malloc(fft_size * sizeof(float));
+    if(in == NULL) {
+        error("Failed to malloc sample input buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    out = (fftwf_complex*)fftwf_malloc(((fft_size / 2) + 1) * sizeof(fftwf_complex));
+    if(out == NULL) {
+        error("Failed to malloc Fourier output buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    plan = new HotSwapPlan(fft_size, in, out);
+
+    // Planning may overwrite the input, so zero the part before the frame afterwards; the r2c transform preserves it
+    std::fill_n(in, fft_size, 0.0);
+    input_buffer = in + (fft_size - frame_size);  // Share the input buffer with caller, so SampleGetter can directly write samples to it (no copies needed)
+
+    get_constant_q_kernel(kernel, config);
+
+    try {
+        amplitudes = new double[config.n_bins];
+    }
+    catch(const std::bad_alloc &e) {
+        error("Failed to allocate constant-Q amplitude buffer (" + STR(e.what()) + ")");
+        exit(EXIT_FAILURE);
+    }
+
+    if constexpr(!HEADLESS)
+        estimator_graphics = new ConstantQGraphics();
+}
+
+ConstantQ::~ConstantQ() {
+    if constexpr(!HEADLESS)
+        delete estimator_graphics;
+
+    delete[] amplitudes;
+    delete plan;
+    fftwf_free(out);
+    fftwf_free(in);
+}
+
+
+Estimators ConstantQ::get_type() const {
+    return Estimators::constant_q;
+}
+
+
+void ConstantQ::perform(float *const input_buffer, NoteEvents &note_events) {
+    // The samples before the frame are the zeros in front of input_buffer
+    if(input_buffer != in + (fft_size - frame_size)) {
+        error("ConstantQ was given a different input buffer than it created");
+        exit(EXIT_FAILURE);
+    }
+
+    plan->execute();
+
+    // Sparse matrix-vector product of the kernel and the spectrum
+    const int n_bins = kernel.config.n_bins;
+    const int *const row_starts = kernel.row_starts.data();
+    const int *const columns = kernel.columns.data();
+    const float *const values_re = kernel.values_re.data();
+    const float *const values_im = kernel.values_im.data();
+    for(int k = 0; k < n_bins; k++) {
+        double re = 0.0, im = 0.0;
+        for(int i = row_starts[k]; i < row_starts[k + 1]; i++) {
+            const int j = columns[i];
+            re += (out[j][0] * values_re[i]) - (out[j][1] * values_im[i]);
+            im += (out[j][0] * values_im[i]) + (out[j][1] * values_re[i]);
+        }
+
+        // The kernel is normalized, so a sine of amplitude A gives a magnitude of A / 2
+        amplitudes[k] = 2.0 * sqrt((re * re) + (im * im));
+    }
+
+    // The note with the highest harmonic sum wins; an octave too low misses the odd harmonics and an octave too high misses the fundamental
+    // The fundamental of a note is the loudest bin within half a semitone, so detuned notes are found as well
+    int best_bin = -1;
+    double best_score = 0.0;
+    for(int n = 0; n <= HIGHEST_NOTE.midi_number - LOWEST_NOTE.midi_number; n++) {
+        const int center = (n * CQ_BINS_PER_SEMITONE) + note_bin_offset;
+        int fundamental = center;
+        for(int k = center - note_bin_offset; k <= center + note_bin_offset; k++)
+            if(amplitudes[k] > amplitudes[fundamental])
+                fundamental = k;
+
+        if(amplitudes[fundamental] < CQ_MIN_AMPLITUDE)
+            continue;
+
+        double score = 0.0;
+        for(int h = 0; h < CQ_HARMONICS && fundamental + harmonic_bin_offsets[h] < n_bins; h++)
+            score += amplitudes[fundamental + harmonic_bin_offsets[h]];
+
+        if(score > best_score) {
+            best_score = score;
+            best_bin = fundamental;
+        }
+    }
+
+    if(best_bin != -1)
+        note_events.push_back(NoteEvent(Note(constant_q_bin_freq(kernel.config, best_bin), amplitudes[best_bin]), frame_size, 0));
+
+
+    // Graphics
+    if constexpr(!HEADLESS) {
+        ConstantQGraphics *const constant_q_graphics = static_cast<ConstantQGraphics *>(estimator_graphics);
+
+        Spectrum &spectrum = constant_q_graphics->get_spectrum();
+        spectrum.clear();
+        double max_amplitude = 0.0;
+        for(int k = 0; k < n_bins; k++) {
+            const double freq = constant_q_bin_freq(kernel.config, k);
+            spectrum.add_data(freq, amplitudes[k], freq / kernel.config.q);
+            max_amplitude = std::max(max_amplitude, amplitudes[k]);
+        }
+        spectrum.add_data(0.0, 0.0, 0.0);  // Make graph start at (0, 0)
+        spectrum.sort();
+        constant_q_graphics->set_last_max_recorded_value(max_amplitude);
+
+        std::vector<double> &f_peaks = constant_q_graphics->get_peaks();
+        f_peaks.clear();
+        if(best_bin != -1)
+            f_peaks.push_back(constant_q_bin_freq(kernel.config, best_bin));
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef DIGISTRING_ESTIMATORS_CONSTANT_Q_H
+#define DIGISTRING_ESTIMATORS_CONSTANT_Q_H
+
+
+#include "estimator.h"
+
+#include "estimation_func/hot_swap_plan.h"
+#include "estimation_func/constant_q_kernel.h"
+
+#include "estimator_graphics/spectrum.h"
+#include "estimator_graphics/spectrogram.h"
+#include "estimator_graphics/bins.h"
+
+#include "config/transcription.h"
+
+#include <fftw3.h>
+
+#include <vector>
+
+
+/* Constant-Q transform using the sparse spectral kernel method of Brown and Puckette
+ * Bins are geometrically spaced like the notes, so the lowest notes get the same relative resolution as the highest without zero-padding
+ * Every frame is one FFT of the longest temporal kernel (rounded up to a power of two) and a sparse matrix-vector product
+ * The kernel only depends on the configuration, so it is computed once and cached (see Cache)
+ */
+class ConstantQ : public Estimator {
+    public:
+        ConstantQ(float *&input_buffer, int &buffer_size);
+        ~ConstantQ() override;
+
+        Estimators get_type() const override;
+
+        void perform(float *const input_buffer, NoteEvents &note_events) override;
+
+
+    private:
+        // Copied from the runtime parameters
+        const int sample_rate;
+
+        // The frame is the longest temporal kernel; it is placed at the end of the FFT input and the rest is zero
+        int frame_size;
+        int fft_size;
+        float *in;
+        fftwf_complex *out;
+        HotSwapPlan *plan;
+
+        ConstantQKernel kernel;
+        double *amplitudes;
+
+        // Bins of the fundamentals are note_bin_offset bins above the note's semitone (so bins below the lowest note can be searched for detuned notes)
+        int note_bin_offset;
+        // Bins between the fundamental and the harmonics
+        int harmonic_bin_offsets[CQ_HARMONICS];
+};
+
+
+class ConstantQGraphics : public EstimatorGraphics {
+    public:
+        void render(SDL_Renderer *const renderer, const SDL_Rect &dst, const GraphicsData &graphics_data) const override {
+            switch(cur_plot) {
+                default:
+                    cur_plot = 0;
+                    __attribute__ ((fallthrough));
+                case 0:
+                    spectrogram.render(renderer, dst, graphics_data, spectrum, envelope, peak_frequencies);
+                    break;
+
+                case 1:
+                    bins.render(renderer, dst, graphics_data, spectrum);
+                    break;
+            }
+        };
+
+        // These should only be called by the ConstantQ estimator in perform()
+        Spectrum &get_spectrum() {return spectrum;};
+        std::vector<double> &get_peaks() {return peak_frequencies;};
+
+
+    private:
+        Spectrogram spectrogram;
+        Bins bins;
+
+        // These get set during a perform() call
+        Spectrum spectrum;
+        Spectrum envelope;  // Always empty
+        std::vector<double> peak_frequencies;
+};
+
+
+#endif  // DIGISTRING_ESTIMATORS_CONSTANT_Q_H
@@ -0,0 +1,136 @@
+#include "ensemble.h"
+
+#include "estimators.h"
+#include "error.h"
+#include "note.h"
+
+#include "config/ensemble.h"
+#include "config/transcription.h"
+#include "config/graphics.h"
+
+#include <fftw3.h>
+
+#include <cstring>  // memcpy()
+#include <algorithm>  // std::max(), std::any_of()
+
+
+Ensemble::Ensemble(float *&input_buffer, int &buffer_size)
+        : pool(ENSEMBLE_SIZE, ENSEMBLE_PIN, ENSEMBLE_FIRST_CPU, WORKER_POOL_SPIN_ITERATIONS, 1) {
+    in_size = 0;
+    for(int i = 0; i < ENSEMBLE_SIZE; i++) {
+        estimator_buffers[i] = NULL;
+        estimator_buffer_sizes[i] = -1;
+        estimators[i] = estimator_factory(ENSEMBLE_ESTIMATORS[i], estimator_buffers[i], estimator_buffer_sizes[i]);
+        if(estimator_buffers[i] == NULL || estimator_buffer_sizes[i] == -1) {
+            error("Estimator '" + EstimatorString.at(ENSEMBLE_ESTIMATORS[i]) + "' in ensemble did not create an input buffer");
+            exit(EXIT_FAILURE);
+        }
+
+        in_size = std::max(in_size, estimator_buffer_sizes[i]);
+        estimator_events[i].reserve(MAX_NOTE_EVENTS_PER_FRAME);
+    }
+
+    // The largest frame, so every estimator can take the newest samples it needs
+    buffer_size = in_size;
+    in = (float*)fftwf_malloc(in_size * sizeof(float));
+    if(in == NULL) {
+        error("Failed to malloc sample input buffer");
+        exit(EXIT_FAILURE);
+    }
+    input_buffer = in;
+}
+
+Ensemble::~Ensemble() {
+    for(int i = 0; i < ENSEMBLE_SIZE; i++)
+        delete estimators[i];
+
+    fftwf_free(in);
+}
+
+
+Estimators Ensemble::get_type() const {
+    return Estimators::ensemble;
+}
+
+
+const EstimatorGraphics *Ensemble::get_estimator_graphics() {
+    return estimators[0]->get_estimator_graphics();
+}
+
+
+void Ensemble::next_plot_type() {
+    estimators[0]->next_plot_type();
+}
+
+
+void Ensemble::add_event(NoteEvents &note_events, const int estimator, const NoteEvent &event) const {
+    NoteEvent ensemble_event = event;
+    ensemble_event.offset += in_size - estimator_buffer_sizes[estimator];
+    note_events.push_back(ensemble_event);
+}
+
+
+void Ensemble::combine_priority(NoteEvents &note_events) const {
+    for(int i = 0; i < ENSEMBLE_SIZE; i++) {
+        if(estimator_events[i].empty())
+            continue;
+
+        for(const NoteEvent &event : estimator_events[i])
+            add_event(note_events, i, event);
+        return;
+    }
+}
+
+
+void Ensemble::combine_vote(NoteEvents &note_events) const {
+    const auto has_note = [](const NoteEvents &events, const int midi_number) {
+        return std::any_of(events.begin(), events.end(), [midi_number](const NoteEvent &event) {
+            return event.note.midi_number == midi_number;
+        });
+    };
+
+    // Estimators are visited in order of priority, so the note event of the first estimator finding a note is used
+    for(int i = 0; i < ENSEMBLE_SIZE; i++) {
+        for(const NoteEvent &event : estimator_events[i]) {
+            const int midi_number = event.note.midi_number;
+            if(has_note(note_events, midi_number))
+                continue;
+
+            int votes = 1;
+            for(int j = i + 1; j < ENSEMBLE_SIZE; j++)
+                votes += has_note(estimator_events[j], midi_number) ? 1 : 0;
+
+            if(votes >= ENSEMBLE_MIN_VOTES)
+                add_event(note_events, i, event);
+        }
+    }
+}
+
+
+void Ensemble::reset() {
+    for(int i = 0; i < ENSEMBLE_SIZE; i++)
+        estimators[i]->reset();
+}
+
+
+void Ensemble::perform(float *const input_buffer, NoteEvents &note_events) {
+    // Every estimator copies the newest samples to its own input buffer in its own thread, as it alters its input buffer
+    pool.parallel_for(ENSEMBLE_SIZE, [&](const int begin, const int end, const int) {
+        for(int i = begin; i < end; i++) {
+            memcpy(estimator_buffers[i], input_buffer + (in_size - estimator_buffer_sizes[i]), estimator_buffer_sizes[i] * sizeof(float));
+
+            estimator_events[i].clear();
+            estimators[i]->perform(estimator_buffers[i], estimator_events[i]);
+        }
+    });
+
+    switch(ENSEMBLE_POLICY) {
+        case EnsemblePolicy::priority:
+            combine_priority(note_events);
+            break;
+
+        case EnsemblePolicy::vote:
+            combine_vote(note_events);
+            break;
+    }
+}
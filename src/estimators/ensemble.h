@@ -0,0 +1,50 @@
+#ifndef DIGISTRING_ESTIMATORS_ENSEMBLE_H
+#define DIGISTRING_ESTIMATORS_ENSEMBLE_H
+
+
+#include "estimator.h"
+
+#include "worker_pool.h"
+
+#include "config/ensemble.h"
+
+
+/* Runs the estimators in ENSEMBLE_ESTIMATORS in parallel on the same frame and combines their note events
+ * Every estimator keeps its own input buffer, as estimators work in place on their input buffer
+ * The graphics are those of the first estimator
+ */
+class Ensemble : public Estimator {
+    public:
+        Ensemble(float *&input_buffer, int &buffer_size);
+        ~Ensemble() override;
+
+        Estimators get_type() const override;
+
+        const EstimatorGraphics *get_estimator_graphics() override;
+        void next_plot_type() override;
+
+        void perform(float *const input_buffer, NoteEvents &note_events) override;
+        void reset() override;
+
+
+    private:
+        float *in;
+        int in_size;
+
+        Estimator *estimators[ENSEMBLE_SIZE];
+        float *estimator_buffers[ENSEMBLE_SIZE];
+        int estimator_buffer_sizes[ENSEMBLE_SIZE];
+        NoteEvents estimator_events[ENSEMBLE_SIZE];
+
+        WorkerPool pool;
+
+
+        void combine_priority(NoteEvents &note_events) const;
+        void combine_vote(NoteEvents &note_events) const;
+
+        // Adds the note event of the given estimator, moved to the position of its frame in the ensemble frame
+        void add_event(NoteEvents &note_events, const int estimator, const NoteEvent &event) const;
+};
+
+
+#endif  // DIGISTRING_ESTIMATORS_ENSEMBLE_H
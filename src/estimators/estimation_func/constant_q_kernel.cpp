@@ -0,0 +1,98 @@
+#include "constant_q_kernel.h"
+
+#include "cache.h"
+#include "error.h"
+
+#include "window_func.h"
+
+#include <fftw3.h>
+
+#include <cmath>
+#include <vector>
+
+
+int constant_q_kernel_length(const ConstantQKernelConfig &config, const int k) {
+    return (int)ceil((config.q * (double)config.sample_rate) / constant_q_bin_freq(config, k));
+}
+
+
+double constant_q_bin_freq(const ConstantQKernelConfig &config, const int k) {
+    return config.min_freq * exp2((double)k / (double)config.bins_per_octave);
+}
+
+
+void get_constant_q_kernel(ConstantQKernel &kernel, const ConstantQKernelConfig &config) {
+    kernel.config = config;
+    if(Cache::load_constant_q_kernel(kernel))
+        return;
+
+    info("Computing constant-Q kernel of " + STR(config.n_bins) + " bins; this is only done once");
+    compute_constant_q_kernel(kernel, config);
+    Cache::save_constant_q_kernel(kernel);
+}
+
+
+void compute_constant_q_kernel(ConstantQKernel &kernel, const ConstantQKernelConfig &config) {
+    kernel.config = config;
+    kernel.row_starts.clear();
+    kernel.columns.clear();
+    kernel.values_re.clear();
+    kernel.values_im.clear();
+
+    if(constant_q_kernel_length(config, 0) > config.fft_size) {
+        error("Constant-Q kernel of the lowest bin doesn't fit in the FFT");
+        exit(EXIT_FAILURE);
+    }
+
+    fftwf_complex *const temporal = (fftwf_complex*)fftwf_malloc(config.fft_size * sizeof(fftwf_complex));
+    fftwf_complex *const spectral = (fftwf_complex*)fftwf_malloc(config.fft_size * sizeof(fftwf_complex));
+    double *const window = (double*)fftwf_malloc(constant_q_kernel_length(config, 0) * sizeof(double));
+    if(temporal == NULL || spectral == NULL || window == NULL) {
+        error("Failed to malloc constant-Q kernel buffers");
+        exit(EXIT_FAILURE);
+    }
+
+    // Only computed once per configuration, so an estimated plan suffices
+    const fftwf_plan plan = Cache::plan_many_dft(config.fft_size, 1, temporal, spectral, FFTW_FORWARD, FFTW_ESTIMATE);
+    if(plan == NULL) {
+        error("Failed to create FFTW3 plan for the constant-Q kernel");
+        exit(EXIT_FAILURE);
+    }
+
+    kernel.row_starts.push_back(0);
+    for(int k = 0; k < config.n_bins; k++) {
+        const int length = constant_q_kernel_length(config, k);
+        const int start = config.fft_size - length;
+        const double omega = (2.0 * M_PI * constant_q_bin_freq(config, k)) / (double)config.sample_rate;
+
+        // Normalized by the window sum, so a sine of amplitude A gives a bin magnitude of A / 2
+        hann_window(window, length);
+        double window_sum = 0.0;
+        for(int n = 0; n < length; n++)
+            window_sum += window[n];
+
+        for(int n = 0; n < start; n++)
+            temporal[n][0] = temporal[n][1] = 0.0;
+        for(int n = 0; n < length; n++) {
+            temporal[start + n][0] = (window[n] / window_sum) * cos(omega * n);
+            temporal[start + n][1] = (window[n] / window_sum) * sin(omega * n);
+        }
+
+        fftwf_execute(plan);
+
+        for(int j = 0; j < (config.fft_size / 2) + 1; j++) {
+            if(sqrt((spectral[j][0] * spectral[j][0]) + (spectral[j][1] * spectral[j][1])) < config.threshold)
+                continue;
+
+            kernel.columns.push_back(j);
+            kernel.values_re.push_back(spectral[j][0] / (double)config.fft_size);
+            kernel.values_im.push_back(-spectral[j][1] / (double)config.fft_size);
+        }
+        kernel.row_starts.push_back(kernel.columns.size());
+    }
+
+    Cache::destroy_plan(plan);
+    fftwf_free(window);
+    fftwf_free(spectral);
+    fftwf_free(temporal);
+}
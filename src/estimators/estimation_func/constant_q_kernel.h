@@ -0,0 +1,49 @@
+#ifndef DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_CONSTANT_Q_KERNEL_H
+#define DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_CONSTANT_Q_KERNEL_H
+
+
+#include <vector>
+
+
+// Everything the spectral kernel depends on; two kernels with equal configs are identical
+struct ConstantQKernelConfig {
+    int sample_rate;
+    int fft_size;
+    double min_freq;  // Frequency of bin 0
+    int bins_per_octave;
+    int n_bins;
+    double q;  // Quality factor; frequency / bandwidth of every bin
+    double threshold;  // Spectral kernel values with a smaller magnitude are dropped
+};
+
+
+/* Sparse spectral kernel of a constant-Q transform (Brown and Puckette, 1992)
+ * Bin k has a Hann windowed complex exponential at min_freq * 2^(k / bins_per_octave) of q periods as temporal kernel
+ * Temporal kernels end at the last sample of the FFT frame, so every bin analyses the newest samples
+ * The spectral kernel is the FFT of the temporal kernels, which is mostly zero; only values above the threshold are kept
+ * By Parseval's theorem, bin k of the constant-Q transform is the sum of FFT(frame)[j] * value for the values in row k
+ * Values are stored conjugated and divided by the FFT size, so only the multiply-adds remain per frame
+ * Only the positive frequencies of the FFT are used, as the temporal kernels are analytic (up to leakage)
+ */
+struct ConstantQKernel {
+    ConstantQKernelConfig config;
+
+    // Compressed sparse rows; the values of bin k are [row_starts[k], row_starts[k + 1])
+    std::vector<int> row_starts;
+    std::vector<int> columns;  // FFT bin of the value
+    std::vector<float> values_re;
+    std::vector<float> values_im;
+};
+
+
+// Length in samples of the temporal kernel of bin k; the lowest bin has the longest kernel
+int constant_q_kernel_length(const ConstantQKernelConfig &config, const int k);
+double constant_q_bin_freq(const ConstantQKernelConfig &config, const int k);
+
+// Loads the kernel of the given config from the cache or computes (and caches) it
+void get_constant_q_kernel(ConstantQKernel &kernel, const ConstantQKernelConfig &config);
+// Always computes the kernel
+void compute_constant_q_kernel(ConstantQKernel &kernel, const ConstantQKernelConfig &config);
+
+
+#endif  // DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_CONSTANT_Q_KERNEL_H
@@ -1,46 +1,190 @@
 #include "envelope.h"
 
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 
 #include <omp.h>
 
 #include <algorithm>
 #include <cmath>
+#include <vector>
 
 
-constexpr int MID = KERNEL_WIDTH / 2;
-static double gaussian[KERNEL_WIDTH];
+// Kernel width is a runtime parameter, so the kernel is sized on first use
+struct GaussianKernel {
+    int mid;
+    std::vector<double> weights;
+};
 
-int precalc_gaussian() {
-    static bool done = false;
-    if(done)
-        return 1;
+static GaussianKernel make_gaussian_kernel() {
+    GaussianKernel kernel;
+    kernel.mid = params.kernel_width / 2;
+    kernel.weights.resize(params.kernel_width);
+    for(int i = 0; i < params.kernel_width; i++)
+        kernel.weights[i] = exp(-M_PI * ((double)(i - kernel.mid) / ((double)kernel.mid * SIGMA)) * ((double)(i - kernel.mid) / ((double)kernel.mid * SIGMA)));
 
-    for(int i = 0; i < KERNEL_WIDTH; i++)
-        gaussian[i] = exp(-M_PI * ((double)(i - MID) / ((double)MID * SIGMA)) * ((double)(i - MID) / ((double)MID * SIGMA)));
+    return kernel;
+}
+
+// Initialization of the function-local static is thread-safe, so the envelope functions may be entered concurrently from any thread
+static const GaussianKernel &gaussian_kernel() {
+    static const GaussianKernel kernel = make_gaussian_kernel();
+    return kernel;
+}
 
-    done = true;
-    return 0;
+// norms holds the bins from norms_begin on
+static inline double gaussian_envelope_bin(const GaussianKernel &kernel, const double norms[], const int n_norms, const int i, const int norms_begin = 0) {
+    const int mid = kernel.mid;
+    const double *const gaussian = kernel.weights.data();
+
+    double sum = 0.0, weights = 0.0;
+    for(int j = std::max(-mid, -i); j <= std::min(mid, (n_norms - 1) - i); j++) {
+        sum += norms[(i + j) - norms_begin] * gaussian[j + mid];
+        weights += gaussian[j + mid];
+    }
+    return sum / weights;
 }
 
 void gaussian_envelope(const double norms[], double envelope[], const int n_norms) {
-    static int precalc = precalc_gaussian();
+    const GaussianKernel &kernel = gaussian_kernel();
 
     // Only use half of total cores, as using all cores may cause latency spikes on systems running other software
     const int n_cores = omp_get_num_procs() / 2;
 
     #pragma omp parallel for num_threads(n_cores)
-    for(int i = 0; i < n_norms; i++) {
-        double sum = 0.0, weights = 0.0;
-        for(int j = std::max(-MID, -i); j <= std::min(MID, (n_norms - 1) - i); j++) {
-            sum += norms[i + j] * gaussian[j + MID];
-            weights += gaussian[j + MID];
+    for(int i = 0; i < n_norms; i++)
+        envelope[i] = gaussian_envelope_bin(kernel, norms, n_norms, i);
+}
+
+void gaussian_envelope(const double norms[], double envelope[], const int n_norms, WorkerPool &pool) {
+    const GaussianKernel &kernel = gaussian_kernel();
+
+    pool.parallel_for(n_norms, [&](const int begin, const int end, const int) {
+        for(int i = begin; i < end; i++)
+            envelope[i] = gaussian_envelope_bin(kernel, norms, n_norms, i);
+    });
+}
+
+void gaussian_envelope(const double norms[], const int norms_begin, double envelope[], const int n_norms, const int begin, const int end) {
+    const GaussianKernel &kernel = gaussian_kernel();
+
+    for(int i = begin; i < end; i++)
+        envelope[i] = gaussian_envelope_bin(kernel, norms, n_norms, i, norms_begin);
+}
+
+int gaussian_envelope_radius() {
+    return gaussian_kernel().mid;
+}
+
+
+/* Cascaded box filters
+ * Widths are chosen such that the variance of the cascade equals the variance of the (truncated) Gaussian kernel
+ * https://www.peterkovesi.com/papers/FastGaussianSmoothing.pdf
+ * Widths are odd, so the cascade stays centered; mixing two widths gets the variance close
+ */
+constexpr int N_BOX_PASSES = 3;
+struct BoxCascade {
+    int widths[N_BOX_PASSES];
+    int radius;  // Radius of the total cascade kernel
+    std::vector<double> kernel_cumsum;  // Cumulative sum of the cascade kernel, for renormalizing weights at the edges
+};
+
+static BoxCascade make_box_cascade() {
+    const GaussianKernel &gaussian = gaussian_kernel();
+
+    // Variance of the reference kernel
+    double weights = 0.0, variance = 0.0;
+    for(int i = 0; i < (int)gaussian.weights.size(); i++) {
+        weights += gaussian.weights[i];
+        variance += gaussian.weights[i] * (i - gaussian.mid) * (i - gaussian.mid);
+    }
+    variance /= weights;
+
+    // A box of width w has variance (w^2 - 1) / 12
+    const double ideal_width = sqrt((12.0 * variance / N_BOX_PASSES) + 1.0);
+    int lower_width = std::max((int)ideal_width, 1);
+    if(lower_width % 2 == 0)
+        lower_width--;
+    const int upper_width = lower_width + 2;
+    const int n_lower = std::clamp((int)round(((12.0 * variance) - (N_BOX_PASSES * lower_width * lower_width) - (4.0 * N_BOX_PASSES * lower_width) - (3.0 * N_BOX_PASSES))
+                                              / ((-4.0 * lower_width) - 4.0)),
+                                   0, N_BOX_PASSES);
+
+    BoxCascade cascade;
+    cascade.radius = 0;
+    for(int i = 0; i < N_BOX_PASSES; i++) {
+        cascade.widths[i] = i < n_lower ? lower_width : upper_width;
+        cascade.radius += cascade.widths[i] / 2;
+    }
+
+    // Explicit cascade kernel by repeatedly convolving boxes
+    std::vector<double> kernel(1, 1.0);
+    for(int i = 0; i < N_BOX_PASSES; i++) {
+        std::vector<double> next(kernel.size() + cascade.widths[i] - 1, 0.0);
+        for(size_t j = 0; j < kernel.size(); j++)
+            for(int k = 0; k < cascade.widths[i]; k++)
+                next[j + k] += kernel[j];
+        kernel = next;
+    }
+
+    cascade.kernel_cumsum.assign(kernel.size() + 1, 0.0);
+    for(size_t i = 0; i < kernel.size(); i++)
+        cascade.kernel_cumsum[i + 1] = cascade.kernel_cumsum[i] + kernel[i];
+
+    return cascade;
+}
+
+// Thread-safe initialization like gaussian_kernel()
+static const BoxCascade &box_cascade() {
+    static const BoxCascade cascade = make_box_cascade();
+    return cascade;
+}
+
+void box_envelope(const double norms[], double envelope[], const int n_norms, WorkspaceArena &workspace) {
+    const BoxCascade &cascade = box_cascade();
+    const int box_radius = cascade.radius;
+    if(n_norms <= 0)
+        return;
+
+    // Zero-pad on both sides by the cascade radius, so no pass clips a partial sum
+    const int padded_size = n_norms + (2 * box_radius);
+    double *a = workspace.alloc<double>(padded_size);
+    double *b = workspace.alloc<double>(padded_size);
+
+    std::fill_n(a, box_radius, 0.0);
+    std::copy_n(norms, n_norms, a + box_radius);
+    std::fill_n(a + box_radius + n_norms, box_radius, 0.0);
+
+    // Running sum per pass
+    for(int pass = 0; pass < N_BOX_PASSES; pass++) {
+        const int r = cascade.widths[pass] / 2;
+
+        double sum = 0.0;
+        for(int i = 0; i <= std::min(r, padded_size - 1); i++)
+            sum += a[i];
+
+        for(int i = 0; i < padded_size; i++) {
+            b[i] = sum;
+            if(i + r + 1 < padded_size)
+                sum += a[i + r + 1];
+            if(i - r >= 0)
+                sum -= a[i - r];
         }
-        envelope[i] = sum / weights;
+
+        std::swap(a, b);
     }
 
+    // Divide by the kernel weights inside the spectrum
+    for(int i = 0; i < n_norms; i++) {
+        const int first = std::max(-i, -box_radius) + box_radius;
+        const int last = std::min((n_norms - 1) - i, box_radius) + box_radius;
+        envelope[i] = a[box_radius + i] / (cascade.kernel_cumsum[last + 1] - cascade.kernel_cumsum[first]);
+    }
+}
+
+size_t box_envelope_workspace_size(const int n_norms) {
+    const int box_radius = box_cascade().radius;
 
-    // Prevent warning
-    return;
-    precalc++;
+    // Both buffers are padded by the cascade radius on both sides and aligned to a cache line by the arena
+    return (2 * (n_norms + (2 * box_radius)) * sizeof(double)) + (2 * CACHE_LINE_SIZE);
 }
@@ -2,8 +2,28 @@
 #define DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_ENVELOPE_H
 
 
+#include "worker_pool.h"
+#include "workspace_arena.h"
+
+#include <cstddef>  // size_t
+
+
 // Can be called with (NULL, NULL, 0) at any time to pre-calculate Gaussian function
 void gaussian_envelope(const double norms[], double envelope[], const int n_norms);
+// Same, but parallelized over the given worker pool instead of an OpenMP team
+void gaussian_envelope(const double norms[], double envelope[], const int n_norms, WorkerPool &pool);
+// Only computes bins [begin, end) of the envelope, where norms holds the bins from norms_begin on (at least the kernel radius around [begin, end) within [0, n_norms))
+// Gives the same values as the full envelope, so a spectrum can be processed in tiles
+void gaussian_envelope(const double norms[], const int norms_begin, double envelope[], const int n_norms, const int begin, const int end);
+// Half the kernel width in bins (pre-calculates the Gaussian function)
+int gaussian_envelope_radius();
+
+// O(n) approximation of gaussian_envelope() using cascaded box filters with the same variance as the Gaussian kernel
+// Weights are renormalized at the edges like gaussian_envelope(); can also be called with (NULL, NULL, 0, workspace) to pre-calculate
+// The running sums are buffered in the workspace (see box_envelope_workspace_size()), so concurrent calls don't share state
+void box_envelope(const double norms[], double envelope[], const int n_norms, WorkspaceArena &workspace);
+// Bytes box_envelope() allocates from the workspace for n_norms bins
+size_t box_envelope_workspace_size(const int n_norms);
 
 
 #endif  // DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_ENVELOPE_H
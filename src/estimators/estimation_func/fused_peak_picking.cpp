@@ -0,0 +1,114 @@
+#include "fused_peak_picking.h"
+
+#include "norms.h"
+#include "envelope.h"
+
+#include "workspace_arena.h"  // CACHE_LINE_SIZE
+
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+
+#include <fftw3.h>
+
+#include <cmath>
+#include <algorithm>  // std::min(), std::max(), std::fill_n(), std::copy()
+#include <vector>
+#include <memory_resource>
+
+
+size_t fused_envelope_peaks_workspace_size(const int n_threads) {
+    const size_t tile_size = FUSED_TILE_BINS + (2 * std::max((params.kernel_width / 2), 1));
+
+    // Padded to a cache line
+    return (n_threads * tile_size * sizeof(double)) + CACHE_LINE_SIZE;
+}
+
+
+void fused_envelope_peaks(const fftwf_complex values[], double norms[], double envelope[], const int n_norms, std::pmr::vector<int> &peaks, double &max_norm, double &power, WorkerPool &pool) {
+    const int n_threads = pool.get_n_threads();
+    // Bins needed on both sides of a tile; at least one for the local maximum check
+    const int halo = std::max(gaussian_envelope_radius(), 1);
+    const int tile_size = FUSED_TILE_BINS + (2 * halo);
+
+    // One tile buffer per chunk, allocated from the same memory resource as the peaks, so estimators using a workspace arena don't allocate on the heap
+    std::pmr::vector<double> tiles(peaks.get_allocator());
+    tiles.resize(n_threads * tile_size);
+
+    // Chunks without work keep the neutral values
+    double chunk_max[MAX_WORKER_POOL_THREADS];
+    double chunk_power[MAX_WORKER_POOL_THREADS];
+    int chunk_begin[MAX_WORKER_POOL_THREADS];
+    int chunk_n_candidates[MAX_WORKER_POOL_THREADS];
+    std::fill_n(chunk_max, n_threads, -1.0);
+    std::fill_n(chunk_power, n_threads, 0.0);
+    std::fill_n(chunk_begin, n_threads, 0);
+    std::fill_n(chunk_n_candidates, n_threads, 0);
+
+    // Like the parallel envelope_peaks(), every chunk writes its candidates to the start of its own range of bins
+    const size_t n_prev_peaks = peaks.size();
+    peaks.resize(n_prev_peaks + n_norms);
+    int *const out = peaks.data() + n_prev_peaks;
+
+    // Read the runtime parameters once, instead of in every iteration
+    const double envelope_min = params.envelope_min;
+
+    pool.parallel_for(n_norms, [&](const int begin, const int end, const int chunk) {
+        double *const tile = tiles.data() + (chunk * tile_size);
+        double tile_max = -1.0, tile_power = 0.0;
+        int n_candidates = 0;
+
+        // Bins [prev_lo, prev_hi) of the previous tile of this chunk are in the tile buffer
+        int prev_lo = 0, prev_hi = 0;
+        for(int tile_begin = begin; tile_begin < end; tile_begin += FUSED_TILE_BINS) {
+            const int tile_end = std::min(tile_begin + FUSED_TILE_BINS, end);
+            const int lo = std::max(tile_begin - halo, 0);
+            const int hi = std::min(tile_end + halo, n_norms);
+
+            // The tiles of a chunk overlap by their halos, so only the norms of the bins new to this tile are calculated
+            // Only the halos at the edges of a chunk are calculated by the neighbouring chunk as well
+            const int reuse_end = tile_begin == begin ? lo : prev_hi;
+            std::copy(tile + (lo - prev_lo), tile + (reuse_end - prev_lo), tile);
+            calc_norms(values + reuse_end, tile + (reuse_end - lo), hi - reuse_end);
+            prev_lo = lo;
+            prev_hi = hi;
+            for(int i = tile_begin; i < tile_end; i++) {
+                norms[i] = tile[i - lo];
+                tile_power += norms[i];
+                if(norms[i] > tile_max)
+                    tile_max = norms[i];
+            }
+
+            gaussian_envelope(tile, lo, envelope, n_norms, tile_begin, tile_end);
+
+            for(int i = std::max(tile_begin, 5); i < std::min(tile_end, n_norms - 1); i++) {
+                const double norm = tile[i - lo];
+                if(tile[(i - 1) - lo] < norm && norm > tile[(i + 1) - lo]  // A local maximum
+                   && norm > envelope[i]  // Higher than envelope
+                   && envelope[i] > envelope_min)  // Filter quiet peaks
+                    out[begin + n_candidates++] = i;
+            }
+        }
+
+        chunk_max[chunk] = tile_max;
+        chunk_power[chunk] = tile_power;
+        chunk_begin[chunk] = begin;
+        chunk_n_candidates[chunk] = n_candidates;
+    });
+
+    max_norm = -1.0;
+    power = 0.0;
+    for(int i = 0; i < n_threads; i++) {
+        max_norm = std::fmax(max_norm, chunk_max[i]);
+        power += chunk_power[i];
+    }
+
+    // Signal to noise filter; envelope_peaks() takes max_norm as int, so truncate it the same way
+    // Chunks are ordered, so compacting keeps the peaks sorted
+    const double min_norm = (int)max_norm * params.signal_to_noise_filter;
+    int n_peaks = 0;
+    for(int i = 0; i < n_threads; i++)
+        for(int j = chunk_begin[i]; j < chunk_begin[i] + chunk_n_candidates[i]; j++)
+            if(norms[out[j]] > min_norm)
+                out[n_peaks++] = out[j];
+    peaks.resize(n_prev_peaks + n_peaks);
+}
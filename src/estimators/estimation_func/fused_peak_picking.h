@@ -0,0 +1,27 @@
+#ifndef DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_FUSED_PEAK_PICKING_H
+#define DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_FUSED_PEAK_PICKING_H
+
+
+#include "worker_pool.h"
+
+#include <fftw3.h>
+
+#include <cstddef>  // size_t
+#include <vector>
+#include <memory_resource>
+
+
+/* calc_norms(), gaussian_envelope() and envelope_peaks(..., max_norm) in one pass over tiles of FUSED_TILE_BINS bins
+ * Every tile holds the norms of its bins plus the envelope kernel radius around them, so the tile stays in cache and chunks of tiles are independent
+ * Consecutive tiles of a chunk reuse the norms of their overlapping halos, so only the halos at the chunk edges are calculated twice
+ * The signal to noise filter needs the maximum norm of the whole spectrum, so local maxima above the envelope are filtered on it afterwards
+ * Gives the same norms, envelope and peaks as the separate functions (power may differ in rounding, as it is summed in another order)
+ * Tile buffers are allocated from the memory resource of peaks (see fused_envelope_peaks_workspace_size())
+ */
+void fused_envelope_peaks(const fftwf_complex values[], double norms[], double envelope[], const int n_norms, std::pmr::vector<int> &peaks, double &max_norm, double &power, WorkerPool &pool);
+
+// Bytes fused_envelope_peaks() allocates for its tile buffers, besides the peaks
+size_t fused_envelope_peaks_workspace_size(const int n_threads);
+
+
+#endif  // DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_FUSED_PEAK_PICKING_H
@@ -0,0 +1,295 @@
+#include "hot_swap_plan.h"
+
+#include "cache.h"
+#include "error.h"
+
+#include "config/cache.h"
+
+#include <fftw3.h>
+
+#include <string>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <sstream>
+#include <iomanip>  // std::setprecision()
+#include <algorithm>  // std::fill_n(), std::max()
+
+
+/* Queue of plans to measure, which are measured one after another by one planner thread
+ * The planner thread is only started by start(), so no measurement holds the (serialized) planner while estimators are being created
+ */
+class BackgroundPlanner {
+    public:
+        BackgroundPlanner() : measuring(nullptr), started(false), stop(false) {};
+        // Called at exit; waits for a running measurement, but doesn't measure the remaining plans
+        ~BackgroundPlanner() {
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            changed.notify_all();
+
+            if(planner_thread.joinable())
+                planner_thread.join();
+        };
+
+        void push(HotSwapPlan *const plan) {
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                queue.push_back(plan);
+            }
+            changed.notify_all();
+        };
+
+        // Removes the plan from the queue, or waits until it is measured if it is being measured
+        void remove(HotSwapPlan *const plan) {
+            std::unique_lock<std::mutex> lock(mutex);
+            std::erase(queue, plan);
+            changed.wait(lock, [&] {return measuring != plan;});
+        };
+
+        // Waits until the plan is measured (or measuring it failed)
+        void wait_for(HotSwapPlan *const plan) {
+            start();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] {return stop || (measuring != plan && std::find(queue.begin(), queue.end(), plan) == queue.end());});
+        };
+
+        // Cheap after the first call, as it is called before every transform until the measured plan is used
+        void start() {
+            if(started.load(std::memory_order_acquire))
+                return;
+
+            const std::lock_guard<std::mutex> lock(mutex);
+            if(!started.load(std::memory_order_relaxed)) {
+                planner_thread = std::thread(&BackgroundPlanner::planner_loop, this);
+                started.store(true, std::memory_order_release);
+            }
+        };
+
+
+    private:
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<HotSwapPlan *> queue;
+        HotSwapPlan *measuring;
+
+        std::thread planner_thread;
+        std::atomic<bool> started;
+        bool stop;
+
+
+        void planner_loop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while(true) {
+                changed.wait(lock, [&] {return stop || !queue.empty();});
+                if(stop)
+                    return;
+
+                measuring = queue.front();
+                queue.pop_front();
+
+                lock.unlock();
+                measuring->measure_plan();
+                lock.lock();
+
+                measuring = nullptr;
+                changed.notify_all();
+            }
+        };
+};
+
+static BackgroundPlanner background_planner;
+
+
+HotSwapPlan::HotSwapPlan(const int _size, float *const _in, fftwf_complex *const _out)
+        : kind(Kind::r2c), size(_size), howmany(1), sign(FFTW_FORWARD), in(_in), out(_out), measured_plan(NULL) {
+    init_plan();
+}
+
+HotSwapPlan::HotSwapPlan(const int _size, const int _howmany, fftwf_complex *const _in, fftwf_complex *const _out, const int _sign)
+        : kind(Kind::many_c2c), size(_size), howmany(_howmany), sign(_sign), in(_in), out(_out), measured_plan(NULL) {
+    init_plan();
+}
+
+HotSwapPlan::~HotSwapPlan() {
+    if(!swapped)
+        background_planner.remove(this);
+
+    // The measured plan may be ready, but not yet swapped in
+    const fftwf_plan p = measured_plan.load(std::memory_order_acquire);
+    if(p != NULL && p != plan)
+        Cache::destroy_plan(p);
+
+    if(estimate_plan != NULL && estimate_plan != plan)
+        Cache::destroy_plan(estimate_plan);
+
+    Cache::destroy_plan(plan);
+}
+
+
+void HotSwapPlan::init_plan() {
+    estimate_plan = NULL;
+    swapped = true;
+    estimate_time = 0.0;
+    measured_time = 0.0;
+
+    if constexpr(!BACKGROUND_FFTW_PLANNING) {
+        plan = create_plan(in, out, FFTW_PLANNER_FLAGS);
+        if(plan == NULL) {
+            error("Failed to create FFTW3 plan");
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    // Cached wisdom makes planning instant, so no need for a temporary plan
+    plan = create_plan(in, out, FFTW_PLANNER_FLAGS | FFTW_WISDOM_ONLY);
+    if(plan != NULL)
+        return;
+
+    plan = create_plan(in, out, FFTW_ESTIMATE);
+    if(plan == NULL) {
+        error("Failed to create FFTW3 plan");
+        exit(EXIT_FAILURE);
+    }
+    estimate_plan = plan;
+    swapped = false;
+
+    info("Measuring FFTW3 plan for " + description() + " in the background; using an estimated plan until it is ready");
+    background_planner.push(this);
+}
+
+
+fftwf_plan HotSwapPlan::create_plan(void *const plan_in, fftwf_complex *const plan_out, const unsigned int flags) const {
+    switch(kind) {
+        case Kind::r2c:
+            return Cache::plan_dft_r2c_1d(size, (float*)plan_in, plan_out, flags);
+
+        case Kind::many_c2c:
+            return Cache::plan_many_dft(size, howmany, (fftwf_complex*)plan_in, plan_out, sign, flags);
+    }
+
+    return NULL;
+}
+
+
+void HotSwapPlan::execute_plan(const fftwf_plan p, void *const exec_in, fftwf_complex *const exec_out) const {
+    // The new-array execute functions are thread-safe, so the planner thread can time plans while the estimator executes them
+    switch(kind) {
+        case Kind::r2c:
+            fftwf_execute_dft_r2c(p, (float*)exec_in, exec_out);
+            break;
+
+        case Kind::many_c2c:
+            fftwf_execute_dft(p, (fftwf_complex*)exec_in, exec_out);
+            break;
+    }
+}
+
+
+double HotSwapPlan::time_plan(const fftwf_plan p, void *const exec_in, fftwf_complex *const exec_out) const {
+    // Warm up caches
+    execute_plan(p, exec_in, exec_out);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int i = 0; i < BACKGROUND_PLAN_TIMING_REPS; i++)
+        execute_plan(p, exec_in, exec_out);
+    const std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+    return duration.count() / (double)BACKGROUND_PLAN_TIMING_REPS;
+}
+
+
+std::string HotSwapPlan::description() const {
+    switch(kind) {
+        case Kind::r2c:
+            return "real transform of size " + STR(size);
+
+        case Kind::many_c2c:
+            return STR(howmany) + " complex transforms of size " + STR(size);
+    }
+
+    return "";
+}
+
+
+void HotSwapPlan::measure_plan() {
+    // Second set of buffers, as measuring overwrites the buffers it plans on
+    // New-array execution requires the plan to be in-place if the estimator's transform is in-place
+    const bool in_place = in == (void*)out;
+    const int in_size = kind == Kind::r2c ? size * sizeof(float) : size * howmany * sizeof(fftwf_complex);
+    const int out_size = kind == Kind::r2c ? ((size / 2) + 1) * sizeof(fftwf_complex) : size * howmany * sizeof(fftwf_complex);
+    void *const plan_in = fftwf_malloc(in_place ? std::max(in_size, out_size) : in_size);
+    fftwf_complex *const plan_out = in_place ? (fftwf_complex*)plan_in : (fftwf_complex*)fftwf_malloc(out_size);
+    if(plan_in == NULL || plan_out == NULL) {
+        warning("Failed to malloc buffers for measuring FFTW3 plan; keeping the estimated plan");
+        fftwf_free(plan_in);
+        if(!in_place)
+            fftwf_free(plan_out);
+        return;
+    }
+
+    const fftwf_plan p = create_plan(plan_in, plan_out, FFTW_PLANNER_FLAGS);
+    if(p == NULL) {
+        warning("Failed to create measured FFTW3 plan; keeping the estimated plan");
+        fftwf_free(plan_in);
+        if(!in_place)
+            fftwf_free(plan_out);
+        return;
+    }
+
+    // Time on zeros, as measuring left arbitrary values (possibly NaNs or denormals) in the buffers
+    std::fill_n((char*)plan_in, in_size, 0);
+    estimate_time = time_plan(estimate_plan, plan_in, plan_out);
+    measured_time = time_plan(p, plan_in, plan_out);
+
+    fftwf_free(plan_in);
+    if(!in_place)
+        fftwf_free(plan_out);
+
+    measured_plan.store(p, std::memory_order_release);
+}
+
+
+void HotSwapPlan::swap_plan() {
+    const fftwf_plan p = measured_plan.load(std::memory_order_acquire);
+    if(p == NULL)
+        return;
+
+    plan = p;
+    swapped = true;
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3)
+       << "Switched to measured FFTW3 plan for " << description() << " ("
+       << estimate_time * 1000.0 << " ms -> " << measured_time * 1000.0 << " ms per transform";
+    if(measured_time > 0.0)
+        ss << "; " << std::setprecision(2) << estimate_time / measured_time << "x speed-up";
+    ss << ')';
+    info(ss.str());
+}
+
+
+void HotSwapPlan::execute() {
+    // Until swapped, this only adds two atomic loads
+    if(!swapped) {
+        background_planner.start();
+        swap_plan();
+    }
+
+    execute_plan(plan, in, out);
+}
+
+
+void HotSwapPlan::wait_for_measured_plan() {
+    if(!swapped)
+        background_planner.wait_for(this);
+
+    if(!swapped)
+        swap_plan();
+}
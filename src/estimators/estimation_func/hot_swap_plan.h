@@ -0,0 +1,72 @@
+#ifndef DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_HOT_SWAP_PLAN_H
+#define DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_HOT_SWAP_PLAN_H
+
+
+#include <fftw3.h>
+
+#include <atomic>
+#include <string>
+
+
+/* FFTW3 plan which is replaced by a measured plan while already in use
+ * If the cached wisdom covers the transform, the measured plan is created directly
+ * Otherwise, execution starts on an FFTW_ESTIMATE plan and a background thread measures a plan on a second set of buffers,
+ * as measuring overwrites the buffers, which are in use by the estimator
+ * A single planner thread measures the plans of all HotSwapPlans one after another, starting at the first execute() of any of them
+ * The planner is serialized, so this way all estimators are created (and start on their estimated plans) before the planner is held by a measurement
+ * execute() switches to the measured plan once it is ready, so the switch always happens between two transforms
+ * The buffers should be allocated using fftwf_malloc(), as the measured plan is executed on other buffers than it was planned on
+ */
+class HotSwapPlan {
+    public:
+        // Real-to-complex transform of size samples; out should hold (size / 2) + 1 bins
+        HotSwapPlan(const int size, float *const in, fftwf_complex *const out);
+        // howmany contiguous complex transforms of size elements each
+        HotSwapPlan(const int size, const int howmany, fftwf_complex *const in, fftwf_complex *const out, const int sign);
+        // Waits if the planner thread is measuring this plan, as a running planner can't be interrupted
+        ~HotSwapPlan();
+
+        void execute();
+
+        // Blocks until the measured plan is used (for benchmarks)
+        void wait_for_measured_plan();
+
+
+    private:
+        enum class Kind {
+            r2c,
+            many_c2c
+        };
+
+        const Kind kind;
+        const int size;
+        const int howmany;
+        const int sign;
+        void *const in;
+        fftwf_complex *const out;
+
+        fftwf_plan plan;
+        // Kept until destruction, as destroying a plan waits for the planner, which may be measuring another plan
+        fftwf_plan estimate_plan;
+        bool swapped;
+
+        // Set by the planner thread when the measured plan is ready
+        std::atomic<fftwf_plan> measured_plan;
+        // Seconds per transform; written by the planner thread before measured_plan is set
+        double estimate_time, measured_time;
+
+
+        void init_plan();
+        fftwf_plan create_plan(void *const plan_in, fftwf_complex *const plan_out, const unsigned int flags) const;
+        void execute_plan(const fftwf_plan p, void *const exec_in, fftwf_complex *const exec_out) const;
+        double time_plan(const fftwf_plan p, void *const exec_in, fftwf_complex *const exec_out) const;
+        std::string description() const;
+        void swap_plan();
+
+        // Runs in the planner thread
+        friend class BackgroundPlanner;
+        void measure_plan();
+};
+
+
+#endif  // DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_HOT_SWAP_PLAN_H
@@ -1,21 +1,159 @@
 #include "norms.h"
 
+#include "cpu_dispatch.h"
+
 #include <fftw3.h>
 
 #include <cmath>
+#include <algorithm>  // std::fill_n()
+
+
+/* SIMD kernels
+ * Kernels compute the norms of the first n bins they can vectorize and return n, so the caller finishes the tail with scalar code
+ * Like the scalar loop, re * re + im * im is computed in float and the square root in double, so the norms are bit-identical
+ * Only the order of summing the power differs
+ * See cpu_dispatch.h for how the kernel is selected
+ */
+typedef int (*norms_kernel_t)(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power);
+
+static int norms_kernel_none(const fftwf_complex[], double[], const int, double &max_norm, double &power) {
+    max_norm = -1.0;
+    power = 0.0;
+    return 0;
+}
+
+#ifdef CPU_X86
+__attribute__((target("sse2")))
+static int norms_kernel_sse2(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power) {
+    const float *const v = (const float *)values;
+    __m128d max_acc = _mm_set1_pd(-1.0);
+    __m128d power_acc = _mm_setzero_pd();
+
+    const int n_vec = n_norms - (n_norms % 4);
+    for(int i = 0; i < n_vec; i += 4) {
+        const __m128 a = _mm_loadu_ps(v + (2 * i));
+        const __m128 b = _mm_loadu_ps(v + (2 * i) + 4);
+        const __m128 a2 = _mm_mul_ps(a, a);
+        const __m128 b2 = _mm_mul_ps(b, b);
+
+        // Deinterleave into real and imaginary parts
+        const __m128 re2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 im2 = _mm_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m128 sq = _mm_add_ps(re2, im2);
+
+        const __m128d lo = _mm_sqrt_pd(_mm_cvtps_pd(sq));
+        const __m128d hi = _mm_sqrt_pd(_mm_cvtps_pd(_mm_movehl_ps(sq, sq)));
+        _mm_storeu_pd(norms + i, lo);
+        _mm_storeu_pd(norms + i + 2, hi);
+
+        max_acc = _mm_max_pd(max_acc, _mm_max_pd(lo, hi));
+        power_acc = _mm_add_pd(power_acc, _mm_add_pd(lo, hi));
+    }
+
+    double max_lanes[2], power_lanes[2];
+    _mm_storeu_pd(max_lanes, max_acc);
+    _mm_storeu_pd(power_lanes, power_acc);
+    max_norm = std::fmax(max_lanes[0], max_lanes[1]);
+    power = power_lanes[0] + power_lanes[1];
+    return n_vec;
+}
+
+__attribute__((target("avx2")))
+static int norms_kernel_avx2(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power) {
+    const float *const v = (const float *)values;
+    __m256d max_acc = _mm256_set1_pd(-1.0);
+    __m256d power_acc = _mm256_setzero_pd();
+
+    const int n_vec = n_norms - (n_norms % 8);
+    for(int i = 0; i < n_vec; i += 8) {
+        const __m256 a = _mm256_loadu_ps(v + (2 * i));
+        const __m256 b = _mm256_loadu_ps(v + (2 * i) + 8);
+        const __m256 a2 = _mm256_mul_ps(a, a);
+        const __m256 b2 = _mm256_mul_ps(b, b);
+
+        // Shuffles are per 128-bit lane, so bins end up as 0 1 4 5 2 3 6 7; permute pairs of bins back in order
+        const __m256 re2 = _mm256_shuffle_ps(a2, b2, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m256 im2 = _mm256_shuffle_ps(a2, b2, _MM_SHUFFLE(3, 1, 3, 1));
+        const __m256 sq = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_add_ps(re2, im2)), _MM_SHUFFLE(3, 1, 2, 0)));
+
+        const __m256d lo = _mm256_sqrt_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(sq)));
+        const __m256d hi = _mm256_sqrt_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(sq, 1)));
+        _mm256_storeu_pd(norms + i, lo);
+        _mm256_storeu_pd(norms + i + 4, hi);
+
+        max_acc = _mm256_max_pd(max_acc, _mm256_max_pd(lo, hi));
+        power_acc = _mm256_add_pd(power_acc, _mm256_add_pd(lo, hi));
+    }
+
+    double max_lanes[4], power_lanes[4];
+    _mm256_storeu_pd(max_lanes, max_acc);
+    _mm256_storeu_pd(power_lanes, power_acc);
+    max_norm = std::fmax(std::fmax(max_lanes[0], max_lanes[1]), std::fmax(max_lanes[2], max_lanes[3]));
+    power = (power_lanes[0] + power_lanes[1]) + (power_lanes[2] + power_lanes[3]);
+    return n_vec;
+}
+
+// GCC's AVX-512 headers use deliberately undefined registers, which triggers (false) uninitialized warnings
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+__attribute__((target("avx512f")))
+static int norms_kernel_avx512(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power) {
+    const float *const v = (const float *)values;
+    __m512d max_acc = _mm512_set1_pd(-1.0);
+    __m512d power_acc = _mm512_setzero_pd();
+
+    // Indices to deinterleave two vectors of 8 complex values into 16 real and 16 imaginary parts
+    const __m512i re_idx = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i im_idx = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+
+    const int n_vec = n_norms - (n_norms % 16);
+    for(int i = 0; i < n_vec; i += 16) {
+        const __m512 a = _mm512_loadu_ps(v + (2 * i));
+        const __m512 b = _mm512_loadu_ps(v + (2 * i) + 16);
+        const __m512 a2 = _mm512_mul_ps(a, a);
+        const __m512 b2 = _mm512_mul_ps(b, b);
+
+        const __m512 re2 = _mm512_permutex2var_ps(a2, re_idx, b2);
+        const __m512 im2 = _mm512_permutex2var_ps(a2, im_idx, b2);
+        const __m512 sq = _mm512_add_ps(re2, im2);
+
+        const __m512d lo = _mm512_sqrt_pd(_mm512_cvtps_pd(_mm512_castps512_ps256(sq)));
+        const __m512d hi = _mm512_sqrt_pd(_mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(sq), 1))));
+        _mm512_storeu_pd(norms + i, lo);
+        _mm512_storeu_pd(norms + i + 8, hi);
+
+        max_acc = _mm512_max_pd(max_acc, _mm512_max_pd(lo, hi));
+        power_acc = _mm512_add_pd(power_acc, _mm512_add_pd(lo, hi));
+    }
+
+    max_norm = _mm512_reduce_max_pd(max_acc);
+    power = _mm512_reduce_add_pd(power_acc);
+    return n_vec;
+}
+#pragma GCC diagnostic pop
+#endif  // CPU_X86
+
+
+static const norms_kernel_t norms_kernel = select_cpu_kernel<norms_kernel_t>({
+    #ifdef CPU_X86
+    {CpuFeature::avx512f, norms_kernel_avx512},
+    {CpuFeature::avx2, norms_kernel_avx2},
+    {CpuFeature::sse2, norms_kernel_sse2}
+    #endif
+}, norms_kernel_none);
 
 
 // Normalize results: http://fftw.org/fftw3_doc/The-1d-Discrete-Fourier-Transform-_0028DFT_0029.html
 void calc_norms(const fftwf_complex values[], double norms[], const int n_norms) {
-    for(int i = 0; i < n_norms; i++)
-        norms[i] = sqrt((values[i][0] * values[i][0]) + (values[i][1] * values[i][1]));
+    double max_norm, power;
+    calc_norms(values, norms, n_norms, max_norm, power);
 }
 
 void calc_norms(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power) {
-    max_norm = -1.0;
-    power = 0.0;
+    const int n_done = norms_kernel(values, norms, n_norms, max_norm, power);
 
-    for(int i = 0; i < n_norms; i++) {
+    for(int i = n_done; i < n_norms; i++) {
         norms[i] = sqrt((values[i][0] * values[i][0]) + (values[i][1] * values[i][1]));
         power += norms[i];
 
@@ -24,23 +162,48 @@ void calc_norms(const fftwf_complex values[], double norms[], const int n_norms,
     }
 }
 
+void calc_norms(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power, WorkerPool &pool) {
+    // Chunks without work keep the neutral values
+    const int n_threads = pool.get_n_threads();
+    double chunk_max[MAX_WORKER_POOL_THREADS];
+    double chunk_power[MAX_WORKER_POOL_THREADS];
+    std::fill_n(chunk_max, n_threads, -1.0);
+    std::fill_n(chunk_power, n_threads, 0.0);
+
+    pool.parallel_for(n_norms, [&](const int begin, const int end, const int chunk) {
+        calc_norms(values + begin, norms + begin, end - begin, chunk_max[chunk], chunk_power[chunk]);
+    });
+
+    max_norm = -1.0;
+    power = 0.0;
+    for(int i = 0; i < n_threads; i++) {
+        max_norm = std::fmax(max_norm, chunk_max[i]);
+        power += chunk_power[i];
+    }
+}
+
 
 // dB ref: https://www.kvraudio.com/forum/viewtopic.php?t=276092
+// There is no vectorized log10(), so only the norms are computed by the SIMD kernels
 void calc_norms_db(const fftwf_complex values[], double norms[], const int n_norms) {
+    double max_norm, power;
+    calc_norms(values, norms, n_norms, max_norm, power);
+
     for(int i = 0; i < n_norms; i++)
-        // norms[i] = 20.0 * log10(sqrt((values[i][0] * values[i][0]) + (values[i][1] * values[i][1])));
-        norms[i] = 20.0 * log10(1.0 + sqrt((values[i][0] * values[i][0]) + (values[i][1] * values[i][1])));
-        // norms[i] = 20.0 * log10(2.0 * sqrt((values[i][0] * values[i][0]) + (values[i][1] * values[i][1])) / n);
+        // norms[i] = 20.0 * log10(norms[i]);
+        norms[i] = 20.0 * log10(1.0 + norms[i]);
+        // norms[i] = 20.0 * log10(2.0 * norms[i] / n);
 }
 
 void calc_norms_db(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power) {
+    calc_norms(values, norms, n_norms, max_norm, power);
+
     max_norm = -1.0;
     power = 0.0;
-
     for(int i = 0; i < n_norms; i++) {
-        // norms[i] = 20.0 * log10(sqrt((values[i][0] * values[i][0]) + (values[i][1] * values[i][1])));
-        norms[i] = 20.0 * log10(1.0 + sqrt((values[i][0] * values[i][0]) + (values[i][1] * values[i][1])));
-        // norms[i] = 20.0 * log10(2.0 * sqrt((values[i][0] * values[i][0]) + (values[i][1] * values[i][1])) / n);
+        // norms[i] = 20.0 * log10(norms[i]);
+        norms[i] = 20.0 * log10(1.0 + norms[i]);
+        // norms[i] = 20.0 * log10(2.0 * norms[i] / n);
         power += norms[i];
 
         if(norms[i] > max_norm)
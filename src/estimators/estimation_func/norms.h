@@ -2,12 +2,16 @@
 #define DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_NORMS_H
 
 
+#include "worker_pool.h"
+
 #include <fftw3.h>
 
 
+// Vectorized using SSE2/AVX2/AVX-512 kernels, depending on what the CPU supports (detected at start-up)
 // Normalize results: http://fftw.org/fftw3_doc/The-1d-Discrete-Fourier-Transform-_0028DFT_0029.html
 void calc_norms(const fftwf_complex values[], double norms[], const int n_norms);
 void calc_norms(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power);
+void calc_norms(const fftwf_complex values[], double norms[], const int n_norms, double &max_norm, double &power, WorkerPool &pool);
 
 // dB ref: https://www.kvraudio.com/forum/viewtopic.php?t=276092
 void calc_norms_db(const fftwf_complex values[], double norms[], const int n_norms);
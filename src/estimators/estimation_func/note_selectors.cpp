@@ -1,10 +1,16 @@
 #include "note_selectors.h"
 
 #include "note.h"
+#include "workspace_arena.h"  // CACHE_LINE_SIZE
 
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 
+#include <cmath>
+#include <algorithm>  // std::max(), std::min()
+#include <array>
 #include <vector>
+#include <memory_resource>
 
 
 void get_loudest_peak(NoteSet &out_notes, const NoteSet &peaks) {
@@ -55,7 +61,8 @@ void get_most_overtones(NoteSet &out_notes, const NoteSet &peaks) {
         return;
     }
 
-    std::vector<int> n_harmonics(n_peaks, 0);
+    // Allocate from the same memory resource as the output, so estimators using a workspace arena don't allocate on the heap
+    std::pmr::vector<int> n_harmonics(n_peaks, 0, out_notes.get_allocator());
     for(int i = 0; i < n_peaks; i++) {
         for(int j = i + 1; j < n_peaks; j++) {
             const double detected_freq = peaks[j].freq;
@@ -63,8 +70,8 @@ void get_most_overtones(NoteSet &out_notes, const NoteSet &peaks) {
             const double cent_error = 1200.0 * log2(detected_freq / theoretical_freq);
             // const double hz_error = abs(detected_freq - theoretical_freq);
 
-            // if(hz_error > -OVERTONE_ERROR && hz_error < OVERTONE_ERROR)
-            if(cent_error > -OVERTONE_ERROR && cent_error < OVERTONE_ERROR)
+            // if(hz_error > -params.overtone_error && hz_error < params.overtone_error)
+            if(cent_error > -params.overtone_error && cent_error < params.overtone_error)
                 n_harmonics[i]++;
         }
     }
@@ -100,14 +107,15 @@ void get_most_overtones(NoteSet &out_notes, const NoteSet &peaks, NoteSet &out_n
         return;
     }
 
-    std::vector<int> n_harmonics(n_peaks, 0);
+    // Allocate from the same memory resource as the output, so estimators using a workspace arena don't allocate on the heap
+    std::pmr::vector<int> n_harmonics(n_peaks, 0, out_notes.get_allocator());
     for(int i = 0; i < n_peaks; i++) {
         for(int j = i + 1; j < n_peaks; j++) {
             const double detected_freq = peaks[j].freq;
             const double theoretical_freq = peaks[i].freq * round(peaks[j].freq / peaks[i].freq);
             const double cent_error = 1200.0 * log2(detected_freq / theoretical_freq);
 
-            if(cent_error > -OVERTONE_ERROR && cent_error < OVERTONE_ERROR)
+            if(cent_error > -params.overtone_error && cent_error < params.overtone_error)
                 n_harmonics[i]++;
         }
     }
@@ -125,7 +133,7 @@ void get_most_overtones(NoteSet &out_notes, const NoteSet &peaks, NoteSet &out_n
         const double detected_freq = peaks[i].freq;
         const double theoretical_freq = peaks[max_idx].freq * round(peaks[i].freq / peaks[max_idx].freq);
         const double cent_error = 1200.0 * log2(detected_freq / theoretical_freq);
-        if(cent_error > -OVERTONE_ERROR && cent_error < OVERTONE_ERROR)
+        if(cent_error > -params.overtone_error && cent_error < params.overtone_error)
             out_note_peaks.push_back(peaks[i]);
     }
 
@@ -154,13 +162,13 @@ void get_most_overtone_power(NoteSet &out_notes, const NoteSet &peaks) {
         return;
     }
 
-    std::vector<double> overtone_power(n_peaks, 0.0);
+    std::pmr::vector<double> overtone_power(n_peaks, 0.0, out_notes.get_allocator());
     for(int i = 0; i < n_peaks; i++) {
         for(int j = i + 1; j < n_peaks; j++) {
             const double detected_freq = peaks[j].freq;
             const double theoretical_freq = peaks[i].freq * round(peaks[j].freq / peaks[i].freq);
             const double cent_error = 1200.0 * log2(detected_freq / theoretical_freq);
-            if(cent_error > -OVERTONE_ERROR && cent_error < OVERTONE_ERROR)
+            if(cent_error > -params.overtone_error && cent_error < params.overtone_error)
                 overtone_power[i] += peaks[j].amp;
         }
     }
@@ -181,3 +189,111 @@ void get_most_overtone_power(NoteSet &out_notes, const NoteSet &peaks) {
 
     out_notes.push_back(peaks[max_idx]);
 }
+
+
+/* Harmonic sieve */
+constexpr double SIEVE_BIN_CENTS = 100.0 / SIEVE_BINS_PER_SEMITONE;
+// Candidate fundamentals from half a semitone below LOWEST_NOTE to half a semitone above HIGHEST_NOTE
+constexpr int N_SIEVE_BINS = ((HIGHEST_NOTE.midi_number - LOWEST_NOTE.midi_number + 1) * SIEVE_BINS_PER_SEMITONE) + 1;
+
+size_t harmonic_sieve_workspace_size(const int n_peaks) {
+    const size_t bytes = (N_SIEVE_BINS * (2 * sizeof(int) + sizeof(double)))  // Votes, fundamentals and power per bin
+                         + (n_peaks * (sizeof(double) + sizeof(char)));  // Log frequencies and explained flags per peak
+
+    // Every allocation is padded to a cache line
+    return bytes + (5 * CACHE_LINE_SIZE);
+}
+
+static void harmonic_sieve(NoteSet &out_notes, const NoteSet &peaks, NoteSet *const out_note_peaks) {
+    const int n_peaks = peaks.size();
+    if(n_peaks == 0)
+        return;
+
+    // Distance in cents between the fundamental and every harmonic, so only one log2() per peak is needed
+    static const std::array<double, SIEVE_HARMONICS> harmonic_cents = [] {
+        std::array<double, SIEVE_HARMONICS> cents;
+        for(int h = 0; h < SIEVE_HARMONICS; h++)
+            cents[h] = 1200.0 * log2(h + 1);
+        return cents;
+    }();
+    static const double sieve_low_cents = (1200.0 * log2(LOWEST_NOTE.freq)) - 50.0;
+
+    // Allocate from the same memory resource as the output, so estimators using a workspace arena don't allocate on the heap
+    std::pmr::vector<int> votes(N_SIEVE_BINS, 0, out_notes.get_allocator());
+    std::pmr::vector<double> vote_power(N_SIEVE_BINS, 0.0, out_notes.get_allocator());
+    std::pmr::vector<int> fundamentals(N_SIEVE_BINS, -1, out_notes.get_allocator());  // Loudest peak on the candidate itself
+    std::pmr::vector<double> peak_cents(n_peaks, 0.0, out_notes.get_allocator());
+    std::pmr::vector<char> explained(n_peaks, false, out_notes.get_allocator());
+
+    // Adds (or removes) the votes of peak i for all candidate fundamentals it is a harmonic of
+    const int spread = (int)(params.overtone_error / SIEVE_BIN_CENTS);
+    const auto vote = [&](const int i, const int sign) {
+        for(int h = 0; h < SIEVE_HARMONICS; h++) {
+            const int center = (int)round((peak_cents[i] - harmonic_cents[h]) / SIEVE_BIN_CENTS);
+            if(center + spread < 0)
+                break;  // Higher harmonics only give lower candidates
+
+            for(int b = std::max(center - spread, 0); b <= std::min(center + spread, N_SIEVE_BINS - 1); b++) {
+                votes[b] += sign;
+                vote_power[b] += sign * peaks[i].amp;
+            }
+        }
+    };
+
+    for(int i = 0; i < n_peaks; i++) {
+        peak_cents[i] = (1200.0 * log2(peaks[i].freq)) - sieve_low_cents;
+        vote(i, 1);
+
+        const int center = (int)round(peak_cents[i] / SIEVE_BIN_CENTS);
+        for(int b = std::max(center - spread, 0); b <= std::min(center + spread, N_SIEVE_BINS - 1); b++)
+            if(fundamentals[b] == -1 || peaks[i].amp > peaks[fundamentals[b]].amp)
+                fundamentals[b] = i;
+    }
+
+    if(out_note_peaks != nullptr)
+        out_note_peaks->clear();
+
+    while((int)out_notes.size() < MAX_POLYPHONY) {
+        // Candidate with most votes, where the power of the votes breaks ties
+        int best = -1;
+        for(int b = 0; b < N_SIEVE_BINS; b++) {
+            const int f = fundamentals[b];
+            if(f == -1 || explained[f] || peaks[f].amp < 0.0)  // Filter noise
+                continue;
+
+            if(best == -1 || votes[b] > votes[best] || (votes[b] == votes[best] && vote_power[b] > vote_power[best]))
+                best = b;
+        }
+
+        if(best == -1 || votes[best] < (out_notes.size() == 0 ? 1 : SIEVE_MIN_HARMONICS))
+            break;
+
+        // Remove the votes of the peaks explained by the selected note
+        // Peaks shared with other notes (like the harmonics of an octave higher note) are removed as well
+        const int f = fundamentals[best];
+        for(int i = 0; i < n_peaks; i++) {
+            const int h = (int)round(peaks[i].freq / peaks[f].freq);
+            if(explained[i] || h < 1)
+                continue;
+
+            const double cent_error = peak_cents[i] - peak_cents[f] - (h <= SIEVE_HARMONICS ? harmonic_cents[h - 1] : 1200.0 * log2(h));
+            if(cent_error > -params.overtone_error && cent_error < params.overtone_error) {
+                vote(i, -1);
+                explained[i] = true;
+
+                if(out_note_peaks != nullptr)
+                    out_note_peaks->push_back(peaks[i]);
+            }
+        }
+
+        out_notes.push_back(peaks[f]);
+    }
+}
+
+void get_harmonic_sieve(NoteSet &out_notes, const NoteSet &peaks) {
+    harmonic_sieve(out_notes, peaks, nullptr);
+}
+
+void get_harmonic_sieve(NoteSet &out_notes, const NoteSet &peaks, NoteSet &out_note_peaks) {
+    harmonic_sieve(out_notes, peaks, &out_note_peaks);
+}
@@ -4,6 +4,8 @@
 
 #include "note.h"
 
+#include <cstddef>  // size_t
+
 
 void get_loudest_peak(NoteSet &out_notes, const NoteSet &peaks);
 void get_lowest_peak(NoteSet &out_notes, const NoteSet &peaks);
@@ -11,5 +13,15 @@ void get_most_overtones(NoteSet &out_notes, const NoteSet &peaks);
 void get_most_overtones(NoteSet &out_notes, const NoteSet &peaks, NoteSet &out_note_peaks);
 void get_most_overtone_power(NoteSet &out_notes, const NoteSet &peaks);
 
+/* Polyphonic selector in O(n_peaks * SIEVE_HARMONICS)
+ * Every peak votes for the candidate fundamentals it is a harmonic of, in a histogram of cents quantised bins between LOWEST_NOTE and HIGHEST_NOTE
+ * The candidate with most votes (and a peak on the fundamental) is selected, after which the votes of its harmonics are removed and the next is searched
+ * Notes are ordered on selection, so out_notes[0] is the note get_most_overtones() would generally select
+ */
+void get_harmonic_sieve(NoteSet &out_notes, const NoteSet &peaks);
+void get_harmonic_sieve(NoteSet &out_notes, const NoteSet &peaks, NoteSet &out_note_peaks);
+// Bytes get_harmonic_sieve() allocates from the memory resource of out_notes for n_peaks peaks
+size_t harmonic_sieve_workspace_size(const int n_peaks);
+
 
 #endif  // DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_NOTE_SELECTORS_H
@@ -1,12 +1,15 @@
 #include "peak_pickers.h"
 
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 
 #include <cmath>
+#include <algorithm>  // std::min(), std::max(), std::fill_n(), std::copy()
 #include <vector>
+#include <memory_resource>
 
 
-void all_max(const double norms[], const int n_norms, std::vector<int> &peaks) {
+void all_max(const double norms[], const int n_norms, std::pmr::vector<int> &peaks) {
     for(int i = 1; i < n_norms - 1; i++) {
         if(norms[i - 1] < norms[i] && norms[i] > norms[i + 1])
             peaks.push_back(i);
@@ -14,47 +17,87 @@ void all_max(const double norms[], const int n_norms, std::vector<int> &peaks) {
 
     // Filter quiet peaks
     for(size_t i = peaks.size(); i > 0; i--) {
-        if(norms[peaks[i - 1]] < PEAK_THRESHOLD)
+        if(norms[peaks[i - 1]] < params.peak_threshold)
             peaks.erase(peaks.begin() + (i - 1));
     }
 }
 
 // With signal to noise filter
-void all_max(const double norms[], const int n_norms, std::vector<int> &peaks, const int max_norm) {
+void all_max(const double norms[], const int n_norms, std::pmr::vector<int> &peaks, const int max_norm) {
     for(int i = 1; i < n_norms - 1; i++) {
-        if(norms[i - 1] < norms[i] && norms[i] > norms[i + 1] && norms[i] > max_norm * SIGNAL_TO_NOISE_FILTER)
+        if(norms[i - 1] < norms[i] && norms[i] > norms[i + 1] && norms[i] > max_norm * params.signal_to_noise_filter)
             peaks.push_back(i);
     }
 
     // Filter quiet peaks
     for(size_t i = peaks.size(); i > 0; i--) {
-        if(norms[peaks[i - 1]] < PEAK_THRESHOLD)
+        if(norms[peaks[i - 1]] < params.peak_threshold)
             peaks.erase(peaks.begin() + (i - 1));
     }
 }
 
 
-void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::vector<int> &peaks) {
+void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::pmr::vector<int> &peaks) {
     for(int i = 5; i < n_norms - 1; i++) {
         if(norms[i - 1] < norms[i] && norms[i] > norms[i + 1]  // A local maximum
            && norms[i] > envelope[i]  // Higher than envelope
-           && envelope[i] > ENVELOPE_MIN)  // Filter quiet peaks
+           && envelope[i] > params.envelope_min)  // Filter quiet peaks
             peaks.push_back(i);
     }
 }
 
-void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::vector<int> &peaks, const int max_norm) {
+void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::pmr::vector<int> &peaks, const int max_norm) {
     for(int i = 5; i < n_norms - 1; i++) {
         if(norms[i - 1] < norms[i] && norms[i] > norms[i + 1]  // A local maximum
            && norms[i] > envelope[i]  // Higher than envelope
-           && envelope[i] > ENVELOPE_MIN  // Filter quiet peaks
-           && norms[i] > max_norm * SIGNAL_TO_NOISE_FILTER)
+           && envelope[i] > params.envelope_min  // Filter quiet peaks
+           && norms[i] > max_norm * params.signal_to_noise_filter)
             peaks.push_back(i);
     }
 }
 
+void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::pmr::vector<int> &peaks, const int max_norm, WorkerPool &pool) {
+    // Every chunk writes its peaks to the start of its own range of bins, as a chunk can't have more peaks than bins
+    // This avoids allocating a vector per chunk
+    const int n_threads = pool.get_n_threads();
+    int chunk_begin[MAX_WORKER_POOL_THREADS];
+    int chunk_n_peaks[MAX_WORKER_POOL_THREADS];
+    std::fill_n(chunk_begin, n_threads, 0);
+    std::fill_n(chunk_n_peaks, n_threads, 0);
 
-void min_dy_peaks(const double norms[], const int n_norms, std::vector<int> &peaks) {
+    const size_t n_prev_peaks = peaks.size();
+    peaks.resize(n_prev_peaks + n_norms);
+    int *const out = peaks.data() + n_prev_peaks;
+
+    // Read the runtime parameters once, instead of in every iteration
+    const double envelope_min = params.envelope_min;
+    const double min_norm = max_norm * params.signal_to_noise_filter;
+
+    pool.parallel_for(n_norms, [&](const int begin, const int end, const int chunk) {
+        int n_peaks = 0;
+        for(int i = std::max(begin, 5); i < std::min(end, n_norms - 1); i++) {
+            if(norms[i - 1] < norms[i] && norms[i] > norms[i + 1]  // A local maximum
+               && norms[i] > envelope[i]  // Higher than envelope
+               && envelope[i] > envelope_min  // Filter quiet peaks
+               && norms[i] > min_norm)
+                out[begin + n_peaks++] = i;
+        }
+
+        chunk_begin[chunk] = begin;
+        chunk_n_peaks[chunk] = n_peaks;
+    });
+
+    // Chunks are ordered, so compacting keeps the peaks sorted
+    int n_peaks = 0;
+    for(int i = 0; i < n_threads; i++) {
+        std::copy(out + chunk_begin[i], out + chunk_begin[i] + chunk_n_peaks[i], out + n_peaks);
+        n_peaks += chunk_n_peaks[i];
+    }
+    peaks.resize(n_prev_peaks + n_peaks);
+}
+
+
+void min_dy_peaks(const double norms[], const int n_norms, std::pmr::vector<int> &peaks) {
     bool was_peak = false;  // If last extreme value was a peak
     int extreme_value_idx = 0;
 
@@ -71,7 +114,7 @@ void min_dy_peaks(const double norms[], const int n_norms, std::vector<int> &pea
             // If previous extreme value was a valley, look for a peak
             if(norms[i - 1] < norms[i] && norms[i] > norms[i + 1]) {
                 // If difference in y is significant enough
-                if(abs(norms[extreme_value_idx] - norms[i]) > MIN_PEAK_DY) {
+                if(abs(norms[extreme_value_idx] - norms[i]) > params.min_peak_dy) {
                     peaks.push_back(i);
                 }
                 was_peak = true;
@@ -2,25 +2,30 @@
 #define DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_PEAK_PICKERS_H
 
 
+#include "worker_pool.h"
+
 #include <vector>
+#include <memory_resource>
 
 
 /* TODO: Description */
-void all_max(const double norms[], const int n_norms, std::vector<int> &peaks);
+void all_max(const double norms[], const int n_norms, std::pmr::vector<int> &peaks);
 
 // With signal to noise filter
-void all_max(const double norms[], const int n_norms, std::vector<int> &peaks, const int max_norm);
+void all_max(const double norms[], const int n_norms, std::pmr::vector<int> &peaks, const int max_norm);
 
 
 /* TODO: Description */
-void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::vector<int> &peaks);
+void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::pmr::vector<int> &peaks);
 
 // With signal to noise filter
-void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::vector<int> &peaks, const int max_norm);
+void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::pmr::vector<int> &peaks, const int max_norm);
+// Parallelized over the given worker pool; gives the same (sorted) peaks
+void envelope_peaks(const double norms[], const double envelope[], const int n_norms, std::pmr::vector<int> &peaks, const int max_norm, WorkerPool &pool);
 
 
 /* TODO: Description */
-void min_dy_peaks(const double norms[], const int n_norms, std::vector<int> &peaks);
+void min_dy_peaks(const double norms[], const int n_norms, std::pmr::vector<int> &peaks);
 
 
 #endif  // DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_PEAK_PICKERS_H
@@ -0,0 +1,145 @@
+#include "pruned_fft.h"
+
+#include "hot_swap_plan.h"
+
+#include "error.h"
+
+#include <fftw3.h>
+
+#include <cmath>
+#include <algorithm>  // std::min()
+
+
+PrunedFFT::PrunedFFT(const int _frame_size, const int _padded_size, const int _n_out_bins)
+        : frame_size(_frame_size), padded_size(_padded_size), pad_factor(_padded_size / _frame_size), n_sub_ffts((pad_factor / 2) + 1),
+          n_out_bins(std::min(_n_out_bins, (_padded_size / 2) + 1)), n_q((n_out_bins + pad_factor - 1) / pad_factor) {
+    if(padded_size % frame_size != 0) {
+        error("Pruned FFT requires the padded size (" + STR(padded_size) + ") to be a multiple of the frame size (" + STR(frame_size) + ")");
+        exit(EXIT_FAILURE);
+    }
+    if(n_out_bins < 1) {
+        error("Pruned FFT should compute at least one bin");
+        exit(EXIT_FAILURE);
+    }
+
+    // Smallest split of the frame which still holds all needed bins; the frame itself if it can't be split
+    n_splits = 1;
+    for(int m = frame_size; m > 1; m--) {
+        if(frame_size % m == 0 && frame_size / m >= 2 * n_q) {
+            n_splits = m;
+            break;
+        }
+    }
+    split_size = frame_size / n_splits;
+
+    sub_buffer = (fftwf_complex*)fftwf_malloc(n_sub_ffts * frame_size * sizeof(fftwf_complex));
+    twiddles = (fftwf_complex*)fftwf_malloc(n_sub_ffts * frame_size * sizeof(fftwf_complex));
+    if(sub_buffer == NULL || twiddles == NULL) {
+        error("Failed to malloc pruned FFT buffers");
+        exit(EXIT_FAILURE);
+    }
+
+    // Compute twiddles in double precision, reducing r * n modulo padded_size to keep the angle exact
+    // Sample n = m + (M * j) of sub-FFT r is stored at split m, index j
+    for(int r = 0; r < n_sub_ffts; r++) {
+        for(int n = 0; n < frame_size; n++) {
+            const long rn = ((long)r * (long)n) % padded_size;
+            const double angle = -(2.0 * M_PI * (double)rn) / (double)padded_size;
+            const int idx = (((r * n_splits) + (n % n_splits)) * split_size) + (n / n_splits);
+            twiddles[idx][0] = cos(angle);
+            twiddles[idx][1] = sin(angle);
+        }
+    }
+
+    try {
+        recombine_re = new double[2 * n_q * n_splits];
+        recombine_im = new double[2 * n_q * n_splits];
+    }
+    catch(const std::bad_alloc &e) {
+        error("Failed to allocate pruned FFT recombination twiddles (" + STR(e.what()) + ")");
+        exit(EXIT_FAILURE);
+    }
+    for(int q = -n_q; q < n_q; q++) {
+        for(int m = 0; m < n_splits; m++) {
+            const long mq = (((long)m * (long)q) % frame_size + frame_size) % frame_size;
+            const double angle = -(2.0 * M_PI * (double)mq) / (double)frame_size;
+            recombine_re[((q + n_q) * n_splits) + m] = cos(angle);
+            recombine_im[((q + n_q) * n_splits) + m] = sin(angle);
+        }
+    }
+
+    // In-place, as the twiddled input is rewritten every call anyway
+    plan = new HotSwapPlan(split_size, n_sub_ffts * n_splits, sub_buffer, sub_buffer, FFTW_FORWARD);
+}
+
+PrunedFFT::~PrunedFFT() {
+    delete plan;
+    delete[] recombine_im;
+    delete[] recombine_re;
+    fftwf_free(twiddles);
+    fftwf_free(sub_buffer);
+}
+
+
+void PrunedFFT::wait_for_measured_plan() {
+    plan->wait_for_measured_plan();
+}
+
+
+void PrunedFFT::execute(const float *const in, fftwf_complex *const out) {
+    // Twiddle and decimate input for every split of every sub-FFT (r = 0 has unit twiddles)
+    for(int m = 0; m < n_splits; m++) {
+        fftwf_complex *const split = sub_buffer + (m * split_size);
+        for(int j = 0; j < split_size; j++) {
+            split[j][0] = in[m + (n_splits * j)];
+            split[j][1] = 0.0;
+        }
+    }
+    for(int r = 1; r < n_sub_ffts; r++) {
+        for(int m = 0; m < n_splits; m++) {
+            const int offset = ((r * n_splits) + m) * split_size;
+            fftwf_complex *const split = sub_buffer + offset;
+            const fftwf_complex *const tw = twiddles + offset;
+            for(int j = 0; j < split_size; j++) {
+                const float sample = in[m + (n_splits * j)];
+                split[j][0] = sample * tw[j][0];
+                split[j][1] = sample * tw[j][1];
+            }
+        }
+    }
+
+    plan->execute();
+
+    // Recombine the splits of sub-FFT r into its bin q (-n_q <= q < n_q)
+    const auto sub_fft_bin = [&](const int r, const int q, double &re, double &im) {
+        const fftwf_complex *const splits = sub_buffer + ((r * n_splits) * split_size) + (q >= 0 ? q : q + split_size);
+        const double *const rec_re = recombine_re + ((q + n_q) * n_splits);
+        const double *const rec_im = recombine_im + ((q + n_q) * n_splits);
+        re = 0.0;
+        im = 0.0;
+        for(int m = 0; m < n_splits; m++) {
+            const double a = splits[m * split_size][0];
+            const double b = splits[m * split_size][1];
+            re += (rec_re[m] * a) - (rec_im[m] * b);
+            im += (rec_re[m] * b) + (rec_im[m] * a);
+        }
+    };
+
+    // Interleave sub-FFT bins; residues above P / 2 are conjugates of bin (padded_size - k)
+    for(int k = 0; k < n_out_bins; k++) {
+        const int q = k / pad_factor;
+        const int r = k % pad_factor;
+
+        double re, im;
+        if(r < n_sub_ffts) {
+            sub_fft_bin(r, q, re, im);
+            out[k][0] = re;
+            out[k][1] = im;
+        }
+        else {
+            sub_fft_bin(pad_factor - r, -(q + 1), re, im);
+            out[k][0] = re;
+            out[k][1] = -im;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_PRUNED_FFT_H
+#define DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_PRUNED_FFT_H
+
+
+#include "hot_swap_plan.h"
+
+#include <fftw3.h>
+
+
+/* Real-to-complex transform of a zero-padded frame, skipping the known zero input and the bins above n_out_bins
+ * With padded_size = P * frame_size, bin k = P * q + r only depends on sub-FFT r:
+ *     X[P * q + r] = FFT_frame_size(x[n] * e^(-2pi*i*r*n / padded_size))[q]
+ * For real input, sub-FFT P - r is the conjugate mirror of sub-FFT r, so only P / 2 + 1 sub-FFTs are computed
+ * Only bins -Q <= q < Q of every sub-FFT are needed (Q = ceil(n_out_bins / P)), so the sub-FFTs are output pruned as well:
+ * with frame_size = M * L and L >= 2Q, every sub-FFT is split in M FFTs of size L of its decimated input, recombined as
+ *     FFT_frame_size(y)[q] = sum_m e^(-2pi*i*m*q / frame_size) * FFT_L(y[m + M * j])[q mod L]
+ * Output equals fftwf_plan_dft_r2c_1d(padded_size, ...) up to floating point rounding (so results differ slightly)
+ */
+class PrunedFFT {
+    public:
+        // Only the first n_out_bins bins are computed (at most (padded_size / 2) + 1)
+        PrunedFFT(const int _frame_size, const int _padded_size, const int _n_out_bins);
+        ~PrunedFFT();
+
+        // Only the first frame_size samples of in are read; writes the first n_out_bins bins to out
+        void execute(const float *const in, fftwf_complex *const out);
+
+        // Size of the FFTs the sub-FFTs are split in (for benchmarks)
+        int get_split_size() const {return split_size;};
+
+        // Blocks until the sub-FFTs use the measured plan (for benchmarks)
+        void wait_for_measured_plan();
+
+
+    private:
+        const int frame_size;
+        const int padded_size;
+        const int pad_factor;  // P
+        const int n_sub_ffts;
+        const int n_out_bins;
+        const int n_q;  // Q; every sub-FFT bin -n_q <= q < n_q is needed
+        int split_size;  // L
+        int n_splits;  // M
+
+        // Decimated twiddled input of every split of every sub-FFT, transformed in-place as one batch
+        fftwf_complex *sub_buffer;
+        fftwf_complex *twiddles;  // In the layout of sub_buffer
+        double *recombine_re;  // e^(-2pi*i*m*q / frame_size) for every q and m
+        double *recombine_im;
+        HotSwapPlan *plan;
+};
+
+
+#endif  // DIGISTRING_ESTIMATORS_ESTIMATION_FUNC_PRUNED_FFT_H
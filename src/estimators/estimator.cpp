@@ -29,6 +29,11 @@ const EstimatorGraphics *Estimator::get_estimator_graphics() {
 }
 
 
+void Estimator::reset() {
+
+}
+
+
 void Estimator::next_plot_type() {
     if(estimator_graphics == nullptr) {
         warning("Current Estimator has no graphics");
@@ -12,10 +12,10 @@
 #include <vector>
 
 
-/* When adding a new estimator, don't forget to include the file in estimators.h */
+/* When adding a new estimator, don't forget to include the file in estimators.h and add it to the factory */
 // Different estimator algorithms types
 enum class Estimators {
-    highres, basic_fourier, tuned
+    highres, basic_fourier, tuned, sliding_highres, ensemble, goertzel, constant_q, yin, multires_highres
 };
 
 // For printing enum
@@ -23,7 +23,38 @@ enum class Estimators {
 const std::map<const Estimators, const std::string> EstimatorString = {
     {Estimators::highres, "highres"},
     {Estimators::basic_fourier, "basic fourier"},
-    {Estimators::tuned, "tuned"}
+    {Estimators::tuned, "tuned"},
+    {Estimators::sliding_highres, "sliding highres"},
+    {Estimators::ensemble, "ensemble"},
+    {Estimators::goertzel, "goertzel"},
+    {Estimators::constant_q, "constant-Q"},
+    {Estimators::yin, "YIN"},
+    {Estimators::multires_highres, "multi-resolution highres"}
+};
+
+// For selecting an estimator using CLI args
+const std::map<const std::string, const Estimators> parse_estimator_string = {
+    {"highres", Estimators::highres},
+    {"basic_fourier", Estimators::basic_fourier},
+    {"tuned", Estimators::tuned},
+    {"sliding_highres", Estimators::sliding_highres},
+    {"ensemble", Estimators::ensemble},
+    {"goertzel", Estimators::goertzel},
+    {"constant_q", Estimators::constant_q},
+    {"yin", Estimators::yin},
+    {"multires_highres", Estimators::multires_highres}
+};
+
+const std::map<const Estimators, const std::string> estimator_description = {
+    {Estimators::highres, "Zero-padded Fourier transform with envelope based peak picking (default)"},
+    {Estimators::basic_fourier, "Loudest bin of a plain Fourier transform"},
+    {Estimators::tuned, "Fourier transforms with bins tuned to the notes (WIP)"},
+    {Estimators::sliding_highres, "HighRes sliding only the bins around its peaks over the new samples of overlapping frames"},
+    {Estimators::ensemble, "Runs the estimators in config/ensemble.h in parallel and combines their results"},
+    {Estimators::goertzel, "Goertzel resonators at the harmonics of every note in range"},
+    {Estimators::constant_q, "Constant-Q transform with a cached sparse spectral kernel"},
+    {Estimators::yin, "Time domain YIN on frames of a few periods (low latency)"},
+    {Estimators::multires_highres, "HighRes over shorter frames for higher notes (lower latency for high notes)"}
 };
 
 
@@ -37,12 +68,17 @@ class Estimator {
         virtual Estimators get_type() const = 0;
 
         // The estimator graphics pointer is valid till the next perform() call
-        const EstimatorGraphics *get_estimator_graphics();
-        void next_plot_type();
+        // Virtual, so estimators wrapping other estimators can forward the graphics
+        virtual const EstimatorGraphics *get_estimator_graphics();
+        virtual void next_plot_type();
 
         // Actually performs the estimation
         virtual void perform(float *const input_buffer, NoteEvents &note_events) = 0;
 
+        // Forgets the state kept between frames, so the next frame is estimated like the first frame of a new recording
+        // Estimators which keep no state don't have to override this
+        virtual void reset();
+
 
     protected:
         // Graphics output related variables, so only available without headless mode
@@ -0,0 +1,49 @@
+#include "estimators.h"
+
+#include "highres.h"
+#include "basic_fourier.h"
+#include "tuned.h"
+#include "sliding_highres.h"
+#include "ensemble.h"
+#include "goertzel.h"
+#include "constant_q.h"
+#include "yin.h"
+#include "multires_highres.h"
+
+#include "error.h"
+
+
+Estimator *estimator_factory(const Estimators &estimator_type, float *&input_buffer, int &buffer_size) {
+    switch(estimator_type) {
+        case Estimators::highres:
+            return new HighRes(input_buffer, buffer_size);
+
+        case Estimators::basic_fourier:
+            return new BasicFourier(input_buffer, buffer_size);
+
+        case Estimators::tuned:
+            return new Tuned(input_buffer, buffer_size);
+
+        case Estimators::sliding_highres:
+            return new SlidingHighRes(input_buffer, buffer_size);
+
+        case Estimators::ensemble:
+            return new Ensemble(input_buffer, buffer_size);
+
+        case Estimators::goertzel:
+            return new Goertzel(input_buffer, buffer_size);
+
+        case Estimators::constant_q:
+            return new ConstantQ(input_buffer, buffer_size);
+
+        case Estimators::yin:
+            return new Yin(input_buffer, buffer_size);
+
+        case Estimators::multires_highres:
+            return new MultiResHighRes(input_buffer, buffer_size);
+
+        default:
+            error("Estimator factory doesn't recognize estimator type");
+            exit(EXIT_FAILURE);
+    }
+}
@@ -9,6 +9,15 @@
 #include "highres.h"
 #include "basic_fourier.h"
 #include "tuned.h"
+#include "sliding_highres.h"
+#include "ensemble.h"
+#include "goertzel.h"
+#include "constant_q.h"
+#include "yin.h"
+#include "multires_highres.h"
+
+
+Estimator *estimator_factory(const Estimators &estimator_type, float *&input_buffer, int &buffer_size);
 
 
 #endif  // DIGISTRING_ESTIMATORS_ESTIMATORS_H
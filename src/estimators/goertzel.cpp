@@ -0,0 +1,162 @@
+#include "goertzel.h"
+
+#include "note.h"
+#include "error.h"
+
+#include "estimation_func/window_func.h"
+
+#include "config/audio.h"
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+#include "config/graphics.h"
+
+#include <cmath>
+#include <algorithm>  // std::max()
+
+
+Goertzel::Goertzel(float *&input_buffer, int &buffer_size)
+        : sample_rate(params.analysis_sample_rate),
+          pool(WORKER_POOL_THREADS, WORKER_POOL_PIN, WORKER_POOL_FIRST_CPU, WORKER_POOL_SPIN_ITERATIONS, 1) {
+    hann_window(window_table, GOERTZEL_WINDOW_TABLE_SIZE);
+
+    for(int i = 0; i < GOERTZEL_N_NOTES; i++) {
+        const double freq = Note(LOWEST_NOTE.midi_number + i).freq;
+
+        block_sizes[i] = std::max((int)round(GOERTZEL_PERIODS * (double)sample_rate / freq), 1);
+        window_strides[i] = (double)GOERTZEL_WINDOW_TABLE_SIZE / (double)block_sizes[i];
+
+        window_sums[i] = 0.0;
+        for(int j = 0; j < block_sizes[i]; j++)
+            window_sums[i] += window_table[(int)(j * window_strides[i])];
+
+        // Resonators above the Nyquist frequency still run (so all lanes do the same work), but are ignored
+        n_harmonics[i] = 0;
+        for(int h = 0; h < GOERTZEL_HARMONICS; h++) {
+            const double harmonic_freq = (h + 1) * freq;
+            if(harmonic_freq < sample_rate / 2.0)
+                n_harmonics[i]++;
+
+            coefs[i][h] = 2.0 * cos((2.0 * M_PI * harmonic_freq) / (double)sample_rate);
+        }
+
+        if(n_harmonics[i] == 0) {
+            error("Fundamental of " + note_to_string(Note(LOWEST_NOTE.midi_number + i)) + " is above the Nyquist frequency");
+            hint("Increase the sample rate or lower HIGHEST_NOTE in config/transcription.h");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Let the caller know the number of samples to request from SampleGetter each call
+    frame_size = block_sizes[0];
+    buffer_size = frame_size;
+
+    try {
+        in = new float[frame_size];
+    }
+    catch(const std::bad_alloc &e) {
+        error("Failed to allocate sample input buffer (" + STR(e.what()) + ")");
+        hint("Try using less Goertzel periods (GOERTZEL_PERIODS in config/transcription.h)");
+        exit(EXIT_FAILURE);
+    }
+    input_buffer = in;  // Share the input buffer with caller, so SampleGetter can directly write samples to it (no copies needed)
+
+    if constexpr(!HEADLESS)
+        estimator_graphics = new GoertzelGraphics();
+}
+
+Goertzel::~Goertzel() {
+    if constexpr(!HEADLESS)
+        delete estimator_graphics;
+
+    delete[] in;
+}
+
+
+Estimators Goertzel::get_type() const {
+    return Estimators::goertzel;
+}
+
+
+// s[n] = x[n] + 2cos(w) * s[n - 1] - s[n - 2], after which |X(w)|^2 = s[n]^2 + s[n - 1]^2 - 2cos(w) * s[n] * s[n - 1]
+void Goertzel::resonate(const float *const input_buffer, const int note_idx) {
+    const int block_size = block_sizes[note_idx];
+    const double window_stride = window_strides[note_idx];
+    const float *const __restrict x = input_buffer + (frame_size - block_size);
+    const float *const __restrict w = window_table;
+    const double *const __restrict c = coefs[note_idx];
+
+    // Fixed number of lanes, so the inner loop is unrolled and vectorized
+    double s1[GOERTZEL_HARMONICS] = {};
+    double s2[GOERTZEL_HARMONICS] = {};
+    for(int j = 0; j < block_size; j++) {
+        const double sample = x[j] * w[(int)(j * window_stride)];
+
+        for(int h = 0; h < GOERTZEL_HARMONICS; h++) {
+            const double s0 = sample + (c[h] * s1[h]) - s2[h];
+            s2[h] = s1[h];
+            s1[h] = s0;
+        }
+    }
+
+    // A sine of amplitude A results in |X(w)| = A * (window sum / 2)
+    for(int h = 0; h < GOERTZEL_HARMONICS; h++) {
+        const double power = (s1[h] * s1[h]) + (s2[h] * s2[h]) - (c[h] * s1[h] * s2[h]);
+        amplitudes[note_idx][h] = h < n_harmonics[note_idx] ? (2.0 * sqrt(std::max(power, 0.0))) / window_sums[note_idx] : 0.0;
+    }
+}
+
+
+void Goertzel::perform(float *const input_buffer, NoteEvents &note_events) {
+    // Block sizes halve every octave, so contiguous ranges of notes would give the first worker most of the work
+    // Instead, every worker takes every n_threads'th note
+    const int n_threads = pool.get_n_threads();
+    pool.parallel_for(n_threads, [&](const int begin, const int end, const int) {
+        for(int t = begin; t < end; t++)
+            for(int i = t; i < GOERTZEL_N_NOTES; i += n_threads)
+                resonate(input_buffer, i);
+    });
+
+    // The note with the highest harmonic sum wins; an octave too low misses the odd harmonics and an octave too high misses the fundamental
+    int best_note_idx = -1;
+    double best_score = 0.0;
+    double max_amplitude = 0.0;
+    for(int i = 0; i < GOERTZEL_N_NOTES; i++) {
+        double score = 0.0;
+        for(int h = 0; h < GOERTZEL_HARMONICS; h++) {
+            score += amplitudes[i][h];
+            max_amplitude = std::max(max_amplitude, amplitudes[i][h]);
+        }
+
+        if(amplitudes[i][0] >= GOERTZEL_MIN_AMPLITUDE && score > best_score) {
+            best_score = score;
+            best_note_idx = i;
+        }
+    }
+
+    if(best_note_idx != -1)
+        note_events.push_back(NoteEvent(Note(LOWEST_NOTE.midi_number + best_note_idx, amplitudes[best_note_idx][0]), frame_size, 0));
+
+
+    // Graphics
+    if constexpr(!HEADLESS) {
+        GoertzelGraphics *const goertzel_graphics = static_cast<GoertzelGraphics *>(estimator_graphics);
+        goertzel_graphics->set_last_max_recorded_value(max_amplitude);
+
+        NoteChannelData &ncd = goertzel_graphics->get_note_channel_data();
+        ncd.clear();
+        Spectrum &spectrum = goertzel_graphics->get_spectrum();
+        spectrum.clear();
+        for(int i = 0; i < GOERTZEL_N_NOTES; i++) {
+            double score = 0.0;
+            const double freq = Note(LOWEST_NOTE.midi_number + i).freq;
+            for(int h = 0; h < n_harmonics[i]; h++) {
+                score += amplitudes[i][h];
+                spectrum.add_data((h + 1) * freq, amplitudes[i][h], (double)sample_rate / (double)block_sizes[i]);
+            }
+
+            ncd.push_back(NoteChannelDataPoint(score));
+        }
+        spectrum.add_data(0.0, 0.0, 0.0);  // Make graph start at (0, 0)
+        spectrum.sort();
+    }
+}
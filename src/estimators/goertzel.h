@@ -0,0 +1,95 @@
+#ifndef DIGISTRING_ESTIMATORS_GOERTZEL_H
+#define DIGISTRING_ESTIMATORS_GOERTZEL_H
+
+
+#include "estimator.h"
+
+#include "worker_pool.h"
+#include "workspace_arena.h"  // CACHE_LINE_SIZE
+
+#include "estimator_graphics/spectrum.h"
+#include "estimator_graphics/bins.h"
+#include "estimator_graphics/note_channels.h"
+
+#include "config/transcription.h"
+
+
+constexpr int GOERTZEL_N_NOTES = (HIGHEST_NOTE.midi_number - LOWEST_NOTE.midi_number) + 1;
+
+
+/* Bank of Goertzel resonators at the fundamental and first overtones of every note between LOWEST_NOTE and HIGHEST_NOTE
+ * Instead of computing a whole spectrum, only the energy at GOERTZEL_N_NOTES * GOERTZEL_HARMONICS frequencies is computed
+ * Every note has its own block of GOERTZEL_PERIODS periods of its fundamental, ending at the newest sample
+ * The resonators of a note share their block and window, so they are updated as SIMD lanes of one recursion
+ */
+class Goertzel : public Estimator {
+    public:
+        Goertzel(float *&input_buffer, int &buffer_size);
+        ~Goertzel() override;
+
+        Estimators get_type() const override;
+
+        void perform(float *const input_buffer, NoteEvents &note_events) override;
+
+
+    private:
+        // Copied from the runtime parameters
+        const int sample_rate;
+
+        // Block size of the lowest note, which has the longest block
+        int frame_size;
+        float *in;
+
+        int block_sizes[GOERTZEL_N_NOTES];
+        // Number of harmonics of the note below the Nyquist frequency
+        int n_harmonics[GOERTZEL_N_NOTES];
+        // Stride through the window table per sample and sum of the sampled window (for normalizing the amplitudes)
+        double window_strides[GOERTZEL_N_NOTES];
+        double window_sums[GOERTZEL_N_NOTES];
+        float window_table[GOERTZEL_WINDOW_TABLE_SIZE];
+
+        // 2cos(2pi * f / sample_rate) of every resonator; a note's lanes are contiguous
+        alignas(CACHE_LINE_SIZE) double coefs[GOERTZEL_N_NOTES][GOERTZEL_HARMONICS];
+        // Written by the workers; every note has its own row, so no synchronization is needed
+        alignas(CACHE_LINE_SIZE) double amplitudes[GOERTZEL_N_NOTES][GOERTZEL_HARMONICS];
+
+        WorkerPool pool;
+
+
+        void resonate(const float *const input_buffer, const int note_idx);
+};
+
+
+class GoertzelGraphics : public EstimatorGraphics {
+    public:
+        void render(SDL_Renderer *const renderer, const SDL_Rect &dst, const GraphicsData &graphics_data) const override {
+            switch(cur_plot) {
+                default:
+                    cur_plot = 0;
+                    __attribute__ ((fallthrough));
+                case 0:
+                    note_channels.render(renderer, dst, graphics_data, note_channel_data);
+                    break;
+
+                case 1:
+                    bins.render(renderer, dst, graphics_data, spectrum);
+                    break;
+            }
+        };
+
+        // These should only be called by the Goertzel estimator in perform()
+        Spectrum &get_spectrum() {return spectrum;};
+        NoteChannelData &get_note_channel_data() {return note_channel_data;};
+
+
+    private:
+        Bins bins;
+        NoteChannels note_channels;
+
+        // These get set during a perform() call
+        Spectrum spectrum;  // Amplitudes of all resonators
+        NoteChannelData note_channel_data;  // Harmonic sum of every note
+};
+
+
+#endif  // DIGISTRING_ESTIMATORS_GOERTZEL_H
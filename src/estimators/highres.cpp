@@ -7,11 +7,14 @@
 #include "estimation_func/norms.h"
 #include "estimation_func/envelope.h"
 #include "estimation_func/peak_pickers.h"
+#include "estimation_func/fused_peak_picking.h"
 #include "estimation_func/interpolate_peaks.h"
 #include "estimation_func/note_selectors.h"
+#include "estimation_func/hot_swap_plan.h"
 
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 #include "config/graphics.h"
 
 #include <fftw3.h>
@@ -21,45 +24,56 @@
 #include <vector>
 
 
-HighRes::HighRes(float *&input_buffer, int &buffer_size) : perf("HighRes") {
+HighRes::HighRes(float *&input_buffer, int &buffer_size)
+        : sample_rate(params.analysis_sample_rate), frame_size(params.analysis_frame_size), frame_size_padded(params.frame_size_padded), n_bins(params.band_limited_n_bins),
+          pool(WORKER_POOL_THREADS, WORKER_POOL_PIN, WORKER_POOL_FIRST_CPU, WORKER_POOL_SPIN_ITERATIONS, WORKER_POOL_MIN_CHUNK), workspace(highres_workspace_size(n_bins) + fused_envelope_peaks_workspace_size(pool.get_n_threads())), perf("HighRes") {
     // Let the called know the number of samples to request from SampleGetter each call
-    buffer_size = FRAME_SIZE;
+    buffer_size = frame_size;
 
     // fftw3 input buffer to Fourier on
-    in = (float*)fftwf_malloc(FRAME_SIZE_PADDED * sizeof(float));
+    in = (float*)fftwf_malloc(frame_size_padded * sizeof(float));
     if(in == NULL) {
         error("Failed to malloc sample input buffer");
         exit(EXIT_FAILURE);
     }
     input_buffer = in;  // Share the input buffer with caller, so SampleGetter can directly write samples to it (no copies needed)
 
-    // Zero zero-padded part of buffer
-    std::fill_n(in + FRAME_SIZE, FRAME_SIZE_PADDED - FRAME_SIZE, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
-
-    out = (fftwf_complex*)fftwf_malloc(((FRAME_SIZE_PADDED / 2) + 1) * sizeof(fftwf_complex));
+    out = (fftwf_complex*)fftwf_malloc(((frame_size_padded / 2) + 1) * sizeof(fftwf_complex));
     if(out == NULL) {
         error("Failed to malloc Fourier output buffer");
         exit(EXIT_FAILURE);
     }
 
-    // TODO: Exhaustive planner and graphics to show "optimizing planner"
-    p = fftwf_plan_dft_r2c_1d(FRAME_SIZE_PADDED, input_buffer, out, FFTW_ESTIMATE);
-    if(p == NULL) {
-        error("Failed to create FFTW3 plan");
+    plan = nullptr;
+    pruned_fft = nullptr;
+    if constexpr(PRUNED_FFT)
+        pruned_fft = new PrunedFFT(frame_size, frame_size_padded, n_bins);
+    else
+        plan = new HotSwapPlan(frame_size_padded, input_buffer, out);
+
+    // Zero zero-padded part of buffer; after planning, as measuring the plan overwrites the buffer
+    std::fill_n(in + frame_size, frame_size_padded - frame_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+
+    window_func = (float*)fftwf_malloc(frame_size * sizeof(float));
+    if(window_func == NULL) {
+        error("Failed to malloc window function");
         exit(EXIT_FAILURE);
     }
 
     // // Pre-calculate window function
-    // if(!dolph_chebyshev_window(window_func, FRAME_SIZE, DEFAULT_ATTENUATION, true)) {
+    // if(!dolph_chebyshev_window(window_func, frame_size, DEFAULT_ATTENUATION, true)) {
     //     // dolph_chebyshev_window() already prints error
     //     warning("Failed to get Dolph Chebyshev window; using Blackman Nuttall window instead...");
 
-        // blackman_nuttall_window(window_func, FRAME_SIZE);
-        hann_window(window_func, FRAME_SIZE);
+        // blackman_nuttall_window(window_func, frame_size);
+        hann_window(window_func, frame_size);
     // }
 
     // Pre-calculate Gaussian for envelope computation
-    gaussian_envelope(NULL, NULL, 0);
+    if constexpr(BOX_ENVELOPE)
+        box_envelope(NULL, NULL, 0, workspace);
+    else
+        gaussian_envelope(NULL, NULL, 0);
 
     if constexpr(!HEADLESS) {
         HighResGraphics *const tmp_graphics = new HighResGraphics();
@@ -67,7 +81,7 @@ HighRes::HighRes(float *&input_buffer, int &buffer_size) : perf("HighRes") {
 
         std::vector<float> &tmp_wave_samples = tmp_graphics->get_wave_samples();
         tmp_wave_samples.clear();  // Just to be sure
-        tmp_wave_samples.resize(FRAME_SIZE, 0.0);
+        tmp_wave_samples.resize(frame_size, 0.0);
     }
 
     prev_power = 0.0;
@@ -77,7 +91,11 @@ HighRes::~HighRes() {
     if constexpr(!HEADLESS)
         delete estimator_graphics;
 
-    fftwf_destroy_plan(p);
+    if constexpr(PRUNED_FFT)
+        delete pruned_fft;
+    else
+        delete plan;
+    fftwf_free(window_func);
     fftwf_free(out);
     fftwf_free(in);
 }
@@ -88,14 +106,29 @@ Estimators HighRes::get_type() const {
 }
 
 
-void HighRes::interpolate_peaks(NoteSet &noteset, const double norms[(FRAME_SIZE_PADDED / 2) + 1], const std::vector<int> &peaks) {
+size_t highres_workspace_size(const int n_bins) {
+    // There is at most one peak per two bins
+    const size_t max_peaks = (n_bins / 2) + 1;
+    const size_t bytes = (2 * n_bins * sizeof(double))  // Norms and envelope
+                         + (n_bins * sizeof(int))  // Peaks (the parallel peak picker uses every bin as scratch space)
+                         + (3 * max_peaks * sizeof(Note))  // Interpolated peaks, selected notes and matched peaks
+                         + (max_peaks * sizeof(double))  // Note selector scratch space
+                         + harmonic_sieve_workspace_size(max_peaks)
+                         + (BOX_ENVELOPE ? box_envelope_workspace_size(n_bins) : 0);  // Running sums of the box filters
+
+    // Every allocation is padded to a cache line
+    return bytes + (16 * CACHE_LINE_SIZE);
+}
+
+
+void HighRes::interpolate_peaks(NoteSet &noteset, const double norms[], const std::pmr::vector<int> &peaks) {
     for(int peak : peaks) {
         // Check if the interpolation will be in-bounds
-        if(peak == 0 || peak == FRAME_SIZE_PADDED / 2) {
+        if(peak == 0 || peak == n_bins - 1) {
             warning("Peak on first or last bin");
             continue;
         }
-        else if(peak > FRAME_SIZE_PADDED / 2) {
+        else if(peak > n_bins - 1) {
             error("Peak found outside bins");
             exit(EXIT_FAILURE);
         }
@@ -103,56 +136,80 @@ void HighRes::interpolate_peaks(NoteSet &noteset, const double norms[(FRAME_SIZE
         double amp;
         // const double offset = interpolate_max_exp(norms[peak], norms[peak - 1], norms[peak + 1], 0.19952623149688797, amp);
         const double offset = interpolate_max_log(norms[peak], norms[peak - 1], norms[peak + 1], amp);
-        const double freq = ((double)SAMPLE_RATE / (double)FRAME_SIZE_PADDED) * (peak + offset);
+        const double freq = ((double)sample_rate / (double)frame_size_padded) * (peak + offset);
         noteset.push_back(Note(freq, amp));
     }
 }
 
 
+void HighRes::reset() {
+    prev_power = 0.0;
+}
+
+
 void HighRes::perform(float *const input_buffer, NoteEvents &note_events) {
     // Safe raw waveform before applying window function
     if constexpr(!HEADLESS) {
         HighResGraphics *const highres_graphics = static_cast<HighResGraphics *>(estimator_graphics);
 
         std::vector<float> &wave_samples = highres_graphics->get_wave_samples();
-        memcpy(wave_samples.data(), input_buffer, FRAME_SIZE * sizeof(float));
+        memcpy(wave_samples.data(), input_buffer, frame_size * sizeof(float));
     }
 
     perf.clear_time_points();
     perf.push_time_point("Start");
 
+    // Nothing allocated in the previous frame is alive anymore
+    workspace.reset();
+
     /* Fourier transform */
     // Apply window function to minimize spectral leakage
-    for(int i = 0; i < FRAME_SIZE; i++)
+    for(int i = 0; i < frame_size; i++)
         input_buffer[i] *= window_func[i];
     perf.push_time_point("1 Applied window function");
 
     // Do the actual transform
-    fftwf_execute(p);
+    if constexpr(PRUNED_FFT)
+        pruned_fft->execute(input_buffer, out);
+    else
+        plan->execute();
     perf.push_time_point("2 Executed FFT");
 
-    // Calculate amplitude of every frequency component
-    double norms[(FRAME_SIZE_PADDED / 2) + 1];
+    // Calculate amplitude of every frequency component below the band limit
+    double *const norms = workspace.alloc<double>(n_bins);
+    double *const envelope = workspace.alloc<double>(n_bins);
+    std::pmr::vector<int> peaks(&workspace);
+    peaks.reserve(n_bins);
     double power, max_norm;
-    calc_norms(out, norms, (FRAME_SIZE_PADDED / 2) + 1, max_norm, power);
-    perf.push_time_point("3 Calculated norms");
-
-    /* Peak picking */
-    // Compute Gaussian envelope
-    double envelope[(FRAME_SIZE_PADDED / 2) + 1];
-    gaussian_envelope(norms, envelope, (FRAME_SIZE_PADDED / 2) + 1);
-    perf.push_time_point("4 Calculated Gaussian envelope");
-
-    // TODO: Convex envelope
-    // Start from highest/lowest peaks, then advance both left/right to next highest peak until no peaks left
-
-    // Find peaks based on envelope
-    std::vector<int> peaks;
-    if(power > POWER_THRESHOLD)
-        envelope_peaks(norms, envelope, (FRAME_SIZE_PADDED / 2) + 1, peaks, max_norm);
-        // all_max(norms, (FRAME_SIZE_PADDED / 2) + 1, peaks, max_norm);
-        // all_max(norms, (FRAME_SIZE_PADDED / 2) + 1, peaks);
-    perf.push_time_point("5 Picked peaks");
+    if constexpr(FUSED_PEAK_PICKING && !BOX_ENVELOPE) {
+        // Same peaks as envelope_peaks() below, but the norms and envelope are only streamed through the cache once
+        fused_envelope_peaks(out, norms, envelope, n_bins, peaks, max_norm, power, pool);
+        if(power <= params.power_threshold)
+            peaks.clear();
+        perf.push_time_point("3 Calculated norms, Gaussian envelope and picked peaks (fused)");
+    }
+    else {
+        calc_norms(out, norms, n_bins, max_norm, power, pool);
+        perf.push_time_point("3 Calculated norms");
+
+        /* Peak picking */
+        // Compute Gaussian envelope
+        if constexpr(BOX_ENVELOPE)
+            box_envelope(norms, envelope, n_bins, workspace);
+        else
+            gaussian_envelope(norms, envelope, n_bins, pool);
+        perf.push_time_point("4 Calculated Gaussian envelope");
+
+        // TODO: Convex envelope
+        // Start from highest/lowest peaks, then advance both left/right to next highest peak until no peaks left
+
+        // Find peaks based on envelope
+        if(power > params.power_threshold)
+            envelope_peaks(norms, envelope, n_bins, peaks, max_norm, pool);
+            // all_max(norms, n_bins, peaks, max_norm);
+            // all_max(norms, n_bins, peaks);
+        perf.push_time_point("5 Picked peaks");
+    }
 
     // // Find peaks on min-dy
     // std::vector<int> peaks;
@@ -160,28 +217,37 @@ void HighRes::perform(float *const input_buffer, NoteEvents &note_events) {
 
     /* Note estimation from peaks */
     // Interpolate peak locations
-    NoteSet i_peaks;
+    NoteSet i_peaks(&workspace);
+    i_peaks.reserve(peaks.size());
     interpolate_peaks(i_peaks, norms, peaks);
     perf.push_time_point("6 Interpolated peaks");
 
     // Extract played note from the peaks
-    NoteSet noteset;  // Noteset, so polyphony can easily be supported
-    NoteSet peakset;
+    NoteSet noteset(&workspace);  // Noteset, so polyphony can easily be supported
+    NoteSet peakset(&workspace);
+    noteset.reserve(i_peaks.size());
+    peakset.reserve(i_peaks.size());
     // get_loudest_peak(noteset, i_peaks);
     // get_lowest_peak(noteset, i_peaks);
     // get_most_overtones(noteset, i_peaks);
-    if constexpr(!HEADLESS)
+    if constexpr(POLYPHONIC) {
+        if constexpr(!HEADLESS)
+            get_harmonic_sieve(noteset, i_peaks, peakset);
+        else
+            get_harmonic_sieve(noteset, i_peaks);
+    }
+    else if constexpr(!HEADLESS)
         get_most_overtones(noteset, i_peaks, peakset);
     else
         get_most_overtones(noteset, i_peaks);
     // get_most_overtone_power(noteset, i_peaks);
     perf.push_time_point("7 Selected note");
 
-    // Add note to output note_events if not filtered
-    if(noteset.size() > 0) {
+    // Add notes to output note_events if not filtered
+    for(const Note &note : noteset) {
         bool add_note = true;
         if constexpr(RANGE_FILTER) {
-            if(noteset[0].midi_number < LOWEST_NOTE.midi_number || noteset[0].midi_number > HIGHEST_NOTE.midi_number)
+            if(note.midi_number < LOWEST_NOTE.midi_number || note.midi_number > HIGHEST_NOTE.midi_number)
                 add_note = false;
         }
 
@@ -191,7 +257,7 @@ void HighRes::perform(float *const input_buffer, NoteEvents &note_events) {
         }
 
         if(add_note)
-            note_events.push_back(NoteEvent(noteset[0], FRAME_SIZE, 0));
+            note_events.push_back(NoteEvent(note, frame_size, 0));
     }
     prev_power = power;
     // perf.push_time_point("8 Filtered notes");
@@ -210,9 +276,9 @@ void HighRes::perform(float *const input_buffer, NoteEvents &note_events) {
 
         // Start at i = 1 to skip rendering DC offset (envelope has no DC offset, so do first explicitly)
         envelope_spectrum.add_data(0.0, envelope[0], 0.0);
-        for(int i = 1; i < (FRAME_SIZE_PADDED / 2) + 1; i++) {
-            spectrum.add_data(i * ((double)SAMPLE_RATE / (double)FRAME_SIZE_PADDED), norms[i], (double)SAMPLE_RATE / (double)FRAME_SIZE_PADDED);
-            envelope_spectrum.add_data(i * ((double)SAMPLE_RATE / (double)FRAME_SIZE_PADDED), envelope[i], 0.0);
+        for(int i = 1; i < n_bins; i++) {
+            spectrum.add_data(i * ((double)sample_rate / (double)frame_size_padded), norms[i], (double)sample_rate / (double)frame_size_padded);
+            envelope_spectrum.add_data(i * ((double)sample_rate / (double)frame_size_padded), envelope[i], 0.0);
         }
         spectrum.sort();
         envelope_spectrum.sort();
@@ -5,6 +5,11 @@
 #include "estimator.h"
 
 #include "performance.h"
+#include "worker_pool.h"
+#include "workspace_arena.h"
+
+#include "estimation_func/pruned_fft.h"
+#include "estimation_func/hot_swap_plan.h"
 
 #include "estimator_graphics/spectrogram.h"
 #include "estimator_graphics/bins.h"
@@ -12,6 +17,7 @@
 #include "estimator_graphics/waveform.h"
 
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 #include "config/graphics.h"
 
 #include <fftw3.h>
@@ -19,6 +25,10 @@
 #include <vector>
 
 
+// Bytes needed for the per frame buffers of a spectrum of n_bins bins (also used by SlidingHighRes)
+size_t highres_workspace_size(const int n_bins);
+
+
 class HighRes : public Estimator {
     public:
         HighRes(float *&input_buffer, int &buffer_size);
@@ -28,21 +38,32 @@ class HighRes : public Estimator {
 
         // Note that when modifying this algorithm, you should disable XQIFFT (enable LQIFFT) or find the new optimal XQIFFT exponent
         void perform(float *const input_buffer, NoteEvents &note_events) override;
+        void reset() override;
 
 
     private:
+        // Copied from the runtime parameters
+        const int sample_rate;
+        const int frame_size;
+        const int frame_size_padded;
+        const int n_bins;  // Band limited
+
         float *in;
         fftwf_complex *out;
-        fftwf_plan p;
+        HotSwapPlan *plan;  // Only used if PRUNED_FFT is not set
+        PrunedFFT *pruned_fft;  // Only used if PRUNED_FFT is set
 
-        float window_func[FRAME_SIZE];
+        float *window_func;
 
         double prev_power;
 
+        WorkerPool pool;
+        WorkspaceArena workspace;
+
         Performance perf;
 
 
-        void interpolate_peaks(NoteSet &noteset, const double norms[(FRAME_SIZE_PADDED / 2) + 1], const std::vector<int> &peaks);
+        void interpolate_peaks(NoteSet &noteset, const double norms[], const std::pmr::vector<int> &peaks);
 };
 
 
@@ -0,0 +1,352 @@
+#include "multires_highres.h"
+
+#include "error.h"
+#include "note.h"
+
+#include "estimation_func/window_func.h"
+#include "estimation_func/norms.h"
+#include "estimation_func/envelope.h"
+#include "estimation_func/peak_pickers.h"
+#include "estimation_func/note_selectors.h"
+#include "estimation_func/interpolate_peaks.h"
+#include "estimation_func/hot_swap_plan.h"
+
+#include "config/audio.h"
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+#include "config/graphics.h"
+
+#include <fftw3.h>
+
+#include <cmath>
+#include <cstring>  // memcpy()
+#include <algorithm>  // std::fill_n(), std::min(), std::max(), std::sort()
+#include <vector>
+
+
+// Lower edge of the frequency range of band b; half a semitone below its lowest note, so detuned notes stay in one band
+static double band_min_freq(const int b) {
+    if(b == 0)
+        return 0.0;
+
+    return MULTIRES_BANDS[b].lowest_note.freq * exp2(-0.5 / 12.0);
+}
+
+// Upper edge of the frequency range of band b; the last band goes up to the band limit (like HighRes)
+static double band_max_freq(const int b) {
+    if(b < N_MULTIRES_BANDS - 1)
+        return band_min_freq(b + 1);
+
+    const double nyquist = params.analysis_sample_rate / 2.0;
+    if constexpr(BAND_LIMIT)
+        return std::min(HIGHEST_NOTE.freq * (BAND_LIMIT_OVERTONES + 1) * exp2(params.overtone_error / 1200.0), nyquist);
+    else
+        return nyquist;
+}
+
+// The envelope kernel is params.kernel_width bins wide in every band, so it covers the same number of semitones around the band's notes
+static int band_n_bins(const int b) {
+    const int frame_size_padded = params.frame_size_padded / MULTIRES_BANDS[b].frame_size_divisor;
+    const double bin_width = (double)params.analysis_sample_rate / (double)frame_size_padded;
+    return std::min((int)(band_max_freq(b) / bin_width) + (params.kernel_width / 2) + 2, (frame_size_padded / 2) + 1);
+}
+
+static size_t multires_workspace_size() {
+    size_t bytes = 0;
+    for(int b = 0; b < N_MULTIRES_BANDS; b++)
+        bytes += highres_workspace_size(band_n_bins(b));
+
+    return bytes;
+}
+
+
+MultiResHighRes::MultiResHighRes(float *&input_buffer, int &buffer_size)
+        : sample_rate(params.analysis_sample_rate), frame_size(params.analysis_frame_size),
+          pool(WORKER_POOL_THREADS, WORKER_POOL_PIN, WORKER_POOL_FIRST_CPU, WORKER_POOL_SPIN_ITERATIONS, WORKER_POOL_MIN_CHUNK), workspace(multires_workspace_size()), perf("MultiResHighRes") {
+    // Let the caller know the number of samples to request from SampleGetter each call
+    buffer_size = frame_size;
+
+    input = (float*)fftwf_malloc(frame_size * sizeof(float));
+    if(input == NULL) {
+        error("Failed to malloc sample input buffer");
+        exit(EXIT_FAILURE);
+    }
+    input_buffer = input;  // Share the input buffer with caller, so SampleGetter can directly write samples to it (no copies needed)
+
+    for(int b = 0; b < N_MULTIRES_BANDS; b++) {
+        Band &band = bands[b];
+        band.divisor = MULTIRES_BANDS[b].frame_size_divisor;
+        if(frame_size % band.divisor != 0 || params.frame_size_padded % band.divisor != 0) {
+            error("Frame size (" + STR(frame_size) + ") and padded frame size (" + STR(params.frame_size_padded) + ") should be divisible by every multi-resolution band divisor (" + STR(band.divisor) + ")");
+            hint("Change the frame size or MULTIRES_BANDS in config/transcription.h");
+            exit(EXIT_FAILURE);
+        }
+
+        band.frame_size = frame_size / band.divisor;
+        band.frame_size_padded = params.frame_size_padded / band.divisor;
+        band.n_bins = band_n_bins(b);
+        band.min_freq = band_min_freq(b);
+        band.max_freq = band_max_freq(b);
+
+        band.in = (float*)fftwf_malloc(band.frame_size_padded * sizeof(float));
+        if(band.in == NULL) {
+            error("Failed to malloc band input buffer");
+            exit(EXIT_FAILURE);
+        }
+
+        band.out = (fftwf_complex*)fftwf_malloc(((band.frame_size_padded / 2) + 1) * sizeof(fftwf_complex));
+        if(band.out == NULL) {
+            error("Failed to malloc Fourier output buffer");
+            exit(EXIT_FAILURE);
+        }
+
+        band.plan = nullptr;
+        band.pruned_fft = nullptr;
+        if constexpr(PRUNED_FFT)
+            band.pruned_fft = new PrunedFFT(band.frame_size, band.frame_size_padded, band.n_bins);
+        else
+            band.plan = new HotSwapPlan(band.frame_size_padded, band.in, band.out);
+
+        // Zero zero-padded part of buffer; after planning, as measuring the plan overwrites the buffer
+        std::fill_n(band.in + band.frame_size, band.frame_size_padded - band.frame_size, 0.0);
+
+        band.window_func = (float*)fftwf_malloc(band.frame_size * sizeof(float));
+        if(band.window_func == NULL) {
+            error("Failed to malloc window function");
+            exit(EXIT_FAILURE);
+        }
+        hann_window(band.window_func, band.frame_size);
+    }
+
+    // Pre-calculate Gaussian for envelope computation
+    if constexpr(BOX_ENVELOPE)
+        box_envelope(NULL, NULL, 0, workspace);
+    else
+        gaussian_envelope(NULL, NULL, 0);
+
+    if constexpr(!HEADLESS) {
+        HighResGraphics *const tmp_graphics = new HighResGraphics();
+        estimator_graphics = tmp_graphics;
+
+        std::vector<float> &tmp_wave_samples = tmp_graphics->get_wave_samples();
+        tmp_wave_samples.clear();  // Just to be sure
+        tmp_wave_samples.resize(frame_size, 0.0);
+    }
+
+    prev_power = 0.0;
+}
+
+MultiResHighRes::~MultiResHighRes() {
+    if constexpr(!HEADLESS)
+        delete estimator_graphics;
+
+    for(int b = 0; b < N_MULTIRES_BANDS; b++) {
+        if constexpr(PRUNED_FFT)
+            delete bands[b].pruned_fft;
+        else
+            delete bands[b].plan;
+        fftwf_free(bands[b].window_func);
+        fftwf_free(bands[b].out);
+        fftwf_free(bands[b].in);
+    }
+    fftwf_free(input);
+}
+
+
+Estimators MultiResHighRes::get_type() const {
+    return Estimators::multires_highres;
+}
+
+
+int MultiResHighRes::freq_to_band(const double freq) const {
+    int b = 0;
+    while(b < N_MULTIRES_BANDS - 1 && freq >= bands[b + 1].min_freq)
+        b++;
+
+    return b;
+}
+
+
+void MultiResHighRes::interpolate_peaks(NoteSet &noteset, const Band &band, const double norms[], const std::pmr::vector<int> &peaks) {
+    const double bin_width = (double)sample_rate / (double)band.frame_size_padded;
+    for(int peak : peaks) {
+        // Peaks outside the band's range are taken from another band (the margin bins are only there for the envelope)
+        if(peak * bin_width < band.min_freq || peak * bin_width >= band.max_freq)
+            continue;
+
+        // Check if the interpolation will be in-bounds
+        if(peak == 0 || peak == band.n_bins - 1) {
+            warning("Peak on first or last bin");
+            continue;
+        }
+        else if(peak > band.n_bins - 1) {
+            error("Peak found outside bins");
+            exit(EXIT_FAILURE);
+        }
+
+        double amp;
+        const double offset = interpolate_max_log(norms[peak], norms[peak - 1], norms[peak + 1], amp);
+        noteset.push_back(Note(bin_width * (peak + offset), amp));
+    }
+}
+
+
+void MultiResHighRes::reset() {
+    prev_power = 0.0;
+}
+
+
+void MultiResHighRes::perform(float *const input_buffer, NoteEvents &note_events) {
+    // Safe raw waveform
+    if constexpr(!HEADLESS) {
+        HighResGraphics *const highres_graphics = static_cast<HighResGraphics *>(estimator_graphics);
+
+        std::vector<float> &wave_samples = highres_graphics->get_wave_samples();
+        memcpy(wave_samples.data(), input_buffer, frame_size * sizeof(float));
+    }
+
+    perf.clear_time_points();
+    perf.push_time_point("Start");
+
+    // Nothing allocated in the previous frame is alive anymore
+    workspace.reset();
+
+    /* Fourier transforms */
+    // Every band windows the newest samples of the frame into its own buffer, so the shared frame stays intact
+    for(int b = 0; b < N_MULTIRES_BANDS; b++) {
+        Band &band = bands[b];
+        const float *const samples = input_buffer + (frame_size - band.frame_size);
+        for(int i = 0; i < band.frame_size; i++)
+            band.in[i] = samples[i] * band.window_func[i];
+
+        if constexpr(PRUNED_FFT)
+            band.pruned_fft->execute(band.in, band.out);
+        else
+            band.plan->execute();
+    }
+    perf.push_time_point("1 Executed FFTs");
+
+    // Norms scale with the frame size, so scale them by the divisor to compare the bands (and use the same thresholds)
+    // A peak spans the same number of bins in every band, so the frame power is the sum of the scaled norms over the band ranges
+    double *norms[N_MULTIRES_BANDS];
+    double power = 0.0, max_norm = 0.0;
+    for(int b = 0; b < N_MULTIRES_BANDS; b++) {
+        const Band &band = bands[b];
+        norms[b] = workspace.alloc<double>(band.n_bins);
+
+        double band_power, band_max_norm;
+        calc_norms(band.out, norms[b], band.n_bins, band_max_norm, band_power, pool);
+        if(band.divisor != 1)
+            for(int i = 0; i < band.n_bins; i++)
+                norms[b][i] *= band.divisor;
+        max_norm = std::max(max_norm, band_max_norm * band.divisor);
+
+        const double bin_width = (double)sample_rate / (double)band.frame_size_padded;
+        for(int i = (int)ceil(band.min_freq / bin_width); i < band.n_bins && i * bin_width < band.max_freq; i++)
+            power += norms[b][i];
+    }
+    perf.push_time_point("2 Calculated norms");
+
+    /* Peak picking */
+    double *envelopes[N_MULTIRES_BANDS];
+    for(int b = 0; b < N_MULTIRES_BANDS; b++) {
+        envelopes[b] = workspace.alloc<double>(bands[b].n_bins);
+        if constexpr(BOX_ENVELOPE)
+            box_envelope(norms[b], envelopes[b], bands[b].n_bins, workspace);
+        else
+            gaussian_envelope(norms[b], envelopes[b], bands[b].n_bins, pool);
+    }
+    perf.push_time_point("3 Calculated Gaussian envelopes");
+
+    // Bands are ordered on frequency and their peaks are sorted, so the merged peak set is sorted as well
+    size_t max_peaks = 0;
+    for(int b = 0; b < N_MULTIRES_BANDS; b++)
+        max_peaks += (bands[b].n_bins / 2) + 1;
+    NoteSet i_peaks(&workspace);
+    i_peaks.reserve(max_peaks);
+    if(power > params.power_threshold) {
+        for(int b = 0; b < N_MULTIRES_BANDS; b++) {
+            std::pmr::vector<int> peaks(&workspace);
+            peaks.reserve(bands[b].n_bins);
+            envelope_peaks(norms[b], envelopes[b], bands[b].n_bins, peaks, max_norm, pool);
+            interpolate_peaks(i_peaks, bands[b], norms[b], peaks);
+        }
+    }
+    perf.push_time_point("4 Picked and merged peaks");
+
+    /* Note estimation from peaks */
+    NoteSet noteset(&workspace);
+    NoteSet peakset(&workspace);
+    noteset.reserve(i_peaks.size());
+    peakset.reserve(i_peaks.size());
+    if constexpr(POLYPHONIC) {
+        if constexpr(!HEADLESS)
+            get_harmonic_sieve(noteset, i_peaks, peakset);
+        else
+            get_harmonic_sieve(noteset, i_peaks);
+    }
+    else if constexpr(!HEADLESS)
+        get_most_overtones(noteset, i_peaks, peakset);
+    else
+        get_most_overtones(noteset, i_peaks);
+    perf.push_time_point("5 Selected note");
+
+    // Add notes to output note_events if not filtered
+    for(const Note &note : noteset) {
+        bool add_note = true;
+        if constexpr(RANGE_FILTER) {
+            if(note.midi_number < LOWEST_NOTE.midi_number || note.midi_number > HIGHEST_NOTE.midi_number)
+                add_note = false;
+        }
+
+        if constexpr(TRANSIENT_FILTER) {
+            if(power > prev_power + TRANSIENT_FILTER_POWER)
+                add_note = false;
+        }
+
+        // A note is found in the frame of the band of its fundamental, which is at the end of the longest frame
+        if(add_note) {
+            const Band &band = bands[freq_to_band(note.freq)];
+            note_events.push_back(NoteEvent(note, band.frame_size, frame_size - band.frame_size));
+        }
+    }
+    prev_power = power;
+
+
+    // Graphics
+    if constexpr(!HEADLESS) {
+        HighResGraphics *const highres_graphics = static_cast<HighResGraphics *>(estimator_graphics);
+        highres_graphics->set_last_max_recorded_value(max_norm);
+
+        Spectrum &spectrum = highres_graphics->get_spectrum();
+        spectrum.clear();
+
+        Spectrum &envelope_spectrum = highres_graphics->get_envelope();
+        envelope_spectrum.clear();
+
+        // Every band only shows its own range; skip rendering DC offset (envelope has no DC offset, so do first explicitly)
+        envelope_spectrum.add_data(0.0, envelopes[0][0], 0.0);
+        for(int b = 0; b < N_MULTIRES_BANDS; b++) {
+            const double bin_width = (double)sample_rate / (double)bands[b].frame_size_padded;
+            for(int i = std::max((int)ceil(bands[b].min_freq / bin_width), 1); i < bands[b].n_bins && i * bin_width < bands[b].max_freq; i++) {
+                spectrum.add_data(i * bin_width, norms[b][i], bin_width);
+                envelope_spectrum.add_data(i * bin_width, envelopes[b][i], 0.0);
+            }
+        }
+        spectrum.sort();
+        envelope_spectrum.sort();
+
+        // All peaks
+        std::vector<double> &f_peaks = highres_graphics->get_peaks();
+        f_peaks.clear();
+        for(const auto &f : i_peaks)
+            f_peaks.push_back(f.freq);
+
+        // Matched peaks
+        std::vector<double> &n_peaks = highres_graphics->get_note_peaks();
+        n_peaks.clear();
+        for(const auto &f : peakset)
+            n_peaks.push_back(f.freq);
+        std::sort(n_peaks.begin(), n_peaks.end());
+    }
+}
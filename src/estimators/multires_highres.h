@@ -0,0 +1,80 @@
+#ifndef DIGISTRING_ESTIMATORS_MULTIRES_HIGHRES_H
+#define DIGISTRING_ESTIMATORS_MULTIRES_HIGHRES_H
+
+
+#include "estimator.h"
+#include "highres.h"  // HighResGraphics
+
+#include "performance.h"
+#include "worker_pool.h"
+#include "workspace_arena.h"
+
+#include "estimation_func/pruned_fft.h"
+#include "estimation_func/hot_swap_plan.h"
+
+#include "config/transcription.h"
+
+#include <fftw3.h>
+
+#include <vector>
+#include <memory_resource>
+
+
+/* HighRes over multiple frame lengths (MULTIRES_BANDS in config/transcription.h)
+ * Low notes need long frames to be resolved, but high notes are resolved by a fraction of the frame
+ * Every band runs the HighRes analysis over the newest part of the frame and only keeps the peaks in its own frequency range
+ * The peak sets of the bands are merged before note selection, so a new high note shows up as soon as the short frames contain it
+ */
+class MultiResHighRes : public Estimator {
+    public:
+        MultiResHighRes(float *&input_buffer, int &buffer_size);
+        ~MultiResHighRes() override;
+
+        Estimators get_type() const override;
+
+        void perform(float *const input_buffer, NoteEvents &note_events) override;
+        void reset() override;
+
+
+    private:
+        struct Band {
+            int divisor;
+            int frame_size;
+            int frame_size_padded;
+            int n_bins;  // Bins up to max_freq, plus a margin for the envelope kernel and interpolation
+
+            // Peaks in [min_freq, max_freq) are taken from this band
+            double min_freq, max_freq;
+
+            float *in;
+            fftwf_complex *out;
+            HotSwapPlan *plan;  // Only used if PRUNED_FFT is not set
+            PrunedFFT *pruned_fft;  // Only used if PRUNED_FFT is set
+
+            float *window_func;
+        };
+
+        // Copied from the runtime parameters
+        const int sample_rate;
+        const int frame_size;
+
+        // Longest frame, shared with the SampleGetter; bands window their part of it into their own buffer
+        float *input;
+        Band bands[N_MULTIRES_BANDS];
+
+        double prev_power;
+
+        WorkerPool pool;
+        WorkspaceArena workspace;
+
+        Performance perf;
+
+
+        // Index of the band whose frequency range contains freq
+        int freq_to_band(const double freq) const;
+        // Appends the interpolated peaks in the band's frequency range to noteset
+        void interpolate_peaks(NoteSet &noteset, const Band &band, const double norms[], const std::pmr::vector<int> &peaks);
+};
+
+
+#endif  // DIGISTRING_ESTIMATORS_MULTIRES_HIGHRES_H
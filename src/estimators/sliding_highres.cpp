@@ -0,0 +1,526 @@
+#include "sliding_highres.h"
+
+#include "error.h"
+#include "note.h"
+
+#include "estimation_func/window_func.h"
+#include "estimation_func/norms.h"
+#include "estimation_func/envelope.h"
+#include "estimation_func/peak_pickers.h"
+#include "estimation_func/interpolate_peaks.h"
+#include "estimation_func/note_selectors.h"
+#include "estimation_func/hot_swap_plan.h"
+
+#include "config/audio.h"
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+#include "config/graphics.h"
+
+#include <fftw3.h>
+
+#include <cmath>
+#include <cstring>  // memcpy(), memcmp()
+#include <algorithm>
+#include <vector>
+
+
+SlidingHighRes::SlidingHighRes(float *&input_buffer, int &buffer_size)
+        : sample_rate(params.analysis_sample_rate), frame_size(params.analysis_frame_size), frame_size_padded(params.frame_size_padded),
+          hann_bin_offset(frame_size_padded / frame_size),
+          n_bins(std::min(params.band_limited_n_bins, ((frame_size_padded / 2) + 1) - hann_bin_offset)),
+          hop(DO_OVERLAP ? frame_size - std::clamp((int)(frame_size * params.overlap_ratio), 1, frame_size - 1) : frame_size),
+          pool(WORKER_POOL_THREADS, WORKER_POOL_PIN, WORKER_POOL_FIRST_CPU, WORKER_POOL_SPIN_ITERATIONS, WORKER_POOL_MIN_CHUNK),
+          workspace(highres_workspace_size(n_bins) + (SLIDING_DFT_MAX_PEAKS * SLIDING_DFT_NEIGHBOURHOOD_BINS * sizeof(double)) + CACHE_LINE_SIZE), perf("SlidingHighRes") {
+    // The Hann window is applied in the frequency domain by combining bins hann_bin_offset apart
+    if(frame_size_padded % frame_size != 0) {
+        error("Sliding DFT requires the zero padded frame to be an integer multiple of the frame size");
+        hint("Use an integer zero pad factor");
+        exit(EXIT_FAILURE);
+    }
+    if(n_bins < SLIDING_DFT_NEIGHBOURHOOD_BINS) {
+        error("Sliding DFT requires at least " + STR(SLIDING_DFT_NEIGHBOURHOOD_BINS) + " analysed bins");
+        exit(EXIT_FAILURE);
+    }
+
+    if constexpr(!DO_OVERLAP)
+        warning("Sliding DFT only saves work on overlapping frames; every frame will be fully analysed");
+
+    // Let the called know the number of samples to request from SampleGetter each call
+    buffer_size = frame_size;
+
+    // fftw3 input buffer to Fourier on
+    in = (float*)fftwf_malloc(frame_size_padded * sizeof(float));
+    if(in == NULL) {
+        error("Failed to malloc sample input buffer");
+        exit(EXIT_FAILURE);
+    }
+    input_buffer = in;  // Share the input buffer with caller, so SampleGetter can directly write samples to it (no copies needed)
+
+    out = (fftwf_complex*)fftwf_malloc(((frame_size_padded / 2) + 1) * sizeof(fftwf_complex));
+    spectrum = (fftwf_complex*)fftwf_malloc(std::max(n_bins, SLIDING_DFT_MAX_PEAKS * SLIDING_DFT_NEIGHBOURHOOD_BINS) * sizeof(fftwf_complex));
+    if(out == NULL || spectrum == NULL) {
+        error("Failed to malloc Fourier output buffer");
+        exit(EXIT_FAILURE);
+    }
+
+    // Both preserve their input, which is needed to check continuity of the next frame
+    plan = nullptr;
+    pruned_fft = nullptr;
+    if constexpr(PRUNED_FFT)
+        pruned_fft = new PrunedFFT(frame_size, frame_size_padded, n_bins + hann_bin_offset);
+    else
+        plan = new HotSwapPlan(frame_size_padded, input_buffer, out);  // Out-of-place r2c
+
+    // Zero zero-padded part of buffer; after planning, as measuring the plan overwrites the buffer
+    std::fill_n(in + frame_size, frame_size_padded - frame_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+
+    window_func = (float*)fftwf_malloc(frame_size * sizeof(float));
+    if(window_func == NULL) {
+        error("Failed to malloc window function");
+        exit(EXIT_FAILURE);
+    }
+    hann_window(window_func, frame_size);
+
+    constexpr int n_slots = SLIDING_DFT_MAX_PEAKS * 3 * SLIDING_DFT_NEIGHBOURHOOD_BINS;
+    try {
+        prev_frame = new float[frame_size];
+        neighbourhood_start = new int[SLIDING_DFT_MAX_PEAKS];
+        tracked_envelope = new double[SLIDING_DFT_MAX_PEAKS];
+        slot_re = new double[n_slots];
+        slot_im = new double[n_slots];
+        rot_re = new double[n_slots];
+        rot_im = new double[n_slots];
+        twiddle_re = new double[n_slots];
+        twiddle_im = new double[n_slots];
+    }
+    catch(const std::bad_alloc &e) {
+        error("Failed to allocate sliding DFT buffers (" + STR(e.what()) + ")");
+        exit(EXIT_FAILURE);
+    }
+    frames_since_resync = 0;
+    n_full_analyses = 0;
+    tracking = false;
+    n_tracked_peaks = 0;
+    full_energy = 0.0;
+    full_share = 0.0;
+    full_power = 0.0;
+    full_max_norm = 0.0;
+    full_tracked_power = 0.0;
+
+    // Pre-calculate Gaussian for envelope computation
+    if constexpr(BOX_ENVELOPE)
+        box_envelope(NULL, NULL, 0, workspace);
+    else
+        gaussian_envelope(NULL, NULL, 0);
+
+    if constexpr(!HEADLESS) {
+        HighResGraphics *const tmp_graphics = new HighResGraphics();
+        estimator_graphics = tmp_graphics;
+
+        std::vector<float> &tmp_wave_samples = tmp_graphics->get_wave_samples();
+        tmp_wave_samples.clear();  // Just to be sure
+        tmp_wave_samples.resize(frame_size, 0.0);
+    }
+
+    prev_power = 0.0;
+}
+
+SlidingHighRes::~SlidingHighRes() {
+    if constexpr(!HEADLESS)
+        delete estimator_graphics;
+
+    delete[] twiddle_im;
+    delete[] twiddle_re;
+    delete[] rot_im;
+    delete[] rot_re;
+    delete[] slot_im;
+    delete[] slot_re;
+    delete[] tracked_envelope;
+    delete[] neighbourhood_start;
+    delete[] prev_frame;
+
+    fftwf_free(window_func);
+    if constexpr(PRUNED_FFT)
+        delete pruned_fft;
+    else
+        delete plan;
+    fftwf_free(spectrum);
+    fftwf_free(out);
+    fftwf_free(in);
+}
+
+
+Estimators SlidingHighRes::get_type() const {
+    return Estimators::sliding_highres;
+}
+
+
+// Energy of the windowed frame
+double SlidingHighRes::frame_energy(const float *const input_buffer) const {
+    double energy = 0.0;
+    for(int i = 0; i < frame_size; i++) {
+        const double sample = input_buffer[i] * window_func[i];
+        energy += sample * sample;
+    }
+
+    return energy;
+}
+
+
+void SlidingHighRes::set_tracked_peaks(const std::pmr::vector<int> &peaks, const double norms[], const double envelope[], const double max_norm, const double power, const double energy) {
+    // Without peaks, nothing tells whether the next frames still match this one, so they are analysed fully
+    tracking = !peaks.empty() && (int)peaks.size() <= SLIDING_DFT_MAX_PEAKS;
+    if(!tracking) {
+        n_tracked_peaks = 0;
+        return;
+    }
+
+    n_tracked_peaks = peaks.size();
+    double tracked_energy = 0.0;
+    double tracked_power = 0.0;
+    for(int i = 0; i < n_tracked_peaks; i++) {
+        const int start = std::clamp(peaks[i] - SLIDING_DFT_PEAK_RADIUS, 0, n_bins - SLIDING_DFT_NEIGHBOURHOOD_BINS);
+        neighbourhood_start[i] = start;
+        tracked_envelope[i] = envelope[peaks[i]];
+
+        for(int j = 0; j < SLIDING_DFT_NEIGHBOURHOOD_BINS; j++) {
+            tracked_energy += norms[start + j] * norms[start + j];
+            tracked_power += norms[start + j];
+        }
+
+        // Groups of the bins hann_bin_offset below, at and above the neighbourhood
+        for(int group = 0; group < 3; group++) {
+            for(int j = 0; j < SLIDING_DFT_NEIGHBOURHOOD_BINS; j++) {
+                const int slot = (((i * 3) + group) * SLIDING_DFT_NEIGHBOURHOOD_BINS) + j;
+                const int k = start + j + ((group - 1) * hann_bin_offset);
+
+                // Bins below DC are the complex conjugates of the mirrored bins; the recursion holds for them as well
+                slot_re[slot] = out[std::abs(k)][0];
+                slot_im[slot] = k >= 0 ? out[k][1] : -out[-k][1];
+
+                // Arguments are reduced modulo frame_size_padded in integers first to keep the angles small and exact
+                const long k_mod = (((long)k % frame_size_padded) + frame_size_padded) % frame_size_padded;
+                const double rot_angle = (2.0 * M_PI * (double)k_mod) / (double)frame_size_padded;
+                rot_re[slot] = cos(rot_angle);
+                rot_im[slot] = sin(rot_angle);
+
+                const long twiddle_k = (k_mod * (long)(frame_size - 1)) % frame_size_padded;
+                const double twiddle_angle = -(2.0 * M_PI * (double)twiddle_k) / (double)frame_size_padded;
+                twiddle_re[slot] = cos(twiddle_angle);
+                twiddle_im[slot] = sin(twiddle_angle);
+            }
+        }
+    }
+
+    full_energy = energy;
+    full_share = energy > 0.0 ? tracked_energy / energy : 0.0;
+    full_power = power;
+    full_max_norm = max_norm;
+    full_tracked_power = tracked_power;
+}
+
+
+// X_k(n + 1) = e^(2pi*i*k/N) * (X_k(n) - x[n - L + 1]) + x[n + 1] * e^(-2pi*i*k*(L-1)/N), where L = frame_size and N = frame_size_padded
+void SlidingHighRes::slide(const float *const input_buffer) {
+    double *const __restrict re = slot_re;
+    double *const __restrict im = slot_im;
+    const double *const __restrict r_re = rot_re;
+    const double *const __restrict r_im = rot_im;
+    const double *const __restrict t_re = twiddle_re;
+    const double *const __restrict t_im = twiddle_im;
+
+    // Bins are independent, so every worker slides its own range of bins over all new samples
+    pool.parallel_for(n_tracked_peaks * 3 * SLIDING_DFT_NEIGHBOURHOOD_BINS, [&](const int begin, const int end, const int) {
+        for(int j = 0; j < hop; j++) {
+            const double x_old = prev_frame[j];
+            const double x_new = input_buffer[(frame_size - hop) + j];
+
+            for(int k = begin; k < end; k++) {
+                const double a = re[k] - x_old;
+                const double b = im[k];
+                re[k] = (r_re[k] * a) - (r_im[k] * b) + (x_new * t_re[k]);
+                im[k] = (r_im[k] * a) + (r_re[k] * b) + (x_new * t_im[k]);
+            }
+        }
+    });
+
+    frames_since_resync++;
+}
+
+
+bool SlidingHighRes::track_peaks(NoteSet &noteset, const float *const input_buffer, double &power) {
+    // Onsets and releases change the energy of the frame
+    const double energy = frame_energy(input_buffer);
+    if(energy > full_energy * SLIDING_DFT_ENERGY_RATIO || energy < full_energy / SLIDING_DFT_ENERGY_RATIO)
+        return false;
+
+    // Apply the window on the neighbourhoods (see apply_window())
+    const int n_tracked_bins = n_tracked_peaks * SLIDING_DFT_NEIGHBOURHOOD_BINS;
+    for(int i = 0; i < n_tracked_peaks; i++) {
+        for(int j = 0; j < SLIDING_DFT_NEIGHBOURHOOD_BINS; j++) {
+            const int low = ((i * 3) * SLIDING_DFT_NEIGHBOURHOOD_BINS) + j;
+            const int center = low + SLIDING_DFT_NEIGHBOURHOOD_BINS;
+            const int high = center + SLIDING_DFT_NEIGHBOURHOOD_BINS;
+
+            spectrum[(i * SLIDING_DFT_NEIGHBOURHOOD_BINS) + j][0] = (0.5 * slot_re[center]) - (0.25 * slot_re[low]) - (0.25 * slot_re[high]);
+            spectrum[(i * SLIDING_DFT_NEIGHBOURHOOD_BINS) + j][1] = (0.5 * slot_im[center]) - (0.25 * slot_im[low]) - (0.25 * slot_im[high]);
+        }
+    }
+
+    double *const norms = workspace.alloc<double>(n_tracked_bins);
+    double max_norm, tracked_power;
+    calc_norms(spectrum, norms, n_tracked_bins, max_norm, tracked_power);
+
+    // New notes take a share of the frame's energy
+    double tracked_energy = 0.0;
+    for(int i = 0; i < n_tracked_bins; i++)
+        tracked_energy += norms[i] * norms[i];
+    if(tracked_energy < SLIDING_DFT_MIN_SHARE * full_share * energy)
+        return false;
+
+    // The power and envelope of the whole spectrum are estimated from the last full analysis, scaled by how much the neighbourhoods changed since
+    const double scale = full_tracked_power > 0.0 ? tracked_power / full_tracked_power : 0.0;
+    power = full_power * scale;
+    max_norm = std::max(max_norm, full_max_norm * scale);
+
+    // Same filters as the full analysis; a tracked peak that doesn't pass them anymore is dropped
+    if(power <= params.power_threshold)
+        return true;
+
+    const double envelope_min = params.envelope_min;
+    const double min_norm = (int)max_norm * params.signal_to_noise_filter;  // envelope_peaks() takes the maximum norm as int
+    for(int i = 0; i < n_tracked_peaks; i++) {
+        const double *const neighbourhood = norms + (i * SLIDING_DFT_NEIGHBOURHOOD_BINS);
+        const int peak = std::max_element(neighbourhood, neighbourhood + SLIDING_DFT_NEIGHBOURHOOD_BINS) - neighbourhood;
+
+        // The interpolation needs both neighbours of the peak
+        if(peak == 0 || peak == SLIDING_DFT_NEIGHBOURHOOD_BINS - 1)
+            return false;
+
+        const double envelope = tracked_envelope[i] * scale;
+        if(neighbourhood[peak] <= envelope || envelope <= envelope_min || neighbourhood[peak] <= min_norm)
+            continue;
+
+        double amp;
+        const double offset = interpolate_max_log(neighbourhood[peak], neighbourhood[peak - 1], neighbourhood[peak + 1], amp);
+        const double freq = ((double)sample_rate / (double)frame_size_padded) * (neighbourhood_start[i] + peak + offset);
+        noteset.push_back(Note(freq, amp));
+    }
+
+    return true;
+}
+
+
+// Periodic Hann (as hann_window()) is 0.5 - 0.5 * cos(2pi*i/L), which in the zero-padded spectrum is a three tap kernel
+void SlidingHighRes::apply_window() {
+    for(int k = 0; k < n_bins; k++) {
+        // Bins below DC are the complex conjugates of the mirrored bins
+        const int k_low = k - hann_bin_offset;
+        const double low_re = out[std::abs(k_low)][0];
+        const double low_im = k_low >= 0 ? out[k_low][1] : -out[-k_low][1];
+
+        spectrum[k][0] = (0.5 * out[k][0]) - (0.25 * low_re) - (0.25 * out[k + hann_bin_offset][0]);
+        spectrum[k][1] = (0.5 * out[k][1]) - (0.25 * low_im) - (0.25 * out[k + hann_bin_offset][1]);
+    }
+}
+
+
+void SlidingHighRes::interpolate_peaks(NoteSet &noteset, const double norms[], const std::pmr::vector<int> &peaks) {
+    for(int peak : peaks) {
+        // Check if the interpolation will be in-bounds
+        if(peak == 0 || peak == n_bins - 1) {
+            warning("Peak on first or last bin");
+            continue;
+        }
+        else if(peak > n_bins - 1) {
+            error("Peak found outside bins");
+            exit(EXIT_FAILURE);
+        }
+
+        double amp;
+        const double offset = interpolate_max_log(norms[peak], norms[peak - 1], norms[peak + 1], amp);
+        const double freq = ((double)sample_rate / (double)frame_size_padded) * (peak + offset);
+        noteset.push_back(Note(freq, amp));
+    }
+}
+
+
+void SlidingHighRes::reset() {
+    // The next frame is not a continuation of the previous frame, so it gets a full analysis
+    tracking = false;
+    n_tracked_peaks = 0;
+    frames_since_resync = 0;
+    full_energy = 0.0;
+    full_share = 0.0;
+    full_power = 0.0;
+    full_max_norm = 0.0;
+    full_tracked_power = 0.0;
+    prev_power = 0.0;
+}
+
+
+void SlidingHighRes::perform(float *const input_buffer, NoteEvents &note_events) {
+    if constexpr(!HEADLESS) {
+        HighResGraphics *const highres_graphics = static_cast<HighResGraphics *>(estimator_graphics);
+
+        std::vector<float> &wave_samples = highres_graphics->get_wave_samples();
+        memcpy(wave_samples.data(), input_buffer, frame_size * sizeof(float));
+    }
+
+    perf.clear_time_points();
+    perf.push_time_point("Start");
+
+    // Nothing allocated in the previous frame is alive anymore
+    workspace.reset();
+
+    /* Sliding DFT */
+    // Only slide if the frame continues the previous frame (seeking or a different overlap breaks this)
+    bool continuous = false;
+    if constexpr(DO_OVERLAP) {
+        continuous = tracking
+                     && frames_since_resync < SLIDING_DFT_RESYNC_INTERVAL
+                     && memcmp(input_buffer, prev_frame + hop, (frame_size - hop) * sizeof(float)) == 0;
+    }
+
+    NoteSet i_peaks(&workspace);
+    bool full_analysis = true;
+    double power = prev_power;
+    if(continuous) {
+        slide(input_buffer);
+        perf.push_time_point("1 Slid tracked bins");
+
+        i_peaks.reserve(n_tracked_peaks);
+        full_analysis = !track_peaks(i_peaks, input_buffer, power);
+        perf.push_time_point("2 Interpolated tracked peaks");
+    }
+    memcpy(prev_frame, input_buffer, frame_size * sizeof(float));
+
+    // Only set by the full analysis; tracked frames keep the spectrum of the last full analysis for the graphics
+    double *norms = nullptr;
+    double *envelope = nullptr;
+    double max_norm = -1.0;
+    if(full_analysis) {
+        i_peaks.clear();
+
+        // The window is applied in the frequency domain, so this needs hann_bin_offset bins above the analysed bins
+        if constexpr(PRUNED_FFT)
+            pruned_fft->execute(input_buffer, out);
+        else {
+            // input_buffer is 'in', so the plan transforms the current frame
+            if(input_buffer != in) {
+                error("SlidingHighRes was given a different input buffer than it created");
+                exit(EXIT_FAILURE);
+            }
+            plan->execute();
+        }
+        apply_window();
+        frames_since_resync = 0;
+        n_full_analyses++;
+        perf.push_time_point("3 Executed FFT and applied window function");
+
+        // Calculate amplitude of every frequency component
+        norms = workspace.alloc<double>(n_bins);
+        calc_norms(spectrum, norms, n_bins, max_norm, power, pool);
+        perf.push_time_point("4 Calculated norms");
+
+        /* Peak picking */
+        // Compute Gaussian envelope
+        envelope = workspace.alloc<double>(n_bins);
+        if constexpr(BOX_ENVELOPE)
+            box_envelope(norms, envelope, n_bins, workspace);
+        else
+            gaussian_envelope(norms, envelope, n_bins, pool);
+        perf.push_time_point("5 Calculated Gaussian envelope");
+
+        // Find peaks based on envelope
+        std::pmr::vector<int> peaks(&workspace);
+        peaks.reserve(n_bins);
+        if(power > params.power_threshold)
+            envelope_peaks(norms, envelope, n_bins, peaks, max_norm, pool);
+        perf.push_time_point("6 Picked peaks");
+
+        // Slide the neighbourhoods of these peaks in the next frames
+        set_tracked_peaks(peaks, norms, envelope, max_norm, power, frame_energy(input_buffer));
+
+        /* Note estimation from peaks */
+        // Interpolate peak locations
+        i_peaks.reserve(peaks.size());
+        interpolate_peaks(i_peaks, norms, peaks);
+        perf.push_time_point("7 Interpolated peaks");
+    }
+
+    // Extract played note from the peaks
+    NoteSet noteset(&workspace);
+    NoteSet peakset(&workspace);
+    noteset.reserve(i_peaks.size());
+    peakset.reserve(i_peaks.size());
+    if constexpr(POLYPHONIC) {
+        if constexpr(!HEADLESS)
+            get_harmonic_sieve(noteset, i_peaks, peakset);
+        else
+            get_harmonic_sieve(noteset, i_peaks);
+    }
+    else if constexpr(!HEADLESS)
+        get_most_overtones(noteset, i_peaks, peakset);
+    else
+        get_most_overtones(noteset, i_peaks);
+    perf.push_time_point("8 Selected note");
+
+    // Add notes to output note_events if not filtered
+    for(const Note &note : noteset) {
+        bool add_note = true;
+        if constexpr(RANGE_FILTER) {
+            if(note.midi_number < LOWEST_NOTE.midi_number || note.midi_number > HIGHEST_NOTE.midi_number)
+                add_note = false;
+        }
+
+        if constexpr(TRANSIENT_FILTER) {
+            if(power > prev_power + TRANSIENT_FILTER_POWER)
+                add_note = false;
+        }
+
+        if(add_note)
+            note_events.push_back(NoteEvent(note, frame_size, 0));
+    }
+    prev_power = power;
+
+
+    // Graphics
+    if constexpr(!HEADLESS) {
+        HighResGraphics *const highres_graphics = static_cast<HighResGraphics *>(estimator_graphics);
+
+        // The spectrum is only known completely after a full analysis, so it is kept until the next one
+        if(full_analysis) {
+            highres_graphics->set_last_max_recorded_value(max_norm);
+
+            Spectrum &spectrum_graphics = highres_graphics->get_spectrum();
+            spectrum_graphics.clear();
+
+            Spectrum &envelope_spectrum = highres_graphics->get_envelope();
+            envelope_spectrum.clear();
+
+            // Start at i = 1 to skip rendering DC offset (envelope has no DC offset, so do first explicitly)
+            envelope_spectrum.add_data(0.0, envelope[0], 0.0);
+            for(int i = 1; i < n_bins; i++) {
+                spectrum_graphics.add_data(i * ((double)sample_rate / (double)frame_size_padded), norms[i], (double)sample_rate / (double)frame_size_padded);
+                envelope_spectrum.add_data(i * ((double)sample_rate / (double)frame_size_padded), envelope[i], 0.0);
+            }
+            spectrum_graphics.sort();
+            envelope_spectrum.sort();
+        }
+
+        // All peaks
+        std::vector<double> &f_peaks = highres_graphics->get_peaks();
+        f_peaks.clear();
+        for(const auto &f : i_peaks)
+            f_peaks.push_back(f.freq);
+        std::sort(f_peaks.begin(), f_peaks.end());
+
+        // Matched peaks
+        std::vector<double> &n_peaks = highres_graphics->get_note_peaks();
+        n_peaks.clear();
+        for(const auto &f : peakset)
+            n_peaks.push_back(f.freq);
+        std::sort(n_peaks.begin(), n_peaks.end());
+    }
+}
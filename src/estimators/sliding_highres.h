@@ -0,0 +1,123 @@
+#ifndef DIGISTRING_ESTIMATORS_SLIDING_HIGHRES_H
+#define DIGISTRING_ESTIMATORS_SLIDING_HIGHRES_H
+
+
+#include "estimator.h"
+#include "highres.h"  // HighResGraphics
+
+#include "performance.h"
+#include "worker_pool.h"
+#include "workspace_arena.h"
+
+#include "estimation_func/pruned_fft.h"
+#include "estimation_func/hot_swap_plan.h"
+
+#include "config/audio.h"
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+#include "config/graphics.h"
+
+#include <fftw3.h>
+
+#include <algorithm>  // std::min()
+#include <vector>
+
+
+/* Same analysis as HighRes, but the spectrum is not recomputed every frame
+ * A full analysis (FFT, envelope and peak picking) finds the peaks, after which only the (unwindowed) bins around these peaks are slid over the new samples of overlapping frames
+ * The window is then applied in the frequency domain, so the tracked bins equal HighRes' spectrum on these bins
+ * The next frame is analysed fully again when the frame's energy changes, when the tracked peaks hold less of it or when a peak leaves its neighbourhood
+ */
+class SlidingHighRes : public Estimator {
+    public:
+        SlidingHighRes(float *&input_buffer, int &buffer_size);
+        ~SlidingHighRes() override;
+
+        Estimators get_type() const override;
+
+        void perform(float *const input_buffer, NoteEvents &note_events) override;
+        void reset() override;
+
+        // Number of frames which were analysed with a full FFT instead of sliding (for benchmarks)
+        long get_n_full_analyses() const {return n_full_analyses;};
+
+
+    private:
+        // Copied from the runtime parameters
+        const int sample_rate;
+        const int frame_size;
+        const int frame_size_padded;
+
+        // Bin distance of the Hann window's frequency domain kernel (0.5 * X[k] - 0.25 * X[k - hann_bin_offset] - 0.25 * X[k + hann_bin_offset])
+        const int hann_bin_offset;
+        // Number of (windowed) bins analysed
+        const int n_bins;
+        // Number of new samples per frame when overlapping
+        const int hop;
+
+        // Used for the full analysis
+        float *in;
+        fftwf_complex *out;
+        HotSwapPlan *plan;  // Only used if PRUNED_FFT is not set
+        PrunedFFT *pruned_fft;  // Only used if PRUNED_FFT is set
+
+        // Used to compute the energy of the frame
+        float *window_func;
+
+        // Previous frame, as the samples leaving the frame are not in the input buffer anymore
+        float *prev_frame;
+        int frames_since_resync;
+        long n_full_analyses;
+
+        // Peaks of the last full analysis, whose neighbourhoods are slid; false if there were too many to track
+        bool tracking;
+        int n_tracked_peaks;
+        int *neighbourhood_start;  // First windowed bin of the neighbourhood of every tracked peak
+        // Energy of the frame and the share of it in the neighbourhoods at the last full analysis
+        double full_energy;
+        double full_share;
+        // Power, maximum norm, summed neighbourhood norms and envelope at every tracked peak of the last full analysis
+        // Tracked frames scale these by their summed neighbourhood norms, as the envelope needs the whole spectrum
+        double full_power;
+        double full_max_norm;
+        double full_tracked_power;
+        double *tracked_envelope;
+
+        // Sliding DFT state of the unwindowed bins the neighbourhoods depend on (split real/imaginary, so the update loop vectorizes)
+        // Every tracked peak has three consecutive groups of SLIDING_DFT_NEIGHBOURHOOD_BINS bins: hann_bin_offset below, at and above its neighbourhood
+        double *slot_re;
+        double *slot_im;
+
+        // Per bin rotation e^(2pi*i*k/N) and twiddle of the incoming sample e^(-2pi*i*k*(L-1)/N)
+        double *rot_re;
+        double *rot_im;
+        double *twiddle_re;
+        double *twiddle_im;
+
+        // Windowed spectrum passed to the norm calculation (all analysed bins or only the neighbourhoods)
+        fftwf_complex *spectrum;
+
+        double prev_power;
+
+        WorkerPool pool;
+        WorkspaceArena workspace;
+
+        Performance perf;
+
+
+        double frame_energy(const float *const input_buffer) const;
+
+        // Starts sliding the neighbourhoods of peaks from the spectrum of the full analysis
+        void set_tracked_peaks(const std::pmr::vector<int> &peaks, const double norms[], const double envelope[], const double max_norm, const double power, const double energy);
+        void slide(const float *const input_buffer);  // Slides the tracked bins over the hop new samples
+        // Interpolates the tracked peaks passing the same filters as envelope_peaks() from the slid bins and sets the frame's power
+        // Returns false if the tracked peaks don't describe the frame anymore
+        bool track_peaks(NoteSet &noteset, const float *const input_buffer, double &power);
+
+        void apply_window();  // On all analysed bins of the full analysis
+
+        void interpolate_peaks(NoteSet &noteset, const double norms[], const std::pmr::vector<int> &peaks);
+};
+
+
+#endif  // DIGISTRING_ESTIMATORS_SLIDING_HIGHRES_H
@@ -5,9 +5,13 @@
 
 #include "estimation_func/norms.h"
 #include "estimation_func/window_func.h"
+#include "estimation_func/hot_swap_plan.h"
+
+#include "workspace_arena.h"  // CACHE_LINE_SIZE
 
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 #include "config/graphics.h"
 
 #include <fftw3.h>
@@ -15,19 +19,27 @@
 #include <cmath>
 
 
-inline constexpr int fourier_size(const Note &note) {
-    return (int)round((double)SAMPLE_RATE / note.freq);
+inline int fourier_size(const Note &note) {
+    return (int)round((double)params.analysis_sample_rate / note.freq);
 }
 
 
-Tuned::Tuned(float *&input_buffer, int &buffer_size) {
-    constexpr int n_samples = fourier_size(LOWEST_NOTE);
+// Rounds n bytes up to a whole number of cache lines
+static inline size_t cache_line_ceil(const size_t n) {
+    return ((n + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE) * CACHE_LINE_SIZE;
+}
+
 
-    input_buffer = (float*)fftwf_malloc(n_samples * sizeof(float));
-    if(input_buffer == NULL) {
+Tuned::Tuned(float *&input_buffer, int &buffer_size)
+        : pool(WORKER_POOL_THREADS, WORKER_POOL_PIN, WORKER_POOL_FIRST_CPU, WORKER_POOL_SPIN_ITERATIONS, 1) {
+    const int n_samples = fourier_size(LOWEST_NOTE);
+
+    input = (float*)fftwf_malloc(n_samples * sizeof(float));
+    if(input == NULL) {
         error("Failed to malloc sample input buffer");
         exit(EXIT_FAILURE);
     }
+    input_buffer = input;
     buffer_size = n_samples;
 
     // Calculate the sizes of the transform buffers
@@ -40,55 +52,42 @@ Tuned::Tuned(float *&input_buffer, int &buffer_size) {
         exit(EXIT_FAILURE);
     }
 
-    // Create transform buffers
-    ins[0] = input_buffer;  // Share the sample input buffer with the Fourier input buffer
-    for(int i = 1; i < 12; i++) {
-        ins[i] = (float*)fftwf_malloc(buffer_sizes[i] * sizeof(float));
-        if(ins[i] == NULL) {
-            error("Failed to malloc " + STR(i) + "-th Fourier input buffer");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    // Create the output buffers
+    // Lay out the input, window, output and norms buffers and the results of every channel in one allocation
+    // Padding every buffer to whole cache lines keeps them SIMD aligned and prevents false sharing between channels
+    size_t offsets[12][5];
+    size_t total_size = 0;
     for(int i = 0; i < 12; i++) {
-        outs[i] = (fftwf_complex*)fftwf_malloc((((buffer_sizes[i]) / 2) + 1) * sizeof(fftwf_complex));
-        if(outs[i] == NULL) {
-            error("Failed to malloc " + STR(i) + "-th Fourier output buffer");
-            exit(EXIT_FAILURE);
+        const int n_bins = (buffer_sizes[i] / 2) + 1;
+        const size_t sizes[5] = {buffer_sizes[i] * sizeof(float), buffer_sizes[i] * sizeof(float), n_bins * sizeof(fftwf_complex), n_bins * sizeof(double), sizeof(ChannelResult)};
+        for(int j = 0; j < 5; j++) {
+            offsets[i][j] = total_size;
+            total_size += cache_line_ceil(sizes[j]);
         }
     }
 
-    // Create the planners which actually perform the Fourier transform
-    // TODO: Exhaustive planner and graphics to show "optimizing planner"
+    // fftwf_malloc() aligns to at least 16 bytes, so over-allocate to align the start to a cache line
+    channel_buffer = (char*)fftwf_malloc(total_size + CACHE_LINE_SIZE);
+    if(channel_buffer == NULL) {
+        error("Failed to malloc channel buffers");
+        exit(EXIT_FAILURE);
+    }
+    char *const aligned_buffer = channel_buffer + (CACHE_LINE_SIZE - ((size_t)channel_buffer % CACHE_LINE_SIZE)) % CACHE_LINE_SIZE;
     for(int i = 0; i < 12; i++) {
-        plans[i] = fftwf_plan_dft_r2c_1d(buffer_sizes[i], ins[i], outs[i], FFTW_ESTIMATE);
-        if(plans[i] == NULL) {
-            error("Failed to create FFTW3 plan");
-            exit(EXIT_FAILURE);
-        }
+        ins[i] = (float*)(aligned_buffer + offsets[i][0]);
+        window_funcs[i] = (float*)(aligned_buffer + offsets[i][1]);
+        outs[i] = (fftwf_complex*)(aligned_buffer + offsets[i][2]);
+        norms[i] = (double*)(aligned_buffer + offsets[i][3]);
+        channel_results[i] = (ChannelResult*)(aligned_buffer + offsets[i][4]);
     }
 
+    // Create the planners which actually perform the Fourier transform
+    // Channels differ in size, so they can't be batched in one plan; instead, every channel is executed by a worker of the pool
+    for(int i = 0; i < 12; i++)
+        plans[i] = new HotSwapPlan(buffer_sizes[i], ins[i], outs[i]);
 
     // Pre-calculate window functions
-    for(int i = 0; i < 12; i++) {
-        window_funcs[i] = (float*)malloc(buffer_sizes[i] * sizeof(float));
-        if(window_funcs[i] == NULL) {
-            error("Failed to allocate buffer for window function");
-            exit(EXIT_FAILURE);
-        }
-
+    for(int i = 0; i < 12; i++)
         blackman_nuttall_window(window_funcs[i], buffer_sizes[i]);
-    }
-
-    // Allocate norms here once instead of VLA in perform()
-    try {
-        norms = new double[(n_samples / 2) + 1];
-    }
-    catch(const std::bad_alloc &e) {
-        error("Failed to allocate norms buffer (" + STR(e.what()) + ")");
-        exit(EXIT_FAILURE);
-    }
 
     if constexpr(!HEADLESS)
         estimator_graphics = new TunedGraphics();
@@ -99,19 +98,10 @@ Tuned::~Tuned() {
         delete estimator_graphics;
 
     for(int i = 0; i < 12; i++)
-        fftwf_destroy_plan(plans[i]);
-
-    // i = 0 is the input buffer
-    for(int i = 0; i < 12; i++)
-        fftwf_free(ins[i]);
-
-    for(int i = 0; i < 12; i++)
-        fftwf_free(outs[i]);
-
-    for(int i = 0; i < 12; i++)
-        free(window_funcs[i]);
+        delete plans[i];
 
-    delete[] norms;
+    fftwf_free(channel_buffer);
+    fftwf_free(input);
 }
 
 
@@ -121,47 +111,42 @@ Estimators Tuned::get_type() const {
 
 
 void Tuned::perform(float *const input_buffer, NoteEvents &note_events) {
-    // Note that ins[0] = input_buffer
-    double max_norm = 0.0;
-
-    // Copy input to each array
-    for(int i = 1; i < 12; i++)
-        memcpy(ins[i], input_buffer + (buffer_sizes[0] - buffer_sizes[i]), buffer_sizes[i] * sizeof(float));
-    // perf.push_time_point("Copied input buffer over");
-
-    // Apply window functions to minimize spectral leakage
-    for(int i = 0; i < 12; i++)
-        for(int j = 0; j < buffer_sizes[j]; j++)
-            ins[i][j] *= window_funcs[i][j];
-    // perf.push_time_point("Applied window functions");
-
-    // Do the actual transform
-    for(int i = 0; i < 12; i++)
-        fftwf_execute(plans[i]);  // TODO: OMP multi threading
+    // Every chunk copies its channels' samples with the window applied, transforms them and calculates their norms
+    pool.parallel_for(12, [&](const int begin, const int end, const int) {
+        for(int i = begin; i < end; i++) {
+            const float *const __restrict src = input_buffer + (buffer_sizes[0] - buffer_sizes[i]);
+            const float *const __restrict window_func = window_funcs[i];
+            float *const __restrict dst = ins[i];
+            for(int j = 0; j < buffer_sizes[i]; j++)
+                dst[j] = src[j] * window_func[j];
+
+            plans[i]->execute();
+
+            channel_results[i]->max_norm = 0.0;
+            calc_norms(outs[i], norms[i], (buffer_sizes[i] / 2) + 1, channel_results[i]->max_norm, channel_results[i]->power);
+        }
+    });
     // perf.push_time_point("Fourier transforms performed");
 
-    // Calculate the amplitudes of each measured frequency
+    // Find the loudest channel; in channel order, so ties resolve like a serial loop
     TunedGraphics *tuned_graphics = nullptr;  // Assign nullptr to prevent warning (it's only set and used when not in headless mode)
     if constexpr(!HEADLESS) {
         tuned_graphics = static_cast<TunedGraphics *>(estimator_graphics);
         tuned_graphics->get_spectrum().clear();
         tuned_graphics->get_note_channel_data().clear();
     }
+    double max_norm = 0.0;
     int max_power_channel_idx = 0;
     double max_power = -1.0;
     for(int i = 0; i < 12; i++) {
-        // double norms[(buffer_sizes[i] / 2) + 1];
-        double power;
-        double tmp_max_norm = 0.0;
-        calc_norms(outs[i], norms, (buffer_sizes[i] / 2) + 1, tmp_max_norm, power);
-
+        const double power = channel_results[i]->power;
         if(power > max_power) {
             max_power = power;
             max_power_channel_idx = i;
         }
 
-        if(tmp_max_norm > max_norm)
-            max_norm = tmp_max_norm;
+        if(channel_results[i]->max_norm > max_norm)
+            max_norm = channel_results[i]->max_norm;
 
         // std::cout << max_norm << std::endl;
 
@@ -176,7 +161,7 @@ void Tuned::perform(float *const input_buffer, NoteEvents &note_events) {
 
             // Start at j = 1 to skip rendering DC offset
             for(int j = 1; j < (buffer_sizes[i] / 2) + 1; j++)
-                spectrum.add_data(j * ((double)SAMPLE_RATE / (double)buffer_sizes[i]), norms[j], (double)SAMPLE_RATE / (double)buffer_sizes[i]);
+                spectrum.add_data(j * ((double)params.analysis_sample_rate / (double)buffer_sizes[i]), norms[i][j], (double)params.analysis_sample_rate / (double)buffer_sizes[i]);
         }
     }
     if constexpr(!HEADLESS) {
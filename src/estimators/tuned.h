@@ -8,6 +8,10 @@
 
 #include "note.h"
 
+#include "worker_pool.h"
+
+#include "estimation_func/hot_swap_plan.h"
+
 #include "estimator_graphics/spectrum.h"
 #include "estimator_graphics/spectrogram.h"
 #include "estimator_graphics/bins.h"
@@ -26,12 +30,28 @@ class Tuned : public Estimator {
 
     private:
         int buffer_sizes[12];
+
+        // Shared with the SampleGetter; every channel reads the newest buffer_sizes[i] samples from it
+        float *input;
+
+        // The buffers and results of all channels live in one allocation, with every buffer starting on its own cache line
+        char *channel_buffer;
         float *ins[12];
+        float *window_funcs[12];
         fftwf_complex *outs[12];
-        fftwf_plan plans[12];
+        double *norms[12];
+        HotSwapPlan *plans[12];
+
+        // Per channel results, reduced in channel order after the parallel part
+        // Stored in the channel's own cache lines, so workers writing the results of neighbouring channels don't falsely share a line
+        struct ChannelResult {
+            double power;
+            double max_norm;
+        };
+        ChannelResult *channel_results[12];
 
-        double *norms;
-        float *window_funcs[12];
+        // Channels are independent, so they are transformed in parallel
+        WorkerPool pool;
 };
 
 
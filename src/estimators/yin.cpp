@@ -0,0 +1,222 @@
+#include "yin.h"
+
+#include "note.h"
+#include "error.h"
+
+#include "estimation_func/hot_swap_plan.h"
+
+#include "config/audio.h"
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+#include "config/graphics.h"
+
+#include <fftw3.h>
+
+#include <cmath>
+#include <cstring>  // memcpy()
+#include <algorithm>  // std::max()
+#include <bit>  // std::bit_ceil()
+#include <vector>
+
+
+Yin::Yin(float *&input_buffer, int &buffer_size) : sample_rate(params.analysis_sample_rate), perf("Yin") {
+    min_lag = std::max((int)floor((double)sample_rate / (HIGHEST_NOTE.freq * exp2(1.0 / 12.0))), 2);
+    max_lag = (int)ceil((double)sample_rate / (LOWEST_NOTE.freq * exp2(-0.5 / 12.0)));
+    window_size = (int)ceil((YIN_WINDOW_PERIODS * (double)sample_rate) / LOWEST_NOTE.freq);
+
+    // Let the caller know the number of samples to request from SampleGetter each call
+    frame_size = window_size + max_lag;
+    buffer_size = frame_size;
+
+    // No circular wrap-around, as the window shifted by max_lag still fits in the transform
+    fft_size = std::bit_ceil((unsigned int)frame_size);
+
+    in = (float*)fftwf_malloc(frame_size * sizeof(float));
+    if(in == NULL) {
+        error("Failed to malloc sample input buffer");
+        exit(EXIT_FAILURE);
+    }
+    input_buffer = in;  // Share the input buffer with caller, so SampleGetter can directly write samples to it (no copies needed)
+
+    packed = (fftwf_complex*)fftwf_malloc(fft_size * sizeof(fftwf_complex));
+    spectrum = (fftwf_complex*)fftwf_malloc(fft_size * sizeof(fftwf_complex));
+    if(packed == NULL || spectrum == NULL) {
+        error("Failed to malloc Fourier buffers");
+        exit(EXIT_FAILURE);
+    }
+
+    forward_plan = new HotSwapPlan(fft_size, 1, packed, spectrum, FFTW_FORWARD);
+    backward_plan = new HotSwapPlan(fft_size, 1, spectrum, packed, FFTW_BACKWARD);
+
+    try {
+        cmndf = new double[max_lag + 1];
+    }
+    catch(const std::bad_alloc &e) {
+        error("Failed to allocate difference function buffer (" + STR(e.what()) + ")");
+        exit(EXIT_FAILURE);
+    }
+
+    if constexpr(!HEADLESS) {
+        YinGraphics *const tmp_graphics = new YinGraphics();
+        estimator_graphics = tmp_graphics;
+
+        std::vector<float> &tmp_wave_samples = tmp_graphics->get_wave_samples();
+        tmp_wave_samples.clear();  // Just to be sure
+        tmp_wave_samples.resize(frame_size, 0.0);
+    }
+}
+
+Yin::~Yin() {
+    if constexpr(!HEADLESS)
+        delete estimator_graphics;
+
+    delete[] cmndf;
+    delete backward_plan;
+    delete forward_plan;
+    fftwf_free(spectrum);
+    fftwf_free(packed);
+    fftwf_free(in);
+}
+
+
+Estimators Yin::get_type() const {
+    return Estimators::yin;
+}
+
+
+void Yin::cross_correlate(const float *const input_buffer) {
+    // Two real transforms for the price of one complex transform
+    for(int i = 0; i < frame_size; i++) {
+        packed[i][0] = input_buffer[i];
+        packed[i][1] = i < window_size ? input_buffer[i] : 0.0;
+    }
+    for(int i = frame_size; i < fft_size; i++)
+        packed[i][0] = packed[i][1] = 0.0;
+
+    forward_plan->execute();
+
+    // Unpack the spectra of the frame, F[k] = (Z[k] + Z*[N - k]) / 2, and window, W[k] = (Z[k] - Z*[N - k]) / 2i
+    // Their cross-correlation is IFFT(F[k] * W*[k]), whose spectrum is Hermitian as well
+    for(int k = 0; k <= fft_size / 2; k++) {
+        const int m = (fft_size - k) % fft_size;
+        const double a = spectrum[k][0], b = spectrum[k][1];
+        const double c = spectrum[m][0], d = spectrum[m][1];
+
+        const double f_re = (a + c) / 2.0, f_im = (b - d) / 2.0;
+        const double w_re = (b + d) / 2.0, w_im = (c - a) / 2.0;
+        const double p_re = (f_re * w_re) + (f_im * w_im);
+        const double p_im = (f_im * w_re) - (f_re * w_im);
+
+        spectrum[k][0] = p_re;
+        spectrum[k][1] = p_im;
+        spectrum[m][0] = p_re;
+        spectrum[m][1] = -p_im;
+    }
+
+    backward_plan->execute();
+}
+
+
+// d(tau) = sum_j (x[j] - x[j + tau])^2 = e(0) + e(tau) - 2r(tau), where e(tau) is the energy of the window shifted by tau and r the cross-correlation
+// cmndf(tau) = d(tau) / ((1 / tau) * sum_{j = 1}^{tau} d(j)), with cmndf(0) = 1
+void Yin::calc_cmndf(const float *const input_buffer) {
+    double e0 = 0.0;
+    for(int j = 0; j < window_size; j++)
+        e0 += (double)input_buffer[j] * (double)input_buffer[j];
+
+    double e_tau = e0;
+    double running_sum = 0.0;
+    cmndf[0] = 1.0;
+    for(int tau = 1; tau <= max_lag; tau++) {
+        const double x_out = input_buffer[tau - 1];
+        const double x_in = input_buffer[tau + window_size - 1];
+        e_tau += (x_in * x_in) - (x_out * x_out);
+
+        // FFTW's inverse transform is unnormalized
+        const double r = packed[tau][0] / (double)fft_size;
+        const double d = std::max(e0 + e_tau - (2.0 * r), 0.0);
+
+        running_sum += d;
+        cmndf[tau] = running_sum > 0.0 ? (d * tau) / running_sum : 1.0;
+    }
+}
+
+
+// The first dip below the threshold, instead of the global minimum, prevents picking a multiple of the period
+double Yin::pick_period(double &aperiodicity) const {
+    for(int tau = min_lag; tau < max_lag; tau++) {
+        if(cmndf[tau] >= YIN_THRESHOLD)
+            continue;
+
+        while(tau + 1 < max_lag && cmndf[tau + 1] < cmndf[tau])
+            tau++;
+
+        // Parabolic interpolation of the dip
+        const double l = cmndf[tau - 1], c = cmndf[tau], r = cmndf[tau + 1];
+        const double denominator = l - (2.0 * c) + r;
+        const double shift = denominator > 0.0 ? (0.5 * (l - r)) / denominator : 0.0;
+
+        aperiodicity = std::max(c - (0.25 * (l - r) * shift), 0.0);
+        return tau + shift;
+    }
+
+    aperiodicity = 1.0;
+    return -1.0;
+}
+
+
+void Yin::perform(float *const input_buffer, NoteEvents &note_events) {
+    perf.clear_time_points();
+    perf.push_time_point("Start");
+
+    // Safe raw waveform for graphics
+    if constexpr(!HEADLESS) {
+        YinGraphics *const yin_graphics = static_cast<YinGraphics *>(estimator_graphics);
+
+        std::vector<float> &wave_samples = yin_graphics->get_wave_samples();
+        memcpy(wave_samples.data(), input_buffer, frame_size * sizeof(float));
+    }
+
+    double energy = 0.0;
+    for(int i = 0; i < frame_size; i++)
+        energy += (double)input_buffer[i] * (double)input_buffer[i];
+    const double rms = sqrt(energy / frame_size);
+
+    double period = -1.0;
+    double aperiodicity = 1.0;
+    if(rms >= YIN_MIN_RMS) {
+        cross_correlate(input_buffer);
+        perf.push_time_point("1 Cross-correlated frame");
+
+        calc_cmndf(input_buffer);
+        perf.push_time_point("2 Calculated difference function");
+
+        period = pick_period(aperiodicity);
+        perf.push_time_point("3 Picked period");
+    }
+
+    // The amplitude of a sine is sqrt(2) times its RMS
+    if(period > 0.0)
+        note_events.push_back(NoteEvent(Note((double)sample_rate / period, rms * sqrt(2.0)), frame_size, 0, 1.0 - aperiodicity));
+
+
+    // Graphics
+    if constexpr(!HEADLESS) {
+        YinGraphics *const yin_graphics = static_cast<YinGraphics *>(estimator_graphics);
+        yin_graphics->set_last_max_recorded_value(1.0);
+
+        Spectrum &periodicity = yin_graphics->get_periodicity();
+        periodicity.clear();
+        if(rms >= YIN_MIN_RMS) {
+            for(int tau = min_lag; tau <= max_lag; tau++)
+                periodicity.add_data((double)sample_rate / tau, std::max(1.0 - cmndf[tau], 0.0), ((double)sample_rate / tau) - ((double)sample_rate / (tau + 1)));
+            periodicity.add_data(0.0, 0.0, 0.0);  // Make graph start at (0, 0)
+            periodicity.sort();
+        }
+
+        std::vector<double> &f_peaks = yin_graphics->get_peaks();
+        f_peaks.clear();
+        if(period > 0.0)
+            f_peaks.push_back((double)sample_rate / period);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef DIGISTRING_ESTIMATORS_YIN_H
+#define DIGISTRING_ESTIMATORS_YIN_H
+
+
+#include "estimator.h"
+
+#include "performance.h"
+
+#include "estimation_func/hot_swap_plan.h"
+
+#include "estimator_graphics/spectrum.h"
+#include "estimator_graphics/spectrogram.h"
+#include "estimator_graphics/waveform.h"
+
+#include <fftw3.h>
+
+#include <vector>
+
+
+/* Time domain pitch estimation using YIN (de Cheveigné and Kawahara, 2002)
+ * The frame only needs to hold one integration window plus the period of the lowest note, so it is much shorter than the Fourier based estimators' frames
+ * The cross-correlation term of the difference function is computed with FFTs; the energy terms with a running sum
+ */
+class Yin : public Estimator {
+    public:
+        Yin(float *&input_buffer, int &buffer_size);
+        ~Yin() override;
+
+        Estimators get_type() const override;
+
+        void perform(float *const input_buffer, NoteEvents &note_events) override;
+
+
+    private:
+        // Copied from the runtime parameters
+        const int sample_rate;
+
+        // Integration window, searched lags and frame size (window + max lag) in samples
+        int window_size;
+        int min_lag, max_lag;
+        int frame_size;
+        int fft_size;
+
+        float *in;
+        // The frame and the window are packed in one complex transform (frame as real part, window as imaginary part)
+        fftwf_complex *packed;
+        fftwf_complex *spectrum;
+        HotSwapPlan *forward_plan;
+        HotSwapPlan *backward_plan;  // From spectrum back to packed
+
+        // Cumulative mean normalized difference function for lags [0, max_lag]
+        double *cmndf;
+
+        Performance perf;
+
+
+        // Cross-correlation of the window with the frame for lags [0, max_lag]; the result is in the real part of packed
+        void cross_correlate(const float *const input_buffer);
+        void calc_cmndf(const float *const input_buffer);
+        // Returns the interpolated period in samples, or -1.0 if the frame is unvoiced
+        double pick_period(double &aperiodicity) const;
+};
+
+
+class YinGraphics : public EstimatorGraphics {
+    public:
+        void render(SDL_Renderer *const renderer, const SDL_Rect &dst, const GraphicsData &graphics_data) const override {
+            switch(cur_plot) {
+                default:
+                    cur_plot = 0;
+                    __attribute__ ((fallthrough));
+                case 0:
+                    spectrogram.render(renderer, dst, graphics_data, periodicity, envelope, peak_frequencies);
+                    break;
+
+                case 1:
+                    waveform.render(renderer, dst, graphics_data, wave_samples);
+                    break;
+            }
+        };
+
+        // These should only be called by the Yin estimator in perform()
+        Spectrum &get_periodicity() {return periodicity;};
+        std::vector<double> &get_peaks() {return peak_frequencies;};
+        std::vector<float> &get_wave_samples() {return wave_samples;};
+
+
+    private:
+        Spectrogram spectrogram;
+        Waveform waveform;
+
+        // These get set during a perform() call
+        Spectrum periodicity;  // 1 - CMNDF at the frequency of every lag
+        Spectrum envelope;  // Always empty
+        std::vector<double> peak_frequencies;
+        std::vector<float> wave_samples;
+};
+
+
+#endif  // DIGISTRING_ESTIMATORS_YIN_H
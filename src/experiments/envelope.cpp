@@ -0,0 +1,116 @@
+#include "envelope.h"
+
+#include "estimators/estimation_func/window_func.h"
+#include "estimators/estimation_func/norms.h"
+#include "estimators/estimation_func/envelope.h"
+#include "estimators/estimation_func/peak_pickers.h"
+#include "workspace_arena.h"
+#include "error.h"
+#include "quit.h"
+
+#include "config/audio.h"
+#include "config/transcription_params.h"
+
+#include <fftw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+
+// Fundamentals of the test signals (single notes and chords)
+const std::vector<std::vector<double>> TEST_SIGNALS = {
+    {82.41}, {110.0}, {440.0}, {1318.51},
+    {82.41, 123.47, 164.81},
+    {110.0, 164.81, 220.0, 277.18, 329.63},
+    {146.83, 220.0, 293.66, 369.99},
+    {82.41, 110.0, 146.83, 196.0, 246.94, 329.63}
+};
+constexpr int TEST_N_OVERTONES = 8;
+
+
+void compare_envelopes(const int frame_size, const int padding_size, const int n_bins, const int iterations) {
+    const int in_size = frame_size + padding_size;
+
+    float *in = (float*)fftwf_malloc(in_size * sizeof(float));
+    fftwf_complex *out = (fftwf_complex*)fftwf_malloc(((in_size / 2) + 1) * sizeof(fftwf_complex));
+    if(in == NULL || out == NULL) {
+        error("Failed to allocate buffers");
+        exit(EXIT_FAILURE);
+    }
+    std::fill_n(in + frame_size, padding_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+
+    fftwf_plan p = fftwf_plan_dft_r2c_1d(in_size, in, out, FFTW_ESTIMATE);
+    if(p == NULL) {
+        error("Failed to create FFTW3 plan");
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<float> window_func(frame_size);
+    hann_window(window_func.data(), frame_size);
+
+    std::vector<double> norms(n_bins), reference(n_bins), approximation(n_bins);
+    WorkspaceArena workspace(box_envelope_workspace_size(n_bins));
+    double total_gaussian_time = 0.0, total_box_time = 0.0;
+    for(const auto &fundamentals : TEST_SIGNALS) {
+        // Generate signal with decaying overtones and a little deterministic noise
+        for(int i = 0; i < frame_size; i++) {
+            double sample = 0.01 * sin(i * 12.9898) * sin(i * 78.233);
+            for(const double f : fundamentals)
+                for(int h = 1; h <= TEST_N_OVERTONES; h++)
+                    sample += (0.2 / h) * sin((2.0 * M_PI * f * h * i) / (double)params.analysis_sample_rate);
+            in[i] = sample * window_func[i];
+        }
+        fftwf_execute(p);
+
+        double max_norm, power;
+        calc_norms(out, norms.data(), n_bins, max_norm, power);
+
+        const auto gaussian_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++)
+            gaussian_envelope(norms.data(), reference.data(), n_bins);
+        const std::chrono::duration<double, std::milli> gaussian_time = std::chrono::steady_clock::now() - gaussian_start;
+
+        const auto box_start = std::chrono::steady_clock::now();
+        for(int i = 0; i < iterations; i++) {
+            workspace.reset();
+            box_envelope(norms.data(), approximation.data(), n_bins, workspace);
+        }
+        const std::chrono::duration<double, std::milli> box_time = std::chrono::steady_clock::now() - box_start;
+
+        total_gaussian_time += gaussian_time.count();
+        total_box_time += box_time.count();
+
+        // Envelope error relative to the largest reference value
+        double max_reference = 0.0, max_error = 0.0, sum_error = 0.0;
+        for(int i = 0; i < n_bins; i++) {
+            max_reference = std::max(max_reference, reference[i]);
+            max_error = std::max(max_error, std::abs(approximation[i] - reference[i]));
+            sum_error += std::abs(approximation[i] - reference[i]);
+        }
+
+        // Compare the peaks which would be picked by HighRes
+        std::pmr::vector<int> reference_peaks, approximation_peaks;
+        envelope_peaks(norms.data(), reference.data(), n_bins, reference_peaks, max_norm);
+        envelope_peaks(norms.data(), approximation.data(), n_bins, approximation_peaks, max_norm);
+        std::vector<int> only_reference, only_approximation;
+        std::set_difference(reference_peaks.begin(), reference_peaks.end(), approximation_peaks.begin(), approximation_peaks.end(), std::back_inserter(only_reference));
+        std::set_difference(approximation_peaks.begin(), approximation_peaks.end(), reference_peaks.begin(), reference_peaks.end(), std::back_inserter(only_approximation));
+
+        std::cout << "Signal with " << fundamentals.size() << " fundamental(s) starting at " << fundamentals[0] << " Hz" << std::endl;
+        std::cout << "    max error " << max_error / max_reference << "    mean error " << (sum_error / n_bins) / max_reference << " (relative to envelope max)" << std::endl;
+        std::cout << "    " << reference_peaks.size() << " peaks; " << only_reference.size() << " missed and " << only_approximation.size() << " extra" << std::endl;
+
+        if(poll_quit())
+            break;
+    }
+
+    std::cout << "Gaussian envelope: " << total_gaussian_time / (iterations * TEST_SIGNALS.size()) << " ms per call" << std::endl;
+    std::cout << "Box envelope:      " << total_box_time / (iterations * TEST_SIGNALS.size()) << " ms per call" << std::endl;
+
+    fftwf_destroy_plan(p);
+    fftwf_free(out);
+    fftwf_free(in);
+}
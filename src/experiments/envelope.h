@@ -0,0 +1,10 @@
+#ifndef DIGISTRING_EXPERIMENTS_ENVELOPE_H
+#define DIGISTRING_EXPERIMENTS_ENVELOPE_H
+
+
+// Compares box_envelope() against the reference gaussian_envelope() on HighRes like spectra
+// Prints the envelope error, differences in picked peaks and the time per call of both
+void compare_envelopes(const int frame_size, const int padding_size, const int n_bins, const int iterations);
+
+
+#endif  // DIGISTRING_EXPERIMENTS_ENVELOPE_H
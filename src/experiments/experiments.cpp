@@ -5,26 +5,33 @@
 
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 
 #include "qifft.h"
 #include "frame_size_limit.h"
+#include "pruned_fft.h"
+#include "envelope.h"
+#include "pcm_convert.h"
+#include "sliding_dft.h"
+#include "multires_latency.h"
+#include "fused_peak_picking.h"
 
 
 void qifft_errors() {
-    if constexpr(ZERO_PAD_FACTOR > 0.0) {
-        info("Assuming frame size of " + STR(FRAME_SIZE) + " samples with " + STR(FRAME_SIZE_PADDED - FRAME_SIZE) + " samples zero-padding\n"
-             "  - Frame time: " + STR(((double)FRAME_SIZE / (double)SAMPLE_RATE) * 1000.0) + " ms\n"
-             "  - Fourier bin size: " + STR((double)SAMPLE_RATE / (double)FRAME_SIZE) + " Hz\n"
-             "  - Frame size with zero padding: " + STR(FRAME_SIZE_PADDED) + " samples\n"
-             "  - Interpolated bin size: " + STR((double)SAMPLE_RATE / (double)FRAME_SIZE_PADDED) + " Hz\n");
+    if(params.zero_pad_factor > 0.0) {
+        info("Assuming frame size of " + STR(params.analysis_frame_size) + " samples with " + STR(params.frame_size_padded - params.analysis_frame_size) + " samples zero-padding\n"
+             "  - Frame time: " + STR(((double)params.analysis_frame_size / (double)params.analysis_sample_rate) * 1000.0) + " ms\n"
+             "  - Fourier bin size: " + STR((double)params.analysis_sample_rate / (double)params.analysis_frame_size) + " Hz\n"
+             "  - Frame size with zero padding: " + STR(params.frame_size_padded) + " samples\n"
+             "  - Interpolated bin size: " + STR((double)params.analysis_sample_rate / (double)params.frame_size_padded) + " Hz\n");
     }
     else {
-        info("Assuming frame size of " + STR(FRAME_SIZE) + " samples\n"
-             "  - Frame time: " + STR(((double)FRAME_SIZE / (double)SAMPLE_RATE) * 1000.0) + " ms\n"
-             "  - Fourier bin size: " + STR((double)SAMPLE_RATE / (double)FRAME_SIZE) + " Hz\n");
+        info("Assuming frame size of " + STR(params.analysis_frame_size) + " samples\n"
+             "  - Frame time: " + STR(((double)params.analysis_frame_size / (double)params.analysis_sample_rate) * 1000.0) + " ms\n"
+             "  - Fourier bin size: " + STR((double)params.analysis_sample_rate / (double)params.analysis_frame_size) + " Hz\n");
     }
 
-    QIFFT qifft = QIFFT(FRAME_SIZE, FRAME_SIZE_PADDED - FRAME_SIZE);
+    QIFFT qifft = QIFFT(params.analysis_frame_size, params.frame_size_padded - params.analysis_frame_size);
     ErrorMeasures error = qifft.no_qifft();
     std::cout << "Nearest bin: "       << OPTI_MEASURE_STR << " " << get_opti_measure(error) << OPTI_MEASURE_UNIT_STR << std::endl;
     std::cout << "    mean error " << error.mean_error << " Hz    max error " << error.max_error << " Hz" << std::endl;
@@ -57,9 +64,9 @@ void qifft_errors() {
 
 
 void optimize_qxifft() {
-    info("Using HighRes estimator defaults...");
+    info("Using HighRes transcription parameters...");
     // iteratively_optimize_qxifft(4096, 0);
-    iteratively_optimize_qxifft(FRAME_SIZE, FRAME_SIZE_PADDED - FRAME_SIZE);
+    iteratively_optimize_qxifft(params.analysis_frame_size, params.frame_size_padded - params.analysis_frame_size);
 }
 
 
@@ -74,3 +81,39 @@ void frame_size_limit() {
     FrameSizeLimit test(frame_size, padding_size);
     test.test();
 }
+
+
+void pruned_fft() {
+    info("Using HighRes transcription parameters...");
+    benchmark_pruned_fft(params.analysis_frame_size, params.frame_size_padded - params.analysis_frame_size, params.band_limited_n_bins, 200);
+}
+
+
+void envelope() {
+    info("Using HighRes transcription parameters (" + STR(params.band_limited_n_bins) + " bins, kernel width " + STR(params.kernel_width) + ")...");
+    compare_envelopes(params.analysis_frame_size, params.frame_size_padded - params.analysis_frame_size, params.band_limited_n_bins, 100);
+}
+
+
+void pcm_convert() {
+    // One second of samples at the internal sample rate
+    benchmark_pcm_convert(params.sample_rate, 200);
+}
+
+
+void sliding_dft() {
+    info("Using HighRes transcription parameters (" + STR(params.analysis_frame_size) + " samples with overlap ratio " + STR(params.overlap_ratio) + ")...");
+    benchmark_sliding_dft(params.analysis_frame_size, 1000);
+}
+
+
+void multires_latency() {
+    info("Using HighRes transcription parameters (" + STR(params.analysis_frame_size) + " samples with overlap ratio " + STR(params.overlap_ratio) + ")...");
+    measure_multires_latency(params.analysis_frame_size);
+}
+
+
+void fused_peak_picking() {
+    info("Using HighRes transcription parameters (" + STR(params.band_limited_n_bins) + " bins, tiles of " + STR(FUSED_TILE_BINS) + " bins)...");
+    compare_fused_peak_picking(params.analysis_frame_size, params.frame_size_padded - params.analysis_frame_size, params.band_limited_n_bins, 100);
+}
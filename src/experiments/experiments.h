@@ -10,12 +10,24 @@
 void qifft_errors();
 void optimize_qxifft();
 void frame_size_limit();
+void pruned_fft();
+void envelope();
+void pcm_convert();
+void sliding_dft();
+void multires_latency();
+void fused_peak_picking();
 
 
 const std::map<const std::string, const std::function<void()>> str_to_experiment = {
     {"qifft", qifft_errors},
     {"optimize_xqifft", optimize_qxifft},
     {"frame_size_limit", frame_size_limit},
+    {"pruned_fft", pruned_fft},
+    {"envelope", envelope},
+    {"pcm_convert", pcm_convert},
+    {"sliding_dft", sliding_dft},
+    {"multires_latency", multires_latency},
+    {"fused_peak_picking", fused_peak_picking},
 };
 
 
@@ -5,9 +5,11 @@
 #include "estimators/estimation_func/norms.h"
 #include "estimators/estimation_func/interpolate_peaks.h"
 #include "error.h"
+#include "cache.h"
 #include "quit.h"
 
 #include "config/audio.h"
+#include "config/transcription_params.h"
 
 #include <fftw3.h>
 
@@ -28,22 +30,21 @@ FrameSizeLimit::FrameSizeLimit(const int _frame_size, const int _padding_size/*,
         error("Failed to allocate input buffer");
         exit(EXIT_FAILURE);
     }
-    // Zero zero-padded part of buffer
-    std::fill_n(in + frame_size, padding_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
-
     out = (fftwf_complex*)fftwf_malloc(((in_size / 2) + 1) * sizeof(fftwf_complex));
     if(out == NULL) {
         error("Failed to allocate Fourier output buffer");
         exit(EXIT_FAILURE);
     }
 
-    // TODO: Exhaustive planner
-    p = fftwf_plan_dft_r2c_1d(in_size, in, out, FFTW_ESTIMATE);
+    p = Cache::plan_dft_r2c_1d(in_size, in, out);
     if(p == NULL) {
         error("Failed to create FFTW3 plan");
         exit(EXIT_FAILURE);
     }
 
+    // Zero zero-padded part of buffer; after planning, as measuring the plan overwrites the buffer
+    std::fill_n(in + frame_size, padding_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+
     try {
         window_func = new float[frame_size];
     }
@@ -83,10 +84,10 @@ void FrameSizeLimit::test() {
 
     double last_phase = 0.0;
     for(int r = 0; r < REPS_PER_FREQ; r++) {
-        const double phase_offset = last_phase * ((double)SAMPLE_RATE / E2.freq);
+        const double phase_offset = last_phase * ((double)params.sample_rate / E2.freq);
         for(int i = 0; i < in_size; i++)
-            in[i] = sinf((2.0 * M_PI * ((double)i + phase_offset) * E2.freq) / (double)SAMPLE_RATE);
-        last_phase = fmod(last_phase + (E2.freq / ((double)SAMPLE_RATE / (double)in_size)), 1.0);
+            in[i] = sinf((2.0 * M_PI * ((double)i + phase_offset) * E2.freq) / (double)params.sample_rate);
+        last_phase = fmod(last_phase + (E2.freq / ((double)params.sample_rate / (double)in_size)), 1.0);
 
         for(int i = 0; i < frame_size; i++)
             in[i] *= window_func[i];
@@ -103,17 +104,17 @@ void FrameSizeLimit::test() {
         double amp;
         const double offset = interpolate_max_log(norms[peak_idx], norms[peak_idx - 1], norms[peak_idx + 1], amp);
 
-        const double detected_freq = (peak_idx + offset) * ((double)SAMPLE_RATE / (double)in_size);
+        const double detected_freq = (peak_idx + offset) * ((double)params.sample_rate / (double)in_size);
         std::cout << Note(detected_freq) << "  (" << detected_freq << ")" << std::endl;
     }
     std::cout << std::endl;
 
     last_phase = 0.0;
     for(int r = 0; r < REPS_PER_FREQ; r++) {
-        const double phase_offset = last_phase * ((double)SAMPLE_RATE / F2.freq);
+        const double phase_offset = last_phase * ((double)params.sample_rate / F2.freq);
         for(int i = 0; i < in_size; i++)
-            in[i] = sinf((2.0 * M_PI * ((double)i + phase_offset) * F2.freq) / (double)SAMPLE_RATE);
-        last_phase = fmod(last_phase + (F2.freq / ((double)SAMPLE_RATE / (double)in_size)), 1.0);
+            in[i] = sinf((2.0 * M_PI * ((double)i + phase_offset) * F2.freq) / (double)params.sample_rate);
+        last_phase = fmod(last_phase + (F2.freq / ((double)params.sample_rate / (double)in_size)), 1.0);
 
         for(int i = 0; i < frame_size; i++)
             in[i] *= window_func[i];
@@ -130,7 +131,7 @@ void FrameSizeLimit::test() {
         double amp;
         const double offset = interpolate_max_log(norms[peak_idx], norms[peak_idx - 1], norms[peak_idx + 1], amp);
 
-        const double detected_freq = (peak_idx + offset) * ((double)SAMPLE_RATE / (double)in_size);
+        const double detected_freq = (peak_idx + offset) * ((double)params.sample_rate / (double)in_size);
         std::cout << Note(detected_freq) << "  (" << detected_freq << ")" << std::endl;
     }
 }
@@ -0,0 +1,133 @@
+#include "fused_peak_picking.h"
+
+#include "estimators/estimation_func/window_func.h"
+#include "estimators/estimation_func/norms.h"
+#include "estimators/estimation_func/envelope.h"
+#include "estimators/estimation_func/peak_pickers.h"
+#include "estimators/estimation_func/fused_peak_picking.h"
+#include "worker_pool.h"
+#include "workspace_arena.h"
+#include "error.h"
+#include "quit.h"
+
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+
+#include <fftw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>  // std::memcmp()
+#include <iostream>
+#include <vector>
+#include <memory_resource>
+
+
+// Fundamentals of the test signals (single notes and chords)
+const std::vector<std::vector<double>> TEST_SIGNALS = {
+    {82.41}, {110.0}, {440.0}, {1318.51},
+    {82.41, 123.47, 164.81},
+    {110.0, 164.81, 220.0, 277.18, 329.63},
+    {146.83, 220.0, 293.66, 369.99},
+    {82.41, 110.0, 146.83, 196.0, 246.94, 329.63}
+};
+constexpr int TEST_N_OVERTONES = 8;
+
+
+void compare_fused_peak_picking(const int frame_size, const int padding_size, const int band_limited_n_bins, const int iterations) {
+    const int in_size = frame_size + padding_size;
+    const int full_n_bins = (in_size / 2) + 1;
+
+    float *in = (float*)fftwf_malloc(in_size * sizeof(float));
+    fftwf_complex *out = (fftwf_complex*)fftwf_malloc(full_n_bins * sizeof(fftwf_complex));
+    if(in == NULL || out == NULL) {
+        error("Failed to allocate buffers");
+        exit(EXIT_FAILURE);
+    }
+    std::fill_n(in + frame_size, padding_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+
+    fftwf_plan p = fftwf_plan_dft_r2c_1d(in_size, in, out, FFTW_ESTIMATE);
+    if(p == NULL) {
+        error("Failed to create FFTW3 plan");
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<float> window_func(frame_size);
+    hann_window(window_func.data(), frame_size);
+
+    // Same pool and workspace as HighRes
+    WorkerPool pool(WORKER_POOL_THREADS, WORKER_POOL_PIN, WORKER_POOL_FIRST_CPU, WORKER_POOL_SPIN_ITERATIONS, WORKER_POOL_MIN_CHUNK);
+    WorkspaceArena workspace((2 * full_n_bins * sizeof(int)) + fused_envelope_peaks_workspace_size(pool.get_n_threads()) + (2 * CACHE_LINE_SIZE));
+
+    std::vector<double> separate_norms(full_n_bins), separate_envelope(full_n_bins), fused_norms(full_n_bins), fused_envelope(full_n_bins);
+    for(const int n_bins : {band_limited_n_bins, full_n_bins}) {
+        std::cout << (n_bins == band_limited_n_bins ? "Band limited spectrum" : "Full spectrum") << " (" << n_bins << " bins):" << std::endl;
+
+        double total_separate_time = 0.0, total_fused_time = 0.0, max_power_error = 0.0;
+        int n_different_norms = 0, n_different_envelope = 0, n_different_peaks = 0, n_different_max = 0;
+        for(const auto &fundamentals : TEST_SIGNALS) {
+            // Generate signal with decaying overtones and a little deterministic noise
+            for(int i = 0; i < frame_size; i++) {
+                double sample = 0.01 * sin(i * 12.9898) * sin(i * 78.233);
+                for(const double f : fundamentals)
+                    for(int h = 1; h <= TEST_N_OVERTONES; h++)
+                        sample += (0.2 / h) * sin((2.0 * M_PI * f * h * i) / (double)params.analysis_sample_rate);
+                in[i] = sample * window_func[i];
+            }
+            fftwf_execute(p);
+
+            double separate_max, separate_power, fused_max, fused_power;
+            std::pmr::vector<int> separate_peaks(&workspace), fused_peaks(&workspace);
+            std::chrono::duration<double, std::milli> separate_time(0.0), fused_time(0.0);
+            for(int i = 0; i < iterations; i++) {
+                workspace.reset();
+                separate_peaks = std::pmr::vector<int>(&workspace);
+                separate_peaks.reserve(n_bins);
+                fused_peaks = std::pmr::vector<int>(&workspace);
+                fused_peaks.reserve(n_bins);
+
+                const auto separate_start = std::chrono::steady_clock::now();
+                calc_norms(out, separate_norms.data(), n_bins, separate_max, separate_power, pool);
+                gaussian_envelope(separate_norms.data(), separate_envelope.data(), n_bins, pool);
+                envelope_peaks(separate_norms.data(), separate_envelope.data(), n_bins, separate_peaks, separate_max, pool);
+                separate_time += std::chrono::steady_clock::now() - separate_start;
+
+                const auto fused_start = std::chrono::steady_clock::now();
+                fused_envelope_peaks(out, fused_norms.data(), fused_envelope.data(), n_bins, fused_peaks, fused_max, fused_power, pool);
+                fused_time += std::chrono::steady_clock::now() - fused_start;
+            }
+            total_separate_time += separate_time.count();
+            total_fused_time += fused_time.count();
+
+            // Bitwise comparison, as the fused pass should compute the same values in the same order
+            for(int i = 0; i < n_bins; i++) {
+                if(std::memcmp(&separate_norms[i], &fused_norms[i], sizeof(double)) != 0)
+                    n_different_norms++;
+                if(std::memcmp(&separate_envelope[i], &fused_envelope[i], sizeof(double)) != 0)
+                    n_different_envelope++;
+            }
+            if(!std::equal(separate_peaks.begin(), separate_peaks.end(), fused_peaks.begin(), fused_peaks.end()))
+                n_different_peaks++;
+            if(std::memcmp(&separate_max, &fused_max, sizeof(double)) != 0)
+                n_different_max++;
+            max_power_error = std::max(max_power_error, std::abs(fused_power - separate_power) / separate_power);
+
+            if(poll_quit())
+                break;
+        }
+
+        std::cout << "    Bins with different norms: " << n_different_norms << "    with different envelope: " << n_different_envelope << std::endl;
+        std::cout << "    Signals with different peaks: " << n_different_peaks << "    with different max norm: " << n_different_max << " (of " << TEST_SIGNALS.size() << ")" << std::endl;
+        std::cout << "    Max relative power difference: " << max_power_error << " (summed in another order)" << std::endl;
+        std::cout << "    Separate: " << total_separate_time / (iterations * TEST_SIGNALS.size()) << " ms per call" << std::endl;
+        std::cout << "    Fused:    " << total_fused_time / (iterations * TEST_SIGNALS.size()) << " ms per call" << std::endl;
+
+        if(poll_quit())
+            break;
+    }
+
+    fftwf_destroy_plan(p);
+    fftwf_free(out);
+    fftwf_free(in);
+}
@@ -0,0 +1,10 @@
+#ifndef DIGISTRING_EXPERIMENTS_FUSED_PEAK_PICKING_H
+#define DIGISTRING_EXPERIMENTS_FUSED_PEAK_PICKING_H
+
+
+// Compares fused_envelope_peaks() against the separate calc_norms(), gaussian_envelope() and envelope_peaks() HighRes uses otherwise
+// Both on the band limited spectrum and on the full spectrum; prints the differences in norms, envelope and peaks and the time per call of both
+void compare_fused_peak_picking(const int frame_size, const int padding_size, const int band_limited_n_bins, const int iterations);
+
+
+#endif  // DIGISTRING_EXPERIMENTS_FUSED_PEAK_PICKING_H
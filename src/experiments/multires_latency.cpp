@@ -0,0 +1,98 @@
+#include "multires_latency.h"
+
+#include "estimators/highres.h"
+#include "estimators/multires_highres.h"
+#include "note.h"
+#include "error.h"
+#include "quit.h"
+
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>  // memcpy()
+#include <iostream>
+#include <vector>
+
+
+// Notes of the test signals; every note starts after a whole frame of silence
+const std::vector<Note> TEST_NOTES = {
+    Note(Notes::E, 2), Note(Notes::A, 2), Note(Notes::E, 3), Note(Notes::A, 3),
+    Note(Notes::E, 4), Note(Notes::A, 4), Note(Notes::E, 5), Note(Notes::A, 5), Note(Notes::E, 6)
+};
+constexpr int TEST_N_OVERTONES = 8;
+constexpr double TEST_DECAY = 1.0;  // Amplitude decays with e^(-TEST_DECAY * t)
+constexpr int MAX_FRAMES_AFTER_ONSET = 64;
+
+
+// Returns the index of the first frame reporting the note, or -1 if no frame within MAX_FRAMES_AFTER_ONSET does
+static int first_detection(Estimator *const estimator, float *const buffer, const std::vector<float> &signal, const int frame_size, const int hop, const int n_frames, const Note &note) {
+    NoteEvents note_events;
+    note_events.reserve(MAX_NOTE_EVENTS_PER_FRAME);
+
+    for(int frame = 0; frame < n_frames; frame++) {
+        // Estimators may window their input buffer in place, so every frame gets a fresh copy
+        memcpy(buffer, signal.data() + ((long)frame * hop), frame_size * sizeof(float));
+        note_events.clear();
+        estimator->perform(buffer, note_events);
+
+        for(const NoteEvent &note_event : note_events)
+            if(note_event.note.midi_number == note.midi_number)
+                return frame;
+    }
+
+    return -1;
+}
+
+
+void measure_multires_latency(const int frame_size) {
+    // Same number of new samples per frame as the SampleGetter
+    const int hop = DO_OVERLAP ? frame_size - std::clamp((int)(frame_size * params.overlap_ratio), 1, frame_size - 1) : frame_size;
+    const int n_frames = (frame_size / hop) + MAX_FRAMES_AFTER_ONSET;
+    const int onset = frame_size;
+
+    float *highres_buffer, *multires_buffer;
+    int highres_buffer_size, multires_buffer_size;
+    Estimator *const highres = new HighRes(highres_buffer, highres_buffer_size);
+    Estimator *const multires = new MultiResHighRes(multires_buffer, multires_buffer_size);
+    if(highres_buffer_size != frame_size || multires_buffer_size != frame_size) {
+        error("Estimators request a different frame size than the transcription parameters");
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<float> signal(frame_size + ((long)n_frames * hop));
+    for(const Note &note : TEST_NOTES) {
+        // A frame of silence followed by a decaying note with overtones and a little deterministic noise
+        for(size_t i = 0; i < signal.size(); i++) {
+            double sample = 0.001 * sin(i * 12.9898) * sin(i * 78.233);
+            if((long)i >= onset) {
+                const double t = (double)(i - onset) / (double)params.analysis_sample_rate;
+                for(int h = 1; h <= TEST_N_OVERTONES; h++)
+                    sample += ((0.2 / h) * exp(-TEST_DECAY * t)) * sin(2.0 * M_PI * note.freq * h * t);
+            }
+            signal[i] = sample;
+        }
+
+        const int highres_frame = first_detection(highres, highres_buffer, signal, frame_size, hop, n_frames, note);
+        const int multires_frame = first_detection(multires, multires_buffer, signal, frame_size, hop, n_frames, note);
+
+        // Latency is the time from the onset till the end of the first frame reporting the note
+        std::cout << note_to_string_ascii(note) << ":" << std::endl;
+        for(const auto &[name, frame] : {std::pair{"HighRes:        ", highres_frame}, std::pair{"MultiResHighRes:", multires_frame}}) {
+            if(frame < 0)
+                std::cout << "    " << name << " not detected within " << MAX_FRAMES_AFTER_ONSET << " frames" << std::endl;
+            else
+                std::cout << "    " << name << " frame " << frame << " ("
+                          << (((long)frame * hop + frame_size - onset) * 1000.0) / (double)params.analysis_sample_rate << " ms after onset)" << std::endl;
+        }
+        if(highres_frame >= 0 && multires_frame >= 0)
+            std::cout << "    MultiResHighRes is " << highres_frame - multires_frame << " frame(s) earlier" << std::endl;
+
+        if(poll_quit())
+            break;
+    }
+
+    delete multires;
+    delete highres;
+}
@@ -0,0 +1,10 @@
+#ifndef DIGISTRING_EXPERIMENTS_MULTIRES_LATENCY_H
+#define DIGISTRING_EXPERIMENTS_MULTIRES_LATENCY_H
+
+
+// Feeds HighRes and MultiResHighRes overlapping frames of single notes starting after silence
+// Prints per note after how many frames (and milliseconds after the onset) each estimator first reports it
+void measure_multires_latency(const int frame_size);
+
+
+#endif  // DIGISTRING_EXPERIMENTS_MULTIRES_LATENCY_H
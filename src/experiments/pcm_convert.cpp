@@ -0,0 +1,83 @@
+#include "pcm_convert.h"
+
+#include "sample_getter/pcm_convert.h"
+#include "error.h"
+#include "quit.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>  // memcmp()
+#include <iostream>
+#include <iomanip>  // std::setw(), std::setprecision()
+#include <string>
+#include <vector>
+
+
+struct TestFormat {
+    PcmFormat format;
+    std::string name;
+};
+
+const std::vector<TestFormat> TEST_FORMATS = {
+    {PcmFormat::s16, "s16"},
+    {PcmFormat::s24, "s24"},
+    {PcmFormat::s24_32, "s24_32"},
+    {PcmFormat::s32, "s32"},
+    {PcmFormat::f32, "f32"}
+};
+constexpr int TEST_MAX_CHANNELS = 2;
+
+
+void benchmark_pcm_convert(const int n_samples, const int iterations) {
+    // Deterministic noise as input; for floats, only values in [-1, 1) are generated
+    std::vector<uint8_t> in(n_samples * TEST_MAX_CHANNELS * sizeof(float));
+    uint32_t state = 0x12345678;
+    for(size_t i = 0; i < in.size(); i++) {
+        state = (state * 1664525) + 1013904223;
+        in[i] = state >> 24;
+    }
+    std::vector<uint8_t> float_in(in.size());
+    for(size_t i = 0; i + sizeof(float) <= float_in.size(); i += sizeof(float)) {
+        const float sample = (float)(int8_t)in[i] / 128.0f;
+        memcpy(float_in.data() + i, &sample, sizeof(float));
+    }
+
+    std::vector<float> out(n_samples), reference(n_samples);
+
+    std::cout << "Converting " << n_samples << " samples " << iterations << " times" << std::endl;
+    for(const TestFormat &test_format : TEST_FORMATS) {
+        const uint8_t *const format_in = test_format.format == PcmFormat::f32 ? float_in.data() : in.data();
+
+        for(int n_channels = 1; n_channels <= TEST_MAX_CHANNELS; n_channels++) {
+            const double in_bytes = (double)n_samples * n_channels * pcm_sample_size(test_format.format);
+            const int channel = n_channels - 1;
+
+            pcm_to_float(out.data(), format_in, n_samples, test_format.format, n_channels, channel);
+            pcm_to_float_scalar(reference.data(), format_in, n_samples, test_format.format, n_channels, channel);
+            const bool identical = memcmp(out.data(), reference.data(), n_samples * sizeof(float)) == 0;
+
+            const auto scalar_start = std::chrono::steady_clock::now();
+            for(int i = 0; i < iterations && !poll_quit(); i++)
+                pcm_to_float_scalar(reference.data(), format_in, n_samples, test_format.format, n_channels, channel);
+            const std::chrono::duration<double> scalar_time = std::chrono::steady_clock::now() - scalar_start;
+
+            const auto simd_start = std::chrono::steady_clock::now();
+            for(int i = 0; i < iterations && !poll_quit(); i++)
+                pcm_to_float(out.data(), format_in, n_samples, test_format.format, n_channels, channel);
+            const std::chrono::duration<double> simd_time = std::chrono::steady_clock::now() - simd_start;
+
+            const double scalar_gbps = (in_bytes * iterations) / (scalar_time.count() * 1e9);
+            const double simd_gbps = (in_bytes * iterations) / (simd_time.count() * 1e9);
+            std::cout << std::left << std::setw(7) << test_format.name << (n_channels == 1 ? "mono  " : "stereo")
+                      << std::right << std::fixed << std::setprecision(2)
+                      << "    scalar " << std::setw(6) << scalar_gbps << " GB/s"
+                      << "    SIMD " << std::setw(6) << simd_gbps << " GB/s"
+                      << "    speedup " << std::setw(5) << simd_gbps / scalar_gbps << "x"
+                      << (identical ? "" : "    (results differ!)") << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+
+            if(poll_quit())
+                return;
+        }
+    }
+}
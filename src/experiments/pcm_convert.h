@@ -0,0 +1,10 @@
+#ifndef DIGISTRING_EXPERIMENTS_PCM_CONVERT_H
+#define DIGISTRING_EXPERIMENTS_PCM_CONVERT_H
+
+
+// Times pcm_to_float() against the scalar conversion for every sample format, for mono and interleaved stereo input
+// Prints the throughput in GB/s of input and checks that both conversions give bit-identical samples
+void benchmark_pcm_convert(const int n_samples, const int iterations);
+
+
+#endif  // DIGISTRING_EXPERIMENTS_PCM_CONVERT_H
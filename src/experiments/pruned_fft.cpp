@@ -0,0 +1,85 @@
+#include "pruned_fft.h"
+
+#include "estimators/estimation_func/pruned_fft.h"
+#include "estimators/estimation_func/window_func.h"
+#include "error.h"
+#include "cache.h"
+#include "quit.h"
+
+#include "config/audio.h"
+#include "config/transcription_params.h"
+
+#include <fftw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+
+void benchmark_pruned_fft(const int frame_size, const int padding_size, const int n_out_bins, const int iterations) {
+    const int in_size = frame_size + padding_size;
+    const int n_bins = (in_size / 2) + 1;
+    const int n_compared_bins = std::min(n_out_bins, n_bins);
+
+    float *in = (float*)fftwf_malloc(in_size * sizeof(float));
+    fftwf_complex *out_full = (fftwf_complex*)fftwf_malloc(n_bins * sizeof(fftwf_complex));
+    fftwf_complex *out_pruned = (fftwf_complex*)fftwf_malloc(n_bins * sizeof(fftwf_complex));
+    if(in == NULL || out_full == NULL || out_pruned == NULL) {
+        error("Failed to allocate buffers");
+        exit(EXIT_FAILURE);
+    }
+    // Use the same planner rigor as the estimators for a fair comparison
+    fftwf_plan p = Cache::plan_dft_r2c_1d(in_size, in, out_full);
+    if(p == NULL) {
+        error("Failed to create FFTW3 plan");
+        exit(EXIT_FAILURE);
+    }
+    std::fill_n(in + frame_size, padding_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+    PrunedFFT pruned_fft(frame_size, in_size, n_out_bins);
+    pruned_fft.wait_for_measured_plan();
+    std::cout << "Sub-FFTs of " << frame_size << " samples split in FFTs of " << pruned_fft.get_split_size() << " samples for " << n_compared_bins << " of " << n_bins << " bins" << std::endl;
+
+    // Windowed chord with some overtones as input
+    float *window_func = new float[frame_size];
+    hann_window(window_func, frame_size);
+    const double freqs[] = {82.41, 110.0, 146.83, 196.0, 246.94, 329.63};
+    for(int i = 0; i < frame_size; i++) {
+        double sample = 0.0;
+        for(const double f : freqs)
+            for(int h = 1; h <= 4; h++)
+                sample += (0.1 / h) * sin((2.0 * M_PI * f * h * i) / (double)params.analysis_sample_rate);
+        in[i] = sample * window_func[i];
+    }
+    delete[] window_func;
+
+    // Accuracy
+    fftwf_execute(p);
+    pruned_fft.execute(in, out_pruned);
+    double max_norm = 0.0, max_diff = 0.0;
+    for(int i = 0; i < n_compared_bins; i++) {
+        max_norm = std::max(max_norm, (double)std::hypot(out_full[i][0], out_full[i][1]));
+        max_diff = std::max(max_diff, (double)std::hypot(out_full[i][0] - out_pruned[i][0], out_full[i][1] - out_pruned[i][1]));
+    }
+    std::cout << "Max bin difference: " << max_diff << " (" << max_diff / max_norm << " relative to largest bin)" << std::endl;
+
+    // Timing
+    const auto full_start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations && !poll_quit(); i++)
+        fftwf_execute(p);
+    const std::chrono::duration<double, std::milli> full_time = std::chrono::steady_clock::now() - full_start;
+
+    const auto pruned_start = std::chrono::steady_clock::now();
+    for(int i = 0; i < iterations && !poll_quit(); i++)
+        pruned_fft.execute(in, out_pruned);
+    const std::chrono::duration<double, std::milli> pruned_time = std::chrono::steady_clock::now() - pruned_start;
+
+    std::cout << "Full plan:   " << full_time.count() / iterations << " ms per transform" << std::endl;
+    std::cout << "Pruned FFT:  " << pruned_time.count() / iterations << " ms per transform" << std::endl;
+    std::cout << "Speedup:     " << full_time.count() / pruned_time.count() << "x" << std::endl;
+
+    fftwf_destroy_plan(p);
+    fftwf_free(out_pruned);
+    fftwf_free(out_full);
+    fftwf_free(in);
+}
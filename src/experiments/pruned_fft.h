@@ -0,0 +1,9 @@
+#ifndef DIGISTRING_EXPERIMENTS_PRUNED_FFT_H
+#define DIGISTRING_EXPERIMENTS_PRUNED_FFT_H
+
+
+// Times the full zero-padded FFTW3 plan against PrunedFFT computing n_out_bins bins and prints the largest difference between these bins
+void benchmark_pruned_fft(const int frame_size, const int padding_size, const int n_out_bins, const int iterations);
+
+
+#endif  // DIGISTRING_EXPERIMENTS_PRUNED_FFT_H
@@ -4,9 +4,11 @@
 #include "estimators/estimation_func/norms.h"
 #include "estimators/estimation_func/interpolate_peaks.h"
 #include "error.h"
+#include "cache.h"
 #include "quit.h"
 
 #include "config/audio.h"
+#include "config/transcription_params.h"
 
 #include <omp.h>
 #include <fftw3.h>
@@ -59,15 +61,15 @@ double iteratively_optimize_qxifft(const int frame_size, const int padding_size/
     warning("You are responsible the optimization pitch estimation process matches the one the parameter is optimized for");
     if(padding_size > 0) {
         info("Assuming frame size of " + STR(frame_size) + " samples with " + STR(padding_size) + " samples zero-padding\n"
-             "  - Frame time: " + STR(((double)frame_size / (double)SAMPLE_RATE) * 1000.0) + " ms\n"
-             "  - Fourier bin size: " + STR((double)SAMPLE_RATE / (double)frame_size) + " Hz\n"
+             "  - Frame time: " + STR(((double)frame_size / (double)params.analysis_sample_rate) * 1000.0) + " ms\n"
+             "  - Fourier bin size: " + STR((double)params.analysis_sample_rate / (double)frame_size) + " Hz\n"
              "  - Frame size with zero padding: " + STR(frame_size + padding_size) + " samples\n"
-             "  - Interpolated bin size: " + STR((double)SAMPLE_RATE / (double)(frame_size + padding_size)) + " Hz\n");
+             "  - Interpolated bin size: " + STR((double)params.analysis_sample_rate / (double)(frame_size + padding_size)) + " Hz\n");
     }
     else {
         info("Assuming frame size of " + STR(frame_size) + " samples\n"
-             "  - Frame time: " + STR(((double)frame_size / (double)SAMPLE_RATE) * 1000.0) + " ms\n"
-             "  - Fourier bin size: " + STR((double)SAMPLE_RATE / (double)frame_size) + " Hz\n");
+             "  - Frame time: " + STR(((double)frame_size / (double)params.analysis_sample_rate) * 1000.0) + " ms\n"
+             "  - Fourier bin size: " + STR((double)params.analysis_sample_rate / (double)frame_size) + " Hz\n");
     }
 
     const int n_cores = omp_get_num_procs();
@@ -173,22 +175,21 @@ QIFFT::QIFFT(const int _frame_size, const int _padding_size/*, const window_func
         error("Failed to allocate input buffer");
         exit(EXIT_FAILURE);
     }
-    // Zero zero-padded part of buffer
-    std::fill_n(in + frame_size, padding_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
-
     out = (fftwf_complex*)fftwf_malloc(((in_size / 2) + 1) * sizeof(fftwf_complex));
     if(out == NULL) {
         error("Failed to allocate Fourier output buffer");
         exit(EXIT_FAILURE);
     }
 
-    // TODO: Exhaustive planner
-    p = fftwf_plan_dft_r2c_1d(in_size, in, out, FFTW_ESTIMATE);
+    p = Cache::plan_dft_r2c_1d(in_size, in, out);
     if(p == NULL) {
         error("Failed to create FFTW3 plan");
         exit(EXIT_FAILURE);
     }
 
+    // Zero zero-padded part of buffer; after planning, as measuring the plan overwrites the buffer
+    std::fill_n(in + frame_size, padding_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+
     try {
         window_func = new float[frame_size];
     }
@@ -232,10 +233,10 @@ ErrorMeasures QIFFT::qifft_error(const std::function<double(double, double, doub
     for(const double freq : freqs) {
         last_phase = 0.0;
         for(int r = 0; r < REPS_PER_FREQ; r++) {
-            const double phase_offset = last_phase * ((double)SAMPLE_RATE / freq);
+            const double phase_offset = last_phase * ((double)params.analysis_sample_rate / freq);
             for(int i = 0; i < in_size; i++)
-                in[i] = sinf((2.0 * M_PI * ((double)i + phase_offset) * freq) / (double)SAMPLE_RATE);
-            last_phase = fmod(last_phase + (freq / ((double)SAMPLE_RATE / (double)in_size)), 1.0);
+                in[i] = sinf((2.0 * M_PI * ((double)i + phase_offset) * freq) / (double)params.analysis_sample_rate);
+            last_phase = fmod(last_phase + (freq / ((double)params.analysis_sample_rate / (double)in_size)), 1.0);
 
             for(int i = 0; i < frame_size; i++)
                 in[i] *= window_func[i];
@@ -252,7 +253,7 @@ ErrorMeasures QIFFT::qifft_error(const std::function<double(double, double, doub
             double amp;
             const double offset = interpolation_func(norms[peak_idx], norms[peak_idx - 1], norms[peak_idx + 1], amp);
 
-            const double detected_freq = (peak_idx + offset) * ((double)SAMPLE_RATE / (double)in_size);
+            const double detected_freq = (peak_idx + offset) * ((double)params.analysis_sample_rate / (double)in_size);
             // const double cent_error = 1200.0 * log2(detected_freq / freq);
             const double hz_error = detected_freq - freq;
 
@@ -315,10 +316,10 @@ ErrorMeasures QIFFT::xqifft_exp_error(const double exp) {
     for(const double freq : freqs) {
         last_phase = 0.0;
         for(int r = 0; r < REPS_PER_FREQ; r++) {
-            const double phase_offset = last_phase * ((double)SAMPLE_RATE / freq);
+            const double phase_offset = last_phase * ((double)params.analysis_sample_rate / freq);
             for(int i = 0; i < in_size; i++)
-                in[i] = sinf((2.0 * M_PI * ((double)i + phase_offset) * freq) / (double)SAMPLE_RATE);
-            last_phase = fmod(last_phase + (freq / ((double)SAMPLE_RATE / (double)in_size)), 1.0);
+                in[i] = sinf((2.0 * M_PI * ((double)i + phase_offset) * freq) / (double)params.analysis_sample_rate);
+            last_phase = fmod(last_phase + (freq / ((double)params.analysis_sample_rate / (double)in_size)), 1.0);
 
             for(int i = 0; i < frame_size; i++)
                 in[i] *= window_func[i];
@@ -335,7 +336,7 @@ ErrorMeasures QIFFT::xqifft_exp_error(const double exp) {
             double amp;
             const double offset = interpolate_max_exp(norms[peak_idx], norms[peak_idx - 1], norms[peak_idx + 1], exp, amp);
 
-            const double detected_freq = (peak_idx + offset) * ((double)SAMPLE_RATE / (double)in_size);
+            const double detected_freq = (peak_idx + offset) * ((double)params.analysis_sample_rate / (double)in_size);
             // const double cent_error = 1200.0 * log2(detected_freq / freq);
             const double hz_error = detected_freq - freq;
 
@@ -0,0 +1,121 @@
+#include "sliding_dft.h"
+
+#include "estimators/highres.h"
+#include "estimators/sliding_highres.h"
+#include "error.h"
+#include "quit.h"
+
+#include "config/transcription.h"
+#include "config/transcription_params.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>  // memcpy()
+#include <iostream>
+#include <vector>
+
+
+// Fundamentals of the notes and chords of the test signal, which are played one after another
+const std::vector<std::vector<double>> TEST_SEQUENCE = {
+    {82.41}, {110.0}, {146.83}, {196.0}, {246.94}, {329.63}, {440.0}, {659.26}, {1318.51},
+    {82.41, 123.47, 164.81},
+    {110.0, 164.81, 220.0, 277.18, 329.63},
+    {146.83, 220.0, 293.66, 369.99}
+};
+constexpr int TEST_N_OVERTONES = 8;
+constexpr double TEST_NOTE_SECONDS = 0.5;
+constexpr double TEST_DECAY = 3.0;  // Amplitude decays with e^(-TEST_DECAY * t)
+
+
+void benchmark_sliding_dft(const int frame_size, const int n_frames) {
+    if constexpr(!DO_OVERLAP) {
+        error("Sliding DFT only slides overlapping frames");
+        hint("Set DO_OVERLAP in config/transcription.h");
+        return;
+    }
+
+    // Same number of new samples per frame as the SampleGetter
+    const int hop = frame_size - std::clamp((int)(frame_size * params.overlap_ratio), 1, frame_size - 1);
+
+    // Decaying notes with overtones and a little deterministic noise, one after another
+    const int note_samples = TEST_NOTE_SECONDS * params.analysis_sample_rate;
+    std::vector<float> signal(frame_size + ((long)n_frames * hop));
+    for(size_t i = 0; i < signal.size(); i++) {
+        const std::vector<double> &fundamentals = TEST_SEQUENCE[(i / note_samples) % TEST_SEQUENCE.size()];
+        const double t = (double)(i % note_samples) / (double)params.analysis_sample_rate;
+
+        double sample = 0.001 * sin(i * 12.9898) * sin(i * 78.233);
+        for(const double f : fundamentals)
+            for(int h = 1; h <= TEST_N_OVERTONES; h++)
+                sample += ((0.2 / h) * exp(-TEST_DECAY * t)) * sin(2.0 * M_PI * f * h * t);
+        signal[i] = sample;
+    }
+
+    float *highres_buffer, *sliding_buffer;
+    int highres_buffer_size, sliding_buffer_size;
+    Estimator *const highres = new HighRes(highres_buffer, highres_buffer_size);
+    SlidingHighRes *const sliding = new SlidingHighRes(sliding_buffer, sliding_buffer_size);
+    if(highres_buffer_size != frame_size || sliding_buffer_size != frame_size) {
+        error("Estimators request a different frame size than the transcription parameters");
+        exit(EXIT_FAILURE);
+    }
+
+    NoteEvents highres_events, sliding_events;
+    highres_events.reserve(MAX_NOTE_EVENTS_PER_FRAME);
+    sliding_events.reserve(MAX_NOTE_EVENTS_PER_FRAME);
+
+    // The first pass warms up the estimators (and gives the planners time to measure), the second is timed
+    double highres_time = 0.0, sliding_time = 0.0, full_analysis_time = 0.0;
+    int n_different = 0, n_timed = 0, n_full_analyses = 0;
+    for(int pass = 0; pass < 2; pass++) {
+        for(int frame = 0; frame < n_frames && !poll_quit(); frame++) {
+            const float *const frame_samples = signal.data() + ((long)frame * hop);
+
+            // HighRes windows its input buffer in place, so both get a fresh copy
+            memcpy(highres_buffer, frame_samples, frame_size * sizeof(float));
+            highres_events.clear();
+            const auto highres_start = std::chrono::steady_clock::now();
+            highres->perform(highres_buffer, highres_events);
+            const std::chrono::duration<double, std::milli> highres_frame_time = std::chrono::steady_clock::now() - highres_start;
+
+            memcpy(sliding_buffer, frame_samples, frame_size * sizeof(float));
+            sliding_events.clear();
+            const long full_analyses_before = sliding->get_n_full_analyses();
+            const auto sliding_start = std::chrono::steady_clock::now();
+            sliding->perform(sliding_buffer, sliding_events);
+            const std::chrono::duration<double, std::milli> sliding_frame_time = std::chrono::steady_clock::now() - sliding_start;
+
+            if(pass == 0)
+                continue;
+
+            highres_time += highres_frame_time.count();
+            sliding_time += sliding_frame_time.count();
+            n_timed++;
+            if(sliding->get_n_full_analyses() != full_analyses_before) {
+                full_analysis_time += sliding_frame_time.count();
+                n_full_analyses++;
+            }
+
+            bool same = highres_events.size() == sliding_events.size();
+            for(size_t i = 0; same && i < highres_events.size(); i++)
+                same = highres_events[i].note.midi_number == sliding_events[i].note.midi_number;
+            if(!same)
+                n_different++;
+        }
+    }
+
+    if(n_timed > 0) {
+        std::cout << "HighRes:        " << highres_time / n_timed << " ms per frame" << std::endl;
+        std::cout << "SlidingHighRes: " << sliding_time / n_timed << " ms per frame (" << (100.0 * n_full_analyses) / n_timed << "% full analyses)" << std::endl;
+        if(n_full_analyses > 0 && n_full_analyses < n_timed) {
+            std::cout << "    " << full_analysis_time / n_full_analyses << " ms per full analysis" << std::endl;
+            std::cout << "    " << (sliding_time - full_analysis_time) / (n_timed - n_full_analyses) << " ms per slid frame" << std::endl;
+        }
+        std::cout << "Speedup:        " << highres_time / sliding_time << "x" << std::endl;
+        std::cout << "Frames with different notes: " << n_different << " of " << n_timed << std::endl;
+    }
+
+    delete sliding;
+    delete highres;
+}
@@ -0,0 +1,10 @@
+#ifndef DIGISTRING_EXPERIMENTS_SLIDING_DFT_H
+#define DIGISTRING_EXPERIMENTS_SLIDING_DFT_H
+
+
+// Runs HighRes and SlidingHighRes on the same overlapping frames of a sequence of notes and chords
+// Prints the time per perform() call of both, how often SlidingHighRes fell back to a full analysis and how often their notes differ
+void benchmark_sliding_dft(const int frame_size, const int n_frames);
+
+
+#endif  // DIGISTRING_EXPERIMENTS_SLIDING_DFT_H
@@ -5,8 +5,10 @@
 
 #include "experiments/experiments.h"
 #include "synth/synth.h"  // Note not synths.h
+#include "estimators/estimator.h"  // Note not estimators.h
 
 #include "config/results_file.h"
+#include "config/transcription_params.h"
 
 #include <map>
 #include <string>
@@ -48,6 +50,20 @@ void ArgParser::generate_completions() {
     if(all_synths.size() > 0)
         all_synths.pop_back();
 
+    // Generate list of all estimator types
+    std::string all_estimators;
+    for(const auto &[key, value] : parse_estimator_string)
+        all_estimators += key + " ";
+    if(all_estimators.size() > 0)
+        all_estimators.pop_back();
+
+    // Generate list of all transcription parameters
+    std::string all_params;
+    for(const auto &[key, value] : param_info)
+        all_params += key + " ";
+    if(all_params.size() > 0)
+        all_params.pop_back();
+
     // Generate the file in a string stream
     std::stringstream ss;
     ss << "# This file is generated using Digistring's completions generator\n"
@@ -56,6 +72,8 @@ void ArgParser::generate_completions() {
        << "    local ALL_FLAGS=\"" << all_flags << "\"\n"
        << "    local ALL_EXPERIMENTS=\"" << all_experiments << "\"\n"
        << "    local ALL_SYNTHS=\"" << all_synths << "\"\n"
+       << "    local ALL_ESTIMATORS=\"" << all_estimators << "\"\n"
+       << "    local ALL_PARAMS=\"" << all_params << "\"\n"
        << "\n";
 
     // Generate rules for when expecting something else than a flag
@@ -250,6 +268,16 @@ void ArgParser::generate_completions() {
                        << indent(4) << "return 0;;\n";
                     break;
 
+                case OptType::estimator:
+                    ss << indent(4) << "COMPREPLY=($(compgen -W \"$ALL_ESTIMATORS\" -- $cur))\n"
+                       << indent(4) << "return 0;;\n";
+                    break;
+
+                case OptType::param:
+                    ss << indent(4) << "COMPREPLY=($(compgen -W \"$ALL_PARAMS\" -- $cur))\n"
+                       << indent(4) << "return 0;;\n";
+                    break;
+
                 case OptType::synth:
                     ss << indent(4) << "COMPREPLY=($(compgen -W \"$ALL_SYNTHS\" -- $cur))\n"
                        << indent(4) << "return 0;;\n";
@@ -0,0 +1,52 @@
+#include "heap_allocations.h"
+
+#include <cstdlib>  // malloc(), free()
+#include <new>  // std::bad_alloc
+
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+// Per thread, so allocations by the audio, worker and planner threads don't count towards the estimating thread
+static thread_local unsigned long thread_heap_allocations = 0;
+
+
+void *operator new(const size_t size) {
+    thread_heap_allocations++;
+
+    void *const p = malloc(size == 0 ? 1 : size);
+    if(p == NULL)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void *operator new[](const size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, const size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void *p, const size_t) noexcept {
+    free(p);
+}
+
+
+unsigned long get_thread_heap_allocations() {
+    return thread_heap_allocations;
+}
+
+#else
+
+unsigned long get_thread_heap_allocations() {
+    return 0;
+}
+#endif  // COUNT_HEAP_ALLOCATIONS
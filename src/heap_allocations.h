@@ -0,0 +1,17 @@
+#ifndef DIGISTRING_HEAP_ALLOCATIONS_H
+#define DIGISTRING_HEAP_ALLOCATIONS_H
+
+
+// Heap allocation counting is a debug feature, as it replaces the global operator new
+#ifdef COUNT_HEAP_ALLOCATIONS
+    constexpr bool COUNT_HEAP_ALLOCS = true;
+#else
+    constexpr bool COUNT_HEAP_ALLOCS = false;
+#endif  // COUNT_HEAP_ALLOCATIONS
+
+
+// Number of calls to operator new by the calling thread; always 0 when not compiled with -DCOUNT_HEAP_ALLOCATIONS
+unsigned long get_thread_heap_allocations();
+
+
+#endif  // DIGISTRING_HEAP_ALLOCATIONS_H
@@ -1,7 +1,10 @@
+#include "init_sdl_audio.h"
+
 #include "error.h"
 
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 #include "config/cli_args.h"
 
 #include <SDL2/SDL.h>
@@ -172,7 +175,7 @@ void print_recording_devices() {
 void init_playback_device(SDL_AudioDeviceID &out_dev) {
     SDL_AudioSpec want, have;
     SDL_memset(&want, 0, sizeof(want));  // Because SDL does this on wiki page
-    want.freq = SAMPLE_RATE;
+    want.freq = params.sample_rate;
     want.format = AUDIO_FORMAT;
     want.channels = (cli_args.stereo_split ? 2 : 1);
     want.samples = SAMPLES_PER_BUFFER;
@@ -222,14 +225,15 @@ void init_playback_device(SDL_AudioDeviceID &out_dev) {
     print_audio_settings(want, have, false);
 }
 
-void init_recording_device(SDL_AudioDeviceID &in_dev) {
+void init_recording_device(SDL_AudioDeviceID &in_dev, CaptureRing *const capture_ring) {
     SDL_AudioSpec want, have;
     SDL_memset(&want, 0, sizeof(want));  // Because SDL does this on wiki page
-    want.freq = SAMPLE_RATE;
+    want.freq = params.sample_rate;
     want.format = AUDIO_FORMAT;
     want.channels = 1;
     want.samples = SAMPLES_PER_BUFFER;
-    want.callback = NULL;
+    want.callback = CaptureRing::sdl_callback;
+    want.userdata = capture_ring;
 
     const char *in_dev_str = (cli_args.in_dev_name == "" ? NULL : cli_args.in_dev_name.c_str());
     in_dev = SDL_OpenAudioDevice(in_dev_str, RECORDING, &want, &have, SDL_AUDIO_ALLOW_ANY_CHANGE);
@@ -2,6 +2,8 @@
 #define DIGISTRING_INIT_SDL_AUDIO_H
 
 
+#include "sample_getter/capture_ring.h"
+
 #include <SDL2/SDL.h>
 
 
@@ -11,7 +13,8 @@ void print_playback_devices();
 void print_recording_devices();
 
 void init_playback_device(SDL_AudioDeviceID &out_dev);
-void init_recording_device(SDL_AudioDeviceID &in_dev);
+// The audio callback of the recording device writes into capture_ring
+void init_recording_device(SDL_AudioDeviceID &in_dev, CaptureRing *const capture_ring);
 
 
 #endif  // DIGISTRING_INIT_SDL_AUDIO_H
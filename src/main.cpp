@@ -8,12 +8,14 @@
 #include "error.h"
 
 #include "play_note_event_file.h"
+#include "batch_transcriber.h"
 #include "experiments/experiments.h"
 
 #include "config/audio.h"
 #include "config/transcription.h"
 #include "config/graphics.h"
 #include "config/cli_args.h"
+#include "config/transcription_params.h"
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
@@ -59,28 +61,36 @@ void print_transcription_config() {
     std::stringstream ss;
     ss << "--- Transcription config ---\n";
 
-    ss << "  - Frame size: " << FRAME_SIZE << " samples\n"
-       << "  - Frame time: " << ((double)FRAME_SIZE / (double)SAMPLE_RATE) * 1000.0 << " ms\n"
-       << "  - Fourier bin size: " << (double)SAMPLE_RATE / (double)FRAME_SIZE << " Hz\n";
+    ss << "  - Sample rate: " << params.sample_rate << " Hz\n"
+       << "  - Frame size: " << params.frame_size << " samples\n"
+       << "  - Frame time: " << ((double)params.frame_size / (double)params.sample_rate) * 1000.0 << " ms\n";
 
-    if(ZERO_PAD_FACTOR > 0.0) {
-        ss << "  - Frame size with zero padding: " << FRAME_SIZE_PADDED << " samples\n"
-           << "  - Interpolated bin size: " << (double)SAMPLE_RATE / (double)FRAME_SIZE_PADDED << " Hz\n";
+    if(params.decimation_factor > 1) {
+        ss << "  - Decimation factor: " << params.decimation_factor << "  (estimating at " << params.analysis_sample_rate << " Hz)\n"
+           << "  - Decimated frame size: " << params.analysis_frame_size << " samples\n"
+           << "  - Decimation passband: " << calc_decimation_passband(params.analysis_sample_rate) << " Hz\n";
+    }
+
+    ss << "  - Fourier bin size: " << (double)params.analysis_sample_rate / (double)params.analysis_frame_size << " Hz\n";
+
+    if(params.zero_pad_factor > 0.0) {
+        ss << "  - Frame size with zero padding: " << params.frame_size_padded << " samples\n"
+           << "  - Interpolated bin size: " << (double)params.analysis_sample_rate / (double)params.frame_size_padded << " Hz\n";
     }
 
     if(DO_OVERLAP) {
-        const int overlap_n_samples = std::clamp((int)(OVERLAP_RATIO * (double)FRAME_SIZE), 1, FRAME_SIZE - 1);
-        ss << "  - Overlap ratio: " << OVERLAP_RATIO << "  (" << overlap_n_samples << " overlapping samples)" << '\n'
-           << "  - Frame time without overlap: " << ((double)(FRAME_SIZE - overlap_n_samples) / (double)SAMPLE_RATE) * 1000.0 << " ms\n";
+        const int overlap_n_samples = std::clamp((int)(params.overlap_ratio * (double)params.frame_size), 1, params.frame_size - 1);
+        ss << "  - Overlap ratio: " << params.overlap_ratio << "  (" << overlap_n_samples << " overlapping samples)" << '\n'
+           << "  - Frame time without overlap: " << ((double)(params.frame_size - overlap_n_samples) / (double)params.sample_rate) * 1000.0 << " ms\n";
     }
 
     if(DO_OVERLAP_NONBLOCK) {
-        const int min_overlap_n_samples = std::max((int)(MIN_NONBLOCK_OVERLAP_RATIO * (double)FRAME_SIZE), 1);
-        const int max_overlap_n_samples = std::min((int)(MAX_NONBLOCK_OVERLAP_RATIO * (double)FRAME_SIZE), FRAME_SIZE - 1);
+        const int min_overlap_n_samples = std::max((int)(MIN_NONBLOCK_OVERLAP_RATIO * (double)params.frame_size), 1);
+        const int max_overlap_n_samples = std::min((int)(MAX_NONBLOCK_OVERLAP_RATIO * (double)params.frame_size), params.frame_size - 1);
 
         ss << "  - Minimum non-blocking overlap ratio: " << MIN_NONBLOCK_OVERLAP_RATIO << "  (" << min_overlap_n_samples << " overlapping samples)\n"
            << "  - Maximum non-blocking overlap ratio: " << MAX_NONBLOCK_OVERLAP_RATIO << "  (" << max_overlap_n_samples << " overlapping samples)\n"
-           << "  - Frame time between " << ((MIN_NONBLOCK_OVERLAP_RATIO * FRAME_SIZE) * 1000.0) / (double)SAMPLE_RATE << " and " << ((MAX_NONBLOCK_OVERLAP_RATIO * FRAME_SIZE) * 1000.0) / (double)SAMPLE_RATE << " ms\n";
+           << "  - Frame time between " << ((MIN_NONBLOCK_OVERLAP_RATIO * params.frame_size) * 1000.0) / (double)params.sample_rate << " and " << ((MAX_NONBLOCK_OVERLAP_RATIO * params.frame_size) * 1000.0) / (double)params.sample_rate << " ms\n";
     }
 
     // TODO: Better estimate
@@ -152,6 +162,10 @@ int main(int argc, char *argv[]) {
         // TODO: Print something? (verify_cli_args() already prints error)
         exit(EXIT_FAILURE);
     }
+    if(!verify_params()) {
+        hint("Check the values passed with '--param' or '--param-file'");
+        exit(EXIT_FAILURE);
+    }
 
     if(!verify_rsc_dir()) {
         hint("You have to point to the resource directory if not running from project root using '--rsc <path>'");
@@ -166,6 +180,18 @@ int main(int argc, char *argv[]) {
         exit(EXIT_SUCCESS);
     }
 
+    // Batch transcription doesn't need any SDL subsystem
+    if(cli_args.batch) {
+        print_transcription_config();
+
+        BatchTranscriber *batch_transcriber = new BatchTranscriber(cli_args.batch_input, cli_args.batch_output_dir, cli_args.batch_workers);
+        const bool all_transcribed = batch_transcriber->run();
+        delete batch_transcriber;
+
+        fftwf_cleanup();
+        return all_transcribed ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // Init SDL with only audio
     if(SDL_Init(SDL_INIT_AUDIO) < 0) {
         error("SDL could not initialize\nSDL Error: " + STR(SDL_GetError()));
@@ -193,9 +219,11 @@ int main(int argc, char *argv[]) {
     }
 
     SDL_AudioDeviceID in_dev;
+    CaptureRing *capture_ring = nullptr;
     if(recording) {
         print_recording_devices();
-        init_recording_device(in_dev);
+        capture_ring = new CaptureRing(CAPTURE_RING_SIZE);
+        init_recording_device(in_dev, capture_ring);
     }
 
     print_transcription_config();
@@ -215,7 +243,7 @@ int main(int argc, char *argv[]) {
     }
 
     // Init program logic
-    Program *program = new Program(graphics, &in_dev, &out_dev);
+    Program *program = new Program(graphics, &in_dev, &out_dev, capture_ring);
 
 
     // Main program starts now, so init is done
@@ -234,6 +262,9 @@ int main(int argc, char *argv[]) {
         delete program;
 
     SDL_CloseAudioDevice(in_dev);
+    // After closing the device, as its audio callback writes to the ring
+    if(capture_ring != nullptr)
+        delete capture_ring;
     SDL_CloseAudioDevice(out_dev);
 
     TTF_Quit();
@@ -5,6 +5,7 @@
 // #include "error.h"
 
 #include <vector>
+#include <memory_resource>
 #include <string>
 #include <ostream>
 #include <cmath>
@@ -104,7 +105,8 @@ struct NoteEvent {
 typedef std::vector<NoteEvent> NoteEvents;
 
 
-typedef std::vector<Note> NoteSet;
+// Polymorphic allocator, so estimators can draw NoteSets from their workspace arena
+typedef std::pmr::vector<Note> NoteSet;
 std::ostream& operator<<(std::ostream &s, const NoteSet &noteset);
 
 
@@ -6,10 +6,12 @@
 #include "error.h"
 
 #include "synth/synth.h"  // Note not synths.h
+#include "estimators/estimator.h"  // Note not estimators.h
 
 #include "config/cli_args.h"
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 #include "config/graphics.h"
 #include "config/results_file.h"
 
@@ -18,15 +20,22 @@
 #include <cstdlib>  // EXIT_SUCCESS, EXIT_FAILURE
 #include <string>  // std::stoi(), std::stod()
 #include <filesystem>  // basic checks on given rsc directory
+#include <fstream>  // Reading parameter files
+#include <sstream>  // Splitting parameter file lines
 #include <functional>  // std::invoke()
 #include <optional>  // Construct note without initializing it
 #include <map>
+#include <variant>  // Parameter types
+#include <algorithm>  // std::replace()
 #include <stdexcept>  // std::runtime_error
 
 
 // Initialize the global holding the chosen CLI argument options
 CLIArgs cli_args;
 
+// Initialize the global holding the transcription parameters
+TranscriptionParams params;
+
 
 bool flag_ordering(const std::string lhs, const std::string rhs) {
     // Normal sorting if both are - or both are --
@@ -51,6 +60,9 @@ const std::map<const std::string, const ParseObj, compare_func_t> ArgParser::fla
         {"--audio",                 ParseObj(&ArgParser::parse_audio,                 {OptType::last_arg})},
         {"--audio_in",              ParseObj(&ArgParser::parse_audio_in,              {OptType::audio_in_device})},
         {"--audio_out",             ParseObj(&ArgParser::parse_audio_out,             {OptType::audio_out_device})},
+        {"--batch",                 ParseObj(&ArgParser::parse_batch,                 {OptType::file, OptType::dir})},
+        {"--estimator",             ParseObj(&ArgParser::parse_estimator,             {OptType::estimator})},
+        {"--estimators",            ParseObj(&ArgParser::parse_estimators,            {OptType::last_arg})},
         {"--experiment",            ParseObj(&ArgParser::parse_experiment,            {OptType::experiment})},
         {"--experiments",           ParseObj(&ArgParser::parse_experiments,           {OptType::last_arg})},
         {"-f",                      ParseObj(&ArgParser::parse_fullscreen,            {})},
@@ -58,10 +70,14 @@ const std::map<const std::string, const ParseObj, compare_func_t> ArgParser::fla
         {"--gen-completions",       ParseObj(&ArgParser::generate_completions,        {OptType::completions_file, OptType::last_arg})},
         {"-h",                      ParseObj(&ArgParser::parse_help,                  {OptType::last_arg})},
         {"--help",                  ParseObj(&ArgParser::parse_help,                  {OptType::last_arg})},
+        {"-j",                      ParseObj(&ArgParser::parse_batch_workers,         {OptType::integer})},
         {"--midi",                  ParseObj(&ArgParser::parse_midi_out,              {})},
         {"-n",                      ParseObj(&ArgParser::parse_generate_note,         {OptType::opt_note})},
         {"-o",                      ParseObj(&ArgParser::parse_output_file,           {OptType::output_file})},
         {"--output",                ParseObj(&ArgParser::parse_output_file,           {OptType::output_file})},
+        {"--param",                 ParseObj(&ArgParser::parse_param,                 {OptType::param, OptType::decimal})},
+        {"--param-file",            ParseObj(&ArgParser::parse_param_file,            {OptType::file})},
+        {"--params",                ParseObj(&ArgParser::parse_params,                {OptType::last_arg})},
         {"--over",                  ParseObj(&ArgParser::parse_print_overtone,        {OptType::note, OptType::opt_integer, OptType::midi_switch, OptType::last_arg})},
         {"-p",                      ParseObj(&ArgParser::parse_playback,              {OptType::opt_left_right})},
         {"--play_note_event_file",  ParseObj(&ArgParser::parse_play_note_event_file,  {OptType::file, OptType::synth, OptType::opt_audio_out_device, OptType::last_arg})},
@@ -83,17 +99,24 @@ const std::pair<const std::string, const std::string> help_strings[] = {
     {"--audio",                     "Print used audio driver and available audio devices"},
     {"--audio_in <device name>",    "Set the recording device to device name (as provided by Digistring at start-up"},
     {"--audio_out <device name>",   "Set the playback device to device name (as provided by Digistring at start-up"},
+    {"--batch <input> [dir]",       "Transcribe the WAV files in input (a directory or a file listing a WAV file per line) in parallel without GUI, writing the results of every file as JSON to dir (default is next to the WAV file)"},
+    {"--estimator <estimator>",     "Use given estimator for transcription (default is highres)"},
+    {"--estimators",                "List available estimators"},
     {"--experiment <experiment>",   "Runs given experiment"},
     {"--experiments",               "Lists available experiments"},
     {"-f",                          "Start in fullscreen (also set the fullscreen resolution with '-r')"},
     {"--file <file>",               "Play samples from given file"},
     {"--gen-completions <file>",    "Generate Bash completions to file (overwriting it) (default filename is completions.sh)"},
     {"-h | --help",                 "Print command line argument information. Optionally pass 'readme' for readme formatting"},
+    {"-j <n>",                      "Number of files batch transcription transcribes in parallel (default is one per core)"},
     {"--midi",                      "Output MIDI events"},
     {"-n [note]",                   "Generate note (default is A4)"},
     {"-o | --output [file]",        "Write estimation results as JSON to file (default filename is " + DEFAULT_OUTPUT_FILENAME + ")"},
     {"--over <note> [n] [midi]",    "Print n (default is 5) overtones of given note; optionally toggle midi number column by passing \"midi_on\" or \"midi_off\" (default to midi_off)"},
     {"-p [left/right]",             "Play recorded audio back; when also synthesizing, pass \"left\" or \"right\" to set playback to this channel (and synthesis to the other)"},
+    {"--param <name> <value>",      "Set transcription parameter name to value (later flags override earlier ones)"},
+    {"--param-file <file>",         "Set transcription parameters from file with a 'name = value' pair per line ('#' starts a comment)"},
+    {"--params",                    "List transcription parameters and their defaults"},
     {"--perf <file>",               "Write performance statistics to file, which can be used by our `performance_plot` tool (may generate different files for different subtasks)"},
     {"-r <w> <h>",                  "Start GUI with given resolution"},
     // {"--real-time",                 "Run Digistring \"real-time\"; in other words, sync graphics etc. as if audio was playing back"},
@@ -232,6 +255,95 @@ void ArgParser::parse_audio_out() {
 }
 
 
+void ArgParser::parse_batch() {
+    const char *input;
+    if(!fetch_opt(input)) {
+        error("No directory or file list given with the '--batch' flag");
+        exit(EXIT_FAILURE);
+    }
+
+    if(!std::filesystem::exists(input)) {
+        error("Given batch input '" + STR(input) + "' does not exist");
+        exit(EXIT_FAILURE);
+    }
+
+    cli_args.batch = true;
+    cli_args.batch_input = input;
+
+    const char *output_dir;
+    if(!fetch_opt(output_dir))
+        return;
+
+    if(!std::filesystem::is_directory(output_dir)) {
+        error("Given batch output directory '" + STR(output_dir) + "' is not a directory");
+        exit(EXIT_FAILURE);
+    }
+
+    cli_args.batch_output_dir = output_dir;
+}
+
+
+void ArgParser::parse_batch_workers() {
+    const char *n_string;
+    if(!fetch_opt(n_string)) {
+        error("No number of workers provided with '-j' flag");
+        exit(EXIT_FAILURE);
+    }
+
+    int n;
+    try {
+        n = std::stoi(n_string);
+    }
+    catch(const std::out_of_range &e) {
+        error("Number of workers is too large to store in an integer");
+        exit(EXIT_FAILURE);
+    }
+    catch(const std::exception &e) {
+        error("Failed to parse given number of workers as an integer (" + STR(e.what()) + ")");
+        exit(EXIT_FAILURE);
+    }
+    if(n < 1) {
+        error("Batch transcription needs at least one worker");
+        exit(EXIT_FAILURE);
+    }
+
+    cli_args.batch_workers = n;
+}
+
+
+void ArgParser::parse_estimator() {
+    const char *estimator_string;
+    if(!fetch_opt(estimator_string)) {
+        error("No estimator provided");
+        exit(EXIT_FAILURE);
+    }
+
+    try {
+        cli_args.estimator_type = parse_estimator_string.at(estimator_string);
+    }
+    catch(const std::out_of_range &e) {
+        error("Unknown estimator type '" + std::string(estimator_string) + "'");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+void ArgParser::parse_estimators() {
+    std::cout << "Available estimators:" << std::endl;
+    for(const auto &[key, value] : parse_estimator_string) {
+        try {
+            std::string description = estimator_description.at(value);
+            std::cout << "  - " << key << ": " << description << std::endl;
+        }
+        catch(const std::out_of_range &e) {
+            std::cout << "  - " << key << std::endl;
+        }
+    }
+
+    exit(EXIT_SUCCESS);
+}
+
+
 void ArgParser::parse_experiment() {
     const char *exp_cstr;
     if(!fetch_opt(exp_cstr)) {
@@ -488,6 +600,118 @@ void ArgParser::parse_play_note_event_file() {
 }
 
 
+// Sets the parameter to the value; returns false (after printing an error) if either isn't valid
+bool set_param(const std::string &name, const std::string &value) {
+    ParamInfo info;
+    try {
+        info = param_info.at(name);
+    }
+    catch(const std::out_of_range &e) {
+        error("Unknown transcription parameter '" + name + "'");
+        hint("List the transcription parameters with '--params'");
+        return false;
+    }
+
+    try {
+        size_t n_parsed;
+        if(std::holds_alternative<int TranscriptionParams::*>(info.member))
+            params.*std::get<int TranscriptionParams::*>(info.member) = std::stoi(value, &n_parsed);
+        else
+            params.*std::get<double TranscriptionParams::*>(info.member) = std::stod(value, &n_parsed);
+
+        if(n_parsed != value.size()) {
+            error("Trailing characters after value '" + value + "' of transcription parameter '" + name + "'");
+            return false;
+        }
+    }
+    catch(const std::out_of_range &e) {
+        error("Value '" + value + "' of transcription parameter '" + name + "' is out of range");
+        return false;
+    }
+    catch(const std::exception &e) {
+        error("Failed to parse value '" + value + "' of transcription parameter '" + name + "' (" + STR(e.what()) + ")");
+        return false;
+    }
+
+    update_derived_params();
+    return true;
+}
+
+
+void ArgParser::parse_param() {
+    const char *name, *value;
+    if(!fetch_opt(name)) {
+        error("No parameter name provided with '--param' flag");
+        exit(EXIT_FAILURE);
+    }
+    // Not fetch_opt(), as values may be negative
+    if(!fetch_arg(value)) {
+        error("No value provided for transcription parameter '" + STR(name) + "'");
+        exit(EXIT_FAILURE);
+    }
+
+    if(!set_param(name, value))
+        exit(EXIT_FAILURE);
+}
+
+
+void ArgParser::parse_param_file() {
+    const char *filename;
+    if(!fetch_opt(filename)) {
+        error("No parameter file provided with '--param-file' flag");
+        exit(EXIT_FAILURE);
+    }
+
+    std::ifstream param_file(filename);
+    if(!param_file.is_open()) {
+        error("Failed to open parameter file '" + STR(filename) + "'");
+        exit(EXIT_FAILURE);
+    }
+
+    std::string line;
+    for(int line_number = 1; std::getline(param_file, line); line_number++) {
+        // Strip comments
+        const size_t comment = line.find('#');
+        if(comment != std::string::npos)
+            line.erase(comment);
+
+        // Allow both "name = value" and "name value"
+        std::replace(line.begin(), line.end(), '=', ' ');
+        std::stringstream ss(line);
+        std::string name, value, rest;
+        if(!(ss >> name))
+            continue;  // Empty line
+
+        if(!(ss >> value) || ss >> rest) {
+            error("Expected 'name = value' on line " + STR(line_number) + " of parameter file '" + STR(filename) + "'");
+            exit(EXIT_FAILURE);
+        }
+
+        if(!set_param(name, value)) {
+            hint("On line " + STR(line_number) + " of parameter file '" + STR(filename) + "'");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+void ArgParser::parse_params() {
+    const TranscriptionParams defaults;
+
+    std::cout << "Transcription parameters (set with '--param <name> <value>' or '--param-file <file>'):" << std::endl;
+    for(const auto &[name, info] : param_info) {
+        std::cout << "  - " << name << ": " << info.description << " (default is ";
+        if(std::holds_alternative<int TranscriptionParams::*>(info.member))
+            std::cout << defaults.*std::get<int TranscriptionParams::*>(info.member);
+        else
+            std::cout << defaults.*std::get<double TranscriptionParams::*>(info.member);
+        std::cout << ")" << std::endl;
+    }
+
+    exit(EXIT_SUCCESS);
+}
+
+
 void ArgParser::parse_print_performance() {
     const char *perf_file;
     if(!fetch_opt(perf_file)) {
@@ -49,6 +49,10 @@ class ArgParser {
         void parse_audio();
         void parse_audio_in();
         void parse_audio_out();
+        void parse_batch();
+        void parse_batch_workers();
+        void parse_estimator();
+        void parse_estimators();
         void parse_experiment();
         void parse_experiments();
         void parse_fullscreen();
@@ -60,6 +64,9 @@ class ArgParser {
         void parse_print_overtone();
         void parse_playback();
         void parse_play_note_event_file();
+        void parse_param();
+        void parse_param_file();
+        void parse_params();
         void parse_print_performance();
         void parse_resolution();
         void parse_rsc_dir();
@@ -76,7 +83,7 @@ class ArgParser {
 // last_arg will prevent further completions to be given (useful for signalling no other flags are possible)
 enum class OptType {
     dir, file, output_file, perf_file, completions_file, decimal, opt_decimal, integer, opt_integer, note, opt_note, last_arg,
-    synth, opt_synth, opt_left_right, audio_in_device, audio_out_device, opt_audio_out_device, midi_switch, experiment
+    synth, opt_synth, opt_left_right, audio_in_device, audio_out_device, opt_audio_out_device, midi_switch, experiment, estimator, param
 };
 
 // Struct holding the parse function and OptTypes
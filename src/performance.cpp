@@ -71,11 +71,11 @@ Performance::~Performance() {
 }
 
 
-void Performance::push_time_point(const std::string &name) {
+void Performance::push_time_point(const char *const name) {
     time_points.push_back({name, std::chrono::steady_clock::now()});
 }
 
-void Performance::push_time_point(const std::string &name, const std::chrono::steady_clock::time_point &tp) {
+void Performance::push_time_point(const char *const name, const std::chrono::steady_clock::time_point &tp) {
     time_points.push_back({name, tp});
 }
 
@@ -12,7 +12,8 @@
 #include <set>
 
 
-typedef std::pair<std::string, std::chrono::steady_clock::time_point> Timestamp;
+// Names are string literals, so pushing a time point doesn't allocate
+typedef std::pair<const char *, std::chrono::steady_clock::time_point> Timestamp;
 
 
 class Performance {
@@ -21,8 +22,8 @@ class Performance {
         Performance() : Performance("") {};
         ~Performance();
 
-        void push_time_point(const std::string &name);  // Pushes timepoint now with given name
-        void push_time_point(const std::string &name, const std::chrono::steady_clock::time_point &tp);
+        void push_time_point(const char *const name);  // Pushes timepoint now with given name
+        void push_time_point(const char *const name, const std::chrono::steady_clock::time_point &tp);
 
         // Writes the time point durations to durations if output file is set in cli_args
         void clear_time_points();
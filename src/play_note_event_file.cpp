@@ -10,6 +10,7 @@
 
 #include "config/synth.h"
 #include "config/cli_args.h"
+#include "config/transcription_params.h"
 
 #include <SDL2/SDL.h>
 
@@ -119,14 +120,14 @@ void play_note_event_file(const std::string &note_event_file, const SDL_AudioDev
     }
     Synth *const synth = synth_factory(cli_args.synth_type);
     synth->set_max_amp(1.0);
-    info("Using a synth buffer size of " + STR(SYNTH_BUFFER_SIZE) + " samples at a sample rate of " + STR(SAMPLE_RATE) + " Hz");
+    info("Using a synth buffer size of " + STR(SYNTH_BUFFER_SIZE) + " samples at a sample rate of " + STR(params.sample_rate) + " Hz");
 
     const int n_events = pne.size();
     int min_idx = 0;
     double played_time = 0.0;
     SDL_PauseAudioDevice(out_dev, 0);
     while(!poll_quit()) {
-        const double frame_time = (double)SYNTH_BUFFER_SIZE / (double)SAMPLE_RATE;
+        const double frame_time = (double)SYNTH_BUFFER_SIZE / (double)params.sample_rate;
         const double frame_ended_time = played_time + frame_time;
 
         // Skip events completely in the past
@@ -152,8 +153,8 @@ void play_note_event_file(const std::string &note_event_file, const SDL_AudioDev
                 continue;
 
             // TODO: Actual timing; but requires polyphonic synth
-            // const int start = std::clamp((int)((pne[i].onset - played_time) * (double)SAMPLE_RATE), 0, SYNTH_BUFFER_SIZE);
-            // const int end = std::clamp((int)((pne[i].offset - played_time) * (double)SAMPLE_RATE), 0, SYNTH_BUFFER_SIZE);
+            // const int start = std::clamp((int)((pne[i].onset - played_time) * (double)params.sample_rate), 0, SYNTH_BUFFER_SIZE);
+            // const int end = std::clamp((int)((pne[i].offset - played_time) * (double)params.sample_rate), 0, SYNTH_BUFFER_SIZE);
             // ne.push_back(NoteEvent(Note(pne[i].note.midi_number, pne[i].volume), end - start, start));
             // std::cout << start << " " << end << std::endl;
             // std::cout << pne[i].onset << ' ' << pne[i].offset << "    " << played_time << " " << frame_ended_time << std::endl;
@@ -6,28 +6,37 @@
 #include "performance.h"
 #include "quit.h"
 #include "error.h"
+#include "heap_allocations.h"
+#include "spsc_queue.h"
 
 #include "config/cli_args.h"
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 #include "config/graphics.h"
 #include "config/results_file.h"
 #include "config/synth.h"
+#include "config/pipeline.h"
 
 #include "estimators/estimators.h"
 #include "sample_getter/sample_getters.h"
 
 #include <SDL2/SDL.h>
 
-#include <iomanip>  // std::setw()
+#include <iomanip>  // std::setw(), std::setprecision()
+#include <sstream>
+#include <string>
 #include <chrono>
 #include <thread>  // sleep
-#include <utility>  // std::move()
+#include <mutex>
+#include <utility>  // std::swap()
+#include <functional>  // std::ref()
 #include <cmath>  // std::round()
 #include <cstring>  // memcpy()
 
 
-Program::Program(Graphics *const _g, SDL_AudioDeviceID *const _in, SDL_AudioDeviceID *const _out) : graphics(_g) {
+Program::Program(Graphics *const _g, SDL_AudioDeviceID *const _in, SDL_AudioDeviceID *const _out, CaptureRing *const capture_ring)
+        : graphics(_g), main_thread_id(std::this_thread::get_id()), pitch_steps(0), seek_samples(0), processed_samples(0), ring_released(0) {
     // As early as possible, so it is very likely enough time has passed to render next frame when main loop is running
     prev_frame = std::chrono::steady_clock::now();
 
@@ -35,20 +44,26 @@ Program::Program(Graphics *const _g, SDL_AudioDeviceID *const _in, SDL_AudioDevi
     out_dev = _out;
 
     // We let the estimator create the input buffer for optimal size and better alignment
-    input_buffer = NULL;
-    input_buffer_n_samples = -1;
-    // estimator = new Tuned(input_buffer, input_buffer_n_samples);
-    estimator = new HighRes(input_buffer, input_buffer_n_samples);
-    // estimator = new BasicFourier(input_buffer, input_buffer_n_samples);
-    if(input_buffer == NULL) {
+    estimator_buffer = NULL;
+    estimator_buffer_n_samples = -1;
+    estimator = estimator_factory(cli_args.estimator_type, estimator_buffer, estimator_buffer_n_samples);
+    if(estimator_buffer == NULL) {
         error("Estimator did not create an input buffer");
         exit(EXIT_FAILURE);
     }
-    if(input_buffer_n_samples == -1) {
+    if(estimator_buffer_n_samples == -1) {
         error("Estimator did not set number of samples in input buffer");
         exit(EXIT_FAILURE);
     }
 
+    // The decimator reads longer frames from the SampleGetter than the estimator gets
+    decimator = nullptr;
+    input_buffer_n_samples = estimator_buffer_n_samples;
+    if(params.decimation_factor > 1) {
+        decimator = new Decimator(params.decimation_factor, estimator_buffer_n_samples);
+        input_buffer_n_samples = decimator->get_in_size();
+    }
+
     switch(cli_args.audio_input_method) {
         case SampleGetters::wave_generator:
             sample_getter = new WaveGenerator(input_buffer_n_samples, cli_args.generate_sine_freq);
@@ -59,11 +74,19 @@ Program::Program(Graphics *const _g, SDL_AudioDeviceID *const _in, SDL_AudioDevi
             break;
 
         case SampleGetters::audio_file:
-            sample_getter = new AudioFile(input_buffer_n_samples, cli_args.play_file_name);
+            try {
+                sample_getter = new AudioFile(input_buffer_n_samples, cli_args.play_file_name);
+            }
+            catch(const AudioFileError &e) {
+                error(e.what());
+                if(!e.get_hint().empty())
+                    hint(e.get_hint());
+                exit(EXIT_FAILURE);
+            }
             break;
 
         case SampleGetters::audio_in:
-            sample_getter = new AudioIn(input_buffer_n_samples, in_dev);
+            sample_getter = new AudioIn(input_buffer_n_samples, capture_ring);
             break;
 
         default:
@@ -117,8 +140,15 @@ Program::Program(Graphics *const _g, SDL_AudioDeviceID *const _in, SDL_AudioDevi
 
     mouse_clicked = false;
 
-    if(cli_args.output_file)
-        results_file = new ResultsFile(cli_args.output_filename);
+    if(cli_args.output_file) {
+        try {
+            results_file = new ResultsFile(cli_args.output_filename);
+        }
+        catch(const std::runtime_error &e) {
+            error(e.what());
+            exit(EXIT_FAILURE);
+        }
+    }
 
     if(cli_args.midi_out)
         midi_out = new MidiOut();
@@ -145,6 +175,8 @@ Program::~Program() {
     }
 
     delete sample_getter;
+
+    delete decimator;
     delete estimator;
 }
 
@@ -158,14 +190,48 @@ void Program::main_loop() {
         SDL_PauseAudioDevice(*out_dev, 0);
 
     if(cli_args.output_file) {
-        write_result_header();
+        write_result_header(*results_file, input_buffer_n_samples, estimator_buffer_n_samples, decimator != nullptr);
         results_file->start_array("note events");  // Stopped after while loop, so only note events can be pushed from now on
     }
 
-    Performance perf;
+    // Slowdown changes the number of new samples after estimation, which the capture stage syncs on
+    // Stereo split playback interleaves captured and synthesized samples, so both have to be in the same stage
+    const bool pipelined = PIPELINE && !cli_args.do_slowdown && !cli_args.stereo_split;
+    if(PIPELINE && !pipelined)
+        info("Slowdown and stereo split playback are not supported by the pipeline; using serial main loop instead");
 
     const std::chrono::steady_clock::time_point start_estimation_loop = std::chrono::steady_clock::now();
-    unsigned long processed_samples = 0;
+    processed_samples = 0;
+    if(pipelined)
+        pipeline_loop();
+    else
+        serial_loop();
+    const std::chrono::steady_clock::time_point stop_estimation_loop = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> estimation_loop_time = stop_estimation_loop - start_estimation_loop;
+    info("Pitch estimation time: " + STR(estimation_loop_time.count()) + " s");
+    if(!cli_args.sync_with_audio && !cli_args.playback && !cli_args.synth && !sample_getter->is_audio_recording_device()) {
+        info("Processed samples time: " + STR((double)processed_samples / (double)params.sample_rate) + " s");
+        info("Estimator was at least " + STR(((double)processed_samples / (double)params.sample_rate) / estimation_loop_time.count()) + " times real-time");
+    }
+
+    if(cli_args.output_file) {
+        // Write silent note event to explicitly stop the last note
+        write_results(*results_file, NoteEvents(), sample_getter->get_played_samples());
+
+        // End note events array
+        results_file->stop_array();
+    }
+}
+
+
+void Program::serial_loop() {
+    Performance perf;
+
+    // Reused every frame, so the estimator doesn't have to allocate for its results
+    NoteEvents estimated_events;
+    estimated_events.reserve(MAX_NOTE_EVENTS_PER_FRAME);
+    unsigned long frame_count = 0;
+
     while(!poll_quit()) {
         perf.clear_time_points();
         perf.push_time_point("Start");
@@ -174,88 +240,359 @@ void Program::main_loop() {
         handle_sdl_events();
         if(poll_quit())
             break;
+        apply_sample_getter_requests();
         perf.push_time_point("Handled SDL events");
 
-        // Read a frame
+        // Read a frame; the frame is a view into the SampleGetter's ring, so overlapping samples aren't copied
         // new_samples is not const, as slowdown may alter it
-        int new_samples = sample_getter->get_frame(input_buffer, input_buffer_n_samples);  // TODO: Don't block on this call (or still handle SDL events during)
+        int new_samples = sample_getter->next_frame(input_buffer_n_samples);  // TODO: Don't block on this call (or still handle SDL events during)
+        const float *const frame = sample_getter->get_frame_view(input_buffer_n_samples);
         processed_samples += new_samples;
         perf.push_time_point("Got samples");
 
-        // Play input_buffer back to the user before it is altered by estimator->perform()
         if(cli_args.playback)
-            playback_audio(new_samples);
+            playback_audio(frame, new_samples);
 
         // Send frame to estimator
-        NoteEvents estimated_events;
-        estimator->perform(input_buffer, estimated_events);
+        load_estimator_buffer(frame);
+        estimate_frame(estimated_events, new_samples, frame_count++);
         perf.push_time_point("Pitch estimated");
 
-        // If less than input_buffer_n_samples new samples are retrieved, only the NoteEvents regarding the first 'new_samples' samples are relevant, as the rest is "overwritten" in the next cycle
-        if(new_samples < input_buffer_n_samples)
-            adjust_events(estimated_events, input_buffer_n_samples, new_samples);
-        // DEBUG: Sanity check
-        else if(new_samples > input_buffer_n_samples) {
-            error("Received too many samples from SampleGetter");
-            exit(EXIT_FAILURE);
+        output_frame(estimated_events, new_samples, sample_getter->get_played_samples(), perf);
+
+        // Print performance information to CLI
+        if(cli_args.output_performance)
+            std::cout << perf << std::endl;
+
+        // Always has to be done when using audio out to prevent program running faster than audio
+        // Otherwise, when no audio out is used and cli_args.sync_with_audio is true, it will simulate this behavior
+        sync_with_audio(new_samples);
+
+
+        // Arpeggiator easter egg
+        if constexpr(ENABLE_ARPEGGIATOR)
+            arpeggiate();
+    }
+}
+
+
+void Program::pipeline_loop() {
+    SPSCQueue<CapturedFrame> capture_queue(PIPELINE_QUEUE_SIZE);
+    SPSCQueue<EstimatedFrames> output_queue(PIPELINE_QUEUE_SIZE);
+
+    // Captured frames are views into the ring, so queued frames need no buffers of their own
+    if(sample_getter->get_ring_capacity() < PIPELINE_RING_FRAMES * input_buffer_n_samples) {
+        error("SampleGetter's ring can't hold the frames of the pipeline");
+        exit(EXIT_FAILURE);
+    }
+    // The frame before the first overlaps the samples before the start
+    ring_released.store(sample_getter->get_ring_position() - input_buffer_n_samples, std::memory_order_relaxed);
+
+    // All buffers are allocated up front, so the stages don't allocate in their steady state
+    for(int i = 0; i < PIPELINE_QUEUE_SIZE; i++) {
+        EstimatedFrames &estimated_frames = output_queue.get_slot(i);
+        estimated_frames.events.reserve(MAX_NOTE_EVENTS_PER_FRAME * (OUTPUT_BACK_PRESSURE == BackPressure::coalesce ? PIPELINE_MAX_COALESCED_FRAMES : 1));
+        estimated_frames.frames.reserve(OUTPUT_BACK_PRESSURE == BackPressure::coalesce ? PIPELINE_MAX_COALESCED_FRAMES : 1);
+    }
+
+    std::thread capture_thread(&Program::capture_stage, this, std::ref(capture_queue));
+    std::thread estimation_thread(&Program::estimation_stage, this, std::ref(capture_queue), std::ref(output_queue));
+    output_stage(output_queue);
+
+    capture_thread.join();
+    estimation_thread.join();
+
+    if constexpr(PRINT_PIPELINE_STATS) {
+        print_queue_stats("Capture", capture_queue.get_stats(), capture_queue.get_capacity());
+        print_queue_stats("Output", output_queue.get_stats(), output_queue.get_capacity());
+    }
+}
+
+
+void Program::capture_stage(SPSCQueue<CapturedFrame> &out_queue) {
+    Performance perf("capture");
+
+    // Samples are captured here when the queue is full, as the SampleGetter has to keep up with the audio recording device
+    CapturedFrame spare_frame;
+
+    // Seeking rewrites the overlap before the next frame is read, so a capture writes at most two frames to the ring
+    const long ring_capacity = sample_getter->get_ring_capacity();
+    const long max_capture_samples = 2 * input_buffer_n_samples;
+
+    const bool blocking = !sample_getter->is_audio_recording_device() || CAPTURE_BACK_PRESSURE == BackPressure::block;
+    while(!poll_quit()) {
+        perf.clear_time_points();
+        perf.push_time_point("Start");
+
+        // Queued frames are views into the ring, so wait till the estimation stage is done with the samples this capture overwrites
+        // An empty queue means the estimation stage doesn't read the ring, as it pops a frame after loading it
+        const long ring_end = sample_getter->get_ring_position() + max_capture_samples;
+        long released;
+        while(ring_end - (released = ring_released.load(std::memory_order_acquire)) > ring_capacity && out_queue.size() != 0)
+            ring_released.wait(released, std::memory_order_acquire);
+        perf.push_time_point("Waited for ring");
+
+        apply_sample_getter_requests();
+
+        CapturedFrame *frame = blocking ? out_queue.wait_write_slot() : out_queue.write_slot();
+        const bool use_spare = frame == nullptr;
+        if(use_spare)
+            frame = &spare_frame;
+        perf.push_time_point("Got queue slot");
+
+        frame->new_samples = sample_getter->next_frame(input_buffer_n_samples);
+        frame->samples = sample_getter->get_frame_view(input_buffer_n_samples);
+        frame->ring_position = sample_getter->get_ring_position();
+        frame->played_samples = sample_getter->get_played_samples();
+        processed_samples += frame->new_samples;
+        perf.push_time_point("Got samples");
+
+        if(cli_args.playback)
+            playback_audio(frame->samples, frame->new_samples);
+
+        // The estimator may have popped a frame while capturing
+        if(use_spare) {
+            CapturedFrame *const slot = out_queue.write_slot();
+            if(slot != nullptr) {
+                *slot = spare_frame;
+                out_queue.push();
+            }
+            else
+                out_queue.count_dropped();
         }
+        else
+            out_queue.push();
 
-        // Write estimation to output file (before applying slowdown)
-        if(cli_args.output_file)
-            write_results(estimated_events, new_samples);
+        // When synthesizing, the output stage syncs with audio out instead
+        if(!cli_args.synth)
+            sync_with_audio(frame->new_samples);
+    }
 
-        if(cli_args.do_slowdown)
-            slowdown(estimated_events, new_samples);
+    out_queue.close();
+}
+
+
+void Program::estimation_stage(SPSCQueue<CapturedFrame> &in_queue, SPSCQueue<EstimatedFrames> &out_queue) {
+    // Unnamed, so the estimation stage writes the same performance file as the serial main loop
+    Performance perf;
+
+    NoteEvents estimated_events;
+    estimated_events.reserve(MAX_NOTE_EVENTS_PER_FRAME);
+    unsigned long frame_count = 0;
+
+    // Frames are collected here and swapped with a queue slot when there is room
+    EstimatedFrames pending;
+    pending.events.reserve(MAX_NOTE_EVENTS_PER_FRAME * (OUTPUT_BACK_PRESSURE == BackPressure::coalesce ? PIPELINE_MAX_COALESCED_FRAMES : 1));
+    pending.frames.reserve(OUTPUT_BACK_PRESSURE == BackPressure::coalesce ? PIPELINE_MAX_COALESCED_FRAMES : 1);
+
+    const bool back_pressure = sample_getter->is_audio_recording_device();
+    const BackPressure capture_policy = back_pressure ? CAPTURE_BACK_PRESSURE : BackPressure::block;
+    const BackPressure output_policy = back_pressure ? OUTPUT_BACK_PRESSURE : BackPressure::block;
+    while(true) {
+        perf.clear_time_points();
+        perf.push_time_point("Start");
+
+        const CapturedFrame *frame = in_queue.wait_read_slot();
+        if(frame == nullptr)
+            break;
 
-        // Arg parser disallows both cli_args.playback and cli_args.synth to be true
-        if(cli_args.synth) {
-            synthesize_audio(estimated_events, new_samples);
-            perf.push_time_point("Synthesized audio");
+        // The newest frame overlaps the older queued frames, so skip to it (the new samples of skipped frames aren't estimated)
+        if(capture_policy == BackPressure::coalesce) {
+            const int stale_frames = in_queue.size() - 1;
+            for(int i = 0; i < stale_frames; i++)
+                in_queue.pop();
+            in_queue.count_coalesced(stale_frames);
+            frame = in_queue.read_slot();
         }
 
-        if(cli_args.midi_out)
-            midi_out->send(estimated_events);
+        // The estimator works in place on its own input buffer, so this is the only copy of the frame
+        load_estimator_buffer(frame->samples);
+        const int new_samples = frame->new_samples;
+        const long played_samples = frame->played_samples;
 
-        if(cli_args.stereo_split)
-            play_split_audio(new_samples);
+        const long frame_start = frame->ring_position - input_buffer_n_samples;
+        in_queue.pop();
 
-        // Print note estimation to CLI
-        // print_results(estimated_events);
+        // Later frames only overlap the samples after the start of this frame
+        ring_released.store(frame_start, std::memory_order_release);
+        ring_released.notify_one();
+        perf.push_time_point("Got samples");
+
+        estimate_frame(estimated_events, new_samples, frame_count++);
+        perf.push_time_point("Pitch estimated");
 
-        // Graphics
-        if constexpr(!HEADLESS) {
-            const bool new_frame = update_graphics(estimated_events);
-            if(new_frame)
-                perf.push_time_point("Frame rendered");
+        pending.events.insert(pending.events.end(), estimated_events.begin(), estimated_events.end());
+        pending.frames.push_back({new_samples, played_samples, (int)estimated_events.size()});
+
+        EstimatedFrames *slot;
+        if(output_policy == BackPressure::block || (int)pending.frames.size() == PIPELINE_MAX_COALESCED_FRAMES)
+            slot = out_queue.wait_write_slot();
+        else
+            slot = out_queue.write_slot();
+
+        if(slot != nullptr) {
+            out_queue.count_coalesced(pending.frames.size() - 1);
+            std::swap(*slot, pending);
+            out_queue.push();
+            pending.events.clear();
+            pending.frames.clear();
         }
+        else if(output_policy == BackPressure::drop) {
+            out_queue.count_dropped();
+            pending.events.clear();
+            pending.frames.clear();
+        }
+        perf.push_time_point("Queued results");
 
         // Print performance information to CLI
         if(cli_args.output_performance)
             std::cout << perf << std::endl;
+    }
 
-        // Always has to be done when using audio out to prevent program running faster than audio
-        // Otherwise, when no audio out is used and cli_args.sync_with_audio is true, it will simulate this behavior
-        sync_with_audio(new_samples);
+    if(pending.frames.size() != 0) {
+        out_queue.count_coalesced(pending.frames.size() - 1);
+        std::swap(*out_queue.wait_write_slot(), pending);
+        out_queue.push();
+    }
+    out_queue.close();
+}
+
+
+void Program::output_stage(SPSCQueue<EstimatedFrames> &in_queue) {
+    Performance perf("output");
+
+    NoteEvents frame_events;
+    frame_events.reserve(MAX_NOTE_EVENTS_PER_FRAME);
+
+    while(true) {
+        // Quitting stops the capture stage; the results still in the queues are output
+        handle_sdl_events();
+
+        EstimatedFrames *const estimated_frames = in_queue.read_slot();
+        if(estimated_frames == nullptr) {
+            if(in_queue.is_finished())
+                break;
+
+            std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(PIPELINE_OUTPUT_POLL_TIME));
+            continue;
+        }
+
+        auto first_event = estimated_frames->events.begin();
+        for(const auto &frame : estimated_frames->frames) {
+            perf.clear_time_points();
+            perf.push_time_point("Start");
 
+            frame_events.assign(first_event, first_event + frame.n_events);
+            first_event += frame.n_events;
+
+            int new_samples = frame.new_samples;
+            output_frame(frame_events, new_samples, frame.played_samples, perf);
+
+            if(cli_args.synth)
+                sync_with_audio(new_samples);
+        }
+        in_queue.pop();
 
         // Arpeggiator easter egg
         if constexpr(ENABLE_ARPEGGIATOR)
             arpeggiate();
     }
-    const std::chrono::steady_clock::time_point stop_estimation_loop = std::chrono::steady_clock::now();
-    const std::chrono::duration<double> estimation_loop_time = stop_estimation_loop - start_estimation_loop;
-    info("Pitch estimation time: " + STR(estimation_loop_time.count()) + " s");
-    if(!cli_args.sync_with_audio && !cli_args.playback && !cli_args.synth && !sample_getter->is_audio_recording_device()) {
-        info("Processed samples time: " + STR((double)processed_samples / (double)SAMPLE_RATE) + " s");
-        info("Estimator was at least " + STR(((double)processed_samples / (double)SAMPLE_RATE) / estimation_loop_time.count()) + " times real-time");
+}
+
+
+void Program::print_queue_stats(const std::string &name, const QueueStats &stats, const int capacity) const {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2)
+       << name << " queue: mean depth " << stats.mean_depth() << ", max depth " << stats.max_depth << " of " << capacity
+       << " (" << stats.pushed << " pushed, " << stats.dropped << " dropped, " << stats.coalesced << " coalesced)";
+    info(ss.str());
+}
+
+
+void Program::apply_sample_getter_requests() {
+    const int steps = pitch_steps.exchange(0);
+    for(int i = 0; i < steps; i++)
+        sample_getter->pitch_up();
+    for(int i = 0; i > steps; i--)
+        sample_getter->pitch_down();
+
+    const int d_samples = seek_samples.exchange(0);
+    if(d_samples != 0)
+        dynamic_cast<AudioFile *>(sample_getter)->seek(d_samples);
+}
+
+
+void Program::load_estimator_buffer(const float *const frame) {
+    if(decimator != nullptr)
+        decimator->decimate(frame, estimator_buffer);
+    else
+        memcpy(estimator_buffer, frame, estimator_buffer_n_samples * sizeof(float));
+}
+
+
+void Program::estimate_frame(NoteEvents &estimated_events, const int new_samples, const unsigned long frame_count) {
+    estimated_events.clear();
+    const unsigned long heap_allocations = get_thread_heap_allocations();
+    {
+        // Uncontended unless the main thread is rendering the estimator graphics
+        const std::lock_guard<std::mutex> lock(estimator_graphics_mutex);
+        estimator->perform(estimator_buffer, estimated_events);
     }
 
-    if(cli_args.output_file) {
-        // Write silent note event to explicitly stop the last note
-        write_results(NoteEvents(), 0);
+    // Estimators give lengths and offsets in decimated samples; the rest of the program counts input samples
+    if(decimator != nullptr)
+        decimator->scale_events(estimated_events);
+
+    // DEBUG: Estimators shouldn't allocate in their steady state
+    // Writing performance statistics to file allocates, so it is not checked then
+    if constexpr(COUNT_HEAP_ALLOCS) {
+        const unsigned long frame_heap_allocations = get_thread_heap_allocations() - heap_allocations;
+        if(frame_count >= HEAP_ALLOCATION_WARMUP_FRAMES && frame_heap_allocations != 0 && cli_args.perf_output_file == "") {
+            error("Estimator made " + STR(frame_heap_allocations) + " heap allocation(s) in frame " + STR(frame_count) + " after warming up");
+            hint("Switching to a background measured FFTW3 plan also allocates; run once more, so the plans are loaded from the cache");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-        // End note events array
-        results_file->stop_array();
+    // If less than input_buffer_n_samples new samples are retrieved, only the NoteEvents regarding the first 'new_samples' samples are relevant, as the rest is "overwritten" in the next cycle
+    if(new_samples < input_buffer_n_samples)
+        adjust_events(estimated_events, input_buffer_n_samples, new_samples);
+    // DEBUG: Sanity check
+    else if(new_samples > input_buffer_n_samples) {
+        error("Received too many samples from SampleGetter");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+void Program::output_frame(NoteEvents &estimated_events, int &new_samples, const long played_samples, Performance &perf) {
+    // Write estimation to output file (before applying slowdown)
+    if(cli_args.output_file)
+        write_results(*results_file, estimated_events, played_samples - new_samples);
+
+    if(cli_args.do_slowdown)
+        slowdown(estimated_events, new_samples);
+
+    // Arg parser disallows both cli_args.playback and cli_args.synth to be true
+    if(cli_args.synth) {
+        synthesize_audio(estimated_events, new_samples);
+        perf.push_time_point("Synthesized audio");
+    }
+
+    if(cli_args.midi_out)
+        midi_out->send(estimated_events);
+
+    if(cli_args.stereo_split)
+        play_split_audio(new_samples);
+
+    // Print note estimation to CLI
+    // print_results(estimated_events);
+
+    // Graphics
+    if constexpr(!HEADLESS) {
+        const bool new_frame = update_graphics(estimated_events, played_samples);
+        if(new_frame)
+            perf.push_time_point("Frame rendered");
     }
 }
 
@@ -265,7 +602,7 @@ void Program::resize(const int w, const int h) {
 }
 
 
-void Program::playback_audio(const int new_samples) {
+void Program::playback_audio(const float *const frame, const int new_samples) {
     if constexpr(PRINT_AUDIO_UNDERRUNS)
         if(SDL_GetQueuedAudioSize(*out_dev) / (SDL_AUDIO_BITSIZE(AUDIO_FORMAT) / 8) == 0)
             warning("Audio output buffer underrun; no audio left to play");
@@ -287,10 +624,10 @@ void Program::playback_audio(const int new_samples) {
             }
         }
 
-        memcpy(playback_buffer, input_buffer + (input_buffer_n_samples - new_samples), new_samples * sizeof(float));
+        memcpy(playback_buffer, frame + (input_buffer_n_samples - new_samples), new_samples * sizeof(float));
     }
     else {
-        if(SDL_QueueAudio(*out_dev, input_buffer + (input_buffer_n_samples - new_samples), new_samples * sizeof(float))) {
+        if(SDL_QueueAudio(*out_dev, frame + (input_buffer_n_samples - new_samples), new_samples * sizeof(float))) {
             error("Failed to queue audio for playback\nSDL error: " + STR(SDL_GetError()));
             exit(EXIT_FAILURE);
         }
@@ -300,56 +637,58 @@ void Program::playback_audio(const int new_samples) {
 }
 
 
-void Program::write_result_header() {
-    results_file->write_int("Sample rate (Hz)", SAMPLE_RATE);
-    results_file->write_int("Input buffer size (samples)", input_buffer_n_samples);
-    results_file->write_double("Input buffer time (ms)", ((double)input_buffer_n_samples * 1000.0) / (double)SAMPLE_RATE);
-    results_file->write_double("Fourier bin size (Hz)", (double)SAMPLE_RATE / (double)input_buffer_n_samples);
+/*static*/ void Program::write_result_header(ResultsFile &results_file, const int frame_n_samples, const int estimator_n_samples, const bool decimating) {
+    results_file.write_int("Sample rate (Hz)", params.sample_rate);
+    results_file.write_int("Input buffer size (samples)", frame_n_samples);
+    results_file.write_double("Input buffer time (ms)", ((double)frame_n_samples * 1000.0) / (double)params.sample_rate);
+    results_file.write_double("Fourier bin size (Hz)", (double)params.analysis_sample_rate / (double)estimator_n_samples);
+
+    if(decimating)
+        results_file.write_int("Decimation factor", params.decimation_factor);
 
     if(DO_OVERLAP)
-        results_file->write_double("Overlap ratio", OVERLAP_RATIO);
+        results_file.write_double("Overlap ratio", params.overlap_ratio);
 
     if(DO_OVERLAP_NONBLOCK) {
-        results_file->write_int("Minimum non-blocking overlap ratio", MIN_NONBLOCK_OVERLAP_RATIO);
-        results_file->write_int("Maximum non-blocking overlap ratio", MAX_NONBLOCK_OVERLAP_RATIO);
+        results_file.write_int("Minimum non-blocking overlap ratio", MIN_NONBLOCK_OVERLAP_RATIO);
+        results_file.write_int("Maximum non-blocking overlap ratio", MAX_NONBLOCK_OVERLAP_RATIO);
     }
 }
 
-void Program::write_results(const NoteEvents &note_events, const int new_samples) {
-    results_file->start_dict();
+/*static*/ void Program::write_results(ResultsFile &results_file, const NoteEvents &note_events, const int start_frame_samples) {
+    results_file.start_dict();
 
-    const int start_frame_samples = sample_getter->get_played_samples() - new_samples;
-    const double start_frame_time = (double)start_frame_samples / (double)SAMPLE_RATE;
+    const double start_frame_time = (double)start_frame_samples / (double)params.sample_rate;
 
     const int n_notes = note_events.size();
     if(n_notes == 0) {
         if constexpr(WRITE_SILENCE) {
-            results_file->write_int("note_start (samples)", start_frame_samples);
-            results_file->write_double("note_start (seconds)", start_frame_time);
-            results_file->write_null("note_duration (samples)");
-            results_file->write_null("note_duration (seconds)");
-            results_file->write_null("note");
-            results_file->write_null("frequency");
-            results_file->write_null("amplitude");
-            results_file->write_null("error");
-            results_file->write_null("midi_number");
+            results_file.write_int("note_start (samples)", start_frame_samples);
+            results_file.write_double("note_start (seconds)", start_frame_time);
+            results_file.write_null("note_duration (samples)");
+            results_file.write_null("note_duration (seconds)");
+            results_file.write_null("note");
+            results_file.write_null("frequency");
+            results_file.write_null("amplitude");
+            results_file.write_null("error");
+            results_file.write_null("midi_number");
         }
     }
 
     for(const auto &note_event : note_events) {
         const std::string note = note_to_string_ascii(note_event.note);
-        results_file->write_int("note_start (samples)", start_frame_samples + note_event.offset);
-        results_file->write_double("note_start (seconds)", start_frame_time + ((double)note_event.offset / (double)SAMPLE_RATE));
-        results_file->write_int("note_duration (samples)", note_event.length);
-        results_file->write_double("note_duration (seconds)", (double)note_event.length / (double)SAMPLE_RATE);
-        results_file->write_string("note", note);
-        results_file->write_double("frequency", note_event.note.freq);
-        results_file->write_double("amplitude", note_event.note.amp);
-        results_file->write_double("error", note_event.note.error);
-        results_file->write_int("midi_number", note_event.note.midi_number);
-    }
-
-    results_file->stop_dict();
+        results_file.write_int("note_start (samples)", start_frame_samples + note_event.offset);
+        results_file.write_double("note_start (seconds)", start_frame_time + ((double)note_event.offset / (double)params.sample_rate));
+        results_file.write_int("note_duration (samples)", note_event.length);
+        results_file.write_double("note_duration (seconds)", (double)note_event.length / (double)params.sample_rate);
+        results_file.write_string("note", note);
+        results_file.write_double("frequency", note_event.note.freq);
+        results_file.write_double("amplitude", note_event.note.amp);
+        results_file.write_double("error", note_event.note.error);
+        results_file.write_int("midi_number", note_event.note.midi_number);
+    }
+
+    results_file.stop_dict();
 }
 
 
@@ -357,19 +696,17 @@ void Program::print_results(const NoteEvents &note_events) const {
     if(note_events.size() == 0)
         return;
 
-    if(note_events.size() > 1) {
-        warning("Polyphonic result printing is not yet supported");  // TODO: Support
-        return;
+    // All notes of a frame on one line, separated by a bar
+    for(size_t i = 0; i < note_events.size(); i++) {
+        if(i > 0)
+            std::cout << "  |  ";
+        std::cout << note_events[i].note << "  (" << note_events[i].note.freq << " Hz, " << note_events[i].note.amp << " dB, " << note_events[i].note.error << " cent)";
     }
-
-    std::cout << note_events[0].note << "  (" << note_events[0].note.freq << " Hz, " << note_events[0].note.amp << " dB, " << note_events[0].note.error << " cent)" << "     \r" << std::flush;
+    std::cout << "     \r" << std::flush;
 }
 
 
-bool Program::update_graphics(const NoteEvents &note_events) {
-    // Get the pointer to the graphics object here, as it is only valid till next call to Estimator::perform()
-    const EstimatorGraphics *const estimator_graphics = estimator->get_estimator_graphics();
-
+bool Program::update_graphics(const NoteEvents &note_events, const long played_samples) {
     // Limit FPS
     frame_time = std::chrono::steady_clock::now() - prev_frame;
     if(frame_time.count() < 1000.0 / MAX_FPS)
@@ -380,17 +717,21 @@ bool Program::update_graphics(const NoteEvents &note_events) {
     graphics->set_clicked((mouse_clicked ? mouse_x : -1), mouse_y);
 
     if(cli_args.audio_input_method == SampleGetters::audio_in)
-        graphics->set_queued_samples(SDL_GetQueuedAudioSize(*in_dev) / (SDL_AUDIO_BITSIZE(AUDIO_FORMAT) / 8));
+        graphics->set_queued_samples(static_cast<AudioIn *>(sample_getter)->get_queued_samples());
     else if(cli_args.audio_input_method == SampleGetters::audio_file)
-        graphics->set_file_played_time(sample_getter->get_played_time());  // TODO: Subtract new_samples(_time) from playtime?
+        graphics->set_file_played_time((double)played_samples / (double)params.sample_rate);  // TODO: Subtract new_samples(_time) from playtime?
 
-    const int n_notes = note_events.size();
-    if(n_notes == 0)
-        graphics->render_frame(nullptr, estimator_graphics);
-    else if(n_notes == 1)
-        graphics->render_frame(&note_events[0].note, estimator_graphics);
-    else  // n_notes > 1
-        warning("Polyphonic graphics not yet supported");  // TODO: Support
+    // The estimation stage may be working on a newer frame than note_events belongs to when pipelining
+    const std::lock_guard<std::mutex> lock(estimator_graphics_mutex);
+    // Get the pointer to the graphics object here, as it is only valid till next call to Estimator::perform()
+    const EstimatorGraphics *const estimator_graphics = estimator->get_estimator_graphics();
+
+    // The note info only has room for one note, so show the loudest of a polyphonic frame (all peaks are in the estimator graphics)
+    const Note *loudest_note = nullptr;
+    for(const NoteEvent &note_event : note_events)
+        if(loudest_note == nullptr || note_event.note.amp > loudest_note->amp)
+            loudest_note = &note_event.note;
+    graphics->render_frame(loudest_note, estimator_graphics);
 
     return true;
 }
@@ -410,9 +751,12 @@ bool Program::update_graphics(const NoteEvents &note_events) {
      */
     const int old_samples = n_frame_samples - new_samples;
 
-    // Make second NoteEvents and move events, so that case 1 event deletion doesn't interfere with the loop
-    NoteEvents adjusted;
-    for(const auto &event : events) {
+    // Compact the kept events to the front in-place, so no second NoteEvents has to be allocated
+    // Writing never overtakes reading, so case 1 event deletion doesn't interfere with the loop
+    size_t n_adjusted = 0;
+    for(size_t i = 0; i < events.size(); i++) {
+        const NoteEvent &event = events[i];
+
         // Case 1
         if(event.offset + event.length < old_samples)
             continue;
@@ -423,17 +767,17 @@ bool Program::update_graphics(const NoteEvents &note_events) {
             const int offset_before_new = old_samples - event.offset;
             const int new_length = event.length - offset_before_new;
             const int new_offset = 0;
-            adjusted.push_back(NoteEvent(std::move(event.note), new_length, new_offset));
+            events[n_adjusted++] = NoteEvent(event.note, new_length, new_offset);
         }
 
         // Case 3
         else {
             const int new_offset = event.offset - old_samples;
             const int new_length = event.length;
-            adjusted.push_back(NoteEvent(std::move(event.note), new_length, new_offset));
+            events[n_adjusted++] = NoteEvent(event.note, new_length, new_offset);
         }
     }
-    events = std::move(adjusted);
+    events.erase(events.begin() + n_adjusted, events.end());
 }
 
 
@@ -522,7 +866,7 @@ void Program::sync_with_audio(const int new_samples) {
 
         // Wait till one frame is left in systems audio out buffer (needed when fetching samples is faster than playing)
         while(SDL_GetQueuedAudioSize(*out_dev) / (SDL_AUDIO_BITSIZE(AUDIO_FORMAT) / 8) >= (unsigned int)input_buffer_n_samples && !poll_quit())
-            handle_sdl_events();
+            sync_wait();
     }
 
     // Otherwise, we have to time the number of used samples ourselves to enforce a virtual sample out rate
@@ -538,21 +882,29 @@ void Program::sync_with_audio(const int new_samples) {
         }
 
         // Given that "new_samples" samples were retrieved, we need to pause for this duration in total (since last call)
-        while(std::chrono::duration<double>(std::chrono::steady_clock::now() - last_call).count() < (double)new_samples / (double)SAMPLE_RATE && !poll_quit())
-            handle_sdl_events();
+        while(std::chrono::duration<double>(std::chrono::steady_clock::now() - last_call).count() < (double)new_samples / (double)params.sample_rate && !poll_quit())
+            sync_wait();
 
         last_call = std::chrono::steady_clock::now();
     }
 }
 
 
+void Program::sync_wait() {
+    if(std::this_thread::get_id() == main_thread_id)
+        handle_sdl_events();
+    else
+        std::this_thread::yield();
+}
+
+
 void Program::arpeggiate() {
     note_change_time = std::chrono::steady_clock::now() - prev_note_change;
     if(note_change_time.count() > NOTE_TIME) {
         if(!plus_held_down && minus_held_down)
-            sample_getter->pitch_down();
+            pitch_steps--;
         else if(plus_held_down && !minus_held_down)
-            sample_getter->pitch_up();
+            pitch_steps++;
 
         prev_note_change = std::chrono::steady_clock::now();
     }
@@ -582,14 +934,14 @@ void Program::handle_sdl_events() {
                         if constexpr(ENABLE_ARPEGGIATOR)
                             minus_held_down = true;
                         else
-                            sample_getter->pitch_down();
+                            pitch_steps--;
                         break;
 
                     case SDLK_EQUALS:
                         if constexpr(ENABLE_ARPEGGIATOR)
                             plus_held_down = true;
                         else
-                            sample_getter->pitch_up();
+                            pitch_steps++;
                         break;
 
                     case SDLK_r:
@@ -610,15 +962,17 @@ void Program::handle_sdl_events() {
                         break;
 
                     case SDLK_y:
-                        // if(cli_args.playback) {
+                        if(sample_getter->get_type() == SampleGetters::audio_in) {
                             debug("Cleared audio in buffer");
-                            SDL_ClearQueuedAudio(*in_dev);
-                        // }
+                            static_cast<AudioIn *>(sample_getter)->clear_queued_samples();
+                        }
                         break;
 
-                    case SDLK_p:
+                    case SDLK_p: {
+                        const std::lock_guard<std::mutex> lock(estimator_graphics_mutex);
                         estimator->next_plot_type();
                         break;
+                    }
 
                     case SDLK_LEFTBRACKET:
                         graphics->add_max_display_frequency(-D_MAX_DISPLAYED_FREQUENCY);
@@ -709,11 +1063,11 @@ void Program::handle_sdl_events() {
                         break;
                     }
 
-                    AudioFile *const audio_in_cast = dynamic_cast<AudioFile *>(sample_getter);
+                    // Seeking is applied by apply_sample_getter_requests()
                     if(e.wheel.y > 0)
-                        audio_in_cast->seek((int)(SECONDS_PER_SCROLL * SAMPLE_RATE * e.wheel.y));
+                        seek_samples += (int)(SECONDS_PER_SCROLL * params.sample_rate * e.wheel.y);
                     else if(e.wheel.y < 0)
-                        audio_in_cast->seek((int)(SECONDS_PER_SCROLL * SAMPLE_RATE * e.wheel.y));
+                        seek_samples += (int)(SECONDS_PER_SCROLL * params.sample_rate * e.wheel.y);
                 }
                 break;
 
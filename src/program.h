@@ -5,26 +5,64 @@
 #include "graphics.h"
 #include "results_file.h"
 #include "midi_out.h"
+#include "performance.h"
+#include "spsc_queue.h"
 
 #include "note.h"
 #include "estimators/estimators.h"
 #include "sample_getter/sample_getters.h"
+#include "sample_getter/decimator.h"
 #include "synth/synths.h"
 
 #include <SDL2/SDL.h>
 
+#include <string>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Frame handed from the capture stage to the estimation stage of the pipeline
+struct CapturedFrame {
+    const float *samples = nullptr;  // View of input_buffer_n_samples samples in the SampleGetter's ring
+    long ring_position;  // Ring position after capturing the frame
+    int new_samples;
+    long played_samples;
+};
+
+// Results of one or more consecutive frames handed from the estimation stage to the output stage (more if coalesced)
+struct EstimatedFrames {
+    struct Frame {
+        int new_samples;
+        long played_samples;
+        int n_events;
+    };
+
+    NoteEvents events;  // Note events of all frames in order; offsets are relative to the start of their own frame
+    std::vector<Frame> frames;
+};
 
 
 class Program {
     public:
-        Program(Graphics *const _g, SDL_AudioDeviceID *const in_dev, SDL_AudioDeviceID *const out_dev);
+        // capture_ring is only used when reading from audio in
+        Program(Graphics *const _g, SDL_AudioDeviceID *const in_dev, SDL_AudioDeviceID *const out_dev, CaptureRing *const capture_ring);
         ~Program();
 
         void main_loop();
 
         void resize(const int w, const int h);
 
+        // If less than input_buffer_n_samples is retrieved, only the NoteEvents regarding the first 'new_samples' samples are relevant, as the rest is "overwritten" in the next cycle
+        // Adjust the note events to reflect this smaller frame (Estimator doesn't know about overlap, so gives full frame lengths to note events)
+        static void adjust_events(NoteEvents &events, const int n_frame_samples, const int new_samples);
+
+        // Results file contents; also used by batch transcription, so every results file is written the same way
+        static void write_result_header(ResultsFile &results_file, const int frame_n_samples, const int estimator_n_samples, const bool decimating);
+        static void write_results(ResultsFile &results_file, const NoteEvents &note_events, const int start_frame_samples);
+
 
     private:
         Graphics *const graphics;
@@ -33,8 +71,12 @@ class Program {
         SDL_AudioDeviceID *out_dev;
 
         Estimator *estimator;
-        float *input_buffer;
+        float *estimator_buffer;  // Created by the estimator
+        int estimator_buffer_n_samples;
+
+        // Size of the frames read from the SampleGetter; larger than the estimator buffer if frames are decimated before estimation
         int input_buffer_n_samples;
+        Decimator *decimator;  // nullptr if not decimating
 
         SampleGetter *sample_getter;
 
@@ -59,30 +101,61 @@ class Program {
 
         MidiOut *midi_out;
 
+        // Only the main thread may handle SDL events and render
+        const std::thread::id main_thread_id;
+
+        // The estimator graphics are written by the estimation stage and read when rendering
+        std::mutex estimator_graphics_mutex;
+
+        // Requests from SDL events, applied by the capture stage between two frames, as the SampleGetter isn't thread-safe
+        std::atomic<int> pitch_steps;
+        std::atomic<int> seek_samples;
+
+        // Written by the capture stage; only read after the main loop
+        unsigned long processed_samples;
+
+        // Ring position before which the capture stage may overwrite samples; advanced by the estimation stage once it loaded a frame
+        std::atomic<long> ring_released;
+
         // Arpeggiator (easter egg)
         bool plus_held_down, minus_held_down;
         std::chrono::duration<double, std::milli> note_change_time;
         std::chrono::steady_clock::time_point prev_note_change;
 
 
-        // This function should only be called if cli_args.playback is true
-        // Queues samples in audio out buffer, but doesn't block (is done by sync_with_audio())
-        void playback_audio(const int new_samples);
+        // Every frame is captured, estimated and output before capturing the next frame
+        void serial_loop();
+
+        /* Pipelined main loop
+         * Capture, estimation and output run in their own thread, connected by SPSC queues
+         * The output stage runs in the main thread, as SDL events and rendering have to be handled there
+         * The capture stage closes its queue when quitting; every stage closes its output queue after its input queue is finished
+         */
+        void pipeline_loop();
+        void capture_stage(SPSCQueue<CapturedFrame> &out_queue);
+        void estimation_stage(SPSCQueue<CapturedFrame> &in_queue, SPSCQueue<EstimatedFrames> &out_queue);
+        void output_stage(SPSCQueue<EstimatedFrames> &in_queue);
+        void print_queue_stats(const std::string &name, const QueueStats &stats, const int capacity) const;
+
+        // Stages shared by both main loops
+        void apply_sample_getter_requests();
+        // Fills the estimator buffer from a frame of input_buffer_n_samples samples (decimating it if enabled)
+        // Estimators alter their buffer (e.g. windowing), so the frame is always copied or decimated to it
+        void load_estimator_buffer(const float *const frame);
+        void estimate_frame(NoteEvents &estimated_events, const int new_samples, const unsigned long frame_count);
+        // new_samples is not const, as slowdown may alter it
+        void output_frame(NoteEvents &estimated_events, int &new_samples, const long played_samples, Performance &perf);
 
-        // These functions should only be called if cli_args.output_file is true
-        void write_result_header();
-        void write_results(const NoteEvents &note_events, const int new_samples);
+        // This function should only be called if cli_args.playback is true
+        // Queues the new samples of frame in audio out buffer, but doesn't block (is done by sync_with_audio())
+        void playback_audio(const float *const frame, const int new_samples);
 
         void print_results(const NoteEvents &note_events) const;
 
-        // If less than input_buffer_n_samples is retrieved, only the NoteEvents regarding the first 'new_samples' samples are relevant, as the rest is "overwritten" in the next cycle
-        // Adjust the note events to reflect this smaller frame (Estimator doesn't know about overlap, so gives full frame lengths to note events)
-        static void adjust_events(NoteEvents &events, const int n_frame_samples, const int new_samples);
-
         static void slowdown(NoteEvents &events, int &new_samples);
 
         // This function should only be called if HEADLESS is false
-        bool update_graphics(const NoteEvents &note_events);
+        bool update_graphics(const NoteEvents &note_events, const long played_samples);
 
         // Queues samples in audio out buffer, but doesn't block (is done by sync_with_audio())
         void synthesize_audio(const NoteEvents &notes, const int new_samples);
@@ -93,6 +166,8 @@ class Program {
         // In case of no audio out, simulate the behavior by timing duration between calls and waiting the appropriate time
         // This effectively syncs program with current audio out
         void sync_with_audio(const int new_samples);
+        // Handles SDL events while waiting if called from the main thread
+        void sync_wait();
 
         // Easter egg arpeggiator
         void arpeggiate();
@@ -5,9 +5,11 @@
 #include <csignal>  // catching signals
 #include <cstring>  // sigabbrev_np()
 #include <execinfo.h>  // backtrace() functions
+#include <atomic>
 
 
-static volatile bool quit = false;
+// Atomic, as the pipeline stages poll it from different threads (lock-free, so safe in signal handlers)
+static std::atomic<bool> quit = false;
 
 bool poll_quit() {
     return quit;
@@ -6,14 +6,13 @@
 
 #include <string>
 #include <fstream>
+#include <stdexcept>  // std::runtime_error
 
 
 ResultsFile::ResultsFile(const std::string &filename) {
     json_file.open(filename, std::fstream::out);
-    if(!json_file.is_open()) {
-        error("Failed to create/open file '" + filename + "'");
-        exit(EXIT_FAILURE);
-    }
+    if(!json_file.is_open())
+        throw(std::runtime_error("Failed to create/open file '" + filename + "'"));
 
     cur_indent = 0;
     first_write_block = true;
@@ -23,11 +22,21 @@ ResultsFile::ResultsFile(const std::string &filename) {
 }
 
 ResultsFile::~ResultsFile() {
+    if(json_file.is_open())
+        close();
+}
+
+
+bool ResultsFile::close() {
     json_file << "\n}" << std::endl;
     cur_indent -= 1;
 
     if(cur_indent != 0)
         warning("JSON output indent was not 1 at the end (was " + STR(cur_indent) + ")\nOutput is possibly ill formatted");
+
+    const bool written = !json_file.fail();
+    json_file.close();
+    return written && !json_file.fail();
 }
 
 
@@ -15,9 +15,14 @@
 //   - Providing empty key
 class ResultsFile {
     public:
+        // Throws a std::runtime_error if the file can't be created
         ResultsFile(const std::string &filename);
+        // Closes the file if close() wasn't called
         ~ResultsFile();
 
+        // Ends the JSON and closes the file; returns false if any write failed (for example, because the disk is full)
+        bool close();
+
         void write_string(const std::string &key, const std::string &value);
         void write_int(const std::string &key, const int value);
         void write_double(const std::string &key, const double value);
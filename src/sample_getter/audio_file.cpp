@@ -1,190 +1,223 @@
 #include "audio_file.h"
+#include "pcm_convert.h"
 
 #include "quit.h"
 #include "error.h"
 
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 
-#include <SDL2/SDL.h>
+#include <fcntl.h>  // open()
+#include <sys/mman.h>  // mmap(), madvise(), munmap()
+#include <sys/stat.h>  // fstat()
+#include <unistd.h>  // close(), sysconf()
 
 #include <string>
-#include <algorithm>  // std::max(), std::clamp(), std::fill_n()
-#include <cstring>  // memcpy()
-#include <limits>
+#include <algorithm>  // std::max(), std::min(), std::clamp(), std::fill_n()
+#include <cstring>  // memcmp(), strerror()
+#include <cerrno>
+#include <cstdint>
 
 #include <sstream>  // This and iomanip are for double->string formatting
 #include <iomanip>
 
 
-AudioFile::AudioFile(const int input_buffer_size, const std::string &file) : SampleGetter(input_buffer_size) {
-    uint8_t *read_buffer;
-    uint32_t read_buffer_bytes;
+// WAV files are little endian
+static uint16_t read_u16(const uint8_t *const p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
 
-    if(SDL_LoadWAV(file.c_str(), &wav_spec, &read_buffer, &read_buffer_bytes) == NULL) {
-        error("Failed to open WAV file '" + file + "'\nSDL error: " + SDL_GetError());
-        exit(EXIT_FAILURE);
-    }
+static uint32_t read_u32(const uint8_t *const p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_u64(const uint8_t *const p) {
+    return (uint64_t)read_u32(p) | ((uint64_t)read_u32(p + 4) << 32);
+}
+
+
+AudioFile::AudioFile(const int input_buffer_size, const std::string &file, const bool _single_file/* = true*/) : SampleGetter(input_buffer_size), single_file(_single_file) {
+    ended = false;
 
-    if(wav_spec.freq != SAMPLE_RATE) {
-        error("Internal sample rate (" + STR(SAMPLE_RATE) + " Hz) mismatches WAV sample rate (" + STR(wav_spec.freq) + " Hz)");
-        hint("Internal sample rate can be set in src/config/audio.h");
-        exit(EXIT_FAILURE);
-    }
 
-    if(wav_spec.channels != 1) {
-        error("Only mono WAVs are supported");
-        exit(EXIT_FAILURE);
+    const int fd = open(file.c_str(), O_RDONLY);
+    if(fd == -1) {
+        throw(AudioFileError("Failed to open WAV file '" + file + "' (" + strerror(errno) + ")"));
     }
 
-    if(wav_spec.format == AUDIO_F32SYS) {
-        if(sizeof(float) != 4) {
-            error("Floats are not 32 bits on this platform; which is a problem when directly interfacing with sample formats");
-            hint("Add conversion to 32 bit floats, like is done with integers");
-            exit(EXIT_FAILURE);
-        }
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) == -1) {
+        const std::string reason = strerror(errno);
+        close(fd);
+        throw(AudioFileError("Failed to get size of WAV file '" + file + "' (" + reason + ")"));
+    }
+    file_size = file_stat.st_size;
+    if(file_size < 12) {
+        close(fd);
+        throw(AudioFileError("File '" + file + "' is too small to be a WAV file"));
+    }
 
-        if(read_buffer_bytes % sizeof(float) != 0) {
-            error("WAV file '" + file + "' has a non 32 bit float sample");
-            exit(EXIT_FAILURE);
-        }
+    file_map = (uint8_t*)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const std::string map_error = strerror(errno);
+    close(fd);  // The map stays valid
+    if(file_map == MAP_FAILED) {
+        throw(AudioFileError("Failed to memory map WAV file '" + file + "' (" + map_error + ")"));
+    }
+    madvise(file_map, file_size, MADV_SEQUENTIAL);  // Only a hint, so failing is fine
+    released_bytes = 0;
 
-        wav_buffer_n_samples = read_buffer_bytes / sizeof(float);
-        try {
-            wav_buffer = new float[wav_buffer_n_samples];
-        }
-        catch(const std::bad_alloc &e) {
-            error("Failed to allocate WAV file buffer; WAV file too big (" + STR(e.what()) + ")");
-            hint("Try a splitting the WAV file into smaller files");
-            exit(EXIT_FAILURE);
-        }
+    // The destructor doesn't run if the constructor throws
+    try {
+        parse_wav(file);
+    }
+    catch(const AudioFileError &e) {
+        munmap(file_map, file_size);
+        throw;
+    }
 
-        memcpy(wav_buffer, read_buffer, read_buffer_bytes);
+    if(single_file) {
+        std::stringstream ss;
+        ss << std::fixed << std::setprecision(3) << (double)wav_n_samples / (double)params.sample_rate;
+        info("WAV file loaded, " + ss.str() + " seconds long");
     }
-    else if(wav_spec.format == AUDIO_S32SYS) {
-        if(read_buffer_bytes % sizeof(int32_t) != 0) {
-            error("WAV file '" + file + "' has a non 4 byte integer sample");
-            exit(EXIT_FAILURE);
-        }
+}
 
-        wav_buffer_n_samples = read_buffer_bytes / sizeof(int32_t);
-        try {
-            wav_buffer = new float[wav_buffer_n_samples];
-        }
-        catch(const std::bad_alloc &e) {
-            error("Failed to allocate WAV file buffer; WAV file too big (" + STR(e.what()) + ")");
-            hint("Try a splitting the WAV file into smaller files");
-            exit(EXIT_FAILURE);
-        }
+AudioFile::~AudioFile() {
+    munmap(file_map, file_size);
+}
 
-        const int32_t *const sample_buffer = (int32_t*)read_buffer;
 
-        // Check if samples are 24-bit or 32-bit
-        bool bit32 = false;
-        for(int i = 0; i < wav_buffer_n_samples; i++) {
-            if((sample_buffer[i] & 0b11111111) != 0b00000000)
-                bit32 = true;
-        }
-        if(bit32)
-            warning("File uses 32 bit samples, lossless conversion");
+SampleGetters AudioFile::get_type() const {
+    return SampleGetters::audio_file;
+}
 
-        for(int i = 0; i < wav_buffer_n_samples; i++) {
-            // | can be interchanged with +
-            // const int32_t new_sample = (read_buffer[(i * 4) + 0]    << 0)
-            //                             | (read_buffer[(i * 4) + 1] << 8)
-            //                             | (read_buffer[(i * 4) + 2] << 16)
-            //                             | (read_buffer[(i * 4) + 3] << 24);
 
-            const int32_t new_sample = sample_buffer[i];
+void AudioFile::parse_wav(const std::string &file) {
+    const bool rf64 = memcmp(file_map, "RF64", 4) == 0;
+    if((memcmp(file_map, "RIFF", 4) != 0 && !rf64) || memcmp(file_map + 8, "WAVE", 4) != 0) {
+        throw(AudioFileError("File '" + file + "' is not a RIFF or RF64 WAV file"));
+    }
 
-            if(bit32) {
-                const double d_sample = (double)new_sample / (double)(std::numeric_limits<int32_t>::max());
-                wav_buffer[i] = (float)d_sample;
+    // RF64 stores the sizes which don't fit in 32 bits in the ds64 chunk (and sets the 32 bit sizes to 0xffffffff)
+    bool has_ds64 = false;
+    uint64_t ds64_data_size = 0;
+    const uint8_t *fmt = nullptr;
+    uint32_t fmt_size = 0;
+    const uint8_t *data = nullptr;
+    uint64_t data_size = 0;
+
+    size_t offset = 12;
+    while(offset + 8 <= file_size) {
+        const uint8_t *const chunk = file_map + offset;
+        uint64_t chunk_size = read_u32(chunk + 4);
+        const size_t chunk_left = file_size - (offset + 8);
+
+        if(memcmp(chunk, "ds64", 4) == 0 && chunk_size >= 16 && chunk_left >= 16) {
+            has_ds64 = true;
+            ds64_data_size = read_u64(chunk + 8 + 8);
+        }
+        else if(memcmp(chunk, "fmt ", 4) == 0 && chunk_size <= chunk_left) {
+            fmt = chunk + 8;
+            fmt_size = chunk_size;
+        }
+        else if(memcmp(chunk, "data", 4) == 0) {
+            if(rf64 && chunk_size == 0xffffffff) {
+                // The ds64 chunk precedes the data chunk; without it, the size of the data is unknown
+                if(!has_ds64) {
+                    throw(AudioFileError("RF64 file '" + file + "' has no valid ds64 chunk before its data chunk, so the size of its data is unknown"));
+                }
+                chunk_size = ds64_data_size;
             }
-            else {
-                // SDL makes 8 least significant bits zero when converting from 24 bit files
-                const double d_sample = (double)(new_sample >> 8) / (double)((1 << 23) - 1);
-                wav_buffer[i] = (float)d_sample;
+
+            // Recordings which were cut off may claim more data than the file holds
+            if(chunk_size > chunk_left) {
+                warning("WAV file '" + file + "' is truncated; reading the samples it holds");
+                chunk_size = chunk_left;
             }
-        }
 
-        // SDL based conversion
-        /*SDL_AudioCVT cvt;
-        SDL_BuildAudioCVT(&cvt, AUDIO_S32SYS, 1, SAMPLE_RATE, AUDIO_F32SYS, 1, SAMPLE_RATE);
-        SDL_assert(cvt.needed);
-        cvt.len = read_buffer_bytes;
-        cvt.buf = (Uint8*)SDL_malloc(cvt.len * cvt.len_mult);
-        memcpy(cvt.buf, read_buffer, read_buffer_bytes);
-        SDL_ConvertAudio(&cvt);*/
-    }
-    else if(wav_spec.format == AUDIO_S16SYS) {
-        if(read_buffer_bytes % sizeof(int16_t) != 0) {
-            error("WAV file '" + file + "' has a non 2 byte integer sample");
-            exit(EXIT_FAILURE);
+            data = chunk + 8;
+            data_size = chunk_size;
         }
 
-        wav_buffer_n_samples = read_buffer_bytes / sizeof(int16_t);
-        try {
-            wav_buffer = new float[wav_buffer_n_samples];
-        }
-        catch(const std::bad_alloc &e) {
-            error("Failed to allocate WAV file buffer; WAV file too big (" + STR(e.what()) + ")");
-            hint("Try a splitting the WAV file into smaller files");
-            exit(EXIT_FAILURE);
-        }
+        // Chunks are padded to an even size
+        offset += 8 + chunk_size + (chunk_size % 2);
+    }
 
-        const int16_t *const sample_buffer = (int16_t*)read_buffer;
-        for(int i = 0; i < wav_buffer_n_samples; i++) {
-            const int16_t new_sample = sample_buffer[i];
+    if(fmt == nullptr || fmt_size < 16) {
+        throw(AudioFileError("WAV file '" + file + "' has no valid format chunk"));
+    }
+    if(data == nullptr) {
+        throw(AudioFileError("WAV file '" + file + "' has no data chunk"));
+    }
 
-            const double d_sample = (double)new_sample / (double)(std::numeric_limits<int16_t>::max());
-            wav_buffer[i] = (float)d_sample;
+    // Extensible format stores the format tag in the first two bytes of the sub-format GUID
+    uint16_t format_tag = read_u16(fmt);
+    n_channels = read_u16(fmt + 2);
+    const uint32_t sample_rate = read_u32(fmt + 4);
+    const uint16_t bits_per_sample = read_u16(fmt + 14);
+    if(format_tag == 0xfffe) {
+        if(fmt_size < 40) {
+            throw(AudioFileError("WAV file '" + file + "' has an invalid extensible format chunk"));
         }
+        format_tag = read_u16(fmt + 24);
+    }
+
+    if((int)sample_rate != params.sample_rate) {
+        throw(AudioFileError("Internal sample rate (" + STR(params.sample_rate) + " Hz) mismatches WAV sample rate (" + STR(sample_rate) + " Hz)", "Set the internal sample rate with '--param sample_rate " + STR(sample_rate) + "' (its default is set in src/config/audio.h)"));
+    }
 
-        // SDL based conversion
-        /*SDL_AudioCVT cvt;
-        SDL_BuildAudioCVT(&cvt, AUDIO_S16SYS, 1, SAMPLE_RATE, AUDIO_F32SYS, 1, SAMPLE_RATE);
-        SDL_assert(cvt.needed);
-        cvt.len = read_buffer_bytes;
-        cvt.buf = (Uint8*)SDL_malloc(cvt.len * cvt.len_mult);
-        memcpy(cvt.buf, read_buffer, read_buffer_bytes);
-        SDL_ConvertAudio(&cvt);*/
+    if(n_channels < 1) {
+        throw(AudioFileError("WAV file '" + file + "' has no channels"));
+    }
+    if(AUDIO_FILE_CHANNEL >= n_channels) {
+        throw(AudioFileError("WAV file '" + file + "' has " + STR(n_channels) + " channels, so channel " + STR(AUDIO_FILE_CHANNEL) + " can't be read", "Set which channel is read with AUDIO_FILE_CHANNEL in src/config/audio.h"));
     }
+    if(n_channels > 1)
+        info("Reading channel " + STR(AUDIO_FILE_CHANNEL) + " of " + STR(n_channels) + " channel WAV file");
+
+    if(format_tag == 1 && bits_per_sample == 16)
+        sample_format = PcmFormat::s16;
+    else if(format_tag == 1 && bits_per_sample == 24)
+        sample_format = PcmFormat::s24;
+    else if(format_tag == 1 && bits_per_sample == 32)
+        sample_format = PcmFormat::s32;
+    else if(format_tag == 3 && bits_per_sample == 32)
+        sample_format = PcmFormat::f32;
     else {
-        error("Sample format not supported");
-        exit(EXIT_FAILURE);
+        throw(AudioFileError("Sample format not supported (format " + STR(format_tag) + ", " + STR(bits_per_sample) + " bits)", "Supported are 16, 24 and 32 bit integer and 32 bit float samples"));
     }
+    bytes_per_frame = n_channels * pcm_sample_size(sample_format);
 
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(3) << (double)wav_buffer_n_samples / (double)SAMPLE_RATE;
-    info("WAV file loaded, " + ss.str() + " seconds long");
-
-    // debug("File is " + STR((double)wav_buffer_n_samples / (double)SAMPLE_RATE) + " seconds; " + STR(wav_buffer_n_samples) + " samples");
-
-    // DEBUG: For analyzing the range of the float samples, as being within [-1.0, 1.0] is not enforced by any standard
-    // double highest = 0.0, lowest = 0.0;
-    // for(int i = 0; i < wav_buffer_n_samples; i++) {
-    //     if(wav_buffer[i] < 0.0) {
-    //         if(wav_buffer[i] < lowest)
-    //             lowest = wav_buffer[i];
-    //     }
-    //     else {
-    //         if(wav_buffer[i] > highest)
-    //             highest = wav_buffer[i];
-    //     }
-    // }
-    // debug(STR(lowest) + " " + STR(highest));
-
-    SDL_FreeWAV(read_buffer);
+    if(data_size % bytes_per_frame != 0)
+        warning("WAV file '" + file + "' ends with a partial sample; ignoring it");
+
+    wav_samples = data;
+    wav_n_samples = data_size / bytes_per_frame;
 }
 
-AudioFile::~AudioFile() {
-    delete[] wav_buffer;
+
+void AudioFile::read_samples(float *const out, const long first_sample, const int n_samples) const {
+    pcm_to_float(out, wav_samples + (first_sample * bytes_per_frame), n_samples, sample_format, n_channels, AUDIO_FILE_CHANNEL);
 }
 
 
-SampleGetters AudioFile::get_type() const {
-    return SampleGetters::audio_file;
+void AudioFile::release_pages(const long first_needed_sample) {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+
+    // Seeking back makes the released pages needed again; they are simply read from the file again
+    const size_t needed_offset = (wav_samples - file_map) + (std::max(first_needed_sample, (long)0) * bytes_per_frame);
+    const size_t release_until = (needed_offset / page_size) * page_size;
+    if(release_until < released_bytes) {
+        released_bytes = release_until;
+        return;
+    }
+
+    if(release_until - released_bytes < AUDIO_FILE_RELEASE_BYTES)
+        return;
+
+    madvise(file_map + released_bytes, release_until - released_bytes, MADV_DONTNEED);  // Only a hint, so failing is fine
+    released_bytes = release_until;
 }
 
 
@@ -194,71 +227,77 @@ void AudioFile::seek(const int d_samples) {
     // If seeked behind start
     if(played_samples <= 0) {
         played_samples = 0;
+        release_pages(0);
 
-        if constexpr(DO_OVERLAP)
-            std::fill_n(overlap_buffer, overlap_buffer_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+        if constexpr(DO_OVERLAP) {
+            std::fill_n(ring.write_ptr(), frame_buffer_size, 0.0);  // memset() might be faster, but assumes IEEE 754 floats/doubles
+            ring.advance(frame_buffer_size);
+        }
 
-        // debug("Seeked to " + STR((double)played_samples / (double)SAMPLE_RATE) + " seconds; " + STR(played_samples) + " samples");
+        // debug("Seeked to " + STR((double)played_samples / (double)params.sample_rate) + " seconds; " + STR(played_samples) + " samples");
         return;
     }
 
-    if(played_samples > wav_buffer_n_samples) {
+    if(played_samples > wav_n_samples) {
+        ended = true;
         info("File ended after seek");
         set_quit();
         return;
     }
 
-    // Fill overlap buffer with correct part of the file
+    // Fill the overlap in the ring with correct part of the file
     if constexpr(DO_OVERLAP) {
-        // Copy as much before played_samples into overlap_buffer to enable seeking while overlapping
-        const int samples_needed_before_file = overlap_buffer_size - played_samples;
+        // Read as much before played_samples into the ring to enable seeking while overlapping
+        float *const overlap = ring.write_ptr();
+        const int samples_needed_before_file = frame_buffer_size - played_samples;
 
         if(samples_needed_before_file > 0) {
             // Zero start of buffer
-            std::fill_n(overlap_buffer, samples_needed_before_file, 0.0);
+            std::fill_n(overlap, samples_needed_before_file, 0.0);
 
-            // Copy as much from file as possible
-            memcpy(overlap_buffer + samples_needed_before_file, wav_buffer, played_samples * sizeof(float));
+            // Read as much from file as possible
+            read_samples(overlap + samples_needed_before_file, 0, played_samples);
         }
         else
-            // Copy as much from file as possible
-            memcpy(overlap_buffer, wav_buffer + played_samples - overlap_buffer_size, overlap_buffer_size * sizeof(float));
+            // Read as much from file as possible
+            read_samples(overlap, played_samples - frame_buffer_size, frame_buffer_size);
+
+        ring.advance(frame_buffer_size);
+
+        release_pages(played_samples - frame_buffer_size);
     }
+    else
+        release_pages(played_samples);
 
-    // debug("Seeked to " + STR((double)played_samples / (double)SAMPLE_RATE) + " seconds; " + STR(played_samples) + " samples");
+    // debug("Seeked to " + STR((double)played_samples / (double)params.sample_rate) + " seconds; " + STR(played_samples) + " samples");
 }
 
 
-int AudioFile::get_frame(float *const in, const int n_samples) {
-    int overlap_n_samples = n_samples;  // n_samples to get after accounting for overlap
-    float *overlap_in = in;
-    if constexpr(DO_OVERLAP)
-        calc_and_paste_overlap(overlap_in, overlap_n_samples);
-
-    // debug("At to " + STR((double)played_samples / (double)SAMPLE_RATE) + " seconds; " + STR(played_samples) + " samples");
+void AudioFile::get_new_samples(float *const out, const int n_samples) {
+    // debug("At to " + STR((double)played_samples / (double)params.sample_rate) + " seconds; " + STR(played_samples) + " samples");
 
     // If file end doesn't align with a frame, we need to read less than n_samples
     // First calculate how many samples we can still read from the file
-    const long file_samples_left = std::max(wav_buffer_n_samples - played_samples, (long)0);  // max(), as played_samples > wav_buffer_n_samples may happen when overlapping
-    const int n_samples_from_file = std::clamp((long)overlap_n_samples, (long)0, file_samples_left);  // overlap_n_samples always fits in int, so n_samples_from_file never overflows
-    if(played_samples < wav_buffer_n_samples)
-        memcpy(overlap_in, wav_buffer + played_samples, n_samples_from_file * sizeof(float));
+    const long file_samples_left = std::max(wav_n_samples - played_samples, (long)0);  // max(), as played_samples > wav_n_samples may happen when overlapping
+    const int n_samples_from_file = std::clamp((long)n_samples, (long)0, file_samples_left);  // n_samples always fits in int, so n_samples_from_file never overflows
+    if(played_samples < wav_n_samples)
+        read_samples(out, played_samples, n_samples_from_file);
 
     // Zero rest of buffer if file ended
-    if(n_samples_from_file < overlap_n_samples)
-        std::fill_n(overlap_in + n_samples_from_file, overlap_n_samples - n_samples_from_file, 0.0);
+    if(n_samples_from_file < n_samples)
+        std::fill_n(out + n_samples_from_file, n_samples - n_samples_from_file, 0.0);
+
+    played_samples += n_samples;
 
-    played_samples += overlap_n_samples;
+    // Samples before the next read are not needed anymore (the overlap is kept in the ring)
+    release_pages(played_samples);
 
     // Check if there won't be any of the file in the next read and quit if so
-    if(played_samples >= wav_buffer_n_samples + (n_samples - overlap_n_samples)) {
-        info("File ended, filling rest of frame with silence...");
-        set_quit();
+    if(played_samples >= wav_n_samples + (frame_buffer_size - n_samples)) {
+        ended = true;
+        if(single_file) {
+            info("File ended, filling rest of frame with silence...");
+            set_quit();
+        }
     }
-
-
-    if constexpr(DO_OVERLAP)
-        copy_overlap(in, n_samples);
-
-    return overlap_n_samples;
 }
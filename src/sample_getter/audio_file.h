@@ -3,28 +3,75 @@
 
 
 #include "sample_getter.h"
+#include "pcm_convert.h"
 
-#include <SDL2/SDL.h>
-
+#include <cstddef>  // size_t
+#include <cstdint>
 #include <string>
+#include <stdexcept>  // std::runtime_error
+
+
+// Thrown when a WAV file can't be opened or is invalid or unsupported; the hint (possibly empty) tells how to resolve it
+class AudioFileError : public std::runtime_error {
+    public:
+        AudioFileError(const std::string &what, const std::string &_hint = "") : std::runtime_error(what), hint_message(_hint) {};
+
+        const std::string &get_hint() const {return hint_message;};
+
+
+    private:
+        std::string hint_message;
+};
 
 
+/* Streams a WAV file (RIFF or RF64) from a memory map
+ * Samples are only converted to floats when a frame or seek needs them, so opening is instant and no copy of the file is made
+ * Of multi-channel files, only channel AUDIO_FILE_CHANNEL (config/audio.h) is read
+ * Pages which were read are given back to the OS, so memory use doesn't grow with the length of the file
+ * When transcribing many files in one run (single_file is false), the end of the file is reported by has_ended() instead of quitting Digistring
+ * Files which can't be read throw an AudioFileError on construction, so a batch can continue with the next file
+ */
 class AudioFile : public SampleGetter {
     public:
-        AudioFile(const int input_buffer_size, const std::string &file);
+        AudioFile(const int input_buffer_size, const std::string &file, const bool _single_file = true);
         ~AudioFile() override;
 
         SampleGetters get_type() const override;
 
         void seek(const int d_samples);
 
-        int get_frame(float *const in, const int n_samples);
+        // True after the frame which holds the last samples of the file was read
+        bool has_ended() const {return ended;};
 
 
     private:
-        float *wav_buffer;
-        int wav_buffer_n_samples;
-        SDL_AudioSpec wav_spec;
+        uint8_t *file_map;
+        size_t file_size;
+
+        // Samples of the data chunk; wav_n_samples counts the samples of one channel
+        const uint8_t *wav_samples;
+        long wav_n_samples;
+        PcmFormat sample_format;
+        int n_channels;
+        int bytes_per_frame;  // One sample of every channel
+
+        // Pages of the map before this offset were given back to the OS
+        size_t released_bytes;
+
+        const bool single_file;
+        bool ended;
+
+
+        // Parses the RIFF/RF64 chunks and sets the data chunk and sample format; throws an AudioFileError on invalid or unsupported files
+        void parse_wav(const std::string &file);
+
+        // Converts n_samples samples from sample index first_sample on to floats (all should be in the file)
+        void read_samples(float *const out, const long first_sample, const int n_samples) const;
+
+        // Gives the pages before first_needed_sample back to the OS (if at least AUDIO_FILE_RELEASE_BYTES can be released)
+        void release_pages(const long first_needed_sample);
+
+        void get_new_samples(float *const out, const int n_samples) override;
 };
 
 
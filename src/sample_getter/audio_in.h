@@ -3,40 +3,45 @@
 
 
 #include "sample_getter.h"
-
-#include <SDL2/SDL.h>
+#include "capture_ring.h"
 
 
+// Reads frames from the capture ring, which is filled by the audio callback of the recording device
+// When the estimator falls behind by more than CAPTURE_MAX_BACKLOG_FRAMES frames, it skips ahead to the newest samples
 class AudioIn : public SampleGetter {
     public:
-        AudioIn(const int input_buffer_size, SDL_AudioDeviceID *const _in);
+        AudioIn(const int input_buffer_size, CaptureRing *const _capture_ring);
         ~AudioIn() override;
 
         SampleGetters get_type() const override;
 
         bool is_audio_recording_device() const override;
 
+        // Number of recorded samples which are not read yet
+        int get_queued_samples() const;
+        // Discards the recorded samples which are not read yet; may be called from any thread
+        void clear_queued_samples();
+
         // DEBUG
         void read_increment(float *const in, const int n_samples);
 
-        void read_frame_float32_audio_device(float *const in, const int n_samples);
-        void read_frame_int32_audio_device(float *const in, const int n_samples);
+        void read_frame(float *const in, const int n_samples);
 
-        void calc_and_paste_nonblocking_overlap(float *&in, int &n_samples, const int bits_per_sample);
-        void copy_nonblocking_overlap(float *const in, const int n_samples);
 
-        int get_frame(float *const in, const int n_samples);
+    private:
+        CaptureRing *const capture_ring;
+        // More queued samples than this are skipped at the next read
+        const int max_backlog_samples;
 
+        // For reporting new overruns after every frame
+        unsigned long reported_overruns;
+        unsigned long reported_lost_samples;
 
-    private:
-        SDL_AudioDeviceID *in_dev;
 
-        int32_t *conv_buf;
-        int conv_buf_size;
+        // With nonblocking overlap, the overlap depends on the number of queued samples
+        int calc_n_new_samples(const int n_samples) const override;
 
-        // Declared in SampleGetter; but explicitly listed as non-blocking overlap accesses these
-        // Only set if DO_OVERLAP or DO_OVERLAP_NON_BLOCK
-        // float *overlap_buffer;
+        void get_new_samples(float *const out, const int n_samples) override;
 };
 
 
@@ -0,0 +1,133 @@
+#include "capture_ring.h"
+#include "pcm_convert.h"
+
+#include "quit.h"
+#include "error.h"
+
+#include "config/audio.h"
+
+#include <SDL2/SDL.h>
+
+#include <cstring>  // memcpy()
+#include <algorithm>  // std::min(), std::max()
+#include <limits>
+#include <bit>  // std::bit_ceil()
+
+
+CaptureRing::CaptureRing(const int _capacity)
+        : capacity(std::bit_ceil((unsigned int)std::max(_capacity, 1))), mask(capacity - 1),
+          write_pos(0), overruns(0), lost_samples(0),
+          read_pos(0), wake_pos(std::numeric_limits<unsigned long>::max()), clear_requested(false), underruns(0) {
+    try {
+        buffer = new float[capacity];
+    }
+    catch(const std::bad_alloc &e) {
+        error("Failed to allocate capture ring buffer (" + STR(e.what()) + ")");
+        hint("Try using a smaller capture ring (CAPTURE_RING_SIZE in config/audio.h)");
+        exit(EXIT_FAILURE);
+    }
+}
+
+CaptureRing::~CaptureRing() {
+    delete[] buffer;
+}
+
+
+/*static*/ void CaptureRing::sdl_callback(void *userdata, Uint8 *stream, int len) {
+    CaptureRing *const ring = static_cast<CaptureRing *>(userdata);
+
+    if constexpr(AUDIO_FORMAT == AUDIO_F32SYS)
+        ring->write(reinterpret_cast<const float *>(stream), len / sizeof(float));
+    else if constexpr(AUDIO_FORMAT == AUDIO_S32SYS) {
+        // Convert in small blocks, as the audio thread shouldn't allocate
+        // Scaled to [-1, 1] like float samples (assumes a little endian host, like the SIMD conversion kernels)
+        const int n_samples = len / sizeof(int32_t);
+
+        float conv_buf[SAMPLES_PER_BUFFER];
+        for(int converted = 0; converted < n_samples; converted += SAMPLES_PER_BUFFER) {
+            const int block = std::min(n_samples - converted, (int)SAMPLES_PER_BUFFER);
+            pcm_to_float(conv_buf, stream + (converted * sizeof(int32_t)), block, PcmFormat::s32);
+
+            ring->write(conv_buf, block);
+        }
+    }
+}
+
+
+void CaptureRing::write(const float *const samples, const int n_samples) {
+    const unsigned long w = write_pos.load(std::memory_order_relaxed);
+    const unsigned long free = capacity - (w - read_pos.load(std::memory_order_acquire));
+
+    int n_write = n_samples;
+    if((unsigned long)n_samples > free) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        lost_samples.fetch_add(n_samples - free, std::memory_order_relaxed);
+        n_write = free;
+    }
+
+    // Copy in at most two parts, as the write may wrap around
+    const int start = w & mask;
+    const int first = std::min(n_write, capacity - start);
+    memcpy(buffer + start, samples, first * sizeof(float));
+    memcpy(buffer, samples + first, (n_write - first) * sizeof(float));
+
+    // Sequentially consistent, so either the consumer sees the new write_pos or we see its wake_pos (no lost wake-ups)
+    write_pos.store(w + n_write, std::memory_order_seq_cst);
+    if(w + n_write >= wake_pos.load(std::memory_order_seq_cst))
+        write_pos.notify_one();
+}
+
+
+int CaptureRing::available() const {
+    return write_pos.load(std::memory_order_acquire) - read_pos.load(std::memory_order_acquire);
+}
+
+
+int CaptureRing::read(float *const out, const int n_samples) {
+    unsigned long r = read_pos.load(std::memory_order_relaxed);
+    if(clear_requested.exchange(false, std::memory_order_relaxed)) {
+        r = write_pos.load(std::memory_order_acquire);
+        read_pos.store(r, std::memory_order_release);
+    }
+
+    unsigned long w = write_pos.load(std::memory_order_acquire);
+    if(w - r < (unsigned long)n_samples) {
+        underruns++;
+
+        // Only woken when the callback completes the frame, so quitting is noticed at the end of the frame
+        wake_pos.store(r + n_samples, std::memory_order_seq_cst);
+        while((w = write_pos.load(std::memory_order_seq_cst)) - r < (unsigned long)n_samples && !poll_quit())
+            write_pos.wait(w, std::memory_order_acquire);
+        wake_pos.store(std::numeric_limits<unsigned long>::max(), std::memory_order_relaxed);
+    }
+
+    const int n_read = std::min((unsigned long)n_samples, w - r);
+    const int start = r & mask;
+    const int first = std::min(n_read, capacity - start);
+    memcpy(out, buffer + start, first * sizeof(float));
+    memcpy(out + first, buffer, (n_read - first) * sizeof(float));
+
+    read_pos.store(r + n_read, std::memory_order_release);
+    return n_read;
+}
+
+
+void CaptureRing::request_clear() {
+    clear_requested.store(true, std::memory_order_relaxed);
+}
+
+
+int CaptureRing::skip_to_newest(const int n_keep) {
+    const unsigned long r = read_pos.load(std::memory_order_relaxed);
+    const unsigned long w = write_pos.load(std::memory_order_acquire);
+    if(w - r <= (unsigned long)n_keep)
+        return 0;
+
+    // Moving read_pos forward only frees space, so this can't race with the callback
+    const int n_skip = (w - r) - n_keep;
+    read_pos.store(r + n_skip, std::memory_order_release);
+
+    overruns.fetch_add(1, std::memory_order_relaxed);
+    lost_samples.fetch_add(n_skip, std::memory_order_relaxed);
+    return n_skip;
+}
@@ -0,0 +1,70 @@
+#ifndef DIGISTRING_SAMPLE_GETTER_CAPTURE_RING_H
+#define DIGISTRING_SAMPLE_GETTER_CAPTURE_RING_H
+
+
+#include "workspace_arena.h"  // CACHE_LINE_SIZE
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+
+
+/* Lock-free single producer, single consumer ring buffer of recorded samples
+ * The producer is SDL's audio callback, which converts the recorded samples to float and never blocks
+ * The consumer (AudioIn) blocks on a futex till a whole frame is available; the callback only wakes it when the frame is complete
+ * Samples which don't fit are discarded and counted as overrun, so a slow consumer never loses the samples it still has to read
+ */
+class CaptureRing {
+    public:
+        CaptureRing(const int capacity);  // In samples; rounded up to a power of two
+        ~CaptureRing();
+
+        // Pass as callback to SDL_OpenAudioDevice() with the ring as userdata; runs in SDL's audio thread
+        static void sdl_callback(void *userdata, Uint8 *stream, int len);
+
+        int get_capacity() const {return capacity;};
+
+        // Number of samples ready to be read
+        int available() const;
+
+        // Blocks till n_samples samples are available and copies them to out
+        // Returns the number of samples read, which is less than n_samples only when quitting
+        int read(float *const out, const int n_samples);
+
+        // Discards the samples ready to be read at the next read(); may be called from any thread
+        void request_clear();
+
+        // Discards the oldest samples ready to be read, so that at most n_keep are left; counted as an overrun
+        // Only called by the consumer; returns the number of discarded samples
+        int skip_to_newest(const int n_keep);
+
+        // Number of overruns (callbacks which didn't fit in the ring and skips) and the total number of samples they lost
+        unsigned long get_overruns() const {return overruns.load(std::memory_order_relaxed);};
+        unsigned long get_lost_samples() const {return lost_samples.load(std::memory_order_relaxed);};
+        // Number of reads which had to wait for samples
+        unsigned long get_underruns() const {return underruns;};
+
+
+    private:
+        const int capacity;
+        const unsigned long mask;
+        float *buffer;
+
+        // Written by producer and consumer respectively; on their own cache lines to prevent false sharing
+        alignas(CACHE_LINE_SIZE) std::atomic<unsigned long> write_pos;
+        std::atomic<unsigned long> overruns;
+        std::atomic<unsigned long> lost_samples;
+
+        alignas(CACHE_LINE_SIZE) std::atomic<unsigned long> read_pos;
+        // The producer wakes the consumer when write_pos reaches this position
+        std::atomic<unsigned long> wake_pos;
+        std::atomic<bool> clear_requested;
+        unsigned long underruns;
+
+
+        // Runs in SDL's audio thread
+        void write(const float *const samples, const int n_samples);
+};
+
+
+#endif  // DIGISTRING_SAMPLE_GETTER_CAPTURE_RING_H
@@ -0,0 +1,138 @@
+#include "decimator.h"
+
+#include "error.h"
+#include "cpu_dispatch.h"
+
+#include "estimators/estimation_func/window_func.h"
+
+#include "config/transcription.h"
+
+#include <cmath>
+#include <new>  // std::bad_alloc
+
+
+/* SIMD kernels
+ * Every output is the dot product of the taps with the n_taps input samples starting at its position
+ * Kernels handle the first n taps they can vectorize and return n, so the caller finishes the dot products with scalar code
+ * See cpu_dispatch.h for how the kernel is selected
+ */
+typedef int (*fir_kernel_t)(const float in[], float out[], const int n_out, const int factor, const float taps[], const int n_taps);
+
+static int fir_kernel_none(const float[], float out[], const int n_out, const int, const float[], const int) {
+    for(int i = 0; i < n_out; i++)
+        out[i] = 0.0;
+
+    return 0;
+}
+
+#ifdef CPU_X86
+__attribute__((target("sse2")))
+static int fir_kernel_sse2(const float in[], float out[], const int n_out, const int factor, const float taps[], const int n_taps) {
+    const int n_vec = n_taps - (n_taps % 8);
+    for(int i = 0; i < n_out; i++) {
+        const float *const x = in + (i * factor);
+
+        // Two accumulators hide the latency of the additions
+        __m128 acc_a = _mm_setzero_ps();
+        __m128 acc_b = _mm_setzero_ps();
+        for(int j = 0; j < n_vec; j += 8) {
+            acc_a = _mm_add_ps(acc_a, _mm_mul_ps(_mm_loadu_ps(taps + j), _mm_loadu_ps(x + j)));
+            acc_b = _mm_add_ps(acc_b, _mm_mul_ps(_mm_loadu_ps(taps + j + 4), _mm_loadu_ps(x + j + 4)));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, _mm_add_ps(acc_a, acc_b));
+        out[i] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    return n_vec;
+}
+
+__attribute__((target("avx2")))
+static int fir_kernel_avx2(const float in[], float out[], const int n_out, const int factor, const float taps[], const int n_taps) {
+    const int n_vec = n_taps - (n_taps % 16);
+    for(int i = 0; i < n_out; i++) {
+        const float *const x = in + (i * factor);
+
+        __m256 acc_a = _mm256_setzero_ps();
+        __m256 acc_b = _mm256_setzero_ps();
+        for(int j = 0; j < n_vec; j += 16) {
+            acc_a = _mm256_add_ps(acc_a, _mm256_mul_ps(_mm256_loadu_ps(taps + j), _mm256_loadu_ps(x + j)));
+            acc_b = _mm256_add_ps(acc_b, _mm256_mul_ps(_mm256_loadu_ps(taps + j + 8), _mm256_loadu_ps(x + j + 8)));
+        }
+
+        const __m256 acc = _mm256_add_ps(acc_a, acc_b);
+        const __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        float lanes[4];
+        _mm_storeu_ps(lanes, sum);
+        out[i] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    return n_vec;
+}
+#endif  // CPU_X86
+
+
+static const fir_kernel_t fir_kernel = select_cpu_kernel<fir_kernel_t>({
+    #ifdef CPU_X86
+    {CpuFeature::avx2, fir_kernel_avx2},
+    {CpuFeature::sse2, fir_kernel_sse2}
+    #endif
+}, fir_kernel_none);
+
+
+Decimator::Decimator(const int _factor, const int _n_out) : factor(_factor), n_out(_n_out) {
+    n_taps = (DECIMATION_TAPS_PER_PHASE * factor) + 1;  // Odd, so the filter delay is a whole number of samples
+
+    double *window;
+    try {
+        taps = new float[n_taps];
+        window = new double[n_taps];
+    }
+    catch(const std::bad_alloc &e) {
+        error("Failed to allocate decimation filter (" + STR(e.what()) + ")");
+        exit(EXIT_FAILURE);
+    }
+
+    // The window functions are periodic, so a window of n_taps - 1 samples is symmetric over n_taps samples
+    blackman_window(window, n_taps - 1);
+    window[n_taps - 1] = window[0];
+
+    // Windowed sinc with the cutoff relative to the input sample rate; normalized for unit gain at DC
+    const double cutoff = DECIMATION_CUTOFF / (2.0 * factor);
+    const int center = (n_taps - 1) / 2;
+    double sum = 0.0;
+    for(int i = 0; i < n_taps; i++) {
+        const double x = i - center;
+        const double sinc = i == center ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+        window[i] *= sinc;
+        sum += window[i];
+    }
+    for(int i = 0; i < n_taps; i++)
+        taps[i] = window[i] / sum;
+
+    delete[] window;
+}
+
+Decimator::~Decimator() {
+    delete[] taps;
+}
+
+
+void Decimator::decimate(const float in[], float out[]) const {
+    const int n_done = fir_kernel(in, out, n_out, factor, taps, n_taps);
+
+    for(int i = 0; i < n_out; i++) {
+        const float *const x = in + (i * factor);
+        for(int j = n_done; j < n_taps; j++)
+            out[i] += taps[j] * x[j];
+    }
+}
+
+
+void Decimator::scale_events(NoteEvents &note_events) const {
+    for(NoteEvent &note_event : note_events) {
+        note_event.length *= factor;
+        note_event.offset = get_delay() + (note_event.offset * factor);
+    }
+}
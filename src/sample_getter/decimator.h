@@ -0,0 +1,40 @@
+#ifndef DIGISTRING_SAMPLE_GETTER_DECIMATOR_H
+#define DIGISTRING_SAMPLE_GETTER_DECIMATOR_H
+
+
+#include "note.h"
+
+/* Anti-aliased decimation of captured frames, between the SampleGetter and the Estimator
+ * A linear phase low-pass FIR filter (Blackman windowed sinc) is only evaluated at the kept outputs, which is the polyphase form of decimation
+ * Every frame is decimated on its own, so overlapping, seeking and skipping frames don't disturb the filter
+ * The first output needs n_taps - 1 samples of history, so input frames are (n_out - 1) * factor + n_taps samples long
+ * Vectorized using SSE2/AVX2 kernels, depending on what the CPU supports (detected at start-up)
+ */
+class Decimator {
+    public:
+        Decimator(const int _factor, const int _n_out);
+        ~Decimator();
+
+        // Number of samples of an input frame
+        int get_in_size() const {return ((n_out - 1) * factor) + n_taps;};
+        // Position of output sample i in the input frame is get_delay() + (i * factor)
+        int get_delay() const {return (n_taps - 1) / 2;};
+
+        // Filters get_in_size() samples of in into n_out samples in out
+        void decimate(const float in[], float out[]) const;
+
+        // Estimators give lengths and offsets in decimated samples; converts them to samples of the input frame
+        void scale_events(NoteEvents &note_events) const;
+
+
+    private:
+        const int factor;
+        const int n_out;
+
+        // Symmetric, so the taps don't have to be reversed for the convolution
+        int n_taps;
+        float *taps;
+};
+
+
+#endif  // DIGISTRING_SAMPLE_GETTER_DECIMATOR_H
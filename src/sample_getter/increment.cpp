@@ -3,7 +3,7 @@
 #include "error.h"
 #include "config/transcription.h"
 
-#include <cstring>
+#include <algorithm>  // std::clamp(), std::min(), std::max()
 
 
 Increment::Increment(const int input_buffer_size) : SampleGetter(input_buffer_size) {
@@ -25,7 +25,10 @@ bool Increment::is_audio_recording_device() const {
 }
 
 
-void Increment::calc_and_paste_nonblocking_overlap(float *&in, int &n_samples) {
+int Increment::calc_n_new_samples(const int n_samples) const {
+    if constexpr(!DO_OVERLAP_NONBLOCK)
+        return SampleGetter::calc_n_new_samples(n_samples);
+
     static int samples_queued = 1;
 
     const int min_overlap_samples = std::max((int)((double)n_samples * MIN_NONBLOCK_OVERLAP_RATIO), 1);
@@ -34,45 +37,15 @@ void Increment::calc_and_paste_nonblocking_overlap(float *&in, int &n_samples) {
     const int n_overlap = std::clamp(n_samples - samples_queued, min_overlap_samples, max_overlap_samples);
     debug("Overlapping " + STR(n_overlap) + " samples");
 
-    // Paste the end of overlap_buffer to start of 'in'
-    memcpy(in, overlap_buffer + (n_samples - n_overlap), n_overlap * sizeof(float));
-
-    // Calculate the remainder of the buffer
-    in += n_overlap;
-    n_samples -= n_overlap;
-
     samples_queued += 1;
-}
-
-
-void Increment::copy_nonblocking_overlap(float *const in, const int n_samples) {
-    memcpy(overlap_buffer, in, n_samples * sizeof(float));
 
-    // Possible optimization if n_samples is the same every call
-    // const int max_overlap_samples = std::min((int)((double)n_samples * MAX_NONBLOCK_OVERLAP_RATIO), n_samples - 1);
-    // memcpy(overlap_buffer + (n_samples - max_overlap_samples), in + (n_samples - max_overlap_samples), max_overlap_samples * sizeof(float));
+    return n_samples - n_overlap;
 }
 
 
-int Increment::get_frame(float *const in, const int n_samples) {
-    int overlap_n_samples = n_samples;
-    float *overlap_in = in;
-    if constexpr(DO_OVERLAP)
-        calc_and_paste_overlap(overlap_in, overlap_n_samples);
-    else if constexpr(DO_OVERLAP_NONBLOCK)
-        calc_and_paste_nonblocking_overlap(overlap_in, overlap_n_samples);
-
-
-    for(int i = 0; i < overlap_n_samples; i++)
-        overlap_in[i] = played_samples + i;
-
-    played_samples += overlap_n_samples;
-
-
-    if constexpr(DO_OVERLAP)
-        copy_overlap(in, n_samples);
-    else if constexpr(DO_OVERLAP_NONBLOCK)
-        copy_nonblocking_overlap(in, n_samples);
+void Increment::get_new_samples(float *const out, const int n_samples) {
+    for(int i = 0; i < n_samples; i++)
+        out[i] = played_samples + i;
 
-    return overlap_n_samples;
+    played_samples += n_samples;
 }
@@ -17,14 +17,12 @@ class Increment : public SampleGetter {
 
         bool is_audio_recording_device() const override;
 
-        void calc_and_paste_nonblocking_overlap(float *&in, int &n_samples);
-        void copy_nonblocking_overlap(float *const in, const int n_samples);
-
-        int get_frame(float *const in, const int n_samples);
-
 
     private:
-        //
+        // Nonblocking overlap is simulated by having one more sample queued every frame
+        int calc_n_new_samples(const int n_samples) const override;
+
+        void get_new_samples(float *const out, const int n_samples) override;
 };
 
 
@@ -0,0 +1,63 @@
+#include "mirrored_ring.h"
+
+#include "error.h"
+
+#include <sys/mman.h>  // memfd_create(), mmap(), munmap()
+#include <unistd.h>  // ftruncate(), close(), sysconf()
+
+#include <cstring>  // strerror()
+#include <cerrno>
+#include <cstdint>
+#include <string>
+
+
+MirroredRing::MirroredRing(const int min_capacity) {
+    // Both mappings have to start at a page boundary
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    map_size = (((min_capacity * sizeof(float)) + page_size - 1) / page_size) * page_size;
+    capacity = map_size / sizeof(float);
+    write_pos = 0;
+    n_written = 0;
+
+    // Anonymous file holding the samples; it is removed when the last mapping is unmapped
+    const int fd = memfd_create("digistring_ring", MFD_CLOEXEC);
+    if(fd == -1) {
+        error("Failed to create file for the overlap ring (" + std::string(strerror(errno)) + ")");
+        exit(EXIT_FAILURE);
+    }
+    if(ftruncate(fd, map_size) == -1) {
+        error("Failed to size the overlap ring to " + STR(map_size) + " bytes (" + strerror(errno) + ")");
+        exit(EXIT_FAILURE);
+    }
+
+    // Reserve address space for both mappings, then map the file over both halves
+    uint8_t *const reserved = (uint8_t*)mmap(NULL, 2 * map_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(reserved == MAP_FAILED) {
+        error("Failed to reserve address space for the overlap ring (" + std::string(strerror(errno)) + ")");
+        exit(EXIT_FAILURE);
+    }
+    for(int i = 0; i < 2; i++) {
+        if(mmap(reserved + (i * map_size), map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+            error("Failed to map the overlap ring (" + std::string(strerror(errno)) + ")");
+            exit(EXIT_FAILURE);
+        }
+    }
+    close(fd);  // The mappings keep the file alive
+
+    buffer = (float*)reserved;
+}
+
+MirroredRing::~MirroredRing() {
+    munmap(buffer, 2 * map_size);
+}
+
+
+void MirroredRing::advance(const int n_samples) {
+    write_pos = (write_pos + n_samples) % capacity;
+    n_written += n_samples;
+}
+
+
+const float *MirroredRing::latest(const int n_samples) const {
+    return buffer + ((write_pos + capacity - n_samples) % capacity);
+}
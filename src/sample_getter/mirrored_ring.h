@@ -0,0 +1,41 @@
+#ifndef DIGISTRING_SAMPLE_GETTER_MIRRORED_RING_H
+#define DIGISTRING_SAMPLE_GETTER_MIRRORED_RING_H
+
+
+#include <cstddef>  // size_t
+
+
+/* Ring buffer of samples which is mapped twice after itself in virtual memory
+ * Both mappings share the same physical pages, so every range of at most capacity samples starting in the first mapping is contiguous
+ * This way, samples are written once and the latest samples can be read as one array, without copying them to the start of a buffer
+ * The ring starts filled with zeros
+ */
+class MirroredRing {
+    public:
+        MirroredRing(const int min_capacity);  // In samples; rounded up to a multiple of the page size
+        ~MirroredRing();
+
+        int get_capacity() const {return capacity;};
+
+        // Space for up to capacity new samples; they are part of the ring after calling advance()
+        float *write_ptr() const {return buffer + write_pos;};
+        void advance(const int n_samples);
+
+        // The latest n_samples (at most capacity) samples, oldest first; overwritten by subsequent writes
+        const float *latest(const int n_samples) const;
+
+        // Total number of samples written since construction
+        long get_n_written() const {return n_written;};
+
+
+    private:
+        int capacity;
+        size_t map_size;  // Of a single mapping, in bytes
+        float *buffer;
+
+        int write_pos;
+        long n_written;
+};
+
+
+#endif  // DIGISTRING_SAMPLE_GETTER_MIRRORED_RING_H
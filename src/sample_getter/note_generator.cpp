@@ -5,6 +5,7 @@
 
 #include "config/audio.h"
 #include "config/transcription.h"
+#include "config/transcription_params.h"
 
 #include <cmath>
 #include <iostream>
@@ -47,24 +48,12 @@ void NoteGenerator::pitch_down() {
 }
 
 
-int NoteGenerator::get_frame(float *const in, const int n_samples) {
-    int overlap_n_samples = n_samples;
-    float *overlap_in = in;
-    if constexpr(DO_OVERLAP)
-        calc_and_paste_overlap(overlap_in, overlap_n_samples);
+void NoteGenerator::get_new_samples(float *const out, const int n_samples) {
+    const double offset = (last_phase * ((double)params.sample_rate / generated_note.freq));
+    for(int i = 0; i < n_samples; i++)
+        out[i] = sinf((2.0 * M_PI * ((double)i + offset) * generated_note.freq) / (double)params.sample_rate);
 
+    last_phase = fmod(last_phase + (generated_note.freq / ((double)params.sample_rate / (double)n_samples)), 1.0);
 
-    const double offset = (last_phase * ((double)SAMPLE_RATE / generated_note.freq));
-    for(int i = 0; i < overlap_n_samples; i++)
-        overlap_in[i] = sinf((2.0 * M_PI * ((double)i + offset) * generated_note.freq) / (double)SAMPLE_RATE);
-
-    last_phase = fmod(last_phase + (generated_note.freq / ((double)SAMPLE_RATE / (double)overlap_n_samples)), 1.0);
-
-    played_samples += overlap_n_samples;
-
-
-    if constexpr(DO_OVERLAP)
-        copy_overlap(in, n_samples);
-
-    return overlap_n_samples;
+    played_samples += n_samples;
 }
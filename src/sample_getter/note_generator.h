@@ -18,14 +18,15 @@ class NoteGenerator : public SampleGetter {
         void pitch_up() override;
         void pitch_down() override;
 
-        int get_frame(float *const in, const int n_samples);
-
 
     private:
         Note generated_note;
         int generated_note_number;
 
         double last_phase;
+
+
+        void get_new_samples(float *const out, const int n_samples) override;
 };
 
 
@@ -0,0 +1,272 @@
+#include "pcm_convert.h"
+
+#include "cpu_dispatch.h"
+
+#include <cstring>  // memcpy()
+#include <cstdint>
+#include <limits>
+#include <bit>  // std::endian
+
+
+/* Integers are divided by their maximum value
+ * 16 and 24 bit integers are exact in float, so dividing in float gives the same result as dividing in double and rounding to float
+ * (double has more than twice the precision of float, so the double rounding can't change the result)
+ * 32 bit integers aren't exact in float, so they are divided in double
+ * The SIMD kernels avoid the slow double division: with y = s * 2^-31, s / (2^31 - 1) = y + y * 2^-31 + ..., and y + y * 2^-31 (both exact, one rounding)
+ * rounds to the same float for every 32 bit integer (checked exhaustively)
+ */
+constexpr float S16_MAX = std::numeric_limits<int16_t>::max();
+constexpr float S24_MAX = (1 << 23) - 1;
+constexpr double S32_MAX = std::numeric_limits<int32_t>::max();
+constexpr double S32_INV_RANGE = 1.0 / 2147483648.0;  // 2^-31
+
+
+int pcm_sample_size(const PcmFormat format) {
+    switch(format) {
+        case PcmFormat::s16:
+            return 2;
+
+        case PcmFormat::s24:
+            return 3;
+
+        case PcmFormat::s24_32:
+        case PcmFormat::s32:
+        case PcmFormat::f32:
+            return 4;
+    }
+
+    return 4;  // Unreachable, but silences warning
+}
+
+
+// Reads are byte-wise, so the scalar code also works on big endian hosts
+static inline uint32_t read_u32(const uint8_t *const p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Shift into the top of an int32_t and back to sign extend
+static inline int32_t read_s16(const uint8_t *const p) {
+    return (int32_t)((uint32_t)p[0] << 16 | (uint32_t)p[1] << 24) >> 16;
+}
+
+static inline int32_t read_s24(const uint8_t *const p) {
+    return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+}
+
+
+// stride is the distance between two samples of the channel in bytes
+static void convert_scalar(float out[], const uint8_t in[], const int n_samples, const PcmFormat format, const int stride) {
+    switch(format) {
+        case PcmFormat::s16:
+            for(int i = 0; i < n_samples; i++)
+                out[i] = (float)read_s16(in + ((long)i * stride)) / S16_MAX;
+            break;
+
+        case PcmFormat::s24:
+        case PcmFormat::s24_32:
+            for(int i = 0; i < n_samples; i++)
+                out[i] = (float)read_s24(in + ((long)i * stride)) / S24_MAX;
+            break;
+
+        case PcmFormat::s32:
+            for(int i = 0; i < n_samples; i++)
+                out[i] = (float)((double)(int32_t)read_u32(in + ((long)i * stride)) / S32_MAX);
+            break;
+
+        case PcmFormat::f32:
+            for(int i = 0; i < n_samples; i++) {
+                const uint32_t bits = read_u32(in + ((long)i * stride));
+                memcpy(&out[i], &bits, sizeof(float));
+            }
+            break;
+    }
+}
+
+
+/* SIMD kernels
+ * Kernels convert the first n samples they can vectorize and return n, so the caller finishes the tail with scalar code
+ * See cpu_dispatch.h for how the kernel is selected
+ */
+typedef int (*pcm_kernel_t)(float out[], const uint8_t in[], const int n_samples, const PcmFormat format, const int stride);
+
+static int pcm_kernel_none(float[], const uint8_t[], const int, const PcmFormat, const int) {
+    return 0;
+}
+
+#ifdef CPU_X86
+// SSE2 has no byte shuffles or gathers, so only contiguous 16 and 32 bit integers are vectorized
+__attribute__((target("sse2")))
+static int pcm_kernel_sse2(float out[], const uint8_t in[], const int n_samples, const PcmFormat format, const int stride) {
+    if(stride != pcm_sample_size(format))
+        return 0;
+
+    switch(format) {
+        case PcmFormat::s16: {
+            const __m128 scale = _mm_set1_ps(S16_MAX);
+            const int n_vec = n_samples - (n_samples % 8);
+            for(int i = 0; i < n_vec; i += 8) {
+                const __m128i v = _mm_loadu_si128((const __m128i *)(in + (2 * i)));
+
+                // Interleave with itself and shift back to sign extend to 32 bit
+                const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                _mm_storeu_ps(out + i, _mm_div_ps(_mm_cvtepi32_ps(lo), scale));
+                _mm_storeu_ps(out + i + 4, _mm_div_ps(_mm_cvtepi32_ps(hi), scale));
+            }
+            return n_vec;
+        }
+
+        case PcmFormat::s24_32: {
+            const __m128 scale = _mm_set1_ps(S24_MAX);
+            const int n_vec = n_samples - (n_samples % 4);
+            for(int i = 0; i < n_vec; i += 4) {
+                const __m128i v = _mm_srai_epi32(_mm_slli_epi32(_mm_loadu_si128((const __m128i *)(in + (4 * i))), 8), 8);
+                _mm_storeu_ps(out + i, _mm_div_ps(_mm_cvtepi32_ps(v), scale));
+            }
+            return n_vec;
+        }
+
+        case PcmFormat::s32: {
+            const __m128d inv_range = _mm_set1_pd(S32_INV_RANGE);
+            const int n_vec = n_samples - (n_samples % 4);
+            for(int i = 0; i < n_vec; i += 4) {
+                const __m128i v = _mm_loadu_si128((const __m128i *)(in + (4 * i)));
+                const __m128d y_lo = _mm_mul_pd(_mm_cvtepi32_pd(v), inv_range);
+                const __m128d y_hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))), inv_range);
+                const __m128d lo = _mm_add_pd(y_lo, _mm_mul_pd(y_lo, inv_range));
+                const __m128d hi = _mm_add_pd(y_hi, _mm_mul_pd(y_hi, inv_range));
+                _mm_storeu_ps(out + i, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+            }
+            return n_vec;
+        }
+
+        case PcmFormat::s24:
+        case PcmFormat::f32:
+            return 0;
+    }
+
+    return 0;
+}
+
+// Stores 8 integers with the format's scaling
+__attribute__((target("avx2")))
+static inline void store_avx2(float out[], const __m256i v, const PcmFormat format) {
+    switch(format) {
+        case PcmFormat::s16:
+            _mm256_storeu_ps(out, _mm256_div_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(S16_MAX)));
+            break;
+
+        case PcmFormat::s24:
+        case PcmFormat::s24_32:
+            _mm256_storeu_ps(out, _mm256_div_ps(_mm256_cvtepi32_ps(v), _mm256_set1_ps(S24_MAX)));
+            break;
+
+        case PcmFormat::s32: {
+            const __m256d inv_range = _mm256_set1_pd(S32_INV_RANGE);
+            const __m256d y_lo = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), inv_range);
+            const __m256d y_hi = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), inv_range);
+            const __m256d lo = _mm256_add_pd(y_lo, _mm256_mul_pd(y_lo, inv_range));
+            const __m256d hi = _mm256_add_pd(y_hi, _mm256_mul_pd(y_hi, inv_range));
+            _mm256_storeu_ps(out, _mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo)));
+            break;
+        }
+
+        case PcmFormat::f32:
+            _mm256_storeu_ps(out, _mm256_castsi256_ps(v));
+            break;
+    }
+}
+
+// Contiguous and stereo 16 and 32 bit samples are loaded directly; other layouts (packed 24 bit and more channels) are gathered
+__attribute__((target("avx2")))
+static int pcm_kernel_avx2(float out[], const uint8_t in[], const int n_samples, const PcmFormat format, const int stride) {
+    const int sample_size = pcm_sample_size(format);
+
+    // Blocks read whole vectors, so a block's last load may read past its own samples; stop while these bytes are still in the buffer
+    const long in_size = ((long)(n_samples - 1) * stride) + sample_size;
+
+    if(stride == sample_size && format == PcmFormat::s16) {
+        const int n_vec = n_samples - (n_samples % 8);
+        for(int i = 0; i < n_vec; i += 8)
+            store_avx2(out + i, _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(in + (2 * i)))), format);
+        return n_vec;
+    }
+    if(stride == sample_size && (format == PcmFormat::s24_32 || format == PcmFormat::s32)) {
+        const int n_vec = n_samples - (n_samples % 8);
+        for(int i = 0; i < n_vec; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(in + (4 * i)));
+            if(format == PcmFormat::s24_32)
+                v = _mm256_srai_epi32(_mm256_slli_epi32(v, 8), 8);
+            store_avx2(out + i, v, format);
+        }
+        return n_vec;
+    }
+
+    // Stereo 16 bit: in points at the channel, so it is in the low half of every 32 bit lane
+    if(stride == 4 && format == PcmFormat::s16) {
+        int i = 0;
+        for(; i + 8 <= n_samples && ((long)(i + 8) * 4) <= in_size; i += 8) {
+            const __m256i v = _mm256_loadu_si256((const __m256i *)(in + (4 * i)));
+            store_avx2(out + i, _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16), format);
+        }
+        return i;
+    }
+
+    // Stereo 32 bit: the channel is in the even lanes of two loads of 4 frames each
+    if(stride == 8 && sample_size == 4) {
+        const __m256i even_lanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+        int i = 0;
+        for(; i + 8 <= n_samples && ((long)(i + 8) * 8) <= in_size; i += 8) {
+            const __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(in + (8 * i))), even_lanes);
+            const __m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)(in + (8 * i) + 32)), even_lanes);
+            __m256i v = _mm256_permute2x128_si256(a, b, 0x20);
+            if(format == PcmFormat::s24_32)
+                v = _mm256_srai_epi32(_mm256_slli_epi32(v, 8), 8);
+            store_avx2(out + i, v, format);
+        }
+        return i;
+    }
+
+    // Every lane gathers 4 bytes
+    const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(stride));
+    int i = 0;
+    for(; i + 8 <= n_samples && ((long)(i + 7) * stride) + 4 <= in_size; i += 8) {
+        __m256i v = _mm256_i32gather_epi32((const int *)(in + ((long)i * stride)), offsets, 1);
+        if(format == PcmFormat::s16)
+            v = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+        else if(format == PcmFormat::s24 || format == PcmFormat::s24_32)
+            v = _mm256_srai_epi32(_mm256_slli_epi32(v, 8), 8);
+        store_avx2(out + i, v, format);
+    }
+    return i;
+}
+#endif  // CPU_X86
+
+
+static const pcm_kernel_t pcm_kernel = select_cpu_kernel<pcm_kernel_t>({
+    #ifdef CPU_X86
+    {CpuFeature::avx2, pcm_kernel_avx2},
+    {CpuFeature::sse2, pcm_kernel_sse2}
+    #endif
+}, pcm_kernel_none);
+
+
+void pcm_to_float(float out[], const uint8_t in[], const int n_samples, const PcmFormat format, const int n_channels/* = 1*/, const int channel/* = 0*/) {
+    const int sample_size = pcm_sample_size(format);
+    const int stride = n_channels * sample_size;
+    const uint8_t *const channel_in = in + (channel * sample_size);
+
+    // Contiguous floats only have to be copied
+    if(format == PcmFormat::f32 && n_channels == 1 && std::endian::native == std::endian::little) {
+        memcpy(out, channel_in, n_samples * sizeof(float));
+        return;
+    }
+
+    const int n_done = pcm_kernel(out, channel_in, n_samples, format, stride);
+    convert_scalar(out + n_done, channel_in + ((long)n_done * stride), n_samples - n_done, format, stride);
+}
+
+void pcm_to_float_scalar(float out[], const uint8_t in[], const int n_samples, const PcmFormat format, const int n_channels/* = 1*/, const int channel/* = 0*/) {
+    const int sample_size = pcm_sample_size(format);
+    convert_scalar(out, in + (channel * sample_size), n_samples, format, n_channels * sample_size);
+}
@@ -0,0 +1,30 @@
+#ifndef DIGISTRING_SAMPLE_GETTER_PCM_CONVERT_H
+#define DIGISTRING_SAMPLE_GETTER_PCM_CONVERT_H
+
+
+#include <cstdint>
+
+
+// Little endian PCM sample formats
+enum class PcmFormat {
+    s16,     // 16 bit signed integers
+    s24,     // 24 bit signed integers packed in 3 bytes
+    s24_32,  // 24 bit signed integers in the low 3 bytes of 4 byte containers
+    s32,     // 32 bit signed integers
+    f32      // 32 bit floats
+};
+
+
+// Size of one sample in bytes
+int pcm_sample_size(const PcmFormat format);
+
+// Converts n_samples samples of one channel of interleaved PCM to floats; integers are scaled by their maximum value
+// Vectorized using SSE2/AVX2 kernels, depending on what the CPU supports (detected at start-up)
+// Results are bit-identical to converting through a double division
+void pcm_to_float(float out[], const uint8_t in[], const int n_samples, const PcmFormat format, const int n_channels = 1, const int channel = 0);
+
+// Same conversion without the SIMD kernels (reference for benchmarking)
+void pcm_to_float_scalar(float out[], const uint8_t in[], const int n_samples, const PcmFormat format, const int n_channels = 1, const int channel = 0);
+
+
+#endif  // DIGISTRING_SAMPLE_GETTER_PCM_CONVERT_H
@@ -2,7 +2,10 @@
 #define DIGISTRING_SAMPLE_GETTER_SAMPLE_GETTER_H
 
 
+#include "mirrored_ring.h"
+
 #include "config/transcription.h"
+#include "config/pipeline.h"
 
 #include <map>
 #include <string>
@@ -47,27 +50,33 @@ class SampleGetter {
         virtual void pitch_up() {};
         virtual void pitch_down() {};
 
-        // Has to increment played_samples
-        // Returns number of newly read samples (which may be less than n_samples due to input buffer overlapping)
-        virtual int get_frame(float *const in, const int n_samples) = 0;
-
-        /* Overlap function
+        /* Frames are assembled in a mirrored ring, so every sample is written once and overlapping frames need no copies
          * Note that n_samples has to be the same every call for overlapping to work!
-         * Furthermore, n_samples should never exceed overlap_buffer_size, given on construction */
-        // Pastes the overlapping part of previous frame and sets 'in' to new start and sets n_samples to remaining space
-        // By changing the passed arguments, the caller can continue working with in and n_samples as if nothing happened
-        void calc_and_paste_overlap(float *&in, int &n_samples) const;
+         * Furthermore, n_samples should never exceed the input_buffer_size given on construction */
+        // Reads the new samples of the next frame of n_samples samples
+        // Returns number of newly read samples (which may be less than n_samples due to input buffer overlapping)
+        int next_frame(const int n_samples);
+        // Contiguous view of the last frame read; valid till the ring wraps around (see get_ring_position())
+        const float *get_frame_view(const int n_samples) const;
 
-        // Copy the part of in that will overlap with the next frame (end) to the overlap_buffer
-        void copy_overlap(float *const in, const int n_samples);
+        // Number of samples written to the ring so far (reading frames and seeking write to it)
+        // A view stays valid as long as less than get_ring_capacity() - n_samples samples are written after it
+        long get_ring_position() const {return ring.get_n_written();};
+        int get_ring_capacity() const {return ring.get_capacity();};
 
 
     protected:
         long played_samples;
 
-        // Only available if DO_OVERLAP or DO_OVERLAP_NON_BLOCK
-        float *overlap_buffer;
-        int overlap_buffer_size;
+        // Overlapping frames share the samples in this ring
+        MirroredRing ring;
+        const int frame_buffer_size;  // Size of a frame; used by AudioFile to refill the overlap after seeking
+
+        // Number of new samples in the next frame of n_samples samples; the rest overlaps with the previous frame
+        virtual int calc_n_new_samples(const int n_samples) const;
+
+        // Has to write the n_samples new samples of the next frame to out and increment played_samples
+        virtual void get_new_samples(float *const out, const int n_samples) = 0;
 };
 
 
@@ -18,13 +18,14 @@ class WaveGenerator : public SampleGetter {
         void pitch_up() override;
         void pitch_down() override;
 
-        int get_frame(float *const in, const int n_samples);
-
 
     private:
         double generated_wave_freq;
 
         double last_phase;
+
+
+        void get_new_samples(float *const out, const int n_samples) override;
 };
 
 
@@ -0,0 +1,152 @@
+#ifndef DIGISTRING_SPSC_QUEUE_H
+#define DIGISTRING_SPSC_QUEUE_H
+
+
+#include "workspace_arena.h"  // CACHE_LINE_SIZE
+
+#include <atomic>
+#include <vector>
+#include <algorithm>  // std::max()
+
+
+// Depth statistics, sampled on every push, and back-pressure counters
+struct QueueStats {
+    unsigned long pushed = 0;
+    unsigned long depth_sum = 0;
+    int max_depth = 0;
+    unsigned long dropped = 0;
+    unsigned long coalesced = 0;
+
+    double mean_depth() const {return pushed == 0 ? 0.0 : (double)depth_sum / (double)pushed;};
+};
+
+
+/* Bounded lock-free queue between exactly one producer thread and one consumer thread
+ * Items are preallocated slots which are filled and read in place, so pushing and popping never allocates or copies
+ * The producer fills write_slot() and publishes it with push(); the consumer reads read_slot() and releases it with pop()
+ * Blocking waits use futexes (atomic wait/notify), which cost no system call if the other side isn't waiting
+ */
+template<typename T>
+class SPSCQueue {
+    public:
+        SPSCQueue(const int _capacity) : capacity(std::max(_capacity, 1)), slots(capacity), head(0), tail(0), signal(0), closed(false) {};
+
+        int get_capacity() const {return capacity;};
+
+        // For initializing the slots before the producer and consumer start
+        T &get_slot(const int i) {return slots[i];};
+
+        // Number of published, not yet popped items (exact when called by the producer or consumer)
+        int size() const {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        };
+
+
+        /* Producer */
+        // The slot to fill next, or nullptr if the queue is full
+        // Returns the same slot until push(), so a slot which couldn't be published can be refilled
+        T *write_slot() {
+            const unsigned long h = head.load(std::memory_order_relaxed);
+            if(h - tail.load(std::memory_order_acquire) == (unsigned long)capacity)
+                return nullptr;
+
+            return &slots[h % capacity];
+        };
+
+        // Publishes the slot returned by write_slot(); should only be called if write_slot() didn't return nullptr
+        void push() {
+            const unsigned long h = head.load(std::memory_order_relaxed) + 1;
+            head.store(h, std::memory_order_release);
+
+            const int depth = h - tail.load(std::memory_order_acquire);
+            stats.pushed++;
+            stats.depth_sum += depth;
+            stats.max_depth = std::max(stats.max_depth, depth);
+
+            signal.fetch_add(1, std::memory_order_release);
+            signal.notify_one();
+        };
+
+        // Blocks until write_slot() returns a slot
+        T *wait_write_slot() {
+            T *slot;
+            while((slot = write_slot()) == nullptr) {
+                const unsigned long t = tail.load(std::memory_order_acquire);
+                if(head.load(std::memory_order_relaxed) - t == (unsigned long)capacity)
+                    tail.wait(t, std::memory_order_acquire);
+            }
+
+            return slot;
+        };
+
+        // No items will be pushed anymore; wakes a waiting consumer
+        void close() {
+            closed.store(true, std::memory_order_release);
+            signal.fetch_add(1, std::memory_order_release);
+            signal.notify_all();
+        };
+
+
+        /* Consumer */
+        // The oldest published item, or nullptr if the queue is empty
+        T *read_slot() {
+            const unsigned long t = tail.load(std::memory_order_relaxed);
+            if(head.load(std::memory_order_acquire) == t)
+                return nullptr;
+
+            return &slots[t % capacity];
+        };
+
+        // Releases the slot returned by read_slot(); should only be called if read_slot() didn't return nullptr
+        void pop() {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            tail.notify_one();
+        };
+
+        // Blocks until an item is available; returns nullptr if the queue is closed and empty
+        T *wait_read_slot() {
+            T *slot;
+            while((slot = read_slot()) == nullptr) {
+                const unsigned int s = signal.load(std::memory_order_acquire);
+                if(read_slot() != nullptr)
+                    continue;
+                if(closed.load(std::memory_order_acquire))
+                    return nullptr;
+
+                signal.wait(s, std::memory_order_acquire);
+            }
+
+            return slot;
+        };
+
+        // True if the producer closed the queue and all items are popped
+        bool is_finished() const {
+            return closed.load(std::memory_order_acquire) && size() == 0;
+        };
+
+
+        // Counted by whichever side applies the back-pressure policy
+        void count_dropped() {stats.dropped++;};
+        void count_coalesced(const int n) {stats.coalesced += n;};
+
+        // Not synchronized, so only read when the producer and consumer are done
+        const QueueStats &get_stats() const {return stats;};
+
+
+    private:
+        const int capacity;
+        std::vector<T> slots;
+
+        // Written by producer and consumer respectively; on their own cache lines to prevent false sharing
+        alignas(CACHE_LINE_SIZE) std::atomic<unsigned long> head;
+        alignas(CACHE_LINE_SIZE) std::atomic<unsigned long> tail;
+
+        // Changed on every push and on close, as the consumer waits on it
+        alignas(CACHE_LINE_SIZE) std::atomic<unsigned int> signal;
+        std::atomic<bool> closed;
+
+        QueueStats stats;
+};
+
+
+#endif  // DIGISTRING_SPSC_QUEUE_H
@@ -2,11 +2,12 @@
 
 #include "error.h"
 #include "config/audio.h"
+#include "config/transcription_params.h"
 
 #include "SDL2/SDL.h"
 
 
-Synth::Synth(const int _sample_rate /*= SAMPLE_RATE*/) {
+Synth::Synth(const int _sample_rate /*= params.sample_rate*/) {
     max_amp = 0.0;
 
     sample_rate = _sample_rate;
@@ -4,6 +4,7 @@
 
 #include "note.h"
 #include "config/audio.h"
+#include "config/transcription_params.h"
 
 #include <map>
 #include <string>
@@ -34,7 +35,7 @@ const std::map<const Synths, const std::string> synth_description = {
 
 class Synth {
     public:
-        Synth(const int _sample_rate = SAMPLE_RATE);
+        Synth(const int _sample_rate = params.sample_rate);
         virtual ~Synth();
 
         virtual void synthesize(const NoteEvents &notes, float *const synth_buffer, const int n_samples, const double volume = 1.0) = 0;
@@ -0,0 +1,186 @@
+#include "worker_pool.h"
+
+#include "error.h"
+
+#include <omp.h>  // omp_get_num_procs()
+
+#ifdef __linux__
+#include <pthread.h>  // pthread_setaffinity_np()
+#include <sched.h>  // cpu_set_t
+#endif
+
+#include <algorithm>  // std::clamp(), std::min(), std::max()
+#include <mutex>
+
+
+// Hint to the CPU that we are spinning, which frees resources for the hyper-thread sibling
+static inline void spin_pause() {
+    #if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+    #endif
+}
+
+
+static std::atomic<int> thread_limit = 0;
+
+void set_worker_pool_thread_limit(const int max_threads) {
+    thread_limit = std::max(max_threads, 0);
+}
+
+
+// CPUs a worker of any pool is pinned to
+static std::mutex pinned_cpus_mutex;
+static std::vector<bool> cpu_pinned;
+
+// Returns the first CPU from first_cpu on (wrapping around) which isn't pinned yet, or -1 if all are
+static int reserve_cpu(const int first_cpu, const int n_procs) {
+    std::lock_guard<std::mutex> lock(pinned_cpus_mutex);
+    if((int)cpu_pinned.size() < n_procs)
+        cpu_pinned.resize(n_procs, false);
+
+    for(int i = 0; i < n_procs; i++) {
+        const int cpu = (first_cpu + i) % n_procs;
+        if(!cpu_pinned[cpu]) {
+            cpu_pinned[cpu] = true;
+            return cpu;
+        }
+    }
+
+    return -1;
+}
+
+static void release_cpus(const std::vector<int> &cpus) {
+    std::lock_guard<std::mutex> lock(pinned_cpus_mutex);
+    for(const int cpu : cpus)
+        cpu_pinned[cpu] = false;
+}
+
+
+WorkerPool::WorkerPool(const int _n_threads, const bool pin, const int first_cpu, const int _spin_iterations, const int _min_chunk_size)
+        : spin_iterations(_spin_iterations), min_chunk_size(std::max(_min_chunk_size, 1)), generation(0), remaining(0), stop(false) {
+    // Only use half of total cores by default, as using all cores may cause latency spikes on systems running other software
+    const int n_procs = omp_get_num_procs();
+    n_threads = _n_threads > 0 ? _n_threads : n_procs / 2;
+    if(thread_limit > 0)
+        n_threads = std::min(n_threads, thread_limit.load());
+    n_threads = std::clamp(n_threads, 1, MAX_WORKER_POOL_THREADS);
+
+    job = nullptr;
+    job_ctx = nullptr;
+    job_n = 0;
+    job_n_chunks = 0;
+
+    for(int i = 1; i < n_threads; i++) {
+        #ifdef __linux__
+        int cpu = -1;
+        if(pin) {
+            cpu = reserve_cpu(std::max(first_cpu, 0), n_procs);
+            if(cpu == -1) {
+                // Sharing a CPU with a worker of another pool makes both spin on it
+                warning("Worker pool uses " + STR(i) + " instead of " + STR(n_threads) + " threads, as all CPUs are pinned by other worker pools");
+                n_threads = i;
+                break;
+            }
+            pinned_cpus.push_back(cpu);
+        }
+        #endif
+
+        threads.emplace_back(&WorkerPool::worker, this, i);
+
+        if(pin) {
+            #ifdef __linux__
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(cpu, &cpu_set);
+            if(pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpu_set_t), &cpu_set) != 0)
+                warning("Failed to pin worker thread " + STR(i) + " to CPU " + STR(cpu));
+            #else
+            (void)first_cpu;
+            #endif
+        }
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    stop.store(true, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+
+    for(auto &thread : threads)
+        thread.join();
+
+    release_cpus(pinned_cpus);
+}
+
+
+void WorkerPool::run_chunk(const int chunk) {
+    if(chunk >= job_n_chunks)
+        return;
+
+    const int begin = (int)(((long)job_n * chunk) / job_n_chunks);
+    const int end = (int)(((long)job_n * (chunk + 1)) / job_n_chunks);
+    job(job_ctx, begin, end, chunk);
+}
+
+
+void WorkerPool::worker(const int id) {
+    unsigned int seen = 0;
+
+    while(true) {
+        // Spin first, as waking a parked thread costs a system call and scheduling latency
+        unsigned int cur = generation.load(std::memory_order_acquire);
+        for(int i = 0; cur == seen && i < spin_iterations; i++) {
+            spin_pause();
+            cur = generation.load(std::memory_order_acquire);
+        }
+
+        // Park
+        if(cur == seen) {
+            generation.wait(seen, std::memory_order_acquire);
+            continue;
+        }
+        seen = cur;
+
+        if(stop.load(std::memory_order_relaxed))
+            return;
+
+        run_chunk(id);
+
+        if(remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            remaining.notify_one();
+    }
+}
+
+
+void WorkerPool::run_job(const int n, const job_func_t func, const void *const ctx) {
+    if(n <= 0)
+        return;
+
+    const int n_chunks = std::clamp(n / min_chunk_size, 1, n_threads);
+    if(n_chunks == 1 || n_threads == 1) {
+        func(ctx, 0, n, 0);
+        return;
+    }
+
+    job = func;
+    job_ctx = ctx;
+    job_n = n;
+    job_n_chunks = n_chunks;
+
+    // Every worker checks in, also the ones without a chunk, so no worker can still be reading the job when it is replaced
+    remaining.store(n_threads - 1, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+
+    run_chunk(0);
+
+    int left = remaining.load(std::memory_order_acquire);
+    for(int i = 0; left != 0 && i < spin_iterations; i++) {
+        spin_pause();
+        left = remaining.load(std::memory_order_acquire);
+    }
+    while(left != 0) {
+        remaining.wait(left, std::memory_order_acquire);
+        left = remaining.load(std::memory_order_acquire);
+    }
+}
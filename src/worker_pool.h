@@ -0,0 +1,74 @@
+#ifndef DIGISTRING_WORKER_POOL_H
+#define DIGISTRING_WORKER_POOL_H
+
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+// Upper bound on the number of threads, so kernels can keep per chunk results on the stack
+constexpr int MAX_WORKER_POOL_THREADS = 64;
+
+// Caps the number of threads of pools created after this call; 0 removes the cap
+// For running many estimators in parallel (batch transcription), as their pools would oversubscribe the cores
+void set_worker_pool_thread_limit(const int max_threads);
+
+
+/* Persistent pool of (optionally core pinned) worker threads for the parallel estimation kernels
+ * Workers spin for a while after finishing a job, as the next kernel of the same frame follows shortly
+ * If no job arrives while spinning, workers park (futex wait) until the next job
+ * The calling thread works on the first chunk, so a pool of n threads only creates n - 1 threads
+ * Pinned workers get a CPU no worker of another pool is pinned to, so pools of estimators running at the same time (ensemble) don't spin on the same CPUs
+ * If all CPUs are pinned by other pools, the pool creates fewer threads
+ */
+class WorkerPool {
+    public:
+        // n_threads <= 0 uses half of the available cores
+        // Pinned workers take the first CPUs from first_cpu on (wrapping around) which aren't pinned by other pools
+        WorkerPool(const int n_threads, const bool pin, const int first_cpu, const int spin_iterations, const int min_chunk_size);
+        ~WorkerPool();
+
+        int get_n_threads() const {return n_threads;};
+
+        // Splits [0, n) in at most get_n_threads() contiguous chunks of at least min_chunk_size elements
+        // Calls func(begin, end, chunk) for every chunk and returns when all chunks are done
+        // Chunk i always covers a lower range than chunk i + 1
+        // A template instead of std::function, as std::function allocates for lambdas with many captures
+        template<typename Func>
+        void parallel_for(const int n, const Func &func) {
+            run_job(n, [](const void *const f, const int begin, const int end, const int chunk) {
+                (*static_cast<const Func *>(f))(begin, end, chunk);
+            }, &func);
+        }
+
+
+    private:
+        int n_threads;
+        const int spin_iterations;
+        const int min_chunk_size;
+
+        std::vector<std::thread> threads;
+        std::vector<int> pinned_cpus;  // Released on destruction
+
+        // Incremented for every new job; workers wait on changes
+        std::atomic<unsigned int> generation;
+        // Number of workers still working on the current job
+        std::atomic<int> remaining;
+        std::atomic<bool> stop;
+
+        // Current job
+        typedef void (*job_func_t)(const void *const, const int, const int, const int);
+        job_func_t job;
+        const void *job_ctx;
+        int job_n;
+        int job_n_chunks;
+
+
+        void run_job(const int n, const job_func_t func, const void *const ctx);
+        void worker(const int id);
+        void run_chunk(const int chunk);
+};
+
+
+#endif  // DIGISTRING_WORKER_POOL_H
@@ -0,0 +1,62 @@
+#include "workspace_arena.h"
+
+#include "error.h"
+
+#include <cstdlib>  // std::aligned_alloc(), std::free()
+#include <memory_resource>
+#include <algorithm>  // std::max()
+
+
+// Rounds up to a multiple of CACHE_LINE_SIZE
+static inline size_t cache_line_ceil(const size_t n) {
+    return ((n + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE) * CACHE_LINE_SIZE;
+}
+
+
+WorkspaceArena::WorkspaceArena(const size_t _capacity) : capacity(cache_line_ceil(_capacity)), used(0), high_water_mark(0), warned_full(false) {
+    buffer = static_cast<char *>(std::aligned_alloc(CACHE_LINE_SIZE, std::max(capacity, CACHE_LINE_SIZE)));
+    if(buffer == NULL) {
+        error("Failed to allocate workspace arena of " + STR(capacity) + " bytes");
+        exit(EXIT_FAILURE);
+    }
+}
+
+WorkspaceArena::~WorkspaceArena() {
+    std::free(buffer);
+}
+
+
+void WorkspaceArena::reset() {
+    used = 0;
+}
+
+
+void *WorkspaceArena::do_allocate(const size_t bytes, const size_t alignment) {
+    // Every allocation starts on a new cache line, so buffers used by different threads never share a cache line
+    if(alignment > CACHE_LINE_SIZE || used + bytes > capacity) {
+        if(!warned_full) {
+            warning("Workspace arena of " + STR(capacity) + " bytes is too small; falling back to heap allocations");
+            warned_full = true;
+        }
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void *const p = buffer + used;
+    used += cache_line_ceil(bytes);
+    high_water_mark = std::max(high_water_mark, used);
+    return p;
+}
+
+
+void WorkspaceArena::do_deallocate(void *p, const size_t bytes, const size_t alignment) {
+    // Memory from the arena is freed on reset()
+    if(p >= buffer && p < buffer + capacity)
+        return;
+
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+
+bool WorkspaceArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept {
+    return this == &other;
+}
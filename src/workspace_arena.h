@@ -0,0 +1,49 @@
+#ifndef DIGISTRING_WORKSPACE_ARENA_H
+#define DIGISTRING_WORKSPACE_ARENA_H
+
+
+#include <cstddef>  // size_t
+#include <memory_resource>
+
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+
+/* Pre-sized memory for the per frame buffers of an estimator, so the estimator doesn't allocate in its steady state
+ * Allocations are cache line aligned and bump a pointer through one block; freeing is a no-op
+ * reset() frees everything at once, so should be called at the start of every frame, when nothing allocated in the previous frame is alive
+ * Also a memory resource, so std::pmr containers (like NoteSet) can draw from it
+ * If the arena is full, allocations fall back to the heap with a warning
+ */
+class WorkspaceArena : public std::pmr::memory_resource {
+    public:
+        WorkspaceArena(const size_t capacity);  // In bytes
+        ~WorkspaceArena();
+
+        // Uninitialized, cache line aligned space for n elements, valid till the next reset()
+        template<typename T>
+        T *alloc(const size_t n) {
+            return static_cast<T *>(allocate(n * sizeof(T), alignof(T)));
+        }
+
+        void reset();
+
+        size_t get_capacity() const {return capacity;};
+        // Maximum number of bytes in use between two resets
+        size_t get_high_water_mark() const {return high_water_mark;};
+
+
+    private:
+        char *buffer;
+        const size_t capacity;
+        size_t used;
+        size_t high_water_mark;
+        bool warned_full;
+
+        void *do_allocate(const size_t bytes, const size_t alignment) override;
+        void do_deallocate(void *p, const size_t bytes, const size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+};
+
+
+#endif  // DIGISTRING_WORKSPACE_ARENA_H